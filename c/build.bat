@@ -1,2 +1,5 @@
 @echo off
-cl /W4 /std:c11 /Zi /nologo src/sdc_parser.c test/test.c /Fe:test_parser.exe
\ No newline at end of file
+cl /W4 /std:c11 /Zi /nologo src/sdc_parser.c test/test.c /Fe:test_parser.exe
+cl /W4 /std:c11 /O2 /nologo src/sdc_parser.c test/bench.c /Fe:bench_parser.exe
+cl /W4 /std:c11 /O2 /nologo src/sdc_parser.c test/stress.c /Fe:stress_parser.exe
+cl /W4 /std:c11 /O2 /nologo src/sdc_parser.c tools/sdc_lsp.c /Fe:sdc_lsp.exe
\ No newline at end of file
@@ -0,0 +1,7 @@
+@echo off
+rem WebAssembly module for js/sdc_wasm.js (needs clang and wasm-ld from LLVM)
+clang --target=wasm32 -std=c11 -O2 -nostdlib -ffreestanding -mbulk-memory -DSDC_NO_FILESYSTEM -Iwasm/include ^
+    -Wl,--no-entry -Wl,-z,stack-size=1048576 ^
+    -Wl,--export=sdc_parse_string -Wl,--export=sdc_free -Wl,--export=sdc_get_error ^
+    -Wl,--export=sdc_get_chapter -Wl,--export=sdc_get_group -Wl,--export=sdc_get_node ^
+    src/sdc_parser.c wasm/sdc_libc.c wasm/sdc_wasm.c -o ../js/sdc_parser.wasm
@@ -6,7 +6,45 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <limits.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Directory access for the parse cache. Builds with SDC_NO_FILESYSTEM
+// (the WebAssembly module) leave out sdc_parse_file and the cache.
+#ifndef SDC_NO_FILESYSTEM
+#include <time.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
+#endif
+#endif
+
+// Vectorized scanning: AVX2 when the compiler targets it, otherwise SSE2
+// (always present on x86-64). Other targets use the scalar loops only.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SDC_SIMD_AVX2
+#define SDC_SIMD_WIDTH 32
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SDC_SIMD_SSE2
+#define SDC_SIMD_WIDTH 16
+#endif
+
+// Bytes requested from a reader per refill
+#ifndef SDC_READ_CHUNK
+#define SDC_READ_CHUNK (64 * 1024)
+#endif
 
 // ============================================================================
 // INTERNAL STRUCTURES (not exposed in header)
@@ -88,9 +126,8 @@ typedef enum {
 
 typedef struct {
     TokenType type;
-    char* lexeme;
-    int line;
-    int column;
+    size_t offset;  // Byte offset of the token in the source
+    size_t length;  // Length of the token text in the source
     
     union {
         long number;
@@ -100,57 +137,137 @@ typedef struct {
     } value;
 } Token;
 
+// The lexer scans a window of the input: bytes [base, base + (end - source))
+// followed by a '\0' sentinel. Strings are one window covering the whole
+// source. Readers refill the window in chunks, dropping bytes the parser
+// can no longer ask about.
 typedef struct {
     const char* source;
+    const char* end;
     const char* start;
     const char* current;
-    int line;
-    int column;
+    size_t base;         // Input offset of source[0]
+    
+    // Streaming input (read is NULL for strings)
+    SdcReadFn read;
+    void* user;
+    char* buffer;
+    size_t capacity;
+    size_t keep;         // Oldest input offset the parser may still refer to
+    bool eof;
+    bool read_error;
     
-    Token* tokens;
-    int token_count;
-    int token_capacity;
+    // Newlines in the dropped part of the input, for diagnostics
+    size_t dropped_lines;
+    size_t line_start;   // Input offset of the first line that is still buffered
 } Lexer;
 
+// Offsets of every newline in a source, built only when a diagnostic
+// needs a line and column
+typedef struct {
+    size_t* offsets;
+    size_t count;
+    bool built;
+} LineIndex;
+
+// Top-level block of a retained source. Chapters, groups and nodes can be
+// reparsed on their own; sections (states, tags, characters, ...) fill
+// story-wide tables and are only parsed with the whole source.
+typedef enum {
+    BLOCK_CHAPTER,
+    BLOCK_GROUP,
+    BLOCK_NODE,
+    BLOCK_SECTION
+} BlockKind;
+
+typedef struct {
+    BlockKind kind;
+    SdcSize index;   // Position in chapters, groups or nodes
+    size_t start;    // Offset of the first token
+    size_t end;      // Offset just past the last token
+} SourceBlock;
+
+// Parse error left in a retained source by a failed reparse. It stands
+// until a reparse of text covering its span succeeds.
+typedef struct {
+    size_t start;     // Span of the text that failed to parse
+    size_t end;
+    size_t offset;    // Offset of the token it was reported at
+    size_t line;      // Line of that token, 0 if it has no position
+    char* message;    // As reported at the time
+} SourceError;
+
+// Source of an editable story. The text lives in a gap buffer with the
+// gap at the last edit, so consecutive keystrokes move few bytes.
+struct SdcSource {
+    char* text;
+    size_t length;        // Text length, excluding the gap
+    size_t gap;           // Offset of the gap in the text
+    size_t gap_length;
+    
+    SourceBlock* blocks;  // In file order
+    SdcSize block_count;
+    SdcSize block_capacity;
+    
+    SourceError* errors;  // Unresolved, in file order
+    SdcSize error_count;
+    SdcSize error_capacity;
+    bool full_pending;    // A whole-source reparse failed and is owed
+};
+
+// Tokens are pulled from the lexer one at a time into a small ring that
+// holds the lookahead token and the ones consumed just before it. A token
+// returned by advance_parser stays valid for TOKEN_RING_SIZE - 1 more
+// advances, which covers every 'name: @type(id)' style lookback.
+#define TOKEN_RING_SIZE 8
+
 typedef struct {
-    Token* tokens;
-    int token_count;
-    int current;
+    Lexer lexer;
+    Token ring[TOKEN_RING_SIZE];
+    size_t current;     // Number of tokens consumed so far
+    bool lexer_error;   // An invalid token ended the input early
+    
+    LineIndex lines;
+    
+    // Content hashes of the block and timeline item being parsed. Consumed
+    // tokens go into the first `hashing` of them.
+    uint64_t hashes[2];
+    int hashing;
     
     StoryData* story;
+    SdcSource* source;  // Receives top-level block spans when set
     char* error_message;
 } Parser;
 
 // Global error message storage
 static char* last_error = NULL;
+static size_t last_error_offset = 0;
+static size_t last_error_line = 0;   // 0 when the error has no position
 
 // ============================================================================
 // LEXER IMPLEMENTATION
 // ============================================================================
 
-static Lexer* lexer_create(const char* source) {
-    Lexer* lexer = (Lexer*)malloc(sizeof(Lexer));
+static void lexer_init(Lexer* lexer, const char* source, size_t length) {
+    memset(lexer, 0, sizeof(Lexer));
     lexer->source = source;
+    lexer->end = source + length;
     lexer->start = source;
     lexer->current = source;
-    lexer->line = 1;
-    lexer->column = 1;
-    lexer->token_count = 0;
-    lexer->token_capacity = 256;
-    lexer->tokens = (Token*)malloc(sizeof(Token) * lexer->token_capacity);
-    return lexer;
+    lexer->eof = true;
 }
 
-static void lexer_free(Lexer* lexer) {
-    for (int i = 0; i < lexer->token_count; i++) {
-        free(lexer->tokens[i].lexeme);
-        if (lexer->tokens[i].type == TOKEN_STRING || 
-            lexer->tokens[i].type == TOKEN_CODE_BLOCK) {
-            free(lexer->tokens[i].value.string);
-        }
-    }
-    free(lexer->tokens);
-    free(lexer);
+static void lexer_init_reader(Lexer* lexer, SdcReadFn read, void* user) {
+    memset(lexer, 0, sizeof(Lexer));
+    lexer->read = read;
+    lexer->user = user;
+    lexer->capacity = SDC_READ_CHUNK + 1;
+    lexer->buffer = (char*)malloc(lexer->capacity);
+    lexer->buffer[0] = '\0';
+    lexer->source = lexer->buffer;
+    lexer->end = lexer->buffer;
+    lexer->start = lexer->buffer;
+    lexer->current = lexer->buffer;
 }
 
 static inline bool is_at_end(Lexer* lexer) {
@@ -158,9 +275,7 @@ static inline bool is_at_end(Lexer* lexer) {
 }
 
 static inline char advance(Lexer* lexer) {
-    char c = *lexer->current++;
-    lexer->column++;
-    return c;
+    return *lexer->current++;
 }
 
 static inline char peek(Lexer* lexer) {
@@ -172,48 +287,134 @@ static inline char peek_next(Lexer* lexer) {
     return lexer->current[1];
 }
 
-static void add_token(Lexer* lexer, TokenType type) {
-    if (lexer->token_count >= lexer->token_capacity) {
-        lexer->token_capacity *= 2;
-        lexer->tokens = (Token*)realloc(lexer->tokens, 
-                                       sizeof(Token) * lexer->token_capacity);
-    }
-    
+static Token make_token(Lexer* lexer, TokenType type) {
     Token token;
     token.type = type;
-    token.line = lexer->line;
-    token.column = lexer->column - (int)(lexer->current - lexer->start);
+    token.offset = lexer->base + (size_t)(lexer->start - lexer->source);
+    token.length = (size_t)(lexer->current - lexer->start);
+    token.value.string = NULL;
+    return token;
+}
+
+// ----------------------------------------------------------------------------
+// Bulk scanning
+// ----------------------------------------------------------------------------
+
+static inline int lowest_bit(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline int bit_count(uint32_t mask) {
+#if defined(_MSC_VER)
+    // __popcnt needs a CPU check on MSVC, so count portably
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    return (int)((((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#else
+    return __builtin_popcount(mask);
+#endif
+}
+
+#if defined(SDC_SIMD_AVX2)
+typedef __m256i sdc_block;
+#define SDC_BLOCK_ALL 0xFFFFFFFFu
+
+static inline sdc_block block_load(const char* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+}
+
+static inline uint32_t block_match(sdc_block block, char c) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c)));
+}
+#elif defined(SDC_SIMD_SSE2)
+typedef __m128i sdc_block;
+#define SDC_BLOCK_ALL 0xFFFFu
+
+static inline sdc_block block_load(const char* p) {
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline uint32_t block_match(sdc_block block, char c) {
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c)));
+}
+#endif
+
+// Move to the next occurrence of stop (or the end of input)
+static void scan_to_byte(Lexer* lexer, char stop) {
+    const char* p = lexer->current;
+    
+#if defined(SDC_SIMD_WIDTH)
+    while (lexer->end - p >= SDC_SIMD_WIDTH) {
+        uint32_t hits = block_match(block_load(p), stop);
+        if (hits) {
+            lexer->current = p + lowest_bit(hits);
+            return;
+        }
+        p += SDC_SIMD_WIDTH;
+    }
+#endif
+    
+    while (p < lexer->end && *p != stop) {
+        p++;
+    }
+    lexer->current = p;
+}
+
+// Number of newlines in [p, p + length)
+static size_t count_newlines(const char* p, size_t length) {
+    size_t count = 0;
+    size_t i = 0;
+    
+#if defined(SDC_SIMD_WIDTH)
+    for (; length - i >= SDC_SIMD_WIDTH; i += SDC_SIMD_WIDTH) {
+        count += (size_t)bit_count(block_match(block_load(p + i), '\n'));
+    }
+#endif
+    
+    for (; i < length; i++) {
+        if (p[i] == '\n') count++;
+    }
+    return count;
+}
+
+// Move past spaces, tabs, carriage returns and newlines
+static void skip_blanks(Lexer* lexer) {
+    const char* p = lexer->current;
     
-    int length = (int)(lexer->current - lexer->start);
-    token.lexeme = (char*)malloc(length + 1);
-    memcpy(token.lexeme, lexer->start, length);
-    token.lexeme[length] = '\0';
+#if defined(SDC_SIMD_WIDTH)
+    while (lexer->end - p >= SDC_SIMD_WIDTH) {
+        sdc_block block = block_load(p);
+        uint32_t blanks = block_match(block, ' ') | block_match(block, '\n') |
+                          block_match(block, '\t') | block_match(block, '\r');
+        uint32_t other = ~blanks & SDC_BLOCK_ALL;
+        
+        if (other) {
+            lexer->current = p + lowest_bit(other);
+            return;
+        }
+        p += SDC_SIMD_WIDTH;
+    }
+#endif
     
-    lexer->tokens[lexer->token_count++] = token;
+    while (p < lexer->end) {
+        char c = *p;
+        if (c != ' ' && c != '\n' && c != '\t' && c != '\r') break;
+        p++;
+    }
+    lexer->current = p;
 }
 
 static void skip_whitespace(Lexer* lexer) {
     while (true) {
-        char c = peek(lexer);
-        switch (c) {
-            case ' ':
-            case '\r':
-            case '\t':
-                advance(lexer);
-                break;
-            case '\n':
-                lexer->line++;
-                lexer->column = 0;
-                advance(lexer);
-                break;
-            case '#':
-                while (peek(lexer) != '\n' && !is_at_end(lexer)) {
-                    advance(lexer);
-                }
-                break;
-            default:
-                return;
-        }
+        skip_blanks(lexer);
+        if (peek(lexer) != '#') return;
+        scan_to_byte(lexer, '\n');  // Comment runs to end of line
     }
 }
 
@@ -225,52 +426,57 @@ static bool is_alpha(char c) {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
 }
 
-static void scan_string(Lexer* lexer) {
+static Token scan_string(Lexer* lexer) {
     advance(lexer);  // Consume opening quote
     const char* string_start = lexer->current;
     
-    while (peek(lexer) != '"' && !is_at_end(lexer)) {
-        if (peek(lexer) == '\n') {
-            lexer->line++;
-            lexer->column = 0;
-        }
-        advance(lexer);
-    }
+    scan_to_byte(lexer, '"');
     
     if (is_at_end(lexer)) {
-        add_token(lexer, TOKEN_ERROR);
-        return;
+        return make_token(lexer, TOKEN_ERROR);
     }
     
-    int length = (int)(lexer->current - string_start);
+    size_t length = (size_t)(lexer->current - string_start);
     advance(lexer);  // Consume closing quote
     
-    Token token;
-    token.type = TOKEN_STRING;
-    token.line = lexer->line;
-    token.column = lexer->column - (int)(lexer->current - lexer->start);
-    
-    int lexeme_length = (int)(lexer->current - lexer->start);
-    token.lexeme = (char*)malloc(lexeme_length + 1);
-    memcpy(token.lexeme, lexer->start, lexeme_length);
-    token.lexeme[lexeme_length] = '\0';
-    
+    Token token = make_token(lexer, TOKEN_STRING);
     token.value.string = (char*)malloc(length + 1);
     memcpy(token.value.string, string_start, length);
     token.value.string[length] = '\0';
+    return token;
+}
+
+// Powers of ten that are exact in a double, for the fast float path
+static const double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+
+// strtod on a copy of the literal: the source may continue with text
+// strtod would accept, like the 'e5' in '1.5e5' that lexes separately
+static double slow_float(const char* start, size_t length) {
+    char buffer[64];
+    char* text = length < sizeof(buffer) ? buffer : (char*)malloc(length + 1);
+    memcpy(text, start, length);
+    text[length] = '\0';
     
-    if (lexer->token_count >= lexer->token_capacity) {
-        lexer->token_capacity *= 2;
-        lexer->tokens = (Token*)realloc(lexer->tokens, 
-                                       sizeof(Token) * lexer->token_capacity);
-    }
-    
-    lexer->tokens[lexer->token_count++] = token;
+    double value = strtod(text, NULL);
+    if (text != buffer) free(text);
+    return value;
 }
 
-static void scan_number(Lexer* lexer) {
+// Scans the literal and converts it in the same pass. Integers accumulate
+// digit by digit; floats with at most 2^53 as the digit string and 22
+// fraction digits are one correctly rounded division of two exact values
+// (Clinger's fast path). Anything longer falls back to strtod.
+static Token scan_number(Lexer* lexer) {
     bool is_float = false;
     bool is_negative = false;
+    bool overflow = false;
+    uint64_t mantissa = 0;
+    int fraction_digits = 0;
     
     // Handle negative sign
     if (peek(lexer) == '-') {
@@ -279,7 +485,9 @@ static void scan_number(Lexer* lexer) {
     }
     
     while (is_digit(peek(lexer))) {
-        advance(lexer);
+        unsigned digit = (unsigned)(advance(lexer) - '0');
+        if (mantissa > (UINT64_MAX - digit) / 10) overflow = true;
+        else mantissa = mantissa * 10 + digit;
     }
     
     // Check for decimal point
@@ -288,309 +496,380 @@ static void scan_number(Lexer* lexer) {
         advance(lexer);  // Consume '.'
         
         while (is_digit(peek(lexer))) {
-            advance(lexer);
+            unsigned digit = (unsigned)(advance(lexer) - '0');
+            if (mantissa > (UINT64_MAX - digit) / 10) overflow = true;
+            else mantissa = mantissa * 10 + digit;
+            fraction_digits++;
         }
     }
     
-    Token token;
-    token.type = is_float ? TOKEN_FLOAT : TOKEN_NUMBER;
-    token.line = lexer->line;
-    token.column = lexer->column - (int)(lexer->current - lexer->start);
-    
-    int length = (int)(lexer->current - lexer->start);
-    token.lexeme = (char*)malloc(length + 1);
-    memcpy(token.lexeme, lexer->start, length);
-    token.lexeme[length] = '\0';
+    Token token = make_token(lexer, is_float ? TOKEN_FLOAT : TOKEN_NUMBER);
     
     if (is_float) {
-        token.value.float_number = strtod(token.lexeme, NULL);
+        if (!overflow && mantissa <= MAX_EXACT_MANTISSA && fraction_digits <= 22) {
+            double value = (double)mantissa / exact_powers_of_ten[fraction_digits];
+            token.value.float_number = is_negative ? -value : value;
+        } else {
+            token.value.float_number = slow_float(lexer->start, token.length);
+        }
     } else {
-        token.value.number = strtol(token.lexeme, NULL, 10);
-    }
-    
-    if (lexer->token_count >= lexer->token_capacity) {
-        lexer->token_capacity *= 2;
-        lexer->tokens = (Token*)realloc(lexer->tokens, 
-                                       sizeof(Token) * lexer->token_capacity);
+        // Saturate like strtol
+        uint64_t limit = is_negative ? (uint64_t)LONG_MAX + 1 : (uint64_t)LONG_MAX;
+        if (overflow || mantissa > limit) mantissa = limit;
+        if (!is_negative) token.value.number = (long)mantissa;
+        else if (mantissa == 0) token.value.number = 0;
+        else token.value.number = -(long)(mantissa - 1) - 1;
     }
     
-    lexer->tokens[lexer->token_count++] = token;
+    return token;
+}
+
+// BEGIN GENERATED KEYWORDS
+// Generated by tools/gen_keywords.js from tools/keywords.txt; do not edit.
+
+#define KEYWORD_COUNT 48
+#define KEYWORD_BUCKETS 24
+
+
+static const uint8_t keyword_displacements[KEYWORD_BUCKETS] = {
+    0, 6, 14, 16, 0, 10, 11, 9, 8, 15, 17, 0, 3, 1, 7, 0,
+    0, 0, 5, 1, 5, 48, 0, 44
+};
+
+static const struct {
+    const char* text;
+    int length;
+    TokenType type;
+} keyword_table[KEYWORD_COUNT] = {
+    { "enter", 5, TOKEN_ENTER },
+    { "points", 6, TOKEN_POINTS },
+    { "end", 3, TOKEN_END },
+    { "nodes", 5, TOKEN_NODES },
+    { "values", 6, TOKEN_VALUES },
+    { "content", 7, TOKEN_CONTENT },
+    { "character", 9, TOKEN_CHARACTER },
+    { "biography", 9, TOKEN_BIOGRAPHY },
+    { "set", 3, TOKEN_SET },
+    { "start", 5, TOKEN_START },
+    { "name", 4, TOKEN_NAME },
+    { "dialogue", 8, TOKEN_DIALOGUE },
+    { "choice", 6, TOKEN_CHOICE },
+    { "tags", 4, TOKEN_TAGS },
+    { "reference", 9, TOKEN_REFERENCE },
+    { "true", 4, TOKEN_TRUE },
+    { "keys", 4, TOKEN_KEYS },
+    { "replace", 7, TOKEN_REPLACE },
+    { "group", 5, TOKEN_GROUP },
+    { "states", 6, TOKEN_STATES },
+    { "false", 5, TOKEN_FALSE },
+    { "structure", 9, TOKEN_STRUCTURE },
+    { "linked-lists", 12, TOKEN_LINKED_LISTS },
+    { "text", 4, TOKEN_TEXT },
+    { "exit", 4, TOKEN_EXIT },
+    { "default", 7, TOKEN_DEFAULT },
+    { "type", 4, TOKEN_TYPE },
+    { "amount", 6, TOKEN_AMOUNT },
+    { "description", 11, TOKEN_DESCRIPTION },
+    { "choices", 7, TOKEN_CHOICES },
+    { "chapter", 7, TOKEN_CHAPTER },
+    { "global-vars", 11, TOKEN_GLOBAL_VARS },
+    { "characters", 10, TOKEN_CHARACTERS },
+    { "data", 4, TOKEN_DATA },
+    { "node", 4, TOKEN_NODE },
+    { "value", 5, TOKEN_VALUE },
+    { "title", 5, TOKEN_TITLE },
+    { "parent-group", 12, TOKEN_PARENT_GROUP },
+    { "increment", 9, TOKEN_INCREMENT },
+    { "linked-list-data", 16, TOKEN_LINKED_LIST_DATA },
+    { "timeline", 8, TOKEN_TIMELINE },
+    { "action", 6, TOKEN_ACTION },
+    { "color", 5, TOKEN_COLOR },
+    { "toggle", 6, TOKEN_TOGGLE },
+    { "goto", 4, TOKEN_GOTO },
+    { "append", 6, TOKEN_APPEND },
+    { "event", 5, TOKEN_EVENT },
+    { "scope", 5, TOKEN_SCOPE }
+};
+
+static inline uint64_t keyword_load64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t keyword_load32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-static TokenType check_keyword(const char* start, int length, 
-                               const char* rest, TokenType type) {
-    if (memcmp(start, rest, length) == 0) {
-        return type;
+// Compare with overlapping head/tail loads that stay inside both strings
+static inline bool keyword_equal(const char* a, const char* b, int length) {
+    if (length >= 8) {
+        for (int i = 0; i + 8 < length; i += 8) {
+            if (keyword_load64(a + i) != keyword_load64(b + i)) return false;
+        }
+        return keyword_load64(a + length - 8) == keyword_load64(b + length - 8);
     }
-    return TOKEN_IDENTIFIER;
+    if (length >= 4) {
+        return keyword_load32(a) == keyword_load32(b) &&
+               keyword_load32(a + length - 4) == keyword_load32(b + length - 4);
+    }
+    for (int i = 0; i < length; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
 }
 
-static TokenType identifier_type(Lexer* lexer) {
-    int length = (int)(lexer->current - lexer->start);
-    const char* start = lexer->start;
+// Classify an identifier of length >= 1
+static TokenType keyword_lookup(const char* start, int length) {
+    uint32_t key = (uint32_t)(unsigned char)start[0] |
+                   (uint32_t)(length > 1 ? (unsigned char)start[1] : 0) << 8 |
+                   (uint32_t)(unsigned char)start[length - 1] << 16 |
+                   (uint32_t)(length & 0xFF) << 24;
+    uint32_t spread = (key ^ keyword_displacements[key % KEYWORD_BUCKETS]) * 0x9e3779b1u;
+    uint32_t slot = (uint32_t)(((uint64_t)spread * KEYWORD_COUNT) >> 32);
     
-    switch (start[0]) {
-        case 'a':
-            if (length == 6) {
-                if (memcmp(start, "action", 6) == 0) return TOKEN_ACTION;
-                if (memcmp(start, "amount", 6) == 0) return TOKEN_AMOUNT;
-                if (memcmp(start, "append", 6) == 0) return TOKEN_APPEND;
-            }
-            break;
-        case 'b':
-            if (length == 9) return check_keyword(start, 9, "biography", TOKEN_BIOGRAPHY);
-            break;
-        case 'c':
-            if (length == 7) {
-                if (memcmp(start, "chapter", 7) == 0) return TOKEN_CHAPTER;
-                if (memcmp(start, "content", 7) == 0) return TOKEN_CONTENT;
-                if (memcmp(start, "choices", 7) == 0) return TOKEN_CHOICES;
-            }
-            if (length == 6) return check_keyword(start, 6, "choice", TOKEN_CHOICE);
-            if (length == 5) return check_keyword(start, 5, "color", TOKEN_COLOR);
-            if (length == 9) return check_keyword(start, 9, "character", TOKEN_CHARACTER);
-            if (length == 10) return check_keyword(start, 10, "characters", TOKEN_CHARACTERS);
-            break;
-        case 'd':
-            if (length == 8) return check_keyword(start, 8, "dialogue", TOKEN_DIALOGUE);
-            if (length == 7) return check_keyword(start, 7, "default", TOKEN_DEFAULT);
-            if (length == 4) return check_keyword(start, 4, "data", TOKEN_DATA);
-            if (length == 11) return check_keyword(start, 11, "description", TOKEN_DESCRIPTION);
-            break;
-        case 'e':
-            if (length == 5) {
-                if (memcmp(start, "enter", 5) == 0) return TOKEN_ENTER;
-                if (memcmp(start, "event", 5) == 0) return TOKEN_EVENT;
-            }
-            if (length == 4) return check_keyword(start, 4, "exit", TOKEN_EXIT);
-            if (length == 3) return check_keyword(start, 3, "end", TOKEN_END);
-            break;
-        case 'f':
-            if (length == 5) return check_keyword(start, 5, "false", TOKEN_FALSE);
-            break;
-        case 'g':
-            if (length == 11) return check_keyword(start, 11, "global-vars", TOKEN_GLOBAL_VARS);
-            if (length == 5) return check_keyword(start, 5, "group", TOKEN_GROUP);
-            if (length == 4) return check_keyword(start, 4, "goto", TOKEN_GOTO);
-            break;
-        case 'i':
-            if (length == 9) return check_keyword(start, 9, "increment", TOKEN_INCREMENT);
-            break;
-        case 'k':
-            if (length == 4) return check_keyword(start, 4, "keys", TOKEN_KEYS);
-            break;
-        case 'l':
-            if (length == 12) return check_keyword(start, 12, "linked-lists", TOKEN_LINKED_LISTS);
-            if (length == 16) return check_keyword(start, 16, "linked-list-data", TOKEN_LINKED_LIST_DATA);
-            break;
-        case 'n':
-            if (length == 4) {
-                if (memcmp(start, "name", 4) == 0) return TOKEN_NAME;
-                if (memcmp(start, "node", 4) == 0) return TOKEN_NODE;
-            }
-            if (length == 5) return check_keyword(start, 5, "nodes", TOKEN_NODES);
-            break;
-        case 'p':
-            if (length == 6) return check_keyword(start, 6, "points", TOKEN_POINTS);
-            if (length == 12) return check_keyword(start, 11, "parent-group", TOKEN_PARENT_GROUP);
-            break;
-        case 'r':
-            if (length == 9) return check_keyword(start, 9, "reference", TOKEN_REFERENCE);
-            if (length == 7) return check_keyword(start, 7, "replace", TOKEN_REPLACE);
-            break;
-        case 's':
-            if (length == 6) return check_keyword(start, 6, "states", TOKEN_STATES);
-            if (length == 5) {
-                if (memcmp(start, "start", 5) == 0) return TOKEN_START;
-                if (memcmp(start, "scope", 5) == 0) return TOKEN_SCOPE;
-            }
-            if (length == 9) return check_keyword(start, 9, "structure", TOKEN_STRUCTURE);
-            if (length == 3) return check_keyword(start, 3, "set", TOKEN_SET);
-            break;
-        case 't':
-            if (length == 4) {
-                if (memcmp(start, "tags", 4) == 0) return TOKEN_TAGS;
-                if (memcmp(start, "type", 4) == 0) return TOKEN_TYPE;
-                if (memcmp(start, "text", 4) == 0) return TOKEN_TEXT;
-                if (memcmp(start, "true", 4) == 0) return TOKEN_TRUE;
-            }
-            if (length == 5) {
-                if (memcmp(start, "title", 5) == 0) return TOKEN_TITLE;
-            }
-            if (length == 6) return check_keyword(start, 6, "toggle", TOKEN_TOGGLE);
-            if (length == 8) return check_keyword(start, 8, "timeline", TOKEN_TIMELINE);
-            break;
-        case 'v':
-            if (length == 5) return check_keyword(start, 5, "value", TOKEN_VALUE);
-            if (length == 6) return check_keyword(start, 6, "values", TOKEN_VALUES);
-            break;
+    if (keyword_table[slot].length == length &&
+        keyword_equal(keyword_table[slot].text, start, length)) {
+        return keyword_table[slot].type;
     }
-    
     return TOKEN_IDENTIFIER;
 }
+// END GENERATED KEYWORDS
 
-static void scan_identifier(Lexer* lexer) {
+static Token scan_identifier(Lexer* lexer) {
     while (is_alpha(peek(lexer)) || is_digit(peek(lexer)) || peek(lexer) == '-') {
         advance(lexer);
     }
     
-    TokenType type = identifier_type(lexer);
+    // Keywords are short; only those lengths need the table
+    size_t length = (size_t)(lexer->current - lexer->start);
+    TokenType type = length < 256 ? keyword_lookup(lexer->start, (int)length) : TOKEN_IDENTIFIER;
+    Token token = make_token(lexer, type);
     
     // For TRUE and FALSE, set the bool value
     if (type == TOKEN_TRUE || type == TOKEN_FALSE) {
-        if (lexer->token_count >= lexer->token_capacity) {
-            lexer->token_capacity *= 2;
-            lexer->tokens = (Token*)realloc(lexer->tokens, 
-                                           sizeof(Token) * lexer->token_capacity);
-        }
-        
-        Token token;
-        token.type = type;
-        token.line = lexer->line;
-        token.column = lexer->column - (int)(lexer->current - lexer->start);
-        
-        int length = (int)(lexer->current - lexer->start);
-        token.lexeme = (char*)malloc(length + 1);
-        memcpy(token.lexeme, lexer->start, length);
-        token.lexeme[length] = '\0';
-        
         token.value.bool_value = (type == TOKEN_TRUE);
-        
-        lexer->tokens[lexer->token_count++] = token;
-    } else {
-        add_token(lexer, type);
     }
+    return token;
 }
 
-static void scan_code_block(Lexer* lexer) {
+static Token scan_code_block(Lexer* lexer) {
     advance(lexer);  // <
     advance(lexer);  // !
     
     const char* code_start = lexer->current;
     
-    while (!is_at_end(lexer)) {
-        if (peek(lexer) == '!' && peek_next(lexer) == '>') {
-            break;
-        }
-        if (peek(lexer) == '\n') {
-            lexer->line++;
-            lexer->column = 0;
-        }
+    while (true) {
+        scan_to_byte(lexer, '!');
+        if (is_at_end(lexer) || peek_next(lexer) == '>') break;
         advance(lexer);
     }
     
     if (is_at_end(lexer)) {
-        add_token(lexer, TOKEN_ERROR);
-        return;
+        return make_token(lexer, TOKEN_ERROR);
     }
     
-    int length = (int)(lexer->current - code_start);
+    size_t length = (size_t)(lexer->current - code_start);
     
     advance(lexer);  // !
     advance(lexer);  // >
     
-    Token token;
-    token.type = TOKEN_CODE_BLOCK;
-    token.line = lexer->line;
-    token.column = lexer->column - (int)(lexer->current - lexer->start);
-    
-    int lexeme_length = (int)(lexer->current - lexer->start);
-    token.lexeme = (char*)malloc(lexeme_length + 1);
-    memcpy(token.lexeme, lexer->start, lexeme_length);
-    token.lexeme[lexeme_length] = '\0';
-    
+    Token token = make_token(lexer, TOKEN_CODE_BLOCK);
     token.value.string = (char*)malloc(length + 1);
     memcpy(token.value.string, code_start, length);
     token.value.string[length] = '\0';
+    return token;
+}
+
+// Scan the next token in the window
+static Token lexer_scan(Lexer* lexer) {
+    skip_whitespace(lexer);
+    lexer->start = lexer->current;
     
-    if (lexer->token_count >= lexer->token_capacity) {
-        lexer->token_capacity *= 2;
-        lexer->tokens = (Token*)realloc(lexer->tokens, 
-                                       sizeof(Token) * lexer->token_capacity);
-    }
+    if (is_at_end(lexer)) return make_token(lexer, TOKEN_EOF);
     
-    lexer->tokens[lexer->token_count++] = token;
+    char c = advance(lexer);
+    
+    switch (c) {
+        case '{': return make_token(lexer, TOKEN_LBRACE);
+        case '}': return make_token(lexer, TOKEN_RBRACE);
+        case '[': return make_token(lexer, TOKEN_LBRACKET);
+        case ']': return make_token(lexer, TOKEN_RBRACKET);
+        case ':': return make_token(lexer, TOKEN_COLON);
+        case ',': return make_token(lexer, TOKEN_COMMA);
+        case '@': return make_token(lexer, TOKEN_AT);
+        case '(': return make_token(lexer, TOKEN_LPAREN);
+        case ')': return make_token(lexer, TOKEN_RPAREN);
+        
+        case '<':
+            if (peek(lexer) == '!') {
+                lexer->current--;
+                return scan_code_block(lexer);
+            }
+            return make_token(lexer, TOKEN_ERROR);
+        
+        case '"':
+            lexer->current--;
+            return scan_string(lexer);
+        
+        case '-':
+            lexer->current--;
+            if (is_digit(peek_next(lexer))) return scan_number(lexer);
+            return scan_identifier(lexer);
+        
+        default:
+            if (is_digit(c)) {
+                lexer->current--;
+                return scan_number(lexer);
+            } else if (is_alpha(c)) {
+                lexer->current--;
+                return scan_identifier(lexer);
+            }
+            return make_token(lexer, TOKEN_ERROR);
+    }
+}
+
+static void token_release(Token* token) {
+    if (token->type == TOKEN_STRING || token->type == TOKEN_CODE_BLOCK) {
+        free(token->value.string);
+    }
 }
 
-static void lexer_scan_tokens(Lexer* lexer) {
-    while (!is_at_end(lexer)) {
-        lexer->start = lexer->current;
-        skip_whitespace(lexer);
+// Drop the window bytes before *from and read more input after the rest.
+// Each refill reads at least as much as is still buffered, so a token
+// spanning many chunks is rescanned a logarithmic number of times.
+static void lexer_fill(Lexer* lexer, const char** from) {
+    size_t length = (size_t)(lexer->end - lexer->source);
+    size_t drop = (size_t)(*from - lexer->source);
+    if (lexer->keep >= lexer->base && lexer->keep - lexer->base < drop) {
+        drop = lexer->keep - lexer->base;
+    }
+    
+    // Carry the line count of the dropped bytes
+    size_t newlines = count_newlines(lexer->source, drop);
+    if (newlines > 0) {
+        const char* last = lexer->source + drop - 1;
+        while (*last != '\n') last--;
+        lexer->dropped_lines += newlines;
+        lexer->line_start = lexer->base + (size_t)(last - lexer->source) + 1;
+    }
+    
+    size_t from_index = (size_t)(*from - lexer->source) - drop;
+    length -= drop;
+    memmove(lexer->buffer, lexer->buffer + drop, length);
+    lexer->base += drop;
+    
+    size_t want = length > SDC_READ_CHUNK ? length : SDC_READ_CHUNK;
+    if (length + want + 1 > lexer->capacity) {
+        lexer->capacity = length + want + 1;
+        lexer->buffer = (char*)realloc(lexer->buffer, lexer->capacity);
+    }
+    
+    // Fill the request completely so short reads (pipes) do not cause
+    // extra rescans. A single call never asks for more than a long can
+    // report back.
+    size_t got = 0;
+    while (got < want) {
+        size_t request = want - got;
+        if (request > (size_t)LONG_MAX) request = (size_t)LONG_MAX;
         
-        if (is_at_end(lexer)) break;
+        long n = lexer->read(lexer->user, lexer->buffer + length + got, request);
+        if (n <= 0 || (size_t)n > request) {
+            lexer->eof = true;
+            lexer->read_error = n != 0;
+            break;
+        }
+        got += (size_t)n;
+    }
+    
+    length += got;
+    lexer->buffer[length] = '\0';
+    *from = lexer->buffer + from_index;
+    lexer->source = lexer->buffer;
+    lexer->end = lexer->buffer + length;
+}
+
+// Scan the next token; at the end of input this keeps returning EOF
+static Token lexer_next(Lexer* lexer) {
+    while (true) {
+        const char* from = lexer->current;
+        Token token = lexer_scan(lexer);
         
-        lexer->start = lexer->current;
-        char c = advance(lexer);
+        // Scanning looks at most one byte past a token, so one that ends
+        // two bytes before the window end cannot change with more input
+        if (lexer->eof || lexer->end - lexer->current >= 2) return token;
         
-        switch (c) {
-            case '{': add_token(lexer, TOKEN_LBRACE); break;
-            case '}': add_token(lexer, TOKEN_RBRACE); break;
-            case '[': add_token(lexer, TOKEN_LBRACKET); break;
-            case ']': add_token(lexer, TOKEN_RBRACKET); break;
-            case ':': add_token(lexer, TOKEN_COLON); break;
-            case ',': add_token(lexer, TOKEN_COMMA); break;
-            case '@': add_token(lexer, TOKEN_AT); break;
-            case '(': add_token(lexer, TOKEN_LPAREN); break;
-            case ')': add_token(lexer, TOKEN_RPAREN); break;
-            
-            case '<':
-                if (peek(lexer) == '!') {
-                    lexer->current--;
-                    lexer->column--;
-                    scan_code_block(lexer);
-                } else {
-                    add_token(lexer, TOKEN_ERROR);
-                }
-                break;
-            
-            case '"':
-                lexer->current--;
-                lexer->column--;
-                scan_string(lexer);
-                break;
-            
-            case '-':
-                if (is_digit(peek(lexer))) {
-                    lexer->current--;
-                    lexer->column--;
-                    scan_number(lexer);
-                } else {
-                    lexer->current--;
-                    lexer->column--;
-                    scan_identifier(lexer);
-                }
-                break;
-            
-            default:
-                if (is_digit(c)) {
-                    lexer->current--;
-                    lexer->column--;
-                    scan_number(lexer);
-                } else if (is_alpha(c)) {
-                    lexer->current--;
-                    lexer->column--;
-                    scan_identifier(lexer);
-                } else {
-                    add_token(lexer, TOKEN_ERROR);
-                }
-                break;
+        token_release(&token);
+        lexer_fill(lexer, &from);
+        lexer->current = from;
+    }
+}
+
+// ============================================================================
+// SOURCE POSITIONS
+// ============================================================================
+
+static void line_index_add(LineIndex* index, size_t* capacity, size_t offset) {
+    if (index->count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 256;
+        index->offsets = (size_t*)realloc(index->offsets, sizeof(size_t) * *capacity);
+    }
+    index->offsets[index->count++] = offset;
+}
+
+static void line_index_build(LineIndex* index, const char* source, size_t length) {
+    size_t capacity = 0;
+    size_t i = 0;
+    
+#if defined(SDC_SIMD_WIDTH)
+    for (; length - i >= SDC_SIMD_WIDTH; i += SDC_SIMD_WIDTH) {
+        uint32_t newlines = block_match(block_load(source + i), '\n');
+        while (newlines) {
+            line_index_add(index, &capacity, i + (size_t)lowest_bit(newlines));
+            newlines &= newlines - 1;
         }
     }
+#endif
     
-    lexer->start = lexer->current;
-    add_token(lexer, TOKEN_EOF);
+    for (; i < length; i++) {
+        if (source[i] == '\n') line_index_add(index, &capacity, i);
+    }
+    index->built = true;
+}
+
+// 1-based line and column of a byte offset
+static void line_index_locate(const LineIndex* index, size_t offset, size_t* line, size_t* column) {
+    // Count the newlines before offset
+    size_t lo = 0;
+    size_t hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->offsets[mid] < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    *line = lo + 1;
+    *column = lo > 0 ? offset - index->offsets[lo - 1] : offset + 1;
 }
 
 // ============================================================================
 // PARSER IMPLEMENTATION
 // ============================================================================
 
-static Parser* parser_create(Token* tokens, int token_count) {
+// Takes over the lexer, including a reader's buffer
+static Parser* parser_create(const Lexer* lexer) {
     Parser* parser = (Parser*)malloc(sizeof(Parser));
-    parser->tokens = tokens;
-    parser->token_count = token_count;
+    parser->lexer = *lexer;
+    memset(parser->ring, 0, sizeof(parser->ring));
     parser->current = 0;
+    parser->lexer_error = false;
+    parser->lines.offsets = NULL;
+    parser->lines.count = 0;
+    parser->lines.built = false;
     parser->error_message = NULL;
+    parser->hashing = 0;
     
     parser->story = (StoryData*)malloc(sizeof(StoryData));
     parser->story->states = NULL;
@@ -605,6 +884,30 @@ static Parser* parser_create(Token* tokens, int token_count) {
     parser->story->group_count = 0;
     parser->story->nodes = NULL;
     parser->story->node_count = 0;
+    parser->story->linked_lists = NULL;
+    parser->story->linked_list_count = 0;
+    parser->story->characters = NULL;
+    parser->story->character_count = 0;
+    parser->story->dialogues = NULL;
+    parser->story->dialogue_hashes = NULL;
+    parser->story->dialogue_count = 0;
+    parser->story->dialogue_capacity = 0;
+    parser->story->actions = NULL;
+    parser->story->action_hashes = NULL;
+    parser->story->action_count = 0;
+    parser->story->action_capacity = 0;
+    parser->story->timeline_pool = NULL;
+    parser->story->timeline_pool_count = 0;
+    parser->story->node_index = NULL;
+    parser->story->group_index = NULL;
+    parser->story->source = NULL;
+    parser->source = NULL;
+    
+    parser->ring[0] = lexer_next(&parser->lexer);
+    if (parser->ring[0].type == TOKEN_ERROR) {
+        parser->lexer_error = true;
+        parser->ring[0].type = TOKEN_EOF;
+    }
     
     return parser;
 }
@@ -613,26 +916,104 @@ static void parser_free(Parser* parser) {
     if (parser->error_message) {
         free(parser->error_message);
     }
+    for (int i = 0; i < TOKEN_RING_SIZE; i++) {
+        token_release(&parser->ring[i]);
+    }
+    free(parser->lines.offsets);
+    free(parser->lexer.buffer);
     free(parser);
 }
 
 static Token* peek_parser(Parser* parser) {
-    return &parser->tokens[parser->current];
+    return &parser->ring[parser->current & (TOKEN_RING_SIZE - 1)];
 }
 
 static Token* previous(Parser* parser) {
-    return &parser->tokens[parser->current - 1];
+    return &parser->ring[(parser->current - 1) & (TOKEN_RING_SIZE - 1)];
 }
 
 static bool is_at_end_parser(Parser* parser) {
     return peek_parser(parser)->type == TOKEN_EOF;
 }
 
+static const char* token_start(Parser* parser, const Token* token) {
+    return parser->lexer.source + (token->offset - parser->lexer.base);
+}
+
+// FNV-1a, 64-bit, taking the text of each token as 64-bit little-endian
+// words. The last word holds the 0 to 7 bytes left over and the low byte
+// of the token's length in its top byte. Whitespace and comments are not
+// tokens, so they never change a hash. The JavaScript parser computes the
+// same values.
+#define SDC_HASH_BASIS 0xCBF29CE484222325ull
+#define SDC_HASH_PRIME 0x100000001B3ull
+
+static void hash_token(Parser* parser, const Token* token) {
+    const unsigned char* text = (const unsigned char*)token_start(parser, token);
+    size_t length = token->length;
+    uint64_t block = parser->hashes[0];
+    uint64_t item = parser->hashes[1];
+    
+    // Both chains always run: they are independent, so the item one costs
+    // next to nothing while no item is being parsed
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word = 0;
+        for (unsigned k = 0; k < 8; k++) {
+            word |= (uint64_t)text[i + k] << (8 * k);
+        }
+        block = (block ^ word) * SDC_HASH_PRIME;
+        item = (item ^ word) * SDC_HASH_PRIME;
+    }
+    
+    uint64_t last = (uint64_t)(length & 0xFF) << 56;
+    for (unsigned shift = 0; i < length; i++, shift += 8) {
+        last |= (uint64_t)text[i] << shift;
+    }
+    parser->hashes[0] = (block ^ last) * SDC_HASH_PRIME;
+    if (parser->hashing == 2) parser->hashes[1] = (item ^ last) * SDC_HASH_PRIME;
+}
+
+// Start hashing the tokens of a block (level 0) or timeline item (level 1)
+static void hash_begin(Parser* parser, int level) {
+    parser->hashes[level] = SDC_HASH_BASIS;
+    parser->hashing = level + 1;
+}
+
 static Token* advance_parser(Parser* parser) {
-    if (!is_at_end_parser(parser)) parser->current++;
+    if (!is_at_end_parser(parser)) {
+        if (parser->hashing) hash_token(parser, peek_parser(parser));
+        parser->current++;
+        
+        // Reuse the slot of the oldest consumed token for the new lookahead.
+        // The window must keep the text of the tokens that remain.
+        Token* next = peek_parser(parser);
+        token_release(next);
+        parser->lexer.keep = parser->ring[(parser->current + 1) & (TOKEN_RING_SIZE - 1)].offset;
+        *next = lexer_next(&parser->lexer);
+        
+        // An invalid token ends the input; the caller reports it
+        if (next->type == TOKEN_ERROR) {
+            parser->lexer_error = true;
+            next->type = TOKEN_EOF;
+        }
+    }
     return previous(parser);
 }
 
+// Copy of the token's source text
+static char* token_text(Parser* parser, const Token* token) {
+    char* text = (char*)malloc(token->length + 1);
+    memcpy(text, token_start(parser, token), token->length);
+    text[token->length] = '\0';
+    return text;
+}
+
+static bool token_text_equals(Parser* parser, const Token* token, const char* text) {
+    return strncmp(token_start(parser, token), text, token->length) == 0 &&
+           text[token->length] == '\0';
+}
+
 static bool check(Parser* parser, TokenType type) {
     if (is_at_end_parser(parser)) return false;
     return peek_parser(parser)->type == type;
@@ -646,17 +1027,48 @@ static bool match(Parser* parser, TokenType type) {
     return false;
 }
 
-static void set_error(Parser* parser, const char* message) {
+static void set_error_at(Parser* parser, const Token* token, const char* message) {
     if (parser->error_message) return;  // Keep first error
     
-    Token* token = peek_parser(parser);
+    // Index the buffered window; a reader has dropped the input before it
+    const Lexer* lexer = &parser->lexer;
+    if (!parser->lines.built) {
+        line_index_build(&parser->lines, lexer->source, (size_t)(lexer->end - lexer->source));
+    }
+    
+    size_t line, column;
+    line_index_locate(&parser->lines, token->offset - lexer->base, &line, &column);
+    if (line == 1) column = token->offset - lexer->line_start + 1;
+    line += lexer->dropped_lines;
+    
     char buffer[512];
-    snprintf(buffer, sizeof(buffer), "Error at line %d, column %d: %s (got '%s')",
-             token->line, token->column, message, token->lexeme);
+    int shown = token->length < 256 ? (int)token->length : 256;
+    snprintf(buffer, sizeof(buffer), "Error at line %zu, column %zu: %s (got '%.*s')",
+             line, column, message, shown, token_start(parser, token));
     
     parser->error_message = strdup(buffer);
     if (last_error) free(last_error);
     last_error = strdup(buffer);
+    last_error_offset = token->offset;
+    last_error_line = line;
+}
+
+static void set_error(Parser* parser, const char* message) {
+    set_error_at(parser, peek_parser(parser), message);
+}
+
+// Copy of a string or code block value. Any other token is recorded as an
+// error here, so the many 'key: "value"' sites need no checks of their own.
+static char* token_string(Parser* parser, const Token* token) {
+    if (token->type == TOKEN_STRING || token->type == TOKEN_CODE_BLOCK) {
+        return strdup(token->value.string);
+    }
+    set_error_at(parser, token, "Expected string");
+    return strdup("");
+}
+
+static bool token_string_equals(const Token* token, const char* text) {
+    return token->type == TOKEN_STRING && strcmp(token->value.string, text) == 0;
 }
 
 static bool expect(Parser* parser, TokenType type, const char* message) {
@@ -668,6 +1080,14 @@ static bool expect(Parser* parser, TokenType type, const char* message) {
     return false;
 }
 
+// Make room for items[count], doubling the capacity when it is full.
+// Sections are parsed in one pass, so arrays grow as entries are read.
+static void* reserve_item(void* items, SdcSize count, SdcSize* capacity, size_t size) {
+    if (count < *capacity) return items;
+    *capacity = *capacity ? *capacity * 2 : 8;
+    return realloc(items, size * *capacity);
+}
+
 // Forward declarations
 static bool parse_states(Parser* parser);
 static bool parse_global_vars(Parser* parser);
@@ -676,52 +1096,71 @@ static bool parse_tag_definition(Parser* parser, TagDefinition* tag);
 static bool parse_chapter(Parser* parser, Chapter* chapter);
 static bool parse_group(Parser* parser, Group* group);
 static bool parse_node(Parser* parser, Node* node);
+static LinkedListValueType ll_type_from_name(const char* type_name);
+static SdcSize ll_find_or_add_list(StoryData* story, const char* name);
+static void ll_merge_schema(LinkedListDefinition* list, char** names, LinkedListField* fields, SdcSize count);
+static void free_action(Action* a);
 
-static bool parse_linked_lists(Parser* parser) {
-    if (!expect(parser, TOKEN_LINKED_LISTS, "Expected 'linked-lists'")) return false;
-    if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'linked-lists'")) return false;
+// Parse the fields of a 'structure: { ... }' schema up to and including
+// its closing brace. The caller owns the arrays, also after a failure.
+static bool parse_linked_list_fields(Parser* parser, char*** field_names_out,
+                                     LinkedListField** fields_out, SdcSize* count_out) {
+    SdcSize field_capacity = 0;
     
-    // Count linked lists first
-    int count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            count++;
-            advance_parser(parser);
-            if (check(parser, TOKEN_COLON)) {
-                advance_parser(parser);
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
+        if (check(parser, TOKEN_IDENTIFIER)) {
+            Token* field_name = advance_parser(parser);
+            SdcSize field_index = *count_out;
+            if (field_index == field_capacity) {
+                field_capacity = field_capacity ? field_capacity * 2 : 8;
+                *field_names_out = (char**)realloc(*field_names_out, sizeof(char*) * field_capacity);
+                *fields_out = (LinkedListField*)realloc(*fields_out, sizeof(LinkedListField) * field_capacity);
             }
-            if (check(parser, TOKEN_LBRACE)) {
-                int brace_count = 1;
-                advance_parser(parser);
-                while (brace_count > 0 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_count++;
-                    if (check(parser, TOKEN_RBRACE)) brace_count--;
+            LinkedListField* field = &(*fields_out)[field_index];
+            (*field_names_out)[field_index] = token_text(parser, field_name);
+            memset(field, 0, sizeof(LinkedListField));
+            (*count_out)++;
+            
+            if (!expect(parser, TOKEN_COLON, "Expected ':' after field name")) return false;
+            if (!expect(parser, TOKEN_LBRACE, "Expected '{' after field name")) return false;
+            
+            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
+                if (match(parser, TOKEN_TYPE)) {
+                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'type'")) return false;
+                    Token* type_token = advance_parser(parser);
+                    free(field->type);
+                    field->type = token_string(parser, type_token);
+                } else {
                     advance_parser(parser);
                 }
+                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
             }
+            
+            if (!expect(parser, TOKEN_RBRACE, "Expected '}' after field definition")) return false;
         } else {
             advance_parser(parser);
         }
         if (check(parser, TOKEN_COMMA)) advance_parser(parser);
     }
-    parser->current = saved_pos;
-    
-    // Allocate linked list array
-    parser->story->linked_lists = (LinkedListDefinition*)calloc(count, sizeof(LinkedListDefinition));
-    parser->story->linked_list_count = count;
     
-    // Parse linked lists
-    int list_index = 0;
+    return expect(parser, TOKEN_RBRACE, "Expected '}' after structure");
+}
+
+static bool parse_linked_lists(Parser* parser) {
+    if (!expect(parser, TOKEN_LINKED_LISTS, "Expected 'linked-lists'")) return false;
+    if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'linked-lists'")) return false;
+    
+    // Parse linked lists. Character data before this block may already
+    // have created a list by name; its schema is merged into that list
+    // so the rows stay with it.
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
             Token* name_token = advance_parser(parser);
-            LinkedListDefinition* list = &parser->story->linked_lists[list_index++];
-            list->name = strdup(name_token->value.string);
-            list->scope = NULL;
-            list->field_names = NULL;
-            list->fields = NULL;
-            list->field_count = 0;
+            StoryData* story = parser->story;
+            char* name = token_string(parser, name_token);
+            SdcSize list_index = ll_find_or_add_list(story, name);
+            LinkedListDefinition* list = &story->linked_lists[list_index];
+            free(name);
             
             if (!expect(parser, TOKEN_COLON, "Expected ':' after linked-list name")) return false;
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after ':'")) return false;
@@ -730,71 +1169,20 @@ static bool parse_linked_lists(Parser* parser) {
                 if (match(parser, TOKEN_SCOPE)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'scope'")) return false;
                     Token* scope_token = advance_parser(parser);
-                    list->scope = strdup(scope_token->value.string);
+                    free(list->scope);
+                    list->scope = token_string(parser, scope_token);
                 } else if (match(parser, TOKEN_STRUCTURE)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'structure'")) return false;
                     if (!expect(parser, TOKEN_LBRACE, "Expected '{' after 'structure:'")) return false;
                     
-                    // Count fields
-                    int field_count = 0;
-                    int saved_pos2 = parser->current;
-                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_IDENTIFIER)) {
-                            field_count++;
-                            advance_parser(parser);
-                            if (check(parser, TOKEN_COLON)) {
-                                advance_parser(parser);
-                                if (check(parser, TOKEN_LBRACE)) {
-                                    int brace_count = 1;
-                                    advance_parser(parser);
-                                    while (brace_count > 0 && !is_at_end_parser(parser)) {
-                                        if (check(parser, TOKEN_LBRACE)) brace_count++;
-                                        if (check(parser, TOKEN_RBRACE)) brace_count--;
-                                        advance_parser(parser);
-                                    }
-                                }
-                            }
-                        } else {
-                            advance_parser(parser);
-                        }
-                        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                    }
-                    parser->current = saved_pos2;
-                    
-                    list->field_count = field_count;
-                    list->field_names = (char**)malloc(sizeof(char*) * field_count);
-                    list->fields = (LinkedListField*)malloc(sizeof(LinkedListField) * field_count);
-                    
-                    // Parse fields
-                    int field_index = 0;
-                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_IDENTIFIER)) {
-                            Token* field_name = advance_parser(parser);
-                            list->field_names[field_index] = strdup(field_name->lexeme);
-                            
-                            if (!expect(parser, TOKEN_COLON, "Expected ':' after field name")) return false;
-                            if (!expect(parser, TOKEN_LBRACE, "Expected '{' after field name")) return false;
-                            
-                            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                                if (match(parser, TOKEN_TYPE)) {
-                                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'type'")) return false;
-                                    Token* type_token = advance_parser(parser);
-                                    list->fields[field_index].type = strdup(type_token->value.string);
-                                } else {
-                                    advance_parser(parser);
-                                }
-                                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                            }
-                            
-                            if (!expect(parser, TOKEN_RBRACE, "Expected '}' after field definition")) return false;
-                            field_index++;
-                        } else {
-                            advance_parser(parser);
-                        }
-                        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                    }
-                    
-                    if (!expect(parser, TOKEN_RBRACE, "Expected '}' after structure")) return false;
+                    // The schema is merged even when it fails to parse, so
+                    // the story owns the fields read so far
+                    char** field_names = NULL;
+                    LinkedListField* fields = NULL;
+                    SdcSize field_count = 0;
+                    bool parsed = parse_linked_list_fields(parser, &field_names, &fields, &field_count);
+                    ll_merge_schema(list, field_names, fields, field_count);
+                    if (!parsed) return false;
                 } else {
                     advance_parser(parser);
                 }
@@ -812,114 +1200,300 @@ static bool parse_linked_lists(Parser* parser) {
     return true;
 }
 
-static LinkedListData parse_linked_list_data_value(Parser* parser) {
+// Linked list column storage
+
+static LinkedListValueType ll_type_from_name(const char* type_name) {
+    if (!type_name) return SDC_LL_VALUE_STRING;
+    if (strcmp(type_name, "integer") == 0 || strcmp(type_name, "int") == 0) return SDC_LL_VALUE_INT;
+    if (strcmp(type_name, "float") == 0) return SDC_LL_VALUE_FLOAT;
+    if (strcmp(type_name, "boolean") == 0 || strcmp(type_name, "bool") == 0) return SDC_LL_VALUE_BOOL;
+    return SDC_LL_VALUE_STRING;
+}
+
+static size_t ll_value_size(LinkedListValueType type) {
+    switch (type) {
+        case SDC_LL_VALUE_INT: return sizeof(long);
+        case SDC_LL_VALUE_FLOAT: return sizeof(double);
+        case SDC_LL_VALUE_BOOL: return sizeof(bool);
+        case SDC_LL_VALUE_STRING: return sizeof(SdcSize);
+    }
+    return sizeof(long);
+}
+
+static void ll_column_resize(LinkedListColumn* column, SdcSize old_capacity, SdcSize new_capacity) {
+    size_t size = ll_value_size(column->type);
+    // All union members are pointers, so int_values aliases the active one
+    void* values = realloc(column->data.int_values, size * new_capacity);
+    memset((char*)values + size * old_capacity, 0, size * (new_capacity - old_capacity));
+    column->data.int_values = (long*)values;
+    
+    column->present = (bool*)realloc(column->present, sizeof(bool) * new_capacity);
+    memset(column->present + old_capacity, 0, sizeof(bool) * (new_capacity - old_capacity));
+}
+
+// Find a linked list by name, creating an empty definition for lists
+// that carry data without a schema
+static SdcSize ll_find_or_add_list(StoryData* story, const char* name) {
+    for (SdcSize i = 0; i < story->linked_list_count; i++) {
+        if (strcmp(story->linked_lists[i].name, name) == 0) return i;
+    }
+    
+    SdcSize index = story->linked_list_count++;
+    story->linked_lists = (LinkedListDefinition*)realloc(story->linked_lists,
+        sizeof(LinkedListDefinition) * story->linked_list_count);
+    memset(&story->linked_lists[index], 0, sizeof(LinkedListDefinition));
+    story->linked_lists[index].name = strdup(name);
+    return index;
+}
+
+// Find a field by name, appending a column typed after the value for
+// keys that are not part of the schema
+static SdcSize ll_find_or_add_field(Parser* parser, LinkedListDefinition* list, Token* key, Token* value) {
+    for (SdcSize i = 0; i < list->field_count; i++) {
+        if (token_text_equals(parser, key, list->field_names[i])) return i;
+    }
+    
+    const char* type_name = "string";
+    if (value->type == TOKEN_NUMBER) type_name = "integer";
+    else if (value->type == TOKEN_FLOAT) type_name = "float";
+    else if (value->type == TOKEN_TRUE || value->type == TOKEN_FALSE) type_name = "boolean";
+    
+    SdcSize index = list->field_count++;
+    list->field_names = (char**)realloc(list->field_names, sizeof(char*) * list->field_count);
+    list->fields = (LinkedListField*)realloc(list->fields, sizeof(LinkedListField) * list->field_count);
+    list->columns = (LinkedListColumn*)realloc(list->columns, sizeof(LinkedListColumn) * list->field_count);
+    
+    list->field_names[index] = token_text(parser, key);
+    list->fields[index].type = strdup(type_name);
+    list->fields[index].value_type = ll_type_from_name(type_name);
+    memset(&list->columns[index], 0, sizeof(LinkedListColumn));
+    list->columns[index].type = list->fields[index].value_type;
+    if (list->row_capacity > 0) {
+        ll_column_resize(&list->columns[index], 0, list->row_capacity);
+    }
+    return index;
+}
+
+static SdcSize ll_add_row(LinkedListDefinition* list) {
+    if (list->row_count >= list->row_capacity) {
+        SdcSize new_capacity = list->row_capacity ? list->row_capacity * 2 : 16;
+        for (SdcSize i = 0; i < list->field_count; i++) {
+            ll_column_resize(&list->columns[i], list->row_capacity, new_capacity);
+        }
+        list->row_capacity = new_capacity;
+    }
+    return list->row_count++;
+}
+
+// Takes ownership of value
+static SdcSize ll_add_string(LinkedListDefinition* list, char* value) {
+    if (list->string_count >= list->string_capacity) {
+        list->string_capacity = list->string_capacity ? list->string_capacity * 2 : 16;
+        list->strings = (char**)realloc(list->strings, sizeof(char*) * list->string_capacity);
+    }
+    list->strings[list->string_count] = value;
+    return list->string_count++;
+}
+
+// Convert a column to another type, as if each cell had been stored with
+// that type from the start. Text cells only convert to text, since
+// ll_set_value never stores a string literal in a typed column.
+static void ll_column_convert(LinkedListDefinition* list, LinkedListColumn* column, LinkedListValueType type) {
+    if (column->type == type) return;
+    
+    LinkedListColumn converted;
+    memset(&converted, 0, sizeof(LinkedListColumn));
+    converted.type = type;
+    if (list->row_capacity > 0) ll_column_resize(&converted, 0, list->row_capacity);
+    
+    for (SdcSize row = 0; row < list->row_count; row++) {
+        if (!column->present[row]) continue;
+        
+        bool is_number = column->type == SDC_LL_VALUE_INT || column->type == SDC_LL_VALUE_FLOAT;
+        double number = 0.0;
+        char text[32];
+        switch (column->type) {
+            case SDC_LL_VALUE_INT:
+                number = (double)column->data.int_values[row];
+                snprintf(text, sizeof(text), "%ld", column->data.int_values[row]);
+                break;
+            case SDC_LL_VALUE_FLOAT:
+                number = column->data.float_values[row];
+                // The shortest form that reads back as the same double
+                snprintf(text, sizeof(text), "%.15g", number);
+                if (strtod(text, NULL) != number) snprintf(text, sizeof(text), "%.17g", number);
+                break;
+            case SDC_LL_VALUE_BOOL:
+                snprintf(text, sizeof(text), "%s", column->data.bool_values[row] ? "true" : "false");
+                break;
+            case SDC_LL_VALUE_STRING:
+                break;
+        }
+        
+        switch (type) {
+            case SDC_LL_VALUE_INT:
+                if (!is_number) continue;
+                converted.data.int_values[row] = column->type == SDC_LL_VALUE_INT ?
+                    column->data.int_values[row] : (long)number;
+                break;
+            case SDC_LL_VALUE_FLOAT:
+                if (!is_number) continue;
+                converted.data.float_values[row] = number;
+                break;
+            case SDC_LL_VALUE_BOOL:
+                if (!is_number) continue;
+                converted.data.bool_values[row] = number != 0.0;
+                break;
+            case SDC_LL_VALUE_STRING:
+                converted.data.string_ids[row] = ll_add_string(list, strdup(text));
+                break;
+        }
+        converted.present[row] = true;
+    }
+    
+    free(column->data.int_values);
+    free(column->present);
+    *column = converted;
+}
+
+// Apply a 'structure' schema to a list, taking ownership of the arrays.
+// The schema's fields come first, in its order and with its types; a
+// field that data already added keeps its column, converted to the
+// schema type. Fields only the data uses follow.
+static void ll_merge_schema(LinkedListDefinition* list, char** names, LinkedListField* fields, SdcSize count) {
+    SdcSize total = count;
+    bool* merged = (bool*)calloc(list->field_count + 1, sizeof(bool));
+    SdcSize* source = (SdcSize*)malloc(sizeof(SdcSize) * (count + 1));
+    for (SdcSize i = 0; i < count; i++) {
+        source[i] = (SdcSize)-1;
+        for (SdcSize j = 0; j < list->field_count; j++) {
+            if (!merged[j] && strcmp(list->field_names[j], names[i]) == 0) {
+                merged[j] = true;
+                source[i] = j;
+                break;
+            }
+        }
+    }
+    for (SdcSize j = 0; j < list->field_count; j++) {
+        if (!merged[j]) total++;
+    }
+    
+    names = (char**)realloc(names, sizeof(char*) * (total + 1));
+    fields = (LinkedListField*)realloc(fields, sizeof(LinkedListField) * (total + 1));
+    LinkedListColumn* columns = (LinkedListColumn*)calloc(total + 1, sizeof(LinkedListColumn));
+    
+    for (SdcSize i = 0; i < count; i++) {
+        fields[i].value_type = ll_type_from_name(fields[i].type);
+        if (source[i] == (SdcSize)-1) {
+            columns[i].type = fields[i].value_type;
+            if (list->row_capacity > 0) ll_column_resize(&columns[i], 0, list->row_capacity);
+            continue;
+        }
+        
+        SdcSize j = source[i];
+        columns[i] = list->columns[j];
+        ll_column_convert(list, &columns[i], fields[i].value_type);
+        free(list->field_names[j]);
+        free(list->fields[j].type);
+    }
+    
+    SdcSize next = count;
+    for (SdcSize j = 0; j < list->field_count; j++) {
+        if (merged[j]) continue;
+        names[next] = list->field_names[j];
+        fields[next] = list->fields[j];
+        columns[next] = list->columns[j];
+        next++;
+    }
+    
+    free(list->field_names);
+    free(list->fields);
+    free(list->columns);
+    free(merged);
+    free(source);
+    list->field_names = names;
+    list->fields = fields;
+    list->columns = columns;
+    list->field_count = total;
+}
+
+// Store a literal token in a cell, converting it to the column type
+static void ll_set_value(Parser* parser, LinkedListDefinition* list, SdcSize row, SdcSize field, Token* value) {
+    LinkedListColumn* column = &list->columns[field];
+    bool is_number = value->type == TOKEN_NUMBER || value->type == TOKEN_FLOAT;
+    bool is_bool = value->type == TOKEN_TRUE || value->type == TOKEN_FALSE;
+    double number = value->type == TOKEN_FLOAT ? value->value.float_number : (double)value->value.number;
+    
+    switch (column->type) {
+        case SDC_LL_VALUE_INT:
+            if (!is_number) return;
+            column->data.int_values[row] = value->type == TOKEN_NUMBER ? value->value.number : (long)number;
+            break;
+        case SDC_LL_VALUE_FLOAT:
+            if (!is_number) return;
+            column->data.float_values[row] = number;
+            break;
+        case SDC_LL_VALUE_BOOL:
+            if (is_bool) column->data.bool_values[row] = value->value.bool_value;
+            else if (is_number) column->data.bool_values[row] = number != 0.0;
+            else return;
+            break;
+        case SDC_LL_VALUE_STRING:
+            column->data.string_ids[row] = ll_add_string(list,
+                value->type == TOKEN_STRING ? token_string(parser, value) : token_text(parser, value));
+            break;
+    }
+    column->present[row] = true;
+}
+
+// Parse the fields of one instance '{ key: value ... }' into a new row.
+// The opening brace has already been consumed.
+static void parse_linked_list_row(Parser* parser, SdcSize list_index) {
+    LinkedListDefinition* list = &parser->story->linked_lists[list_index];
+    SdcSize row = ll_add_row(list);
+    
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
+        if (check(parser, TOKEN_IDENTIFIER)) {
+            Token* key = advance_parser(parser);
+            if (check(parser, TOKEN_COLON)) advance_parser(parser);
+            
+            Token* value = peek_parser(parser);
+            if (value->type == TOKEN_NUMBER || value->type == TOKEN_FLOAT ||
+                value->type == TOKEN_STRING ||
+                value->type == TOKEN_TRUE || value->type == TOKEN_FALSE) {
+                advance_parser(parser);
+                SdcSize field = ll_find_or_add_field(parser, list, key, value);
+                ll_set_value(parser, list, row, field, value);
+            }
+        } else {
+            advance_parser(parser);
+        }
+        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
+    }
+    
+    if (check(parser, TOKEN_RBRACE)) advance_parser(parser);
+}
+
+static LinkedListData parse_linked_list_data_value(Parser* parser, const char* list_name) {
     LinkedListData data;
-    data.instances = NULL;
+    data.list_index = ll_find_or_add_list(parser->story, list_name);
+    data.first_row = parser->story->linked_lists[data.list_index].row_count;
     data.count = 0;
     data.is_array = false;
     
     if (check(parser, TOKEN_LBRACKET)) {
-        // Array of instances
+        // Array of instances, one row each
         advance_parser(parser);
         data.is_array = true;
         
-        // Count instances
-        int instance_count = 0;
-        int saved_pos = parser->current;
-        while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-            if (check(parser, TOKEN_STRING)) {
-                instance_count++;
-                advance_parser(parser);
-                if (check(parser, TOKEN_COLON)) {
-                    advance_parser(parser);
-                    if (check(parser, TOKEN_LBRACE)) {
-                        int brace_count = 1;
-                        advance_parser(parser);
-                        while (brace_count > 0 && !is_at_end_parser(parser)) {
-                            if (check(parser, TOKEN_LBRACE)) brace_count++;
-                            if (check(parser, TOKEN_RBRACE)) brace_count--;
-                            advance_parser(parser);
-                        }
-                    }
-                }
-            } else {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-        }
-        parser->current = saved_pos;
-        
-        data.count = instance_count;
-        data.instances = (LinkedListDataInstance*)calloc(instance_count, sizeof(LinkedListDataInstance));
-        
-        // Parse instances
-        int inst_idx = 0;
         while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
             if (check(parser, TOKEN_STRING)) {
                 advance_parser(parser); // Skip string key
                 if (check(parser, TOKEN_COLON)) advance_parser(parser);
                 if (check(parser, TOKEN_LBRACE)) {
                     advance_parser(parser);
-                    
-                    // Count fields in this instance
-                    int field_count = 0;
-                    int saved_pos2 = parser->current;
-                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_IDENTIFIER)) {
-                            field_count++;
-                            advance_parser(parser);
-                            if (check(parser, TOKEN_COLON)) {
-                                advance_parser(parser);
-                                advance_parser(parser); // value
-                            }
-                        } else {
-                            advance_parser(parser);
-                        }
-                        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                    }
-                    parser->current = saved_pos2;
-                    
-                    data.instances[inst_idx].count = field_count;
-                    data.instances[inst_idx].keys = (char**)malloc(sizeof(char*) * field_count);
-                    data.instances[inst_idx].values = (LinkedListValue*)malloc(sizeof(LinkedListValue) * field_count);
-                    
-                    // Parse fields
-                    int field_idx = 0;
-                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_IDENTIFIER)) {
-                            Token* key = advance_parser(parser);
-                            data.instances[inst_idx].keys[field_idx] = strdup(key->lexeme);
-                            
-                            if (check(parser, TOKEN_COLON)) advance_parser(parser);
-                            
-                            Token* value = peek_parser(parser);
-                            if (value->type == TOKEN_NUMBER) {
-                                advance_parser(parser);
-                                data.instances[inst_idx].values[field_idx].type = SDC_LL_VALUE_INT;
-                                data.instances[inst_idx].values[field_idx].data.int_value = value->value.number;
-                            } else if (value->type == TOKEN_FLOAT) {
-                                advance_parser(parser);
-                                data.instances[inst_idx].values[field_idx].type = SDC_LL_VALUE_FLOAT;
-                                data.instances[inst_idx].values[field_idx].data.float_value = value->value.float_number;
-                            } else if (value->type == TOKEN_STRING) {
-                                advance_parser(parser);
-                                data.instances[inst_idx].values[field_idx].type = SDC_LL_VALUE_STRING;
-                                data.instances[inst_idx].values[field_idx].data.string_value = strdup(value->value.string);
-                            } else if (value->type == TOKEN_TRUE || value->type == TOKEN_FALSE) {
-                                advance_parser(parser);
-                                data.instances[inst_idx].values[field_idx].type = SDC_LL_VALUE_BOOL;
-                                data.instances[inst_idx].values[field_idx].data.bool_value = value->value.bool_value;
-                            }
-                            
-                            field_idx++;
-                        } else {
-                            advance_parser(parser);
-                        }
-                        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                    }
-                    
-                    if (check(parser, TOKEN_RBRACE)) advance_parser(parser);
-                    inst_idx++;
+                    parse_linked_list_row(parser, data.list_index);
+                    data.count++;
                 }
             } else {
                 advance_parser(parser);
@@ -931,68 +1505,8 @@ static LinkedListData parse_linked_list_data_value(Parser* parser) {
     } else if (check(parser, TOKEN_LBRACE)) {
         // Single instance
         advance_parser(parser);
-        data.is_array = false;
+        parse_linked_list_row(parser, data.list_index);
         data.count = 1;
-        data.instances = (LinkedListDataInstance*)calloc(1, sizeof(LinkedListDataInstance));
-        
-        // Count fields
-        int field_count = 0;
-        int saved_pos = parser->current;
-        while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-            if (check(parser, TOKEN_IDENTIFIER)) {
-                field_count++;
-                advance_parser(parser);
-                if (check(parser, TOKEN_COLON)) {
-                    advance_parser(parser);
-                    advance_parser(parser); // value
-                }
-            } else {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-        }
-        parser->current = saved_pos;
-        
-        data.instances[0].count = field_count;
-        data.instances[0].keys = (char**)malloc(sizeof(char*) * field_count);
-        data.instances[0].values = (LinkedListValue*)malloc(sizeof(LinkedListValue) * field_count);
-        
-        // Parse fields
-        int field_idx = 0;
-        while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-            if (check(parser, TOKEN_IDENTIFIER)) {
-                Token* key = advance_parser(parser);
-                data.instances[0].keys[field_idx] = strdup(key->lexeme);
-                
-                if (check(parser, TOKEN_COLON)) advance_parser(parser);
-                
-                Token* value = peek_parser(parser);
-                if (value->type == TOKEN_NUMBER) {
-                    advance_parser(parser);
-                    data.instances[0].values[field_idx].type = SDC_LL_VALUE_INT;
-                    data.instances[0].values[field_idx].data.int_value = value->value.number;
-                } else if (value->type == TOKEN_FLOAT) {
-                    advance_parser(parser);
-                    data.instances[0].values[field_idx].type = SDC_LL_VALUE_FLOAT;
-                    data.instances[0].values[field_idx].data.float_value = value->value.float_number;
-                } else if (value->type == TOKEN_STRING) {
-                    advance_parser(parser);
-                    data.instances[0].values[field_idx].type = SDC_LL_VALUE_STRING;
-                    data.instances[0].values[field_idx].data.string_value = strdup(value->value.string);
-                } else if (value->type == TOKEN_TRUE || value->type == TOKEN_FALSE) {
-                    advance_parser(parser);
-                    data.instances[0].values[field_idx].type = SDC_LL_VALUE_BOOL;
-                    data.instances[0].values[field_idx].data.bool_value = value->value.bool_value;
-                }
-                
-                field_idx++;
-            } else {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-        }
-        
-        if (check(parser, TOKEN_RBRACE)) advance_parser(parser);
     }
     
     return data;
@@ -1002,47 +1516,22 @@ static bool parse_characters(Parser* parser) {
     if (!expect(parser, TOKEN_CHARACTERS, "Expected 'characters'")) return false;
     if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'characters'")) return false;
     
-    // Count characters
-    int count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            count++;
-            advance_parser(parser);
-            if (check(parser, TOKEN_COLON)) {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_LBRACE)) {
-                int brace_count = 1;
-                advance_parser(parser);
-                while (brace_count > 0 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_count++;
-                    if (check(parser, TOKEN_RBRACE)) brace_count--;
-                    advance_parser(parser);
-                }
-            }
-        } else {
-            advance_parser(parser);
-        }
-        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-    }
-    parser->current = saved_pos;
-    
-    parser->story->characters = (Character*)calloc(count, sizeof(Character));
-    parser->story->character_count = count;
+    parser->story->characters = NULL;
+    parser->story->character_count = 0;
+    SdcSize capacity = 0;
     
     // Parse characters
-    int char_index = 0;
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
             Token* name_token = advance_parser(parser);
-            Character* character = &parser->story->characters[char_index++];
-            character->name = strdup(name_token->value.string);
+            StoryData* story = parser->story;
+            story->characters = (Character*)reserve_item(story->characters,
+                story->character_count, &capacity, sizeof(Character));
+            Character* character = &story->characters[story->character_count++];
+            memset(character, 0, sizeof(Character));
+            character->name = token_string(parser, name_token);
             character->biography = strdup("");
             character->description = strdup("");
-            character->linked_list_names = NULL;
-            character->linked_list_data = NULL;
-            character->linked_list_count = 0;
             
             if (!expect(parser, TOKEN_COLON, "Expected ':' after character name")) return false;
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after ':'")) return false;
@@ -1052,69 +1541,41 @@ static bool parse_characters(Parser* parser) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'biography'")) return false;
                     Token* bio = advance_parser(parser);
                     free(character->biography);
-                    character->biography = strdup(bio->value.string);
+                    character->biography = token_string(parser, bio);
                 } else if (match(parser, TOKEN_DESCRIPTION)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'description'")) return false;
                     Token* desc = advance_parser(parser);
                     free(character->description);
-                    character->description = strdup(desc->value.string);
+                    character->description = token_string(parser, desc);
                 } else if (match(parser, TOKEN_LINKED_LIST_DATA)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'linked-list-data'")) return false;
                     if (!expect(parser, TOKEN_LBRACE, "Expected '{' after 'linked-list-data:'")) return false;
                     
-                    // Count linked lists
-                    int ll_count = 0;
-                    int saved_pos2 = parser->current;
-                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_IDENTIFIER)) {
-                            ll_count++;
-                            advance_parser(parser);
-                            if (check(parser, TOKEN_COLON)) {
-                                advance_parser(parser);
-                                // Skip the value part
-                                int depth = 0;
-                                if (check(parser, TOKEN_LBRACE)) {
-                                    depth = 1;
-                                    advance_parser(parser);
-                                    while (depth > 0 && !is_at_end_parser(parser)) {
-                                        if (check(parser, TOKEN_LBRACE)) depth++;
-                                        if (check(parser, TOKEN_RBRACE)) depth--;
-                                        advance_parser(parser);
-                                    }
-                                } else if (check(parser, TOKEN_LBRACKET)) {
-                                    depth = 1;
-                                    advance_parser(parser);
-                                    while (depth > 0 && !is_at_end_parser(parser)) {
-                                        if (check(parser, TOKEN_LBRACKET)) depth++;
-                                        if (check(parser, TOKEN_RBRACKET)) depth--;
-                                        if (check(parser, TOKEN_LBRACE)) depth++;
-                                        if (check(parser, TOKEN_RBRACE)) depth--;
-                                        advance_parser(parser);
-                                    }
-                                }
-                            }
-                        } else {
-                            advance_parser(parser);
-                        }
-                        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                    }
-                    parser->current = saved_pos2;
-                    
-                    character->linked_list_count = ll_count;
-                    character->linked_list_names = (char**)malloc(sizeof(char*) * ll_count);
-                    character->linked_list_data = (LinkedListData*)malloc(sizeof(LinkedListData) * ll_count);
+                    character->linked_list_names = NULL;
+                    character->linked_list_data = NULL;
+                    character->linked_list_count = 0;
+                    SdcSize ll_capacity = 0;
                     
                     // Parse linked lists
-                    int ll_index = 0;
                     while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                         if (check(parser, TOKEN_IDENTIFIER)) {
                             Token* list_name = advance_parser(parser);
-                            character->linked_list_names[ll_index] = strdup(list_name->lexeme);
+                            SdcSize ll_index = character->linked_list_count;
+                            if (ll_index == ll_capacity) {
+                                ll_capacity = ll_capacity ? ll_capacity * 2 : 8;
+                                character->linked_list_names = (char**)realloc(
+                                    character->linked_list_names, sizeof(char*) * ll_capacity);
+                                character->linked_list_data = (LinkedListData*)realloc(
+                                    character->linked_list_data, sizeof(LinkedListData) * ll_capacity);
+                            }
+                            character->linked_list_names[ll_index] = token_text(parser, list_name);
+                            memset(&character->linked_list_data[ll_index], 0, sizeof(LinkedListData));
+                            character->linked_list_count++;
                             
                             if (!expect(parser, TOKEN_COLON, "Expected ':' after list name")) return false;
                             
-                            character->linked_list_data[ll_index] = parse_linked_list_data_value(parser);
-                            ll_index++;
+                            character->linked_list_data[ll_index] = 
+                                parse_linked_list_data_value(parser, character->linked_list_names[ll_index]);
                         } else {
                             advance_parser(parser);
                         }
@@ -1144,30 +1605,18 @@ static bool parse_states(Parser* parser) {
     if (!expect(parser, TOKEN_STATES, "Expected 'states'")) return false;
     if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'states'")) return false;
     
-    // Count states first
-    int count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            count++;
-            advance_parser(parser);
-        } else {
-            advance_parser(parser);
-        }
-        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-    }
-    parser->current = saved_pos;
-    
-    // Allocate state array
-    parser->story->states = (State*)calloc(count, sizeof(State));
-    parser->story->state_count = count;
+    parser->story->states = NULL;
+    parser->story->state_count = 0;
+    SdcSize capacity = 0;
     
     // Parse states
-    int state_index = 0;
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
             Token* state_token = advance_parser(parser);
-            parser->story->states[state_index++].name = strdup(state_token->value.string);
+            StoryData* story = parser->story;
+            story->states = (State*)reserve_item(story->states,
+                story->state_count, &capacity, sizeof(State));
+            story->states[story->state_count++].name = token_string(parser, state_token);
         } else {
             advance_parser(parser);
         }
@@ -1178,75 +1627,70 @@ static bool parse_states(Parser* parser) {
     return true;
 }
 
+// Only string variables own their default. Drop a default whose kind
+// does not match the type, which may be declared before or after it.
+static void settle_default(GlobalVariable* var, bool string_default) {
+    if ((var->type == SDC_VAR_TYPE_STRING) == string_default) return;
+    if (string_default) free(var->default_value.string_value);
+    memset(&var->default_value, 0, sizeof(var->default_value));
+}
+
 // Parse global_vars section
 static bool parse_global_vars(Parser* parser) {
     if (!expect(parser, TOKEN_GLOBAL_VARS, "Expected 'global_vars'")) return false;
     if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'global_vars'")) return false;
     
-    // Count variables first
-    int count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            count++;
-            advance_parser(parser);
-            if (check(parser, TOKEN_COLON)) {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_LBRACE)) {
-                int brace_count = 1;
-                advance_parser(parser);
-                while (brace_count > 0 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_count++;
-                    if (check(parser, TOKEN_RBRACE)) brace_count--;
-                    advance_parser(parser);
-                }
-            }
-        } else {
-            advance_parser(parser);
-        }
-        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-    }
-    parser->current = saved_pos;
-    
-    // Allocate variable array
-    parser->story->global_vars = (GlobalVariable*)calloc(count, sizeof(GlobalVariable));
-    parser->story->global_var_count = count;
+    parser->story->global_vars = NULL;
+    parser->story->global_var_count = 0;
+    SdcSize capacity = 0;
     
     // Parse variables
-    int var_index = 0;
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
             Token* name_token = advance_parser(parser);
-            GlobalVariable* var = &parser->story->global_vars[var_index++];
-            var->name = strdup(name_token->value.string);
+            StoryData* story = parser->story;
+            story->global_vars = (GlobalVariable*)reserve_item(story->global_vars,
+                story->global_var_count, &capacity, sizeof(GlobalVariable));
+            GlobalVariable* var = &story->global_vars[story->global_var_count++];
+            memset(var, 0, sizeof(GlobalVariable));
+            var->name = token_string(parser, name_token);
             
             if (!expect(parser, TOKEN_COLON, "Expected ':' after variable name")) return false;
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after ':'")) return false;
             
             // Parse variable properties
+            bool string_default = false;
             while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                 if (match(parser, TOKEN_TYPE)) {
-                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'type'")) return false;
+                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'type'")) {
+                        settle_default(var, string_default);
+                        return false;
+                    }
                     Token* type_token = advance_parser(parser);
                     
-                    if (strcmp(type_token->value.string, "string") == 0) {
+                    if (token_string_equals(type_token, "string")) {
                         var->type = SDC_VAR_TYPE_STRING;
-                    } else if (strcmp(type_token->value.string, "int") == 0) {
+                    } else if (token_string_equals(type_token, "int")) {
                         var->type = SDC_VAR_TYPE_INT;
-                    } else if (strcmp(type_token->value.string, "bool") == 0) {
+                    } else if (token_string_equals(type_token, "bool")) {
                         var->type = SDC_VAR_TYPE_BOOL;
-                    } else if (strcmp(type_token->value.string, "float") == 0) {
+                    } else if (token_string_equals(type_token, "float")) {
                         var->type = SDC_VAR_TYPE_FLOAT;
                     }
                 } else if (match(parser, TOKEN_DEFAULT)) {
-                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'default'")) return false;
+                    if (!expect(parser, TOKEN_COLON, "Expected ':' after 'default'")) {
+                        settle_default(var, string_default);
+                        return false;
+                    }
                     
                     Token* default_token = peek_parser(parser);
+                    if (string_default) free(var->default_value.string_value);
+                    string_default = false;
                     
                     if (default_token->type == TOKEN_STRING) {
                         advance_parser(parser);
-                        var->default_value.string_value = strdup(default_token->value.string);
+                        var->default_value.string_value = token_string(parser, default_token);
+                        string_default = true;
                     } else if (default_token->type == TOKEN_NUMBER) {
                         advance_parser(parser);
                         var->default_value.int_value = default_token->value.number;
@@ -1258,6 +1702,7 @@ static bool parse_global_vars(Parser* parser) {
                         var->default_value.bool_value = default_token->value.bool_value;
                     } else {
                         set_error(parser, "Expected default value");
+                        settle_default(var, string_default);
                         return false;
                     }
                 } else {
@@ -1266,6 +1711,7 @@ static bool parse_global_vars(Parser* parser) {
                 
                 if (check(parser, TOKEN_COMMA)) advance_parser(parser);
             }
+            settle_default(var, string_default);
             
             if (!expect(parser, TOKEN_RBRACE, "Expected '}' after variable definition")) return false;
         } else {
@@ -1284,41 +1730,19 @@ static bool parse_tags(Parser* parser) {
     if (!expect(parser, TOKEN_TAGS, "Expected 'tags'")) return false;
     if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'tags'")) return false;
     
-    // Count tags first
-    int count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            count++;
-            advance_parser(parser);
-            if (check(parser, TOKEN_COLON)) {
-                advance_parser(parser);
-            }
-            if (check(parser, TOKEN_LBRACE)) {
-                int brace_count = 1;
-                advance_parser(parser);
-                while (brace_count > 0 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_count++;
-                    if (check(parser, TOKEN_RBRACE)) brace_count--;
-                    advance_parser(parser);
-                }
-            }
-        } else {
-            advance_parser(parser);
-        }
-        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-    }
-    parser->current = saved_pos;
-    
-    // Allocate tag array
-    parser->story->tags = (TagDefinition*)calloc(count, sizeof(TagDefinition));
-    parser->story->tag_count = count;
+    parser->story->tags = NULL;
+    parser->story->tag_count = 0;
+    SdcSize capacity = 0;
     
     // Parse tags
-    int tag_index = 0;
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
-            if (!parse_tag_definition(parser, &parser->story->tags[tag_index++])) {
+            StoryData* story = parser->story;
+            story->tags = (TagDefinition*)reserve_item(story->tags,
+                story->tag_count, &capacity, sizeof(TagDefinition));
+            TagDefinition* tag = &story->tags[story->tag_count++];
+            memset(tag, 0, sizeof(TagDefinition));
+            if (!parse_tag_definition(parser, tag)) {
                 return false;
             }
         } else {
@@ -1334,7 +1758,7 @@ static bool parse_tags(Parser* parser) {
 static bool parse_tag_definition(Parser* parser, TagDefinition* tag) {
     // Tag name
     Token* name_token = advance_parser(parser);
-    tag->name = strdup(name_token->value.string);
+    tag->name = token_string(parser, name_token);
     
     if (!expect(parser, TOKEN_COLON, "Expected ':' after tag name")) return false;
     if (!expect(parser, TOKEN_LBRACE, "Expected '{' after ':'")) return false;
@@ -1349,38 +1773,31 @@ static bool parse_tag_definition(Parser* parser, TagDefinition* tag) {
         if (match(parser, TOKEN_TYPE)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'type'")) return false;
             Token* type_token = advance_parser(parser);
-            if (strcmp(type_token->value.string, "key-value") == 0) {
+            if (token_string_equals(type_token, "key-value")) {
                 tag->type = SDC_TAG_TYPE_KEYVALUE;
-            } else if (strcmp(type_token->value.string, "single") == 0) {
+            } else if (token_string_equals(type_token, "single")) {
                 tag->type = SDC_TAG_TYPE_SINGLE;
             }
         } else if (match(parser, TOKEN_COLOR)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'color'")) return false;
             Token* color_token = advance_parser(parser);
-            tag->color = strdup(color_token->value.string);
+            tag->color = token_string(parser, color_token);
         } else if (match(parser, TOKEN_KEYS)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'keys'")) return false;
             if (!expect(parser, TOKEN_LBRACKET, "Expected '[' after 'keys:'")) return false;
             
-            // Count keys
-            int key_count = 0;
-            int saved_pos = parser->current;
-            while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-                if (check(parser, TOKEN_STRING)) key_count++;
-                advance_parser(parser);
-                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-            }
-            parser->current = saved_pos;
-            
-            // Allocate and parse keys
-            tag->keys = (char**)malloc(sizeof(char*) * key_count);
-            tag->key_count = key_count;
+            tag->keys = NULL;
+            tag->key_count = 0;
+            SdcSize key_capacity = 0;
             
-            int key_index = 0;
             while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
                 if (check(parser, TOKEN_STRING)) {
                     Token* key_token = advance_parser(parser);
-                    tag->keys[key_index++] = strdup(key_token->value.string);
+                    tag->keys = (char**)reserve_item(tag->keys, tag->key_count,
+                                                     &key_capacity, sizeof(char*));
+                    tag->keys[tag->key_count++] = token_string(parser, key_token);
+                } else {
+                    advance_parser(parser);
                 }
                 if (check(parser, TOKEN_COMMA)) advance_parser(parser);
             }
@@ -1398,6 +1815,7 @@ static bool parse_tag_definition(Parser* parser, TagDefinition* tag) {
 }
 
 static bool parse_chapter(Parser* parser, Chapter* chapter) {
+    hash_begin(parser, 0);
     if (!expect(parser, TOKEN_CHAPTER, "Expected 'chapter'")) return false;
     
     Token* id_token = advance_parser(parser);
@@ -1415,56 +1833,35 @@ static bool parse_chapter(Parser* parser, Chapter* chapter) {
         if (match(parser, TOKEN_NAME)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'name'")) return false;
             Token* name_token = advance_parser(parser);
-            chapter->name = strdup(name_token->value.string);
+            chapter->name = token_string(parser, name_token);
         } else {
             advance_parser(parser);
         }
     }
     
     if (!expect(parser, TOKEN_RBRACE, "Expected '}' after chapter")) return false;
+    chapter->content_hash = parser->hashes[0];
+    parser->hashing = 0;
     return true;
 }
 
 static bool parse_group_tags(Parser* parser, Group* group) {
     if (!expect(parser, TOKEN_LBRACKET, "Expected '[' for tags")) return false;
     
-    // Count tags
-    int tag_count = 0;
-    int saved_pos = parser->current;
-    while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_STRING)) {
-            tag_count++;
-            advance_parser(parser);
-            if (check(parser, TOKEN_COLON)) {
-                advance_parser(parser);
-                if (check(parser, TOKEN_LBRACE)) {
-                    int brace_count = 1;
-                    advance_parser(parser);
-                    while (brace_count > 0 && !is_at_end_parser(parser)) {
-                        if (check(parser, TOKEN_LBRACE)) brace_count++;
-                        if (check(parser, TOKEN_RBRACE)) brace_count--;
-                        advance_parser(parser);
-                    }
-                }
-            }
-        } else {
-            advance_parser(parser);
-        }
-        if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-    }
-    parser->current = saved_pos;
-    
-    group->tags = (GroupTag*)calloc(tag_count, sizeof(GroupTag));
-    group->tag_count = tag_count;
+    group->tags = NULL;
+    group->tag_count = 0;
+    SdcSize capacity = 0;
     
     // Parse tags
-    int tag_index = 0;
     while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
         if (check(parser, TOKEN_STRING)) {
             Token* tag_name = advance_parser(parser);
-            group->tags[tag_index].tag_name = strdup(tag_name->value.string);
-            group->tags[tag_index].selected_key = NULL;
-            group->tags[tag_index].value = NULL;
+            group->tags = (GroupTag*)reserve_item(group->tags, group->tag_count,
+                                                  &capacity, sizeof(GroupTag));
+            GroupTag* tag = &group->tags[group->tag_count++];
+            tag->tag_name = token_string(parser, tag_name);
+            tag->selected_key = NULL;
+            tag->value = NULL;
             
             if (match(parser, TOKEN_COLON)) {
                 if (check(parser, TOKEN_LBRACE)) {
@@ -1473,11 +1870,11 @@ static bool parse_group_tags(Parser* parser, Group* group) {
                     while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                         if (check(parser, TOKEN_STRING)) {
                             Token* key = advance_parser(parser);
-                            group->tags[tag_index].selected_key = strdup(key->value.string);
+                            tag->selected_key = token_string(parser, key);
                             
                             if (match(parser, TOKEN_COLON)) {
                                 Token* value = advance_parser(parser);
-                                group->tags[tag_index].value = strdup(value->value.string);
+                                tag->value = token_string(parser, value);
                             }
                         } else {
                             advance_parser(parser);
@@ -1488,8 +1885,6 @@ static bool parse_group_tags(Parser* parser, Group* group) {
                     if (!expect(parser, TOKEN_RBRACE, "Expected '}' after tag object")) return false;
                 }
             }
-            
-            tag_index++;
         } else {
             advance_parser(parser);
         }
@@ -1523,71 +1918,51 @@ static bool parse_node_graph(Parser* parser, NodeGraph* graph) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'points'")) return false;
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after 'points:'")) return false;
             
-            // Count points
-            int point_count = 0;
-            int saved_pos = parser->current;
-            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                if (check(parser, TOKEN_NUMBER)) {
-                    point_count++;
-                    advance_parser(parser);
-                    if (check(parser, TOKEN_COLON)) {
-                        advance_parser(parser);
-                        if (check(parser, TOKEN_LBRACKET)) {
-                            int bracket_count = 1;
-                            advance_parser(parser);
-                            while (bracket_count > 0 && !is_at_end_parser(parser)) {
-                                if (check(parser, TOKEN_LBRACKET)) bracket_count++;
-                                if (check(parser, TOKEN_RBRACKET)) bracket_count--;
-                                advance_parser(parser);
-                            }
-                        }
-                    }
-                } else {
-                    advance_parser(parser);
-                }
-                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-            }
-            parser->current = saved_pos;
-            
-            graph->point_keys = (int*)malloc(sizeof(int) * point_count);
-            graph->point_values = (int**)malloc(sizeof(int*) * point_count);
-            graph->point_value_counts = (int*)malloc(sizeof(int) * point_count);
-            graph->point_count = point_count;
+            graph->point_keys = NULL;
+            graph->point_values = NULL;
+            graph->point_value_counts = NULL;
+            graph->point_count = 0;
+            SdcSize point_capacity = 0;
             
-            int point_index = 0;
             while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                 if (check(parser, TOKEN_NUMBER)) {
                     Token* key = advance_parser(parser);
+                    SdcSize point_index = graph->point_count;
+                    if (point_index == point_capacity) {
+                        point_capacity = point_capacity ? point_capacity * 2 : 8;
+                        graph->point_keys = (int*)realloc(graph->point_keys, sizeof(int) * point_capacity);
+                        graph->point_values = (int**)realloc(graph->point_values, sizeof(int*) * point_capacity);
+                        graph->point_value_counts = (SdcSize*)realloc(graph->point_value_counts,
+                                                                      sizeof(SdcSize) * point_capacity);
+                    }
                     graph->point_keys[point_index] = (int)key->value.number;
+                    graph->point_values[point_index] = NULL;
+                    graph->point_value_counts[point_index] = 0;
+                    graph->point_count++;
                     
                     if (expect(parser, TOKEN_COLON, "Expected ':' after point key")) {
                         if (expect(parser, TOKEN_LBRACKET, "Expected '[' for point values")) {
-                            // Count values
-                            int value_count = 0;
-                            int saved_pos2 = parser->current;
-                            while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-                                if (check(parser, TOKEN_NUMBER)) value_count++;
-                                advance_parser(parser);
-                                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                            }
-                            parser->current = saved_pos2;
-                            
-                            graph->point_values[point_index] = (int*)malloc(sizeof(int) * value_count);
-                            graph->point_value_counts[point_index] = value_count;
+                            int* values = NULL;
+                            SdcSize value_count = 0;
+                            SdcSize value_capacity = 0;
                             
-                            int value_index = 0;
                             while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
                                 if (check(parser, TOKEN_NUMBER)) {
                                     Token* val = advance_parser(parser);
-                                    graph->point_values[point_index][value_index++] = (int)val->value.number;
+                                    values = (int*)reserve_item(values, value_count, &value_capacity, sizeof(int));
+                                    values[value_count++] = (int)val->value.number;
+                                } else {
+                                    advance_parser(parser);
                                 }
                                 if (check(parser, TOKEN_COMMA)) advance_parser(parser);
                             }
                             
+                            graph->point_values[point_index] = values;
+                            graph->point_value_counts[point_index] = value_count;
+                            
                             expect(parser, TOKEN_RBRACKET, "Expected ']' after point values");
                         }
                     }
-                    point_index++;
                 } else {
                     advance_parser(parser);
                 }
@@ -1607,6 +1982,7 @@ static bool parse_node_graph(Parser* parser, NodeGraph* graph) {
 }
 
 static bool parse_group(Parser* parser, Group* group) {
+    hash_begin(parser, 0);
     if (!expect(parser, TOKEN_GROUP, "Expected 'group'")) return false;
     
     Token* id_token = advance_parser(parser);
@@ -1632,11 +2008,11 @@ static bool parse_group(Parser* parser, Group* group) {
         } else if (match(parser, TOKEN_NAME)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'name'")) return false;
             Token* name_token = advance_parser(parser);
-            group->name = strdup(name_token->value.string);
+            group->name = token_string(parser, name_token);
         } else if (match(parser, TOKEN_CONTENT)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'content'")) return false;
             Token* content_token = advance_parser(parser);
-            group->content = strdup(content_token->value.string);
+            group->content = token_string(parser, content_token);
         } else if (match(parser, TOKEN_PARENT_GROUP)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'parentGroup'")) return false;
             Token* parent_token = advance_parser(parser);
@@ -1651,25 +2027,19 @@ static bool parse_group(Parser* parser, Group* group) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'linked-lists'")) return false;
             if (!expect(parser, TOKEN_LBRACKET, "Expected '['")) return false;
             
-            // Count linked lists
-            int count = 0;
-            int saved_pos = parser->current;
-            while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-                if (check(parser, TOKEN_STRING)) count++;
-                advance_parser(parser);
-                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-            }
-            parser->current = saved_pos;
-            
-            group->linked_list_count = count;
-            group->linked_lists = (char**)malloc(sizeof(char*) * count);
+            group->linked_lists = NULL;
+            group->linked_list_count = 0;
+            SdcSize capacity = 0;
             
             // Parse linked lists
-            int index = 0;
             while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
                 if (check(parser, TOKEN_STRING)) {
                     Token* list_name = advance_parser(parser);
-                    group->linked_lists[index++] = strdup(list_name->value.string);
+                    group->linked_lists = (char**)reserve_item(group->linked_lists,
+                        group->linked_list_count, &capacity, sizeof(char*));
+                    group->linked_lists[group->linked_list_count++] = token_string(parser, list_name);
+                } else {
+                    advance_parser(parser);
                 }
                 if (check(parser, TOKEN_COMMA)) advance_parser(parser);
             }
@@ -1683,126 +2053,126 @@ static bool parse_group(Parser* parser, Group* group) {
     }
     
     if (!expect(parser, TOKEN_RBRACE, "Expected '}' after group")) return false;
+    group->content_hash = parser->hashes[0];
+    parser->hashing = 0;
     return true;
 }
 
+// Append a zeroed payload and return its index
+static uint32_t story_add_dialogue(StoryData* story) {
+    if (story->dialogue_count >= story->dialogue_capacity) {
+        story->dialogue_capacity = story->dialogue_capacity ? story->dialogue_capacity * 2 : 64;
+        story->dialogues = (Dialogue*)realloc(story->dialogues,
+            sizeof(Dialogue) * story->dialogue_capacity);
+        story->dialogue_hashes = (uint64_t*)realloc(story->dialogue_hashes,
+            sizeof(uint64_t) * story->dialogue_capacity);
+    }
+    memset(&story->dialogues[story->dialogue_count], 0, sizeof(Dialogue));
+    story->dialogue_hashes[story->dialogue_count] = 0;
+    return (uint32_t)story->dialogue_count++;
+}
+
+static uint32_t story_add_action(StoryData* story) {
+    if (story->action_count >= story->action_capacity) {
+        story->action_capacity = story->action_capacity ? story->action_capacity * 2 : 64;
+        story->actions = (Action*)realloc(story->actions,
+            sizeof(Action) * story->action_capacity);
+        story->action_hashes = (uint64_t*)realloc(story->action_hashes,
+            sizeof(uint64_t) * story->action_capacity);
+    }
+    memset(&story->actions[story->action_count], 0, sizeof(Action));
+    story->action_hashes[story->action_count] = 0;
+    return (uint32_t)story->action_count++;
+}
+
+// Switch an action to another kind. The kinds share storage, so whatever
+// an earlier key stored for the old kind is released first.
+static void action_set_type(Action* action, ActionType type) {
+    if (action->type == type) return;
+    free_action(action);
+    memset(&action->data, 0, sizeof(action->data));
+    action->type = type;
+}
+
+// Append a zeroed item to the node's timeline
+static TimelineItem* timeline_add(Node* node, SdcSize* capacity) {
+    node->timeline = (TimelineItem*)reserve_item(node->timeline, node->timeline_count,
+                                                 capacity, sizeof(TimelineItem));
+    TimelineItem* item = &node->timeline[node->timeline_count++];
+    memset(item, 0, sizeof(TimelineItem));
+    return item;
+}
+
 static bool parse_timeline(Parser* parser, Node* node) {
     if (!expect(parser, TOKEN_LBRACE, "Expected '{' for timeline")) return false;
     
-    int item_count = 0;
-    int saved_pos = parser->current;
-    int brace_depth = 1;
-    
-    while (brace_depth > 0 && !is_at_end_parser(parser)) {
-        if (check(parser, TOKEN_DIALOGUE)) {
-            item_count++;
-            advance_parser(parser);
-            advance_parser(parser);
-            if (check(parser, TOKEN_LBRACE)) {
-                brace_depth++;
-                advance_parser(parser);
-                while (brace_depth > 1 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_depth++;
-                    if (check(parser, TOKEN_RBRACE)) brace_depth--;
-                    advance_parser(parser);
-                }
-            }
-        } else if (check(parser, TOKEN_ACTION)) {
-            item_count++;
-            advance_parser(parser);
-            advance_parser(parser);
-            if (check(parser, TOKEN_LBRACE)) {
-                brace_depth++;
-                advance_parser(parser);
-                while (brace_depth > 1 && !is_at_end_parser(parser)) {
-                    if (check(parser, TOKEN_LBRACE)) brace_depth++;
-                    if (check(parser, TOKEN_RBRACE)) brace_depth--;
-                    advance_parser(parser);
-                }
-            }
-        } else {
-            if (check(parser, TOKEN_LBRACE)) brace_depth++;
-            if (check(parser, TOKEN_RBRACE)) brace_depth--;
-            advance_parser(parser);
-        }
-    }
-    
-    parser->current = saved_pos;
-    
-    node->timeline = (TimelineItem*)calloc(item_count, sizeof(TimelineItem));
-    node->timeline_count = item_count;
-    
-    int item_index = 0;
+    // A repeated 'timeline' key replaces the earlier one
+    free(node->timeline);
+    node->timeline = NULL;
+    node->timeline_count = 0;
+    SdcSize capacity = 0;
     
-    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser) && item_index < item_count) {
+    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
+        hash_begin(parser, 1);
+        
         if (match(parser, TOKEN_DIALOGUE)) {
             Token* num = advance_parser(parser);
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after dialogue")) return false;
             
-            node->timeline[item_index].type = SDC_TIMELINE_ITEM_DIALOGUE;
-            node->timeline[item_index].number = (int)num->value.number;
-            
-            int line_count = 0;
-            int saved_pos2 = parser->current;
-            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
-                if (check(parser, TOKEN_IDENTIFIER)) {
-                    line_count++;
-                    advance_parser(parser);
-                    if (check(parser, TOKEN_COLON)) {
-                        advance_parser(parser);
-                        if (check(parser, TOKEN_STRING)) {
-                            advance_parser(parser);
-                        }
-                    }
-                } else {
-                    advance_parser(parser);
-                }
-            }
-            parser->current = saved_pos2;
+            TimelineItem* item = timeline_add(node, &capacity);
+            item->type = SDC_TIMELINE_ITEM_DIALOGUE;
+            item->number = (int)num->value.number;
+            item->payload = story_add_dialogue(parser->story);
+            Dialogue* dialogue = &parser->story->dialogues[item->payload];
             
-            node->timeline[item_index].data.dialogue.characters = 
-                (char**)malloc(sizeof(char*) * line_count);
-            node->timeline[item_index].data.dialogue.texts = 
-                (char**)malloc(sizeof(char*) * line_count);
-            node->timeline[item_index].data.dialogue.line_count = line_count;
+            SdcSize line_capacity = 0;
             
-            int line_index = 0;
-            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser) && line_index < line_count) {
+            while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                 Token* character = peek_parser(parser);
-                if (character->type == TOKEN_IDENTIFIER) {
-                    node->timeline[item_index].data.dialogue.characters[line_index] = 
-                        strdup(character->lexeme);
-                    advance_parser(parser);
-                } else {
+                if (character->type != TOKEN_IDENTIFIER) {
                     advance_parser(parser);
                     continue;
                 }
                 
+                SdcSize line_index = dialogue->line_count;
+                if (line_index == line_capacity) {
+                    line_capacity = line_capacity ? line_capacity * 2 : 4;
+                    dialogue->characters = (char**)realloc(dialogue->characters,
+                                                           sizeof(char*) * line_capacity);
+                    dialogue->texts = (char**)realloc(dialogue->texts, sizeof(char*) * line_capacity);
+                }
+                dialogue->characters[line_index] = token_text(parser, character);
+                dialogue->texts[line_index] = NULL;
+                dialogue->line_count++;
+                advance_parser(parser);
+                
                 if (!expect(parser, TOKEN_COLON, "Expected ':' after character")) return false;
                 
                 Token* text = peek_parser(parser);
                 if (text->type == TOKEN_STRING) {
-                    node->timeline[item_index].data.dialogue.texts[line_index] = 
-                        strdup(text->value.string);
+                    dialogue->texts[line_index] = 
+                        token_string(parser, text);
                     advance_parser(parser);
                 } else {
                     set_error(parser, "Expected dialogue text");
                     return false;
                 }
-                
-                line_index++;
             }
             
             if (!expect(parser, TOKEN_RBRACE, "Expected '}' after dialogue")) return false;
-            item_index++;
+            parser->story->dialogue_hashes[item->payload] = parser->hashes[1];
             
         } else if (match(parser, TOKEN_ACTION)) {
             Token* num = advance_parser(parser);
             if (!expect(parser, TOKEN_LBRACE, "Expected '{' after action")) return false;
             
-            node->timeline[item_index].type = SDC_TIMELINE_ITEM_ACTION;
-            node->timeline[item_index].number = (int)num->value.number;
-            node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_CODE;
+            TimelineItem* item = timeline_add(node, &capacity);
+            item->type = SDC_TIMELINE_ITEM_ACTION;
+            item->number = (int)num->value.number;
+            item->payload = story_add_action(parser->story);
+            Action* action = &parser->story->actions[item->payload];
+            action->number = item->number;
+            action->type = SDC_ACTION_TYPE_CODE;
             
             int action_brace_depth = 1;
             while (action_brace_depth > 0 && !is_at_end_parser(parser)) {
@@ -1813,14 +2183,15 @@ static bool parse_timeline(Parser* parser, Node* node) {
                     if (type_token->type == TOKEN_STRING) {
                         advance_parser(parser);
                         
-                        if (strcmp(type_token->value.string, "code") == 0) {
-                            node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_CODE;
+                        if (token_string_equals(type_token, "code")) {
+                            action_set_type(action, SDC_ACTION_TYPE_CODE);
                             
                             while (action_brace_depth > 0 && !is_at_end_parser(parser)) {
                                 if (check(parser, TOKEN_CODE_BLOCK)) {
                                     Token* code_token = advance_parser(parser);
-                                    node->timeline[item_index].data.action.data.code.code = 
-                                        strdup(code_token->value.string);
+                                    free(action->data.code.code);
+                                    action->data.code.code = 
+                                        token_string(parser, code_token);
                                 }
                                 if (check(parser, TOKEN_LBRACE)) action_brace_depth++;
                                 if (check(parser, TOKEN_RBRACE)) {
@@ -1830,11 +2201,13 @@ static bool parse_timeline(Parser* parser, Node* node) {
                                 advance_parser(parser);
                             }
                             break;
-                        } else if (strcmp(type_token->value.string, "event") == 0) {
-                            node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_EVENT;
-                            node->timeline[item_index].data.action.data.event.event_type = SDC_EVENT_TYPE_UNKNOWN;
-                        } else if (strcmp(type_token->value.string, "choice") == 0) {
-                            node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_CHOICE;
+                        } else if (token_string_equals(type_token, "event")) {
+                            if (action->type != SDC_ACTION_TYPE_EVENT) {
+                                action_set_type(action, SDC_ACTION_TYPE_EVENT);
+                                action->data.event.event_type = SDC_EVENT_TYPE_UNKNOWN;
+                            }
+                        } else if (token_string_equals(type_token, "choice")) {
+                            action_set_type(action, SDC_ACTION_TYPE_CHOICE);
                         }
                     } else {
                         advance_parser(parser);
@@ -1844,7 +2217,9 @@ static bool parse_timeline(Parser* parser, Node* node) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'data'")) return false;
                     if (!expect(parser, TOKEN_LBRACE, "Expected '{' after 'data:'")) return false;
                     
-                    EventActionData* event = &node->timeline[item_index].data.action.data.event;
+                    action_set_type(action, SDC_ACTION_TYPE_EVENT);
+                    
+                    EventActionData* event = &action->data.event;
                     event->event_type = SDC_EVENT_TYPE_UNKNOWN;
                     
                     int data_brace_depth = 1;
@@ -1854,13 +2229,13 @@ static bool parse_timeline(Parser* parser, Node* node) {
                             Token* event_type = advance_parser(parser);
                             
                             if (event_type->type == TOKEN_STRING) {
-                                if (strcmp(event_type->value.string, "next-node") == 0) {
+                                if (token_string_equals(event_type, "next-node")) {
                                     event->event_type = SDC_EVENT_TYPE_NEXT_NODE;
-                                } else if (strcmp(event_type->value.string, "exit-current-node") == 0) {
+                                } else if (token_string_equals(event_type, "exit-current-node")) {
                                     event->event_type = SDC_EVENT_TYPE_EXIT_CURRENT_NODE;
-                                } else if (strcmp(event_type->value.string, "exit-current-group") == 0) {
+                                } else if (token_string_equals(event_type, "exit-current-group")) {
                                     event->event_type = SDC_EVENT_TYPE_EXIT_CURRENT_GROUP;
-                                } else if (strcmp(event_type->value.string, "adjust-variable") == 0) {
+                                } else if (token_string_equals(event_type, "adjust-variable")) {
                                     event->event_type = SDC_EVENT_TYPE_ADJUST_VARIABLE;
                                     event->data.adjust_variable.name = NULL;
                                     event->data.adjust_variable.value = NULL;
@@ -1868,72 +2243,51 @@ static bool parse_timeline(Parser* parser, Node* node) {
                                     event->data.adjust_variable.is_toggle = false;
                                     event->data.adjust_variable.has_increment = false;
                                     event->data.adjust_variable.has_value = false;
-                                } else if (strcmp(event_type->value.string, "add-state") == 0) {
+                                } else if (token_string_equals(event_type, "add-state")) {
                                     event->event_type = SDC_EVENT_TYPE_ADD_STATE;
                                     event->data.add_state.name = NULL;
                                     event->data.add_state.character = NULL;
-                                } else if (strcmp(event_type->value.string, "remove-state") == 0) {
+                                } else if (token_string_equals(event_type, "remove-state")) {
                                     event->event_type = SDC_EVENT_TYPE_REMOVE_STATE;
                                     event->data.remove_state.name = NULL;
                                     event->data.remove_state.character = NULL;
-                                } else if (strcmp(event_type->value.string, "progress-story") == 0) {
+                                } else if (token_string_equals(event_type, "progress-story")) {
                                     event->event_type = SDC_EVENT_TYPE_PROGRESS_STORY;
                                     event->data.progress_story.chapter_id = -1;
                                     event->data.progress_story.group_id = -1;
                                     event->data.progress_story.node_id = -1;
-                                } else if (strcmp(event_type->value.string, "linked-list") == 0) {
+                                } else if (token_string_equals(event_type, "linked-list")) {
                                     event->event_type = SDC_EVENT_TYPE_LINKED_LIST;
                                     event->data.linked_list.reference = NULL;
                                     event->data.linked_list.modifications = NULL;
                                     event->data.linked_list.modification_count = 0;
                                     
                                     // Parse reference and values
-                                    while (!check(parser, TOKEN_RBRACE) && data_brace_depth > 0) {
+                                    while (!check(parser, TOKEN_RBRACE) && !is_at_end_parser(parser)) {
                                         if (match(parser, TOKEN_REFERENCE)) {
                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                             Token* ref = advance_parser(parser);
-                                            event->data.linked_list.reference = strdup(ref->value.string);
+                                            event->data.linked_list.reference = token_string(parser, ref);
                                         } else if (match(parser, TOKEN_VALUES)) {
                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                             if (!expect(parser, TOKEN_LBRACKET, "Expected '['")) return false;
                                             
-                                            // Count modifications
-                                            int mod_count = 0;
-                                            int saved_pos3 = parser->current;
-                                            while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
-                                                if (check(parser, TOKEN_STRING)) {
-                                                    mod_count++;
-                                                    advance_parser(parser);
-                                                    if (check(parser, TOKEN_COLON)) {
-                                                        advance_parser(parser);
-                                                        if (check(parser, TOKEN_LBRACE)) {
-                                                            int depth = 1;
-                                                            advance_parser(parser);
-                                                            while (depth > 0 && !is_at_end_parser(parser)) {
-                                                                if (check(parser, TOKEN_LBRACE)) depth++;
-                                                                if (check(parser, TOKEN_RBRACE)) depth--;
-                                                                advance_parser(parser);
-                                                            }
-                                                        }
-                                                    }
-                                                } else {
-                                                    advance_parser(parser);
-                                                }
-                                                if (check(parser, TOKEN_COMMA)) advance_parser(parser);
-                                            }
-                                            parser->current = saved_pos3;
-                                            
-                                            event->data.linked_list.modification_count = mod_count;
-                                            event->data.linked_list.modifications = 
-                                                (LinkedListFieldModification*)calloc(mod_count, sizeof(LinkedListFieldModification));
+                                            LinkedListEventData* list_event = &event->data.linked_list;
+                                            list_event->modifications = NULL;
+                                            list_event->modification_count = 0;
+                                            SdcSize mod_capacity = 0;
                                             
                                             // Parse modifications
-                                            int mod_idx = 0;
                                             while (!check(parser, TOKEN_RBRACKET) && !is_at_end_parser(parser)) {
                                                 if (check(parser, TOKEN_STRING)) {
                                                     Token* field_name = advance_parser(parser);
-                                                    LinkedListFieldModification* mod = &event->data.linked_list.modifications[mod_idx++];
-                                                    mod->field = strdup(field_name->value.string);
+                                                    list_event->modifications = (LinkedListFieldModification*)reserve_item(
+                                                        list_event->modifications, list_event->modification_count,
+                                                        &mod_capacity, sizeof(LinkedListFieldModification));
+                                                    LinkedListFieldModification* mod =
+                                                        &list_event->modifications[list_event->modification_count++];
+                                                    memset(mod, 0, sizeof(LinkedListFieldModification));
+                                                    mod->field = token_string(parser, field_name);
                                                     mod->has_amount = false;
                                                     mod->has_set = false;
                                                     mod->has_append = false;
@@ -1956,22 +2310,22 @@ static bool parse_timeline(Parser* parser, Node* node) {
                                                         } else if (match(parser, TOKEN_SET)) {
                                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                                             Token* val = advance_parser(parser);
-                                                            mod->set_value = strdup(val->value.string);
+                                                            mod->set_value = token_string(parser, val);
                                                             mod->has_set = true;
                                                         } else if (match(parser, TOKEN_APPEND)) {
                                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                                             Token* val = advance_parser(parser);
-                                                            mod->append_value = strdup(val->value.string);
+                                                            mod->append_value = token_string(parser, val);
                                                             mod->has_append = true;
                                                         } else if (match(parser, TOKEN_REPLACE)) {
                                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                                             Token* val = advance_parser(parser);
-                                                            mod->replace_value = strdup(val->value.string);
+                                                            mod->replace_value = token_string(parser, val);
                                                             mod->has_replace = true;
                                                         } else if (match(parser, TOKEN_TOGGLE)) {
                                                             if (!expect(parser, TOKEN_COLON, "Expected ':'")) return false;
                                                             Token* val = advance_parser(parser);
-                                                            mod->is_toggle = (strcmp(val->value.string, "toggle") == 0);
+                                                            mod->is_toggle = (token_string_equals(val, "toggle"));
                                                         } else {
                                                             advance_parser(parser);
                                                         }
@@ -1986,6 +2340,8 @@ static bool parse_timeline(Parser* parser, Node* node) {
                                             }
                                             
                                             if (!expect(parser, TOKEN_RBRACKET, "Expected ']'")) return false;
+                                        } else {
+                                            advance_parser(parser);
                                         }
                                         
                                         if (check(parser, TOKEN_COMMA)) advance_parser(parser);
@@ -1996,13 +2352,13 @@ static bool parse_timeline(Parser* parser, Node* node) {
                             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'name'")) return false;
                             Token* name = advance_parser(parser);
                             if (event->event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE) {
-                                event->data.adjust_variable.name = strdup(name->value.string);
+                                event->data.adjust_variable.name = token_string(parser, name);
                             } else if (event->event_type == SDC_EVENT_TYPE_ADD_STATE || 
                                       event->event_type == SDC_EVENT_TYPE_REMOVE_STATE) {
                                 if (event->event_type == SDC_EVENT_TYPE_ADD_STATE) {
-                                    event->data.add_state.name = strdup(name->value.string);
+                                    event->data.add_state.name = token_string(parser, name);
                                 } else {
-                                    event->data.remove_state.name = strdup(name->value.string);
+                                    event->data.remove_state.name = token_string(parser, name);
                                 }
                             }
                         } else if (match(parser, TOKEN_INCREMENT)) {
@@ -2020,7 +2376,7 @@ static bool parse_timeline(Parser* parser, Node* node) {
                             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'value'")) return false;
                             Token* val = advance_parser(parser);
                             if (event->event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE) {
-                                event->data.adjust_variable.value = strdup(val->value.string);
+                                event->data.adjust_variable.value = token_string(parser, val);
                                 event->data.adjust_variable.has_value = true;
                             }
                         } else if (match(parser, TOKEN_TOGGLE)) {
@@ -2028,15 +2384,15 @@ static bool parse_timeline(Parser* parser, Node* node) {
                             Token* tog = advance_parser(parser);
                             if (event->event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE) {
                                 event->data.adjust_variable.is_toggle = 
-                                    (strcmp(tog->value.string, "toggle") == 0);
+                                    (token_string_equals(tog, "toggle"));
                             }
                         } else if (match(parser, TOKEN_CHARACTER)) {
                             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'character'")) return false;
                             Token* chr = advance_parser(parser);
                             if (event->event_type == SDC_EVENT_TYPE_ADD_STATE) {
-                                event->data.add_state.character = strdup(chr->value.string);
+                                event->data.add_state.character = token_string(parser, chr);
                             } else if (event->event_type == SDC_EVENT_TYPE_REMOVE_STATE) {
-                                event->data.remove_state.character = strdup(chr->value.string);
+                                event->data.remove_state.character = token_string(parser, chr);
                             }
                         } else if (match(parser, TOKEN_CHAPTER)) {
                             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'chapter'")) return false;
@@ -2094,17 +2450,18 @@ static bool parse_timeline(Parser* parser, Node* node) {
                     Token* ref_id = advance_parser(parser);
                     if (!expect(parser, TOKEN_RPAREN, "Expected ')' after reference id")) return false;
                     
-                    if (strcmp(ref_type->lexeme, "node") == 0) {
-                        node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_GOTO;
-                        node->timeline[item_index].data.action.data.goto_action.target_node = 
+                    if (token_text_equals(parser, ref_type, "node")) {
+                        action_set_type(action, SDC_ACTION_TYPE_GOTO);
+                        action->data.goto_action.target_node = 
                             (int)ref_id->value.number;
                     }
                 } else if (match(parser, TOKEN_EXIT)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'exit'")) return false;
                     Token* target = advance_parser(parser);
-                    node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_EXIT;
-                    node->timeline[item_index].data.action.data.exit_action.target = 
-                        strdup(target->value.string);
+                    action_set_type(action, SDC_ACTION_TYPE_EXIT);
+                    free(action->data.exit_action.target);
+                    action->data.exit_action.target = 
+                        token_string(parser, target);
                 } else if (match(parser, TOKEN_ENTER)) {
                     if (!expect(parser, TOKEN_COLON, "Expected ':' after 'enter'")) return false;
                     if (!expect(parser, TOKEN_AT, "Expected '@' for reference")) return false;
@@ -2114,9 +2471,9 @@ static bool parse_timeline(Parser* parser, Node* node) {
                     Token* ref_id = advance_parser(parser);
                     if (!expect(parser, TOKEN_RPAREN, "Expected ')' after reference id")) return false;
                     
-                    if (strcmp(ref_type->lexeme, "group") == 0) {
-                        node->timeline[item_index].data.action.type = SDC_ACTION_TYPE_ENTER;
-                        node->timeline[item_index].data.action.data.enter_action.target_group = 
+                    if (token_text_equals(parser, ref_type, "group")) {
+                        action_set_type(action, SDC_ACTION_TYPE_ENTER);
+                        action->data.enter_action.target_group = 
                             (int)ref_id->value.number;
                     }
                 } else {
@@ -2130,11 +2487,12 @@ static bool parse_timeline(Parser* parser, Node* node) {
             }
             
             if (!expect(parser, TOKEN_RBRACE, "Expected '}' after action")) return false;
-            item_index++;
+            parser->story->action_hashes[item->payload] = parser->hashes[1];
             
         } else {
             advance_parser(parser);
         }
+        parser->hashing = 1;
     }
     
     if (!expect(parser, TOKEN_RBRACE, "Expected '}' after timeline")) return false;
@@ -2142,6 +2500,7 @@ static bool parse_timeline(Parser* parser, Node* node) {
 }
 
 static bool parse_node(Parser* parser, Node* node) {
+    hash_begin(parser, 0);
     if (!expect(parser, TOKEN_NODE, "Expected 'node'")) return false;
     
     Token* id_token = advance_parser(parser);
@@ -2158,11 +2517,11 @@ static bool parse_node(Parser* parser, Node* node) {
         if (match(parser, TOKEN_TITLE)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'title'")) return false;
             Token* title_token = advance_parser(parser);
-            node->title = strdup(title_token->value.string);
+            node->title = token_string(parser, title_token);
         } else if (match(parser, TOKEN_CONTENT)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'content'")) return false;
             Token* content_token = advance_parser(parser);
-            node->content = strdup(content_token->value.string);
+            node->content = token_string(parser, content_token);
         } else if (match(parser, TOKEN_TIMELINE)) {
             if (!expect(parser, TOKEN_COLON, "Expected ':' after 'timeline'")) return false;
             if (!parse_timeline(parser, node)) return false;
@@ -2172,46 +2531,75 @@ static bool parse_node(Parser* parser, Node* node) {
     }
     
     if (!expect(parser, TOKEN_RBRACE, "Expected '}' after node")) return false;
+    node->content_hash = parser->hashes[0];
+    parser->hashing = 0;
     return true;
 }
 
+// Note the span of the top-level block that started at offset start
+static void record_block(Parser* parser, BlockKind kind, SdcSize index, size_t start) {
+    SdcSource* source = parser->source;
+    if (!source) return;
+    
+    source->blocks = (SourceBlock*)reserve_item(source->blocks, source->block_count,
+                                                &source->block_capacity, sizeof(SourceBlock));
+    SourceBlock* block = &source->blocks[source->block_count++];
+    block->kind = kind;
+    block->index = index;
+    block->start = start;
+    block->end = previous(parser)->offset + previous(parser)->length;
+}
+
 static bool parse_story(Parser* parser) {
     while (!is_at_end_parser(parser)) {
+        size_t start = peek_parser(parser)->offset;
+        
         if (check(parser, TOKEN_STATES)) {
             if (!parse_states(parser)) return false;
+            record_block(parser, BLOCK_SECTION, 0, start);
         } else if (check(parser, TOKEN_GLOBAL_VARS)) {
             if (!parse_global_vars(parser)) return false;
+            record_block(parser, BLOCK_SECTION, 0, start);
         } else if (check(parser, TOKEN_TAGS)) {
             if (!parse_tags(parser)) return false;
+            record_block(parser, BLOCK_SECTION, 0, start);
         } else if (check(parser, TOKEN_CHAPTER)) {
             parser->story->chapter_count++;
             parser->story->chapters = (Chapter*)realloc(parser->story->chapters, 
                 sizeof(Chapter) * parser->story->chapter_count);
+            memset(&parser->story->chapters[parser->story->chapter_count - 1], 0, sizeof(Chapter));
             
             if (!parse_chapter(parser, &parser->story->chapters[parser->story->chapter_count - 1])) {
                 return false;
             }
+            record_block(parser, BLOCK_CHAPTER, parser->story->chapter_count - 1, start);
         } else if (check(parser, TOKEN_GROUP)) {
             parser->story->group_count++;
             parser->story->groups = (Group*)realloc(parser->story->groups,
                 sizeof(Group) * parser->story->group_count);
+            memset(&parser->story->groups[parser->story->group_count - 1], 0, sizeof(Group));
             
             if (!parse_group(parser, &parser->story->groups[parser->story->group_count - 1])) {
                 return false;
             }
+            record_block(parser, BLOCK_GROUP, parser->story->group_count - 1, start);
         } else if (check(parser, TOKEN_NODE)) {
             parser->story->node_count++;
             parser->story->nodes = (Node*)realloc(parser->story->nodes,
                 sizeof(Node) * parser->story->node_count);
+            memset(&parser->story->nodes[parser->story->node_count - 1], 0, sizeof(Node));
             
             if (!parse_node(parser, &parser->story->nodes[parser->story->node_count - 1])) {
                 return false;
             }
+            record_block(parser, BLOCK_NODE, parser->story->node_count - 1, start);
         }
         else if (check(parser, TOKEN_LINKED_LISTS)) {
             if (!parse_linked_lists(parser)) return false;
+            record_block(parser, BLOCK_SECTION, 0, start);
         } else if (check(parser, TOKEN_CHARACTERS)) {
             if (!parse_characters(parser)) return false;
+            record_block(parser, BLOCK_SECTION, 0, start);
         } else {
             advance_parser(parser);
         }
@@ -2221,215 +2609,2500 @@ static bool parse_story(Parser* parser) {
 }
 
 // ============================================================================
-// PUBLIC API IMPLEMENTATION
+// RELAYOUT
 // ============================================================================
 
-StoryData* sdc_parse_string(const char* source) {
-    if (!source) return NULL;
-    
-    Lexer* lexer = lexer_create(source);
-    lexer_scan_tokens(lexer);
-    
-    for (int i = 0; i < lexer->token_count; i++) {
-        if (lexer->tokens[i].type == TOKEN_ERROR) {
-            if (last_error) free(last_error);
-            last_error = strdup("Lexer error: invalid token");
-            lexer_free(lexer);
-            return NULL;
+static void free_dialogue(Dialogue* d) {
+    for (SdcSize k = 0; k < d->line_count; k++) {
+        free(d->characters[k]);
+        free(d->texts[k]);
+    }
+    free(d->characters);
+    free(d->texts);
+}
+
+static void free_action(Action* a) {
+    if (a->type == SDC_ACTION_TYPE_CODE) {
+        free(a->data.code.code);
+    } else if (a->type == SDC_ACTION_TYPE_EXIT) {
+        free(a->data.exit_action.target);
+    } else if (a->type == SDC_ACTION_TYPE_CHOICE) {
+        for (SdcSize k = 0; k < a->data.choice.option_count; k++) {
+            ChoiceOption* option = &a->data.choice.options[k];
+            free(option->text);
+            for (SdcSize j = 0; j < option->action_count; j++) {
+                free_action(&option->actions[j]);
+            }
+            free(option->actions);
+        }
+        free(a->data.choice.options);
+    } else if (a->type == SDC_ACTION_TYPE_EVENT) {
+        EventActionData* e = &a->data.event;
+        if (e->event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE) {
+            free(e->data.adjust_variable.name);
+            free(e->data.adjust_variable.value);
+        } else if (e->event_type == SDC_EVENT_TYPE_ADD_STATE) {
+            free(e->data.add_state.name);
+            free(e->data.add_state.character);
+        } else if (e->event_type == SDC_EVENT_TYPE_REMOVE_STATE) {
+            free(e->data.remove_state.name);
+            free(e->data.remove_state.character);
+        } else if (e->event_type == SDC_EVENT_TYPE_LINKED_LIST) {
+            free(e->data.linked_list.reference);
+            for (SdcSize k = 0; k < e->data.linked_list.modification_count; k++) {
+                free(e->data.linked_list.modifications[k].field);
+                free(e->data.linked_list.modifications[k].set_value);
+                free(e->data.linked_list.modifications[k].append_value);
+                free(e->data.linked_list.modifications[k].replace_value);
+            }
+            free(e->data.linked_list.modifications);
         }
     }
+}
+
+static bool timeline_in_pool(StoryData* data, TimelineItem* timeline) {
+    return data->timeline_pool && timeline >= data->timeline_pool &&
+           timeline < data->timeline_pool + data->timeline_pool_count;
+}
+
+static void free_group(Group* group) {
+    free(group->name);
+    free(group->content);
     
-    Parser* parser = parser_create(lexer->tokens, lexer->token_count);
-    
-    if (!parse_story(parser)) {
-        StoryData* failed_story = parser->story;
-        sdc_free(failed_story);
-        parser->story = NULL;
-        parser_free(parser);
-        lexer_free(lexer);
-        return NULL;
+    for (SdcSize j = 0; j < group->tag_count; j++) {
+        free(group->tags[j].tag_name);
+        free(group->tags[j].selected_key);
+        free(group->tags[j].value);
     }
+    free(group->tags);
     
-    StoryData* result = parser->story;
-    parser->story = NULL;
-    
-    parser_free(parser);
-    lexer_free(lexer);
+    for (SdcSize j = 0; j < group->linked_list_count; j++) {
+        free(group->linked_lists[j]);
+    }
+    free(group->linked_lists);
     
-    return result;
+    free(group->nodes.point_keys);
+    for (SdcSize j = 0; j < group->nodes.point_count; j++) {
+        free(group->nodes.point_values[j]);
+    }
+    free(group->nodes.point_values);
+    free(group->nodes.point_value_counts);
 }
 
-StoryData* sdc_parse_file(const char* filename) {
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        if (last_error) free(last_error);
-        last_error = strdup("Failed to open file");
-        return NULL;
+// Frees the node's own fields; its payloads stay in the story arrays
+static void free_node(StoryData* data, Node* node) {
+    free(node->title);
+    free(node->content);
+    if (!timeline_in_pool(data, node->timeline)) {
+        free(node->timeline);
     }
-    
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
-    
-    char* source = (char*)malloc(size + 1);
-    fread(source, 1, size, file);
-    source[size] = '\0';
-    fclose(file);
-    
-    StoryData* result = sdc_parse_string(source);
-    free(source);
-    
-    return result;
 }
 
-void sdc_free(StoryData* data) {
-    if (!data) return;
-    
-    // Free states
-    for (int i = 0; i < data->state_count; i++) {
-        free(data->states[i].name);
+static int compare_id_index(const void* a, const void* b) {
+    const IdIndexEntry* x = (const IdIndexEntry*)a;
+    const IdIndexEntry* y = (const IdIndexEntry*)b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+// Position in the sorted index of the first entry with an id >= id
+static SdcSize id_index_lower_bound(const IdIndexEntry* index, SdcSize count, int id) {
+    SdcSize lo = 0;
+    SdcSize hi = count;
+    while (lo < hi) {
+        SdcSize mid = lo + (hi - lo) / 2;
+        if (index[mid].id < id) lo = mid + 1;
+        else hi = mid;
     }
-    free(data->states);
+    return lo;
+}
+
+// Returns the array position for id, or SDC_NOT_FOUND. With duplicate
+// ids the first entry in array order wins, matching the linear lookups.
+static SdcSize id_index_find(const IdIndexEntry* index, SdcSize count, int id) {
+    SdcSize lo = id_index_lower_bound(index, count, id);
+    return (lo < count && index[lo].id == id) ? index[lo].index : SDC_NOT_FOUND;
+}
+
+static IdIndexEntry* build_node_index(StoryData* data) {
+    IdIndexEntry* index = (IdIndexEntry*)malloc(sizeof(IdIndexEntry) * (data->node_count + 1));
+    for (SdcSize i = 0; i < data->node_count; i++) {
+        index[i].id = data->nodes[i].id;
+        index[i].index = i;
+    }
+    qsort(index, data->node_count, sizeof(IdIndexEntry), compare_id_index);
+    return index;
+}
+
+static IdIndexEntry* build_group_index(StoryData* data) {
+    IdIndexEntry* index = (IdIndexEntry*)malloc(sizeof(IdIndexEntry) * (data->group_count + 1));
+    for (SdcSize i = 0; i < data->group_count; i++) {
+        index[i].id = data->groups[i].id;
+        index[i].index = i;
+    }
+    qsort(index, data->group_count, sizeof(IdIndexEntry), compare_id_index);
+    return index;
+}
+
+// Point the block spans of an editable story at the entries' new positions.
+// order lists the old position of each entry in its new order.
+static void source_remap(SdcSource* source, BlockKind kind, const SdcSize* order, SdcSize count) {
+    if (!source) return;
     
-    // Free global variables
-    for (int i = 0; i < data->global_var_count; i++) {
-        free(data->global_vars[i].name);
-        if (data->global_vars[i].type == SDC_VAR_TYPE_STRING) {
-            free(data->global_vars[i].default_value.string_value);
+    SdcSize* moved = (SdcSize*)malloc(sizeof(SdcSize) * (count + 1));
+    for (SdcSize i = 0; i < count; i++) {
+        moved[order[i]] = i;
+    }
+    for (SdcSize i = 0; i < source->block_count; i++) {
+        if (source->blocks[i].kind == kind) {
+            source->blocks[i].index = moved[source->blocks[i].index];
         }
     }
-    free(data->global_vars);
+    free(moved);
+}
+
+// Append the node with this id to the order if it exists and is not placed
+static void relayout_place(const IdIndexEntry* by_id, SdcSize node_count, int id,
+                           SdcSize* order, bool* placed, SdcSize* placed_count) {
+    SdcSize index = id_index_find(by_id, node_count, id);
+    if (index != SDC_NOT_FOUND && !placed[index]) {
+        placed[index] = true;
+        order[(*placed_count)++] = index;
+    }
+}
+
+void sdc_relayout(StoryData* data) {
+    if (!data) return;
     
-    // Free tags
-    for (int i = 0; i < data->tag_count; i++) {
-        free(data->tags[i].name);
-        free(data->tags[i].color);
-        for (int j = 0; j < data->tags[i].key_count; j++) {
-            free(data->tags[i].keys[j]);
-        }
-        free(data->tags[i].keys);
+    // Groups by chapter, keeping file order within a chapter
+    IdIndexEntry* group_order = (IdIndexEntry*)malloc(sizeof(IdIndexEntry) * (data->group_count + 1));
+    for (SdcSize i = 0; i < data->group_count; i++) {
+        group_order[i].id = data->groups[i].chapter_id;
+        group_order[i].index = i;
     }
-    free(data->tags);
+    qsort(group_order, data->group_count, sizeof(IdIndexEntry), compare_id_index);
     
-    // Free chapters
-    for (int i = 0; i < data->chapter_count; i++) {
-        free(data->chapters[i].name);
+    Group* groups = (Group*)malloc(sizeof(Group) * (data->group_count + 1));
+    SdcSize* moved_groups = (SdcSize*)malloc(sizeof(SdcSize) * (data->group_count + 1));
+    for (SdcSize i = 0; i < data->group_count; i++) {
+        groups[i] = data->groups[group_order[i].index];
+        moved_groups[i] = group_order[i].index;
     }
-    free(data->chapters);
+    source_remap(data->source, BLOCK_GROUP, moved_groups, data->group_count);
+    free(moved_groups);
+    free(data->groups);
+    data->groups = groups;
+    free(group_order);
     
-    // Free groups (updated to include linked_lists)
-    for (int i = 0; i < data->group_count; i++) {
-        free(data->groups[i].name);
-        free(data->groups[i].content);
+    // Node order: breadth-first through each group's graph. The order
+    // array doubles as the BFS queue.
+    SdcSize node_count = data->node_count;
+    IdIndexEntry* by_id = build_node_index(data);
+    SdcSize* order = (SdcSize*)malloc(sizeof(SdcSize) * (node_count + 1));
+    bool* placed = (bool*)calloc(node_count + 1, sizeof(bool));
+    SdcSize placed_count = 0;
+    IdIndexEntry* edges = NULL;
+    SdcSize edge_capacity = 0;
+    
+    for (SdcSize g = 0; g < data->group_count; g++) {
+        NodeGraph* graph = &data->groups[g].nodes;
+        SdcSize head = placed_count;
         
-        for (int j = 0; j < data->groups[i].tag_count; j++) {
-            free(data->groups[i].tags[j].tag_name);
-            free(data->groups[i].tags[j].selected_key);
-            free(data->groups[i].tags[j].value);
+        // The group's points sorted by key, so each dequeued node finds
+        // its points without scanning the whole graph. Points sharing a
+        // key stay in file order.
+        if (graph->point_count > edge_capacity) {
+            edge_capacity = graph->point_count;
+            edges = (IdIndexEntry*)realloc(edges, sizeof(IdIndexEntry) * edge_capacity);
+        }
+        for (SdcSize p = 0; p < graph->point_count; p++) {
+            edges[p].id = graph->point_keys[p];
+            edges[p].index = p;
+        }
+        if (graph->point_count > 1) {
+            qsort(edges, graph->point_count, sizeof(IdIndexEntry), compare_id_index);
         }
-        free(data->groups[i].tags);
         
-        for (int j = 0; j < data->groups[i].linked_list_count; j++) {
-            free(data->groups[i].linked_lists[j]);
+        relayout_place(by_id, node_count, graph->start_node, order, placed, &placed_count);
+        while (head < placed_count) {
+            int id = data->nodes[order[head++]].id;
+            for (SdcSize e = id_index_lower_bound(edges, graph->point_count, id);
+                 e < graph->point_count && edges[e].id == id; e++) {
+                SdcSize p = edges[e].index;
+                for (SdcSize v = 0; v < graph->point_value_counts[p]; v++) {
+                    relayout_place(by_id, node_count, graph->point_values[p][v],
+                                   order, placed, &placed_count);
+                }
+            }
         }
-        free(data->groups[i].linked_lists);
         
-        free(data->groups[i].nodes.point_keys);
-        for (int j = 0; j < data->groups[i].nodes.point_count; j++) {
-            free(data->groups[i].nodes.point_values[j]);
+        // Graph nodes not reachable from the start node
+        for (SdcSize p = 0; p < graph->point_count; p++) {
+            relayout_place(by_id, node_count, graph->point_keys[p], order, placed, &placed_count);
+            for (SdcSize v = 0; v < graph->point_value_counts[p]; v++) {
+                relayout_place(by_id, node_count, graph->point_values[p][v],
+                               order, placed, &placed_count);
+            }
         }
-        free(data->groups[i].nodes.point_values);
-        free(data->groups[i].nodes.point_value_counts);
+        relayout_place(by_id, node_count, graph->end_node, order, placed, &placed_count);
     }
-    free(data->groups);
     
-    // Free nodes (updated to include linked-list events)
-    for (int i = 0; i < data->node_count; i++) {
-        free(data->nodes[i].title);
-        free(data->nodes[i].content);
+    for (SdcSize i = 0; i < node_count; i++) {
+        if (!placed[i]) order[placed_count++] = i;
+    }
+    free(edges);
+    free(placed);
+    free(by_id);
+    source_remap(data->source, BLOCK_NODE, order, node_count);
+    
+    // Rebuild nodes, one timeline pool and payloads in traversal order
+    SdcSize item_total = 0;
+    for (SdcSize i = 0; i < node_count; i++) {
+        item_total += data->nodes[i].timeline_count;
+    }
+    
+    Node* nodes = (Node*)malloc(sizeof(Node) * (node_count + 1));
+    TimelineItem* pool = (TimelineItem*)malloc(sizeof(TimelineItem) * (item_total + 1));
+    Dialogue* dialogues = (Dialogue*)malloc(sizeof(Dialogue) * (data->dialogue_count + 1));
+    Action* actions = (Action*)malloc(sizeof(Action) * (data->action_count + 1));
+    uint64_t* dialogue_hashes = (uint64_t*)malloc(sizeof(uint64_t) * (data->dialogue_count + 1));
+    uint64_t* action_hashes = (uint64_t*)malloc(sizeof(uint64_t) * (data->action_count + 1));
+    bool* dialogue_used = (bool*)calloc(data->dialogue_count + 1, sizeof(bool));
+    bool* action_used = (bool*)calloc(data->action_count + 1, sizeof(bool));
+    SdcSize item_offset = 0;
+    SdcSize dialogue_count = 0;
+    SdcSize action_count = 0;
+    
+    for (SdcSize i = 0; i < node_count; i++) {
+        Node* node = &nodes[i];
+        *node = data->nodes[order[i]];
         
-        for (int j = 0; j < data->nodes[i].timeline_count; j++) {
-            if (data->nodes[i].timeline[j].type == SDC_TIMELINE_ITEM_DIALOGUE) {
-                Dialogue* d = &data->nodes[i].timeline[j].data.dialogue;
-                for (int k = 0; k < d->line_count; k++) {
-                    free(d->characters[k]);
-                    free(d->texts[k]);
-                }
-                free(d->characters);
-                free(d->texts);
-            } else if (data->nodes[i].timeline[j].type == SDC_TIMELINE_ITEM_ACTION) {
-                Action* a = &data->nodes[i].timeline[j].data.action;
-                if (a->type == SDC_ACTION_TYPE_CODE) {
-                    free(a->data.code.code);
-                } else if (a->type == SDC_ACTION_TYPE_EXIT) {
-                    free(a->data.exit_action.target);
-                } else if (a->type == SDC_ACTION_TYPE_EVENT) {
-                    EventActionData* e = &a->data.event;
-                    if (e->event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE) {
-                        free(e->data.adjust_variable.name);
-                        free(e->data.adjust_variable.value);
-                    } else if (e->event_type == SDC_EVENT_TYPE_ADD_STATE) {
-                        free(e->data.add_state.name);
-                        free(e->data.add_state.character);
-                    } else if (e->event_type == SDC_EVENT_TYPE_REMOVE_STATE) {
-                        free(e->data.remove_state.name);
-                        free(e->data.remove_state.character);
-                    } else if (e->event_type == SDC_EVENT_TYPE_LINKED_LIST) {
-                        free(e->data.linked_list.reference);
-                        for (int k = 0; k < e->data.linked_list.modification_count; k++) {
-                            free(e->data.linked_list.modifications[k].field);
-                            free(e->data.linked_list.modifications[k].set_value);
-                            free(e->data.linked_list.modifications[k].append_value);
-                            free(e->data.linked_list.modifications[k].replace_value);
-                        }
-                        free(e->data.linked_list.modifications);
-                    }
-                }
+        TimelineItem* timeline = &pool[item_offset];
+        for (SdcSize j = 0; j < node->timeline_count; j++) {
+            timeline[j] = node->timeline[j];
+            if (timeline[j].type == SDC_TIMELINE_ITEM_DIALOGUE) {
+                dialogue_used[timeline[j].payload] = true;
+                dialogues[dialogue_count] = data->dialogues[timeline[j].payload];
+                dialogue_hashes[dialogue_count] = data->dialogue_hashes[timeline[j].payload];
+                timeline[j].payload = (uint32_t)dialogue_count++;
+            } else {
+                action_used[timeline[j].payload] = true;
+                actions[action_count] = data->actions[timeline[j].payload];
+                action_hashes[action_count] = data->action_hashes[timeline[j].payload];
+                timeline[j].payload = (uint32_t)action_count++;
             }
         }
-        free(data->nodes[i].timeline);
+        
+        if (!timeline_in_pool(data, node->timeline)) {
+            free(node->timeline);
+        }
+        node->timeline = node->timeline_count > 0 ? timeline : NULL;
+        item_offset += node->timeline_count;
     }
-    free(data->nodes);
     
-    for (int i = 0; i < data->linked_list_count; i++) {
-        free(data->linked_lists[i].name);
-        free(data->linked_lists[i].scope);
-        for (int j = 0; j < data->linked_lists[i].field_count; j++) {
+    // Payloads no timeline refers to
+    for (SdcSize i = 0; i < data->dialogue_count; i++) {
+        if (!dialogue_used[i]) free_dialogue(&data->dialogues[i]);
+    }
+    for (SdcSize i = 0; i < data->action_count; i++) {
+        if (!action_used[i]) free_action(&data->actions[i]);
+    }
+    free(dialogue_used);
+    free(action_used);
+    free(order);
+    
+    free(data->nodes);
+    free(data->timeline_pool);
+    free(data->dialogues);
+    free(data->dialogue_hashes);
+    free(data->actions);
+    free(data->action_hashes);
+    data->nodes = nodes;
+    data->timeline_pool = pool;
+    data->timeline_pool_count = item_total;
+    data->dialogues = dialogues;
+    data->dialogue_hashes = dialogue_hashes;
+    data->dialogue_count = dialogue_count;
+    data->dialogue_capacity = dialogue_count;
+    data->actions = actions;
+    data->action_hashes = action_hashes;
+    data->action_count = action_count;
+    data->action_capacity = action_count;
+    
+    free(data->node_index);
+    free(data->group_index);
+    data->node_index = build_node_index(data);
+    data->group_index = build_group_index(data);
+}
+
+#ifndef SDC_NO_FILESYSTEM
+
+// ============================================================================
+// BINARY IMAGE
+// ============================================================================
+
+// A parsed story flattened field by field in native byte order, used by
+// the parse cache. Images are only read back by a build with the same
+// layout: the header records SDC_IMAGE_VERSION and the native type sizes.
+// Bump SDC_IMAGE_VERSION when the parser output or this format changes.
+#define SDC_IMAGE_VERSION 3
+#define SDC_IMAGE_MAGIC 0x49434453u  // "SDCI"
+#define SDC_IMAGE_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+} ImageWriter;
+
+// Reads past the end or implausible counts set failed; every getter then
+// returns zero or NULL so a damaged image unwinds without extra checks
+typedef struct {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool failed;
+} ImageReader;
+
+static void image_put(ImageWriter* w, const void* bytes, size_t size) {
+    if (w->length + size > w->capacity) {
+        w->capacity = (w->capacity + size) * 2;
+        w->data = (unsigned char*)realloc(w->data, w->capacity);
+    }
+    if (size > 0) memcpy(w->data + w->length, bytes, size);
+    w->length += size;
+}
+
+static void image_put_u8(ImageWriter* w, unsigned value) {
+    unsigned char byte = (unsigned char)value;
+    image_put(w, &byte, 1);
+}
+
+static void image_put_i32(ImageWriter* w, int value) {
+    int32_t v = (int32_t)value;
+    image_put(w, &v, sizeof(v));
+}
+
+static void image_put_u64(ImageWriter* w, uint64_t value) {
+    image_put(w, &value, sizeof(value));
+}
+
+static void image_put_f64(ImageWriter* w, double value) {
+    image_put(w, &value, sizeof(value));
+}
+
+// Length and bytes; NULL is stored as length UINT64_MAX
+static void image_put_string(ImageWriter* w, const char* s) {
+    if (!s) {
+        image_put_u64(w, UINT64_MAX);
+        return;
+    }
+    size_t length = strlen(s);
+    image_put_u64(w, length);
+    image_put(w, s, length);
+}
+
+static void image_put_strings(ImageWriter* w, char** strings, SdcSize count) {
+    for (SdcSize i = 0; i < count; i++) {
+        image_put_string(w, strings[i]);
+    }
+}
+
+static bool image_get(ImageReader* r, void* bytes, size_t size) {
+    if (r->failed || (size_t)(r->end - r->p) < size) {
+        r->failed = true;
+        memset(bytes, 0, size);
+        return false;
+    }
+    memcpy(bytes, r->p, size);
+    r->p += size;
+    return true;
+}
+
+static unsigned image_get_u8(ImageReader* r) {
+    unsigned char byte;
+    image_get(r, &byte, 1);
+    return byte;
+}
+
+static int image_get_i32(ImageReader* r) {
+    int32_t v;
+    image_get(r, &v, sizeof(v));
+    return (int)v;
+}
+
+static uint64_t image_get_u64(ImageReader* r) {
+    uint64_t v;
+    image_get(r, &v, sizeof(v));
+    return v;
+}
+
+static double image_get_f64(ImageReader* r) {
+    double v;
+    image_get(r, &v, sizeof(v));
+    return v;
+}
+
+// Element count of an array whose entries take at least min_size bytes,
+// rejecting counts the rest of the image cannot hold
+static SdcSize image_get_count(ImageReader* r, size_t min_size) {
+    uint64_t count = image_get_u64(r);
+    if (count > (uint64_t)(r->end - r->p) / min_size) {
+        r->failed = true;
+        return 0;
+    }
+    return (SdcSize)count;
+}
+
+static char* image_get_string(ImageReader* r) {
+    uint64_t length = image_get_u64(r);
+    if (r->failed || length == UINT64_MAX) return NULL;
+    if (length > (uint64_t)(r->end - r->p)) {
+        r->failed = true;
+        return NULL;
+    }
+    char* s = (char*)malloc((size_t)length + 1);
+    memcpy(s, r->p, (size_t)length);
+    s[length] = '\0';
+    r->p += length;
+    return s;
+}
+
+// Array of count strings, allocated even when empty
+static char** image_get_strings(ImageReader* r, SdcSize* count) {
+    *count = image_get_count(r, sizeof(uint64_t));
+    char** strings = (char**)calloc(*count + 1, sizeof(char*));
+    for (SdcSize i = 0; i < *count; i++) {
+        strings[i] = image_get_string(r);
+    }
+    return strings;
+}
+
+// Copy of size raw bytes (NULL when empty)
+static void* image_get_block(ImageReader* r, size_t size) {
+    if (r->failed || (size_t)(r->end - r->p) < size) {
+        r->failed = true;
+        return NULL;
+    }
+    if (size == 0) return NULL;
+    void* block = malloc(size);
+    memcpy(block, r->p, size);
+    r->p += size;
+    return block;
+}
+
+static void image_put_event(ImageWriter* w, const EventActionData* e) {
+    image_put_u8(w, e->event_type);
+    switch (e->event_type) {
+        case SDC_EVENT_TYPE_ADJUST_VARIABLE: {
+            const AdjustVariableEventData* adjust = &e->data.adjust_variable;
+            image_put_string(w, adjust->name);
+            image_put_f64(w, adjust->increment);
+            image_put_string(w, adjust->value);
+            image_put_u8(w, adjust->is_toggle);
+            image_put_u8(w, adjust->has_increment);
+            image_put_u8(w, adjust->has_value);
+            break;
+        }
+        case SDC_EVENT_TYPE_ADD_STATE:
+            image_put_string(w, e->data.add_state.name);
+            image_put_string(w, e->data.add_state.character);
+            break;
+        case SDC_EVENT_TYPE_REMOVE_STATE:
+            image_put_string(w, e->data.remove_state.name);
+            image_put_string(w, e->data.remove_state.character);
+            break;
+        case SDC_EVENT_TYPE_PROGRESS_STORY:
+            image_put_i32(w, e->data.progress_story.chapter_id);
+            image_put_i32(w, e->data.progress_story.group_id);
+            image_put_i32(w, e->data.progress_story.node_id);
+            break;
+        case SDC_EVENT_TYPE_LINKED_LIST: {
+            const LinkedListEventData* event = &e->data.linked_list;
+            image_put_string(w, event->reference);
+            image_put_u64(w, event->modification_count);
+            for (SdcSize i = 0; i < event->modification_count; i++) {
+                const LinkedListFieldModification* mod = &event->modifications[i];
+                image_put_string(w, mod->field);
+                image_put_f64(w, mod->amount);
+                image_put_string(w, mod->set_value);
+                image_put_string(w, mod->append_value);
+                image_put_string(w, mod->replace_value);
+                image_put_u8(w, mod->is_toggle);
+                image_put_u8(w, mod->has_amount);
+                image_put_u8(w, mod->has_set);
+                image_put_u8(w, mod->has_append);
+                image_put_u8(w, mod->has_replace);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void image_get_event(ImageReader* r, EventActionData* e) {
+    e->event_type = (EventType)image_get_u8(r);
+    if (e->event_type > SDC_EVENT_TYPE_UNKNOWN) {
+        e->event_type = SDC_EVENT_TYPE_UNKNOWN;
+        r->failed = true;
+    }
+    switch (e->event_type) {
+        case SDC_EVENT_TYPE_ADJUST_VARIABLE: {
+            AdjustVariableEventData* adjust = &e->data.adjust_variable;
+            adjust->name = image_get_string(r);
+            adjust->increment = image_get_f64(r);
+            adjust->value = image_get_string(r);
+            adjust->is_toggle = image_get_u8(r) != 0;
+            adjust->has_increment = image_get_u8(r) != 0;
+            adjust->has_value = image_get_u8(r) != 0;
+            break;
+        }
+        case SDC_EVENT_TYPE_ADD_STATE:
+            e->data.add_state.name = image_get_string(r);
+            e->data.add_state.character = image_get_string(r);
+            break;
+        case SDC_EVENT_TYPE_REMOVE_STATE:
+            e->data.remove_state.name = image_get_string(r);
+            e->data.remove_state.character = image_get_string(r);
+            break;
+        case SDC_EVENT_TYPE_PROGRESS_STORY:
+            e->data.progress_story.chapter_id = image_get_i32(r);
+            e->data.progress_story.group_id = image_get_i32(r);
+            e->data.progress_story.node_id = image_get_i32(r);
+            break;
+        case SDC_EVENT_TYPE_LINKED_LIST: {
+            LinkedListEventData* event = &e->data.linked_list;
+            event->reference = image_get_string(r);
+            SdcSize count = image_get_count(r, 1);
+            event->modifications = (LinkedListFieldModification*)calloc(count + 1,
+                sizeof(LinkedListFieldModification));
+            event->modification_count = count;
+            for (SdcSize i = 0; i < count; i++) {
+                LinkedListFieldModification* mod = &event->modifications[i];
+                mod->field = image_get_string(r);
+                mod->amount = image_get_f64(r);
+                mod->set_value = image_get_string(r);
+                mod->append_value = image_get_string(r);
+                mod->replace_value = image_get_string(r);
+                mod->is_toggle = image_get_u8(r) != 0;
+                mod->has_amount = image_get_u8(r) != 0;
+                mod->has_set = image_get_u8(r) != 0;
+                mod->has_append = image_get_u8(r) != 0;
+                mod->has_replace = image_get_u8(r) != 0;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void image_put_action(ImageWriter* w, const Action* a) {
+    image_put_i32(w, a->number);
+    image_put_u8(w, a->type);
+    switch (a->type) {
+        case SDC_ACTION_TYPE_CODE:
+            image_put_string(w, a->data.code.code);
+            break;
+        case SDC_ACTION_TYPE_GOTO:
+            image_put_i32(w, a->data.goto_action.target_node);
+            break;
+        case SDC_ACTION_TYPE_EXIT:
+            image_put_string(w, a->data.exit_action.target);
+            break;
+        case SDC_ACTION_TYPE_ENTER:
+            image_put_i32(w, a->data.enter_action.target_group);
+            break;
+        case SDC_ACTION_TYPE_CHOICE:
+            image_put_u64(w, a->data.choice.option_count);
+            for (SdcSize i = 0; i < a->data.choice.option_count; i++) {
+                const ChoiceOption* option = &a->data.choice.options[i];
+                image_put_string(w, option->text);
+                image_put_u64(w, option->action_count);
+                for (SdcSize j = 0; j < option->action_count; j++) {
+                    image_put_action(w, &option->actions[j]);
+                }
+            }
+            break;
+        case SDC_ACTION_TYPE_EVENT:
+            image_put_event(w, &a->data.event);
+            break;
+    }
+}
+
+static void image_get_action(ImageReader* r, Action* a) {
+    a->number = image_get_i32(r);
+    a->type = (ActionType)image_get_u8(r);
+    switch (a->type) {
+        case SDC_ACTION_TYPE_CODE:
+            a->data.code.code = image_get_string(r);
+            break;
+        case SDC_ACTION_TYPE_GOTO:
+            a->data.goto_action.target_node = image_get_i32(r);
+            break;
+        case SDC_ACTION_TYPE_EXIT:
+            a->data.exit_action.target = image_get_string(r);
+            break;
+        case SDC_ACTION_TYPE_ENTER:
+            a->data.enter_action.target_group = image_get_i32(r);
+            break;
+        case SDC_ACTION_TYPE_CHOICE: {
+            ChoiceAction* choice = &a->data.choice;
+            SdcSize count = image_get_count(r, 2 * sizeof(uint64_t));
+            choice->options = (ChoiceOption*)calloc(count + 1, sizeof(ChoiceOption));
+            choice->option_count = count;
+            for (SdcSize i = 0; i < count; i++) {
+                ChoiceOption* option = &choice->options[i];
+                option->text = image_get_string(r);
+                SdcSize action_count = image_get_count(r, 5);
+                option->actions = (Action*)calloc(action_count + 1, sizeof(Action));
+                option->action_count = action_count;
+                for (SdcSize j = 0; j < action_count; j++) {
+                    image_get_action(r, &option->actions[j]);
+                }
+            }
+            break;
+        }
+        case SDC_ACTION_TYPE_EVENT:
+            image_get_event(r, &a->data.event);
+            break;
+        default:
+            // Unknown kinds cannot come from this build
+            a->type = SDC_ACTION_TYPE_CODE;
+            r->failed = true;
+            break;
+    }
+}
+
+static void image_put_linked_list(ImageWriter* w, const LinkedListDefinition* list) {
+    image_put_string(w, list->name);
+    image_put_string(w, list->scope);
+    image_put_u64(w, list->field_count);
+    image_put_strings(w, list->field_names, list->field_count);
+    for (SdcSize i = 0; i < list->field_count; i++) {
+        image_put_string(w, list->fields[i].type);
+        image_put_u8(w, list->fields[i].value_type);
+    }
+    
+    // Column data is only as long as the rows in use
+    image_put_u8(w, list->columns != NULL);
+    image_put_u64(w, list->row_count);
+    if (list->columns) {
+        for (SdcSize i = 0; i < list->field_count; i++) {
+            const LinkedListColumn* column = &list->columns[i];
+            image_put_u8(w, column->type);
+            image_put(w, column->data.int_values, ll_value_size(column->type) * list->row_count);
+            image_put(w, column->present, sizeof(bool) * list->row_count);
+        }
+    }
+    
+    image_put_u64(w, list->string_count);
+    image_put_strings(w, list->strings, list->string_count);
+}
+
+static void image_get_linked_list(ImageReader* r, LinkedListDefinition* list) {
+    list->name = image_get_string(r);
+    list->scope = image_get_string(r);
+    
+    SdcSize field_count = image_get_count(r, sizeof(uint64_t));
+    list->field_names = (char**)calloc(field_count + 1, sizeof(char*));
+    list->fields = (LinkedListField*)calloc(field_count + 1, sizeof(LinkedListField));
+    list->field_count = field_count;
+    for (SdcSize i = 0; i < field_count; i++) {
+        list->field_names[i] = image_get_string(r);
+    }
+    for (SdcSize i = 0; i < field_count; i++) {
+        list->fields[i].type = image_get_string(r);
+        list->fields[i].value_type = (LinkedListValueType)image_get_u8(r);
+    }
+    
+    bool has_columns = image_get_u8(r) != 0;
+    SdcSize row_count = image_get_count(r, 1);
+    if (has_columns) {
+        list->columns = (LinkedListColumn*)calloc(field_count + 1, sizeof(LinkedListColumn));
+        for (SdcSize i = 0; i < field_count && !r->failed; i++) {
+            LinkedListColumn* column = &list->columns[i];
+            column->type = (LinkedListValueType)image_get_u8(r);
+            if (column->type > SDC_LL_VALUE_BOOL) {
+                column->type = SDC_LL_VALUE_INT;
+                r->failed = true;
+            }
+            column->data.int_values = (long*)image_get_block(r, ll_value_size(column->type) * row_count);
+            column->present = (bool*)image_get_block(r, sizeof(bool) * row_count);
+        }
+    }
+    list->row_count = row_count;
+    list->row_capacity = row_count;
+    
+    list->strings = image_get_strings(r, &list->string_count);
+    list->string_capacity = list->string_count;
+}
+
+static void image_put_group(ImageWriter* w, const Group* group) {
+    image_put_i32(w, group->id);
+    image_put_u64(w, group->content_hash);
+    image_put_i32(w, group->chapter_id);
+    image_put_string(w, group->name);
+    image_put_string(w, group->content);
+    image_put_i32(w, group->parent_group);
+    
+    image_put_u64(w, group->tag_count);
+    for (SdcSize i = 0; i < group->tag_count; i++) {
+        image_put_string(w, group->tags[i].tag_name);
+        image_put_string(w, group->tags[i].selected_key);
+        image_put_string(w, group->tags[i].value);
+    }
+    
+    const NodeGraph* graph = &group->nodes;
+    image_put_i32(w, graph->start_node);
+    image_put_i32(w, graph->end_node);
+    image_put_u64(w, graph->point_count);
+    for (SdcSize i = 0; i < graph->point_count; i++) {
+        image_put_i32(w, graph->point_keys[i]);
+        image_put_u64(w, graph->point_value_counts[i]);
+        for (SdcSize j = 0; j < graph->point_value_counts[i]; j++) {
+            image_put_i32(w, graph->point_values[i][j]);
+        }
+    }
+    
+    image_put_u64(w, group->linked_list_count);
+    image_put_strings(w, group->linked_lists, group->linked_list_count);
+}
+
+static void image_get_group(ImageReader* r, Group* group) {
+    group->id = image_get_i32(r);
+    group->content_hash = image_get_u64(r);
+    group->chapter_id = image_get_i32(r);
+    group->name = image_get_string(r);
+    group->content = image_get_string(r);
+    group->parent_group = image_get_i32(r);
+    
+    SdcSize tag_count = image_get_count(r, 3 * sizeof(uint64_t));
+    group->tags = (GroupTag*)calloc(tag_count + 1, sizeof(GroupTag));
+    group->tag_count = tag_count;
+    for (SdcSize i = 0; i < tag_count; i++) {
+        group->tags[i].tag_name = image_get_string(r);
+        group->tags[i].selected_key = image_get_string(r);
+        group->tags[i].value = image_get_string(r);
+    }
+    
+    NodeGraph* graph = &group->nodes;
+    graph->start_node = image_get_i32(r);
+    graph->end_node = image_get_i32(r);
+    SdcSize point_count = image_get_count(r, sizeof(int32_t) + sizeof(uint64_t));
+    graph->point_keys = (int*)calloc(point_count + 1, sizeof(int));
+    graph->point_values = (int**)calloc(point_count + 1, sizeof(int*));
+    graph->point_value_counts = (SdcSize*)calloc(point_count + 1, sizeof(SdcSize));
+    graph->point_count = point_count;
+    for (SdcSize i = 0; i < point_count; i++) {
+        graph->point_keys[i] = image_get_i32(r);
+        SdcSize value_count = image_get_count(r, sizeof(int32_t));
+        graph->point_values[i] = (int*)calloc(value_count + 1, sizeof(int));
+        graph->point_value_counts[i] = value_count;
+        for (SdcSize j = 0; j < value_count; j++) {
+            graph->point_values[i][j] = image_get_i32(r);
+        }
+    }
+    
+    group->linked_lists = image_get_strings(r, &group->linked_list_count);
+}
+
+static void image_write_story(ImageWriter* w, const StoryData* data) {
+    image_put_u64(w, data->state_count);
+    for (SdcSize i = 0; i < data->state_count; i++) {
+        image_put_string(w, data->states[i].name);
+    }
+    
+    image_put_u64(w, data->global_var_count);
+    for (SdcSize i = 0; i < data->global_var_count; i++) {
+        const GlobalVariable* var = &data->global_vars[i];
+        image_put_string(w, var->name);
+        image_put_u8(w, var->type);
+        switch (var->type) {
+            case SDC_VAR_TYPE_STRING: image_put_string(w, var->default_value.string_value); break;
+            case SDC_VAR_TYPE_INT: image_put_u64(w, (uint64_t)var->default_value.int_value); break;
+            case SDC_VAR_TYPE_BOOL: image_put_u8(w, var->default_value.bool_value); break;
+            case SDC_VAR_TYPE_FLOAT: image_put_f64(w, var->default_value.float_value); break;
+        }
+    }
+    
+    image_put_u64(w, data->linked_list_count);
+    for (SdcSize i = 0; i < data->linked_list_count; i++) {
+        image_put_linked_list(w, &data->linked_lists[i]);
+    }
+    
+    image_put_u64(w, data->character_count);
+    for (SdcSize i = 0; i < data->character_count; i++) {
+        const Character* character = &data->characters[i];
+        image_put_string(w, character->name);
+        image_put_string(w, character->biography);
+        image_put_string(w, character->description);
+        image_put_u64(w, character->linked_list_count);
+        image_put_strings(w, character->linked_list_names, character->linked_list_count);
+        for (SdcSize j = 0; j < character->linked_list_count; j++) {
+            const LinkedListData* ll = &character->linked_list_data[j];
+            image_put_u64(w, ll->list_index);
+            image_put_u64(w, ll->first_row);
+            image_put_u64(w, ll->count);
+            image_put_u8(w, ll->is_array);
+        }
+    }
+    
+    image_put_u64(w, data->tag_count);
+    for (SdcSize i = 0; i < data->tag_count; i++) {
+        const TagDefinition* tag = &data->tags[i];
+        image_put_string(w, tag->name);
+        image_put_u8(w, tag->type);
+        image_put_string(w, tag->color);
+        image_put_u8(w, tag->keys != NULL);
+        image_put_u64(w, tag->key_count);
+        image_put_strings(w, tag->keys, tag->key_count);
+    }
+    
+    image_put_u64(w, data->chapter_count);
+    for (SdcSize i = 0; i < data->chapter_count; i++) {
+        image_put_i32(w, data->chapters[i].id);
+        image_put_u64(w, data->chapters[i].content_hash);
+        image_put_string(w, data->chapters[i].name);
+    }
+    
+    image_put_u64(w, data->group_count);
+    for (SdcSize i = 0; i < data->group_count; i++) {
+        image_put_group(w, &data->groups[i]);
+    }
+    
+    image_put_u64(w, data->node_count);
+    for (SdcSize i = 0; i < data->node_count; i++) {
+        const Node* node = &data->nodes[i];
+        image_put_i32(w, node->id);
+        image_put_u64(w, node->content_hash);
+        image_put_string(w, node->title);
+        image_put_string(w, node->content);
+        image_put_u64(w, node->timeline_count);
+        for (SdcSize j = 0; j < node->timeline_count; j++) {
+            image_put_u8(w, node->timeline[j].type);
+            image_put_i32(w, node->timeline[j].number);
+            image_put_i32(w, (int)node->timeline[j].payload);
+        }
+    }
+    
+    image_put_u64(w, data->dialogue_count);
+    for (SdcSize i = 0; i < data->dialogue_count; i++) {
+        const Dialogue* dialogue = &data->dialogues[i];
+        image_put_u64(w, data->dialogue_hashes[i]);
+        image_put_u64(w, dialogue->line_count);
+        image_put_strings(w, dialogue->characters, dialogue->line_count);
+        image_put_strings(w, dialogue->texts, dialogue->line_count);
+    }
+    
+    image_put_u64(w, data->action_count);
+    for (SdcSize i = 0; i < data->action_count; i++) {
+        image_put_u64(w, data->action_hashes[i]);
+        image_put_action(w, &data->actions[i]);
+    }
+}
+
+// Rebuild a story from an image; NULL if the image is damaged
+static StoryData* image_read_story(ImageReader* r) {
+    StoryData* data = (StoryData*)calloc(1, sizeof(StoryData));
+    
+    SdcSize state_count = image_get_count(r, sizeof(uint64_t));
+    data->states = (State*)calloc(state_count + 1, sizeof(State));
+    data->state_count = state_count;
+    for (SdcSize i = 0; i < state_count; i++) {
+        data->states[i].name = image_get_string(r);
+    }
+    
+    SdcSize var_count = image_get_count(r, sizeof(uint64_t) + 1);
+    data->global_vars = (GlobalVariable*)calloc(var_count + 1, sizeof(GlobalVariable));
+    data->global_var_count = var_count;
+    for (SdcSize i = 0; i < var_count; i++) {
+        GlobalVariable* var = &data->global_vars[i];
+        var->name = image_get_string(r);
+        var->type = (GlobalVarType)image_get_u8(r);
+        switch (var->type) {
+            case SDC_VAR_TYPE_STRING: var->default_value.string_value = image_get_string(r); break;
+            case SDC_VAR_TYPE_INT: var->default_value.int_value = (long)image_get_u64(r); break;
+            case SDC_VAR_TYPE_BOOL: var->default_value.bool_value = image_get_u8(r) != 0; break;
+            case SDC_VAR_TYPE_FLOAT: var->default_value.float_value = image_get_f64(r); break;
+            default:
+                var->type = SDC_VAR_TYPE_INT;
+                r->failed = true;
+                break;
+        }
+    }
+    
+    SdcSize list_count = image_get_count(r, 2 * sizeof(uint64_t));
+    data->linked_lists = (LinkedListDefinition*)calloc(list_count + 1, sizeof(LinkedListDefinition));
+    data->linked_list_count = list_count;
+    for (SdcSize i = 0; i < list_count; i++) {
+        image_get_linked_list(r, &data->linked_lists[i]);
+    }
+    
+    SdcSize character_count = image_get_count(r, 3 * sizeof(uint64_t));
+    data->characters = (Character*)calloc(character_count + 1, sizeof(Character));
+    data->character_count = character_count;
+    for (SdcSize i = 0; i < character_count; i++) {
+        Character* character = &data->characters[i];
+        character->name = image_get_string(r);
+        character->biography = image_get_string(r);
+        character->description = image_get_string(r);
+        character->linked_list_names = image_get_strings(r, &character->linked_list_count);
+        character->linked_list_data = (LinkedListData*)calloc(character->linked_list_count + 1,
+                                                              sizeof(LinkedListData));
+        for (SdcSize j = 0; j < character->linked_list_count; j++) {
+            LinkedListData* ll = &character->linked_list_data[j];
+            ll->list_index = (SdcSize)image_get_u64(r);
+            ll->first_row = (SdcSize)image_get_u64(r);
+            ll->count = (SdcSize)image_get_u64(r);
+            ll->is_array = image_get_u8(r) != 0;
+            if (ll->list_index >= list_count) r->failed = true;
+        }
+    }
+    
+    SdcSize tag_count = image_get_count(r, 2 * sizeof(uint64_t));
+    data->tags = (TagDefinition*)calloc(tag_count + 1, sizeof(TagDefinition));
+    data->tag_count = tag_count;
+    for (SdcSize i = 0; i < tag_count; i++) {
+        TagDefinition* tag = &data->tags[i];
+        tag->name = image_get_string(r);
+        tag->type = (TagType)image_get_u8(r);
+        tag->color = image_get_string(r);
+        bool has_keys = image_get_u8(r) != 0;
+        tag->keys = image_get_strings(r, &tag->key_count);
+        if (!has_keys && tag->key_count == 0) {
+            free(tag->keys);
+            tag->keys = NULL;
+        } else if (!has_keys) {
+            r->failed = true;
+        }
+    }
+    
+    SdcSize chapter_count = image_get_count(r, sizeof(int32_t) + 2 * sizeof(uint64_t));
+    data->chapters = (Chapter*)calloc(chapter_count + 1, sizeof(Chapter));
+    data->chapter_count = chapter_count;
+    for (SdcSize i = 0; i < chapter_count; i++) {
+        data->chapters[i].id = image_get_i32(r);
+        data->chapters[i].content_hash = image_get_u64(r);
+        data->chapters[i].name = image_get_string(r);
+    }
+    
+    SdcSize group_count = image_get_count(r, 3 * sizeof(int32_t) + 3 * sizeof(uint64_t));
+    data->groups = (Group*)calloc(group_count + 1, sizeof(Group));
+    data->group_count = group_count;
+    for (SdcSize i = 0; i < group_count; i++) {
+        image_get_group(r, &data->groups[i]);
+    }
+    
+    SdcSize node_count = image_get_count(r, sizeof(int32_t) + 4 * sizeof(uint64_t));
+    data->nodes = (Node*)calloc(node_count + 1, sizeof(Node));
+    data->node_count = node_count;
+    for (SdcSize i = 0; i < node_count; i++) {
+        Node* node = &data->nodes[i];
+        node->id = image_get_i32(r);
+        node->content_hash = image_get_u64(r);
+        node->title = image_get_string(r);
+        node->content = image_get_string(r);
+        SdcSize item_count = image_get_count(r, 1 + 2 * sizeof(int32_t));
+        node->timeline = item_count > 0 ? (TimelineItem*)calloc(item_count, sizeof(TimelineItem)) : NULL;
+        node->timeline_count = item_count;
+        for (SdcSize j = 0; j < item_count; j++) {
+            node->timeline[j].type = (TimelineItemType)image_get_u8(r);
+            node->timeline[j].number = image_get_i32(r);
+            node->timeline[j].payload = (uint32_t)image_get_i32(r);
+        }
+    }
+    
+    SdcSize dialogue_count = image_get_count(r, 4 * sizeof(uint64_t));
+    data->dialogues = (Dialogue*)calloc(dialogue_count + 1, sizeof(Dialogue));
+    data->dialogue_hashes = (uint64_t*)calloc(dialogue_count + 1, sizeof(uint64_t));
+    data->dialogue_count = dialogue_count;
+    data->dialogue_capacity = dialogue_count;
+    for (SdcSize i = 0; i < dialogue_count; i++) {
+        Dialogue* dialogue = &data->dialogues[i];
+        data->dialogue_hashes[i] = image_get_u64(r);
+        SdcSize line_count = image_get_count(r, 2 * sizeof(uint64_t));
+        dialogue->characters = (char**)calloc(line_count + 1, sizeof(char*));
+        dialogue->texts = (char**)calloc(line_count + 1, sizeof(char*));
+        dialogue->line_count = line_count;
+        for (SdcSize j = 0; j < line_count; j++) {
+            dialogue->characters[j] = image_get_string(r);
+        }
+        for (SdcSize j = 0; j < line_count; j++) {
+            dialogue->texts[j] = image_get_string(r);
+        }
+    }
+    
+    SdcSize action_count = image_get_count(r, sizeof(uint64_t) + sizeof(int32_t) + 1);
+    data->actions = (Action*)calloc(action_count + 1, sizeof(Action));
+    data->action_hashes = (uint64_t*)calloc(action_count + 1, sizeof(uint64_t));
+    data->action_count = action_count;
+    data->action_capacity = action_count;
+    for (SdcSize i = 0; i < action_count && !r->failed; i++) {
+        data->action_hashes[i] = image_get_u64(r);
+        image_get_action(r, &data->actions[i]);
+    }
+    
+    // Timeline payloads must stay inside their arrays
+    for (SdcSize i = 0; i < node_count && !r->failed; i++) {
+        for (SdcSize j = 0; j < data->nodes[i].timeline_count; j++) {
+            const TimelineItem* item = &data->nodes[i].timeline[j];
+            SdcSize limit = item->type == SDC_TIMELINE_ITEM_DIALOGUE ? dialogue_count : action_count;
+            if ((SdcSize)item->payload >= limit) r->failed = true;
+        }
+    }
+    
+    if (r->failed) {
+        sdc_free(data);
+        return NULL;
+    }
+    return data;
+}
+
+#endif // SDC_NO_FILESYSTEM
+
+// ============================================================================
+// PARSE CACHE
+// ============================================================================
+
+static StoryData* parse_input(const Lexer* lexer, SdcSource* source, bool* at_end);
+
+// 64-bit content hash taking eight bytes per step, with a murmur3
+// finalizer. Not cryptographic: entries are also checked by length.
+static uint64_t content_hash(const char* data, size_t length) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)length;
+    size_t i = 0;
+    
+    for (; length - i >= 8; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, length - i);
+    h = (h ^ tail) * 0xC4CEB9FE1A85EC53ull;
+    
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+#ifndef SDC_NO_FILESYSTEM
+
+// Images are named after the content hash and the image version, so
+// entries from other library versions are never loaded and age out
+#define SDC_CACHE_SUFFIX ".sdci"
+
+typedef struct {
+    char* directory;   // NULL while disabled
+    size_t max_bytes;
+    SdcCacheStats stats;
+} ParseCache;
+
+typedef struct {
+    char* path;
+    uint64_t size;
+    uint64_t used;     // Modification time, refreshed on every hit
+} CacheEntry;
+
+static ParseCache parse_cache;
+
+static double cache_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Whole contents of a stream followed by a '\0' sentinel, or NULL on error
+static char* read_stream(FILE* file, size_t* length) {
+    size_t capacity = SDC_READ_CHUNK;
+    char* data = (char*)malloc(capacity + 1);
+    *length = 0;
+    
+    while (true) {
+        size_t count = fread(data + *length, 1, capacity - *length, file);
+        *length += count;
+        if (*length < capacity) break;
+        capacity *= 2;
+        data = (char*)realloc(data, capacity + 1);
+    }
+    
+    if (ferror(file)) {
+        free(data);
+        return NULL;
+    }
+    data[*length] = '\0';
+    return data;
+}
+
+static char* cache_path(const char* name) {
+    size_t length = strlen(parse_cache.directory) + strlen(name) + 2;
+    char* path = (char*)malloc(length);
+    snprintf(path, length, "%s/%s", parse_cache.directory, name);
+    return path;
+}
+
+static char* cache_entry_path(uint64_t hash) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-v%d" SDC_CACHE_SUFFIX,
+             (unsigned long long)hash, SDC_IMAGE_VERSION);
+    return cache_path(name);
+}
+
+static bool has_cache_suffix(const char* name) {
+    size_t length = strlen(name);
+    size_t suffix = sizeof(SDC_CACHE_SUFFIX) - 1;
+    return length > suffix && strcmp(name + length - suffix, SDC_CACHE_SUFFIX) == 0;
+}
+
+#if defined(_WIN32)
+
+static bool cache_make_directory(const char* directory) {
+    _mkdir(directory);
+    DWORD attributes = GetFileAttributesA(directory);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+static void cache_touch(const char* path) {
+    _utime(path, NULL);
+}
+
+// Every image in the cache directory
+static CacheEntry* cache_list(SdcSize* count) {
+    SdcSize capacity = 0;
+    CacheEntry* entries = NULL;
+    *count = 0;
+    
+    char* pattern = cache_path("*" SDC_CACHE_SUFFIX);
+    WIN32_FIND_DATAA found;
+    HANDLE handle = FindFirstFileA(pattern, &found);
+    free(pattern);
+    if (handle == INVALID_HANDLE_VALUE) return NULL;
+    
+    do {
+        if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !has_cache_suffix(found.cFileName)) {
+            continue;
+        }
+        entries = (CacheEntry*)reserve_item(entries, *count, &capacity, sizeof(CacheEntry));
+        CacheEntry* entry = &entries[(*count)++];
+        entry->path = cache_path(found.cFileName);
+        entry->size = (uint64_t)found.nFileSizeHigh << 32 | found.nFileSizeLow;
+        entry->used = (uint64_t)found.ftLastWriteTime.dwHighDateTime << 32 |
+                      found.ftLastWriteTime.dwLowDateTime;
+    } while (FindNextFileA(handle, &found));
+    
+    FindClose(handle);
+    return entries;
+}
+
+#else
+
+static bool cache_make_directory(const char* directory) {
+    mkdir(directory, 0777);
+    struct stat info;
+    return stat(directory, &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+static void cache_touch(const char* path) {
+    utime(path, NULL);
+}
+
+// Every image in the cache directory
+static CacheEntry* cache_list(SdcSize* count) {
+    SdcSize capacity = 0;
+    CacheEntry* entries = NULL;
+    *count = 0;
+    
+    DIR* dir = opendir(parse_cache.directory);
+    if (!dir) return NULL;
+    
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        if (!has_cache_suffix(item->d_name)) continue;
+        
+        char* path = cache_path(item->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            free(path);
+            continue;
+        }
+        
+        entries = (CacheEntry*)reserve_item(entries, *count, &capacity, sizeof(CacheEntry));
+        CacheEntry* entry = &entries[(*count)++];
+        entry->path = path;
+        entry->size = (uint64_t)info.st_size;
+        entry->used = (uint64_t)info.st_mtime;
+    }
+    
+    closedir(dir);
+    return entries;
+}
+
+#endif
+
+static void cache_free_list(CacheEntry* entries, SdcSize count) {
+    for (SdcSize i = 0; i < count; i++) {
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+static int compare_cache_entries(const void* a, const void* b) {
+    const CacheEntry* x = (const CacheEntry*)a;
+    const CacheEntry* y = (const CacheEntry*)b;
+    return x->used < y->used ? -1 : (x->used > y->used);
+}
+
+// Remove least recently used images until the directory fits max_bytes
+static void cache_evict(void) {
+    SdcSize count;
+    CacheEntry* entries = cache_list(&count);
+    
+    uint64_t total = 0;
+    for (SdcSize i = 0; i < count; i++) {
+        total += entries[i].size;
+    }
+    
+    if (total > parse_cache.max_bytes) {
+        qsort(entries, count, sizeof(CacheEntry), compare_cache_entries);
+        for (SdcSize i = 0; i < count && total > parse_cache.max_bytes; i++) {
+            if (remove(entries[i].path) == 0) {
+                total -= entries[i].size;
+                parse_cache.stats.evictions++;
+            }
+        }
+    }
+    
+    cache_free_list(entries, count);
+}
+
+// Story from the image at path if it was built from these contents
+static StoryData* cache_load(const char* path, uint64_t hash, size_t length) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+    
+    size_t image_length;
+    char* image = read_stream(file, &image_length);
+    fclose(file);
+    if (!image) return NULL;
+    
+    ImageReader reader = { (const unsigned char*)image, (const unsigned char*)image + image_length, false };
+    bool valid = image_get_u64(&reader) == SDC_IMAGE_MAGIC &&
+                 image_get_u64(&reader) == SDC_IMAGE_VERSION &&
+                 image_get_u64(&reader) == SDC_IMAGE_BYTE_ORDER &&
+                 image_get_u8(&reader) == sizeof(SdcSize) &&
+                 image_get_u8(&reader) == sizeof(long) &&
+                 image_get_u8(&reader) == sizeof(bool) &&
+                 image_get_u64(&reader) == hash &&
+                 image_get_u64(&reader) == (uint64_t)length;
+    
+    StoryData* story = valid ? image_read_story(&reader) : NULL;
+    if (story && reader.p != reader.end) {
+        sdc_free(story);
+        story = NULL;
+    }
+    free(image);
+    
+    // A damaged entry would miss forever; drop it
+    if (!story) remove(path);
+    return story;
+}
+
+// Write the image under a temporary name and move it into place, so a
+// concurrent reader never sees half an image
+static bool cache_store(const char* path, const StoryData* story, uint64_t hash, size_t length) {
+    ImageWriter writer = { NULL, 0, 0 };
+    image_put_u64(&writer, SDC_IMAGE_MAGIC);
+    image_put_u64(&writer, SDC_IMAGE_VERSION);
+    image_put_u64(&writer, SDC_IMAGE_BYTE_ORDER);
+    image_put_u8(&writer, sizeof(SdcSize));
+    image_put_u8(&writer, sizeof(long));
+    image_put_u8(&writer, sizeof(bool));
+    image_put_u64(&writer, hash);
+    image_put_u64(&writer, (uint64_t)length);
+    image_write_story(&writer, story);
+    
+    size_t temp_length = strlen(path) + 8;
+    char* temp = (char*)malloc(temp_length);
+    snprintf(temp, temp_length, "%s.tmp", path);
+    
+    bool stored = false;
+    FILE* file = fopen(temp, "wb");
+    if (file) {
+        stored = fwrite(writer.data, 1, writer.length, file) == writer.length;
+        stored = fclose(file) == 0 && stored;
+        stored = stored && rename(temp, path) == 0;
+        if (!stored) remove(temp);
+    }
+    
+    free(temp);
+    free(writer.data);
+    return stored;
+}
+
+// sdc_parse_file with the cache enabled
+static StoryData* cache_parse_file(FILE* file) {
+    SdcCacheStats* stats = &parse_cache.stats;
+    stats->lookups++;
+    
+    double start = cache_now();
+    size_t length;
+    char* source = read_stream(file, &length);
+    if (!source) {
+        if (last_error) free(last_error);
+        last_error = strdup("Failed to read input");
+        return NULL;
+    }
+    uint64_t hash = content_hash(source, length);
+    char* path = cache_entry_path(hash);
+    double hashed = cache_now();
+    stats->hash_seconds += hashed - start;
+    
+    StoryData* story = cache_load(path, hash, length);
+    if (story) {
+        cache_touch(path);
+        stats->hits++;
+        stats->hit_seconds += cache_now() - hashed;
+    } else {
+        Lexer lexer;
+        lexer_init(&lexer, source, length);
+        story = parse_input(&lexer, NULL, NULL);
+        if (story && cache_store(path, story, hash, length)) {
+            stats->stores++;
+            cache_evict();
+        }
+        stats->misses++;
+        stats->miss_seconds += cache_now() - hashed;
+    }
+    
+    free(path);
+    free(source);
+    return story;
+}
+
+bool sdc_cache_enable(const char* directory, size_t max_bytes) {
+    sdc_cache_disable();
+    if (!directory || !cache_make_directory(directory)) return false;
+    
+    parse_cache.directory = strdup(directory);
+    parse_cache.max_bytes = max_bytes;
+    sdc_cache_reset_stats();
+    return true;
+}
+
+void sdc_cache_disable(void) {
+    free(parse_cache.directory);
+    parse_cache.directory = NULL;
+}
+
+void sdc_cache_clear(void) {
+    if (!parse_cache.directory) return;
+    
+    SdcSize count;
+    CacheEntry* entries = cache_list(&count);
+    for (SdcSize i = 0; i < count; i++) {
+        remove(entries[i].path);
+    }
+    cache_free_list(entries, count);
+}
+
+void sdc_cache_get_stats(SdcCacheStats* stats) {
+    if (stats) *stats = parse_cache.stats;
+}
+
+void sdc_cache_reset_stats(void) {
+    memset(&parse_cache.stats, 0, sizeof(SdcCacheStats));
+}
+
+#endif // SDC_NO_FILESYSTEM
+
+// ============================================================================
+// INCREMENTAL REPARSE
+// ============================================================================
+
+// Spare bytes kept after the text, plus an eighth of its length
+#define SDC_SOURCE_GAP 4096
+
+static SdcSource* source_create(const char* text, size_t length) {
+    SdcSource* source = (SdcSource*)calloc(1, sizeof(SdcSource));
+    source->gap_length = SDC_SOURCE_GAP + length / 8;
+    source->text = (char*)malloc(length + source->gap_length);
+    memcpy(source->text, text, length);
+    source->length = length;
+    source->gap = length;
+    return source;
+}
+
+static void free_source(SdcSource* source) {
+    if (!source) return;
+    free(source->text);
+    free(source->blocks);
+    for (SdcSize i = 0; i < source->error_count; i++) {
+        free(source->errors[i].message);
+    }
+    free(source->errors);
+    free(source);
+}
+
+static void source_move_gap(SdcSource* source, size_t offset) {
+    char* text = source->text;
+    if (offset < source->gap) {
+        memmove(text + offset + source->gap_length, text + offset, source->gap - offset);
+    } else if (offset > source->gap) {
+        memmove(text + source->gap, text + source->gap + source->gap_length, offset - source->gap);
+    }
+    source->gap = offset;
+}
+
+static void source_reserve_gap(SdcSource* source, size_t size) {
+    if (source->gap_length >= size) return;
+    
+    size_t tail = source->length - source->gap;
+    size_t gap_length = size + SDC_SOURCE_GAP + source->length / 8;
+    source->text = (char*)realloc(source->text, source->length + gap_length);
+    memmove(source->text + source->gap + gap_length,
+            source->text + source->gap + source->gap_length, tail);
+    source->gap_length = gap_length;
+}
+
+// Replace old_length bytes at offset with length bytes of text
+static void source_replace(SdcSource* source, size_t offset, size_t old_length,
+                           const char* text, size_t length) {
+    source_move_gap(source, offset);
+    source->gap_length += old_length;
+    source->length -= old_length;
+    
+    source_reserve_gap(source, length);
+    memcpy(source->text + source->gap, text, length);
+    source->gap += length;
+    source->gap_length -= length;
+    source->length += length;
+}
+
+// Text from start to end in one piece, followed by the '\0' sentinel the
+// lexer stops at. The gap moves to end to hold the sentinel.
+static const char* source_window(SdcSource* source, size_t start, size_t end) {
+    source_move_gap(source, end);
+    source_reserve_gap(source, 1);
+    source->text[end] = '\0';
+    return source->text + start;
+}
+
+// First block that ends at or after offset
+static SdcSize source_block_ending(const SdcSource* source, size_t offset) {
+    SdcSize lo = 0;
+    SdcSize hi = source->block_count;
+    while (lo < hi) {
+        SdcSize mid = lo + (hi - lo) / 2;
+        if (source->blocks[mid].end < offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// First block that starts after offset
+static SdcSize source_block_after(const SdcSource* source, size_t offset) {
+    SdcSize lo = 0;
+    SdcSize hi = source->block_count;
+    while (lo < hi) {
+        SdcSize mid = lo + (hi - lo) / 2;
+        if (source->blocks[mid].start <= offset) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Whether text that lexes cleanly from start to end runs into what
+// follows it: its last token touches end, or a comment is still open
+static bool source_joins_next(SdcSource* source, size_t start, size_t end) {
+    const char* text = source_window(source, start, end);
+    Lexer lexer;
+    lexer_init(&lexer, text, end - start);
+    
+    size_t last_end = 0;
+    while (true) {
+        Token token = lexer_scan(&lexer);
+        if (token.type == TOKEN_EOF || token.type == TOKEN_ERROR) break;
+        last_end = (size_t)(lexer.current - text);
+        token_release(&token);
+    }
+    if (last_end == end - start) return end > start;
+    
+    // Only blanks and comments follow the last token, so a '#' on the
+    // last line starts a comment that is still open
+    for (size_t i = end - start; i > last_end; i--) {
+        if (text[i - 1] == '\n') return false;
+        if (text[i - 1] == '#') return true;
+    }
+    return false;
+}
+
+// Parse the text from start to end as a run of top-level blocks, adding
+// their spans to found. Diagnostics count lines from start unless locate
+// is set, which costs a scan of the text before it.
+static StoryData* parse_region(SdcSource* source, size_t start, size_t end,
+                               SdcSource* found, bool locate, bool* at_end) {
+    Lexer lexer;
+    lexer_init(&lexer, source_window(source, start, end), end - start);
+    lexer.base = start;
+    lexer.line_start = start;
+    
+    if (locate) {
+        lexer.dropped_lines = count_newlines(source->text, start);
+        while (lexer.line_start > 0 && source->text[lexer.line_start - 1] != '\n') {
+            lexer.line_start--;
+        }
+    }
+    
+    found->block_count = 0;
+    return parse_input(&lexer, found, at_end);
+}
+
+// Parse the whole source into a new story and swap its contents in
+static bool reparse_all(StoryData* data) {
+    SdcSource* source = data->source;
+    SdcSource found = { 0 };
+    
+    Lexer lexer;
+    lexer_init(&lexer, source_window(source, 0, source->length), source->length);
+    StoryData* fresh = parse_input(&lexer, &found, NULL);
+    if (!fresh) {
+        free(found.blocks);
+        return false;
+    }
+    
+    bool relayout = data->node_index != NULL;
+    StoryData old = *data;
+    *data = *fresh;
+    *fresh = old;
+    fresh->source = NULL;
+    sdc_free(fresh);
+    
+    free(source->blocks);
+    source->blocks = found.blocks;
+    source->block_count = found.block_count;
+    source->block_capacity = found.block_capacity;
+    data->source = source;
+    
+    if (relayout) sdc_relayout(data);
+    return true;
+}
+
+// Free the payloads of replaced timeline items, leaving empty slots
+static void release_payloads(StoryData* data, const TimelineItem* items, SdcSize count) {
+    for (SdcSize i = 0; i < count; i++) {
+        uint32_t slot = items[i].payload;
+        if (items[i].type == SDC_TIMELINE_ITEM_DIALOGUE) {
+            free_dialogue(&data->dialogues[slot]);
+            memset(&data->dialogues[slot], 0, sizeof(Dialogue));
+            data->dialogue_hashes[slot] = 0;
+        } else {
+            free_action(&data->actions[slot]);
+            memset(&data->actions[slot], 0, sizeof(Action));
+            data->action_hashes[slot] = 0;
+        }
+    }
+}
+
+// Move the payloads of a node parsed into region over to data. The
+// released slots of reused items are filled first, so retyping a line
+// does not grow the payload arrays.
+static void move_payloads(StoryData* data, const TimelineItem* reused, SdcSize reused_count,
+                          StoryData* region, Node* node) {
+    SdcSize next_dialogue = 0;
+    SdcSize next_action = 0;
+    
+    for (SdcSize i = 0; i < node->timeline_count; i++) {
+        TimelineItem* item = &node->timeline[i];
+        uint32_t slot;
+        
+        if (item->type == SDC_TIMELINE_ITEM_DIALOGUE) {
+            while (next_dialogue < reused_count &&
+                   reused[next_dialogue].type != SDC_TIMELINE_ITEM_DIALOGUE) {
+                next_dialogue++;
+            }
+            slot = next_dialogue < reused_count ? reused[next_dialogue++].payload
+                                                : story_add_dialogue(data);
+            data->dialogues[slot] = region->dialogues[item->payload];
+            data->dialogue_hashes[slot] = region->dialogue_hashes[item->payload];
+            memset(&region->dialogues[item->payload], 0, sizeof(Dialogue));
+        } else {
+            while (next_action < reused_count &&
+                   reused[next_action].type != SDC_TIMELINE_ITEM_ACTION) {
+                next_action++;
+            }
+            slot = next_action < reused_count ? reused[next_action++].payload
+                                              : story_add_action(data);
+            data->actions[slot] = region->actions[item->payload];
+            data->action_hashes[slot] = region->action_hashes[item->payload];
+            memset(&region->actions[item->payload], 0, sizeof(Action));
+        }
+        item->payload = slot;
+    }
+}
+
+// The edit kept the same blocks: overwrite the entries in place
+static void reparse_in_place(StoryData* data, SdcSize first, StoryData* region, const SdcSource* found) {
+    SdcSource* source = data->source;
+    bool ids_changed = false;
+    
+    for (SdcSize i = 0; i < found->block_count; i++) {
+        SourceBlock* block = &source->blocks[first + i];
+        const SourceBlock* parsed = &found->blocks[i];
+        
+        if (block->kind == BLOCK_CHAPTER) {
+            Chapter* chapter = &data->chapters[block->index];
+            free(chapter->name);
+            *chapter = region->chapters[parsed->index];
+        } else if (block->kind == BLOCK_GROUP) {
+            Group* group = &data->groups[block->index];
+            ids_changed |= group->id != region->groups[parsed->index].id;
+            free_group(group);
+            *group = region->groups[parsed->index];
+        } else if (block->kind == BLOCK_NODE) {
+            Node* node = &data->nodes[block->index];
+            Node* parsed_node = &region->nodes[parsed->index];
+            ids_changed |= node->id != parsed_node->id;
+            release_payloads(data, node->timeline, node->timeline_count);
+            move_payloads(data, node->timeline, node->timeline_count, region, parsed_node);
+            free_node(data, node);
+            *node = *parsed_node;
+        }
+        
+        block->start = parsed->start;
+        block->end = parsed->end;
+    }
+    
+    if (ids_changed && data->node_index) {
+        free(data->node_index);
+        free(data->group_index);
+        data->node_index = build_node_index(data);
+        data->group_index = build_group_index(data);
+    }
+}
+
+// Replace items [at, at + old_count) of an array with room for new_count
+// items there, growing the allocation past *capacity when needed
+static void* splice_items(void* items, SdcSize count, SdcSize* capacity, size_t size,
+                          SdcSize at, SdcSize old_count, SdcSize new_count) {
+    char* bytes = (char*)items;
+    SdcSize total = count - old_count + new_count;
+    if (total > *capacity) {
+        *capacity = total;
+        bytes = (char*)realloc(bytes, size * total);
+    }
+    if (count > at + old_count) {
+        memmove(bytes + size * (at + new_count), bytes + size * (at + old_count),
+                size * (count - at - old_count));
+    }
+    return bytes;
+}
+
+// The edit added or removed blocks. Entries keep file order, so the ones
+// of each kind in the region form one run of their array.
+static void reparse_splice(StoryData* data, SdcSize first, SdcSize after,
+                           StoryData* region, const SdcSource* found) {
+    SdcSource* source = data->source;
+    
+    // Where each kind's run starts: past the last such entry before it
+    SdcSize at[BLOCK_SECTION] = { 0, 0, 0 };
+    SdcSize missing = BLOCK_SECTION;
+    bool placed[BLOCK_SECTION] = { false, false, false };
+    for (SdcSize i = first; i-- > 0 && missing > 0;) {
+        BlockKind kind = source->blocks[i].kind;
+        if (kind != BLOCK_SECTION && !placed[kind]) {
+            at[kind] = source->blocks[i].index + 1;
+            placed[kind] = true;
+            missing--;
+        }
+    }
+    
+    SdcSize removed[BLOCK_SECTION] = { 0, 0, 0 };
+    for (SdcSize i = first; i < after; i++) {
+        SourceBlock* block = &source->blocks[i];
+        removed[block->kind]++;
+        
+        if (block->kind == BLOCK_CHAPTER) {
+            free(data->chapters[block->index].name);
+        } else if (block->kind == BLOCK_GROUP) {
+            free_group(&data->groups[block->index]);
+        } else {
+            Node* node = &data->nodes[block->index];
+            release_payloads(data, node->timeline, node->timeline_count);
+            free_node(data, node);
+        }
+    }
+    
+    SdcSize capacity = data->chapter_count;
+    data->chapters = (Chapter*)splice_items(data->chapters, data->chapter_count, &capacity,
+        sizeof(Chapter), at[BLOCK_CHAPTER], removed[BLOCK_CHAPTER], region->chapter_count);
+    if (region->chapter_count > 0) {
+        memcpy(&data->chapters[at[BLOCK_CHAPTER]], region->chapters, sizeof(Chapter) * region->chapter_count);
+    }
+    data->chapter_count = data->chapter_count - removed[BLOCK_CHAPTER] + region->chapter_count;
+    
+    capacity = data->group_count;
+    data->groups = (Group*)splice_items(data->groups, data->group_count, &capacity,
+        sizeof(Group), at[BLOCK_GROUP], removed[BLOCK_GROUP], region->group_count);
+    if (region->group_count > 0) {
+        memcpy(&data->groups[at[BLOCK_GROUP]], region->groups, sizeof(Group) * region->group_count);
+    }
+    data->group_count = data->group_count - removed[BLOCK_GROUP] + region->group_count;
+    
+    capacity = data->node_count;
+    data->nodes = (Node*)splice_items(data->nodes, data->node_count, &capacity,
+        sizeof(Node), at[BLOCK_NODE], removed[BLOCK_NODE], region->node_count);
+    for (SdcSize i = 0; i < region->node_count; i++) {
+        move_payloads(data, NULL, 0, region, &region->nodes[i]);
+        data->nodes[at[BLOCK_NODE] + i] = region->nodes[i];
+    }
+    data->node_count = data->node_count - removed[BLOCK_NODE] + region->node_count;
+    
+    // Swap the region's spans into the block list
+    SdcSize added[BLOCK_SECTION] = { region->chapter_count, region->group_count, region->node_count };
+    for (SdcSize i = after; i < source->block_count; i++) {
+        SourceBlock* block = &source->blocks[i];
+        if (block->kind != BLOCK_SECTION) {
+            block->index = block->index - removed[block->kind] + added[block->kind];
+        }
+    }
+    
+    source->blocks = (SourceBlock*)splice_items(source->blocks, source->block_count,
+        &source->block_capacity, sizeof(SourceBlock), first, after - first, found->block_count);
+    for (SdcSize i = 0; i < found->block_count; i++) {
+        SourceBlock* block = &source->blocks[first + i];
+        *block = found->blocks[i];
+        block->index += at[block->kind];
+    }
+    source->block_count = source->block_count - (after - first) + found->block_count;
+}
+
+static char source_char(const SdcSource* source, size_t offset) {
+    return source->text[offset < source->gap ? offset : offset + source->gap_length];
+}
+
+// Drop the errors whose spans overlap start to end
+static void source_clear_errors(SdcSource* source, size_t start, size_t end) {
+    SdcSize kept = 0;
+    for (SdcSize i = 0; i < source->error_count; i++) {
+        SourceError* error = &source->errors[i];
+        if (error->start < end && error->end > start) {
+            free(error->message);
+        } else {
+            source->errors[kept++] = *error;
+        }
+    }
+    source->error_count = kept;
+}
+
+// Record last_error for the text from start to end. Positioned errors keep
+// only the text after "Error at line L, column C: ", as both can move.
+static void source_add_error(SdcSource* source, size_t start, size_t end) {
+    source_clear_errors(source, start, end);
+    
+    SdcSize at = source->error_count;
+    while (at > 0 && source->errors[at - 1].start > start) at--;
+    source->errors = (SourceError*)splice_items(source->errors, source->error_count,
+        &source->error_capacity, sizeof(SourceError), at, 0, 1);
+    source->error_count++;
+    
+    const char* detail = last_error_line > 0 ? strstr(last_error, ": ") : NULL;
+    SourceError* error = &source->errors[at];
+    error->start = start;
+    error->end = end;
+    error->offset = last_error_offset;
+    error->line = detail ? last_error_line : 0;
+    error->message = strdup(detail ? detail + 2 : last_error);
+}
+
+// Point last_error at the first error still in the source
+static void source_report_error(const SdcSource* source) {
+    const SourceError* error = &source->errors[0];
+    if (last_error) free(last_error);
+    last_error_offset = error->offset;
+    last_error_line = error->line;
+    if (error->line == 0) {
+        last_error = strdup(error->message);
+        return;
+    }
+    
+    size_t line_start = error->offset;
+    while (line_start > 0 && source_char(source, line_start - 1) != '\n') line_start--;
+    
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "Error at line %zu, column %zu: %s",
+             error->line, error->offset - line_start + 1, error->message);
+    last_error = strdup(buffer);
+}
+
+bool sdc_reparse(StoryData* data, size_t edit_offset, size_t old_length, const char* new_text) {
+    if (!data || !data->source) {
+        if (last_error) free(last_error);
+        last_error = strdup("Story has no source to reparse");
+        return false;
+    }
+    
+    SdcSource* source = data->source;
+    if (edit_offset > source->length || old_length > source->length - edit_offset) {
+        if (last_error) free(last_error);
+        last_error = strdup("Edit is outside the source");
+        return false;
+    }
+    if (!new_text) new_text = "";
+    
+    // Blocks the edit touches, counting ones it only borders: text typed
+    // right before a block can join its first token
+    size_t new_length = strlen(new_text);
+    size_t edit_end = edit_offset + old_length;
+    SdcSize first = source_block_ending(source, edit_offset);
+    SdcSize after = source_block_after(source, edit_end);
+    
+    // Errors past the edit move with the text; the ones it touches lie
+    // in the region reparsed below
+    if (source->error_count > 0) {
+        size_t old_lines = count_newlines(source_window(source, edit_offset, edit_end), old_length);
+        size_t new_lines = count_newlines(new_text, new_length);
+        for (SdcSize i = 0; i < source->error_count; i++) {
+            SourceError* error = &source->errors[i];
+            if (error->start <= edit_end) continue;
+            error->start = error->start - old_length + new_length;
+            error->end = error->end - old_length + new_length;
+            error->offset = error->offset - old_length + new_length;
+            if (error->line > 0) error->line = error->line - old_lines + new_lines;
+        }
+    }
+    
+    source_replace(source, edit_offset, old_length, new_text, new_length);
+    for (SdcSize i = after; i < source->block_count; i++) {
+        source->blocks[i].start = source->blocks[i].start - old_length + new_length;
+        source->blocks[i].end = source->blocks[i].end - old_length + new_length;
+    }
+    
+    // Reparse the text between the neighbouring blocks. A block or string
+    // left open runs into the blocks after it, as does a comment or token
+    // that reaches the next block; take in as many again.
+    size_t region_start = first > 0 ? source->blocks[first - 1].end : 0;
+    size_t region_end;
+    SdcSource found = { 0 };
+    StoryData* region;
+    bool at_end;
+    
+    while (true) {
+        region_end = after < source->block_count ? source->blocks[after].start : source->length;
+        region = parse_region(source, region_start, region_end, &found, false, &at_end);
+        
+        bool joins = false;
+        if (region && after < source->block_count) {
+            size_t tail = found.block_count > 0 ? found.blocks[found.block_count - 1].end : region_start;
+            joins = source_joins_next(source, tail, region_end);
+        }
+        if (joins) {
+            sdc_free(region);
+            region = NULL;
+        } else if (region || !at_end || after == source->block_count) {
+            break;
+        }
+        
+        after += after - first + 1;
+        if (after > source->block_count) after = source->block_count;
+    }
+    
+    bool sections = false;
+    bool same_blocks = region && found.block_count == after - first;
+    for (SdcSize i = 0; region && i < found.block_count; i++) {
+        sections |= found.blocks[i].kind == BLOCK_SECTION;
+        same_blocks = same_blocks && found.blocks[i].kind == source->blocks[first + i].kind;
+    }
+    for (SdcSize i = first; i < after; i++) {
+        sections |= source->blocks[i].kind == BLOCK_SECTION;
+    }
+    
+    // Sections fill story-wide tables, and a relaid-out story no longer
+    // has entries in file order to splice into. While errors stand
+    // elsewhere the whole source cannot parse; it is owed until they go.
+    bool parsed = region != NULL;
+    bool merged = false;
+    if (parsed) source_clear_errors(source, region_start, region_end);
+    
+    if (region && (sections || source->full_pending || (!same_blocks && data->node_index))) {
+        merged = source->error_count == 0 && reparse_all(data);
+        source->full_pending = !merged;
+        sdc_free(region);
+    } else if (region) {
+        merged = true;
+        if (same_blocks) {
+            reparse_in_place(data, first, region, &found);
+        } else {
+            reparse_splice(data, first, after, region, &found);
+        }
+        
+        // Its entries and payloads now belong to data
+        region->chapter_count = 0;
+        region->group_count = 0;
+        region->node_count = 0;
+        sdc_free(region);
+    }
+    
+    if (!parsed) {
+        // Report the error with its real line
+        StoryData* located = parse_region(source, region_start, region_end, &found, true, &at_end);
+        sdc_free(located);
+        source_add_error(source, region_start, region_end);
+    }
+    if (!merged) {
+        // Widen the spans of the blocks kept from before so the next edit
+        // nearby retries them all
+        for (SdcSize i = first; i < after; i++) {
+            source->blocks[i].start = region_start;
+            source->blocks[i].end = region_end;
+        }
+    }
+    
+    free(found.blocks);
+    if (source->error_count == 0 && !source->full_pending) return true;
+    
+    if (source->error_count > 0) source_report_error(source);
+    return false;
+}
+
+// ============================================================================
+// HOT RELOAD
+// ============================================================================
+
+// Whether two sources have the same section blocks in the same order
+static bool sections_equal(const SdcSource* a, const char* a_text, const SdcSource* b, const char* b_text) {
+    SdcSize i = 0;
+    SdcSize j = 0;
+    while (true) {
+        while (i < a->block_count && a->blocks[i].kind != BLOCK_SECTION) i++;
+        while (j < b->block_count && b->blocks[j].kind != BLOCK_SECTION) j++;
+        if (i == a->block_count || j == b->block_count) {
+            return i == a->block_count && j == b->block_count;
+        }
+        
+        const SourceBlock* x = &a->blocks[i++];
+        const SourceBlock* y = &b->blocks[j++];
+        size_t length = x->end - x->start;
+        if (length != y->end - y->start) return false;
+        if (content_hash(a_text + x->start, length) != content_hash(b_text + y->start, length)) return false;
+    }
+}
+
+static SdcSize entity_count(const StoryData* story, BlockKind kind) {
+    if (kind == BLOCK_CHAPTER) return story->chapter_count;
+    if (kind == BLOCK_GROUP) return story->group_count;
+    return story->node_count;
+}
+
+static size_t entity_size(BlockKind kind) {
+    if (kind == BLOCK_CHAPTER) return sizeof(Chapter);
+    if (kind == BLOCK_GROUP) return sizeof(Group);
+    return sizeof(Node);
+}
+
+static void* entity_at(StoryData* story, BlockKind kind, SdcSize index) {
+    if (kind == BLOCK_CHAPTER) return &story->chapters[index];
+    if (kind == BLOCK_GROUP) return &story->groups[index];
+    return &story->nodes[index];
+}
+
+static int entity_id(StoryData* story, BlockKind kind, SdcSize index) {
+    if (kind == BLOCK_CHAPTER) return story->chapters[index].id;
+    if (kind == BLOCK_GROUP) return story->groups[index].id;
+    return story->nodes[index].id;
+}
+
+static uint64_t entity_hash(StoryData* story, BlockKind kind, SdcSize index) {
+    if (kind == BLOCK_CHAPTER) return story->chapters[index].content_hash;
+    if (kind == BLOCK_GROUP) return story->groups[index].content_hash;
+    return story->nodes[index].content_hash;
+}
+
+// Free an entry of data, with its payloads
+static void entity_release(StoryData* data, BlockKind kind, void* entry) {
+    if (kind == BLOCK_CHAPTER) {
+        free(((Chapter*)entry)->name);
+    } else if (kind == BLOCK_GROUP) {
+        free_group((Group*)entry);
+    } else {
+        Node* node = (Node*)entry;
+        release_payloads(data, node->timeline, node->timeline_count);
+        free_node(data, node);
+    }
+}
+
+// Move entry index of fresh to dest in data, releasing old (a copy of the
+// entry it replaces, or NULL). The payload slots of old are reused.
+static void entity_adopt(StoryData* data, BlockKind kind, void* dest, const void* old,
+                         StoryData* fresh, SdcSize index) {
+    if (kind == BLOCK_CHAPTER) {
+        if (old) free(((const Chapter*)old)->name);
+        *(Chapter*)dest = fresh->chapters[index];
+        memset(&fresh->chapters[index], 0, sizeof(Chapter));
+    } else if (kind == BLOCK_GROUP) {
+        if (old) free_group((Group*)old);
+        *(Group*)dest = fresh->groups[index];
+        memset(&fresh->groups[index], 0, sizeof(Group));
+    } else {
+        Node previous = { 0 };
+        if (old) previous = *(const Node*)old;
+        release_payloads(data, previous.timeline, previous.timeline_count);
+        move_payloads(data, previous.timeline, previous.timeline_count, fresh, &fresh->nodes[index]);
+        if (old) free_node(data, &previous);
+        *(Node*)dest = fresh->nodes[index];
+        memset(&fresh->nodes[index], 0, sizeof(Node));
+    }
+}
+
+// Pair each entry of fresh with the entry of data that has its id, the
+// k-th with the k-th when ids repeat. Returns the index in data for each
+// entry of fresh, SDC_NOT_FOUND for new ones.
+static SdcSize* match_ids(StoryData* data, StoryData* fresh, BlockKind kind) {
+    SdcSize old_count = entity_count(data, kind);
+    SdcSize new_count = entity_count(fresh, kind);
+    IdIndexEntry* old_ids = (IdIndexEntry*)malloc(sizeof(IdIndexEntry) * (old_count + 1));
+    IdIndexEntry* new_ids = (IdIndexEntry*)malloc(sizeof(IdIndexEntry) * (new_count + 1));
+    for (SdcSize i = 0; i < old_count; i++) {
+        old_ids[i].id = entity_id(data, kind, i);
+        old_ids[i].index = i;
+    }
+    for (SdcSize i = 0; i < new_count; i++) {
+        new_ids[i].id = entity_id(fresh, kind, i);
+        new_ids[i].index = i;
+    }
+    qsort(old_ids, old_count, sizeof(IdIndexEntry), compare_id_index);
+    qsort(new_ids, new_count, sizeof(IdIndexEntry), compare_id_index);
+    
+    SdcSize* match = (SdcSize*)malloc(sizeof(SdcSize) * (new_count + 1));
+    SdcSize next = 0;
+    for (SdcSize i = 0; i < new_count; i++) {
+        while (next < old_count && old_ids[next].id < new_ids[i].id) next++;
+        bool found = next < old_count && old_ids[next].id == new_ids[i].id;
+        match[new_ids[i].index] = found ? old_ids[next++].index : SDC_NOT_FOUND;
+    }
+    
+    free(old_ids);
+    free(new_ids);
+    return match;
+}
+
+static void add_change(SdcChangeSet* set, SdcSize* capacity, BlockKind kind,
+                       SdcChangeType type, int id, SdcSize index) {
+    set->changes = (SdcChange*)reserve_item(set->changes, set->change_count, capacity, sizeof(SdcChange));
+    SdcChange* change = &set->changes[set->change_count++];
+    change->kind = (SdcEntityKind)kind;
+    change->type = type;
+    change->id = id;
+    change->index = index;
+}
+
+// Merge the chapters, groups or nodes of fresh into data. Matched entries
+// with the same content hash are kept. Sets where each entry of fresh
+// ended up.
+static void reload_entities(StoryData* data, StoryData* fresh, BlockKind kind,
+                            SdcChangeSet* set, SdcSize* capacity, SdcSize* placed) {
+    SdcSize old_count = entity_count(data, kind);
+    SdcSize new_count = entity_count(fresh, kind);
+    size_t size = entity_size(kind);
+    SdcSize* match = match_ids(data, fresh, kind);
+    
+    bool* kept = (bool*)calloc(old_count + 1, sizeof(bool));
+    bool same_ids = old_count == new_count;
+    for (SdcSize i = 0; i < new_count; i++) {
+        if (match[i] == SDC_NOT_FOUND) same_ids = false;
+        else kept[match[i]] = true;
+    }
+    
+    // Entries of the same ids are updated where they are
+    char* items = same_ids ? NULL : (char*)malloc(size * (new_count + 1));
+    for (SdcSize i = 0; i < new_count; i++) {
+        SdcSize old = match[i];
+        bool unchanged = old != SDC_NOT_FOUND && entity_hash(data, kind, old) == entity_hash(fresh, kind, i);
+        placed[i] = same_ids ? old : i;
+        
+        if (unchanged) {
+            if (!same_ids) memcpy(items + size * i, entity_at(data, kind, old), size);
+            set->unchanged_count++;
+            continue;
+        }
+        
+        int id = entity_id(fresh, kind, i);
+        void* dest = same_ids ? entity_at(data, kind, old) : items + size * i;
+        if (old == SDC_NOT_FOUND) {
+            entity_adopt(data, kind, dest, NULL, fresh, i);
+        } else {
+            // A copy, as dest may be the entry itself
+            union { Chapter chapter; Group group; Node node; } previous;
+            memcpy(&previous, entity_at(data, kind, old), size);
+            entity_adopt(data, kind, dest, &previous, fresh, i);
+        }
+        add_change(set, capacity, kind, old == SDC_NOT_FOUND ? SDC_CHANGE_ADDED : SDC_CHANGE_MODIFIED,
+                   id, placed[i]);
+    }
+    
+    for (SdcSize i = 0; i < old_count; i++) {
+        if (kept[i]) continue;
+        add_change(set, capacity, kind, SDC_CHANGE_REMOVED, entity_id(data, kind, i), SDC_NOT_FOUND);
+        entity_release(data, kind, entity_at(data, kind, i));
+    }
+    
+    if (!same_ids) {
+        if (kind == BLOCK_CHAPTER) {
+            free(data->chapters);
+            data->chapters = (Chapter*)items;
+            data->chapter_count = new_count;
+            set->chapters_moved = true;
+        } else if (kind == BLOCK_GROUP) {
+            free(data->groups);
+            data->groups = (Group*)items;
+            data->group_count = new_count;
+            set->groups_moved = true;
+        } else {
+            free(data->nodes);
+            data->nodes = (Node*)items;
+            data->node_count = new_count;
+            set->nodes_moved = true;
+        }
+    }
+    
+    free(kept);
+    free(match);
+}
+
+static int compare_changes(const void* a, const void* b) {
+    const SdcChange* x = (const SdcChange*)a;
+    const SdcChange* y = (const SdcChange*)b;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return x->type < y->type ? -1 : (x->type > y->type);
+}
+
+SdcChangeSet* sdc_reload(StoryData* data, const char* new_source) {
+    if (!data || !new_source) {
+        if (last_error) free(last_error);
+        last_error = strdup("No story or source to reload");
+        return NULL;
+    }
+    
+    size_t length = strlen(new_source);
+    SdcSource* source = source_create(new_source, length);
+    Lexer lexer;
+    lexer_init(&lexer, source_window(source, 0, length), length);
+    StoryData* fresh = parse_input(&lexer, source, NULL);
+    if (!fresh) {
+        free_source(source);
+        return NULL;
+    }
+    
+    // The old section spans can be trusted only while no edit left them widened
+    SdcSource* old_source = data->source;
+    bool comparable = old_source && old_source->error_count == 0 && !old_source->full_pending;
+    const char* old_text = comparable ? source_window(old_source, 0, old_source->length) : NULL;
+    const char* new_text = source->text;
+    
+    SdcChangeSet* set = (SdcChangeSet*)calloc(1, sizeof(SdcChangeSet));
+    SdcSize capacity = 0;
+    
+    // Section tables go as a whole
+    set->sections_changed = !comparable || !sections_equal(old_source, old_text, source, new_text);
+    if (set->sections_changed) {
+        StoryData old = *data;
+        data->states = fresh->states;
+        data->state_count = fresh->state_count;
+        data->global_vars = fresh->global_vars;
+        data->global_var_count = fresh->global_var_count;
+        data->linked_lists = fresh->linked_lists;
+        data->linked_list_count = fresh->linked_list_count;
+        data->characters = fresh->characters;
+        data->character_count = fresh->character_count;
+        data->tags = fresh->tags;
+        data->tag_count = fresh->tag_count;
+        fresh->states = old.states;
+        fresh->state_count = old.state_count;
+        fresh->global_vars = old.global_vars;
+        fresh->global_var_count = old.global_var_count;
+        fresh->linked_lists = old.linked_lists;
+        fresh->linked_list_count = old.linked_list_count;
+        fresh->characters = old.characters;
+        fresh->character_count = old.character_count;
+        fresh->tags = old.tags;
+        fresh->tag_count = old.tag_count;
+    }
+    
+    SdcSize* placed[BLOCK_SECTION];
+    for (int kind = BLOCK_CHAPTER; kind < BLOCK_SECTION; kind++) {
+        SdcSize count = entity_count(fresh, (BlockKind)kind);
+        placed[kind] = (SdcSize*)malloc(sizeof(SdcSize) * (count + 1));
+        reload_entities(data, fresh, (BlockKind)kind, set, &capacity, placed[kind]);
+    }
+    
+    // The new spans point at the merged entries
+    for (SdcSize i = 0; i < source->block_count; i++) {
+        SourceBlock* block = &source->blocks[i];
+        if (block->kind != BLOCK_SECTION) block->index = placed[block->kind][block->index];
+    }
+    for (int kind = BLOCK_CHAPTER; kind < BLOCK_SECTION; kind++) {
+        free(placed[kind]);
+    }
+    // Only editable stories keep their source
+    free_source(old_source);
+    if (old_source) {
+        data->source = source;
+    } else {
+        free_source(source);
+    }
+    
+    // A relaid-out story is laid out again once entries moved, and the
+    // changes are pointed at the positions it gave them
+    if (data->node_index && (set->chapters_moved || set->groups_moved || set->nodes_moved)) {
+        sdc_relayout(data);
+        set->groups_moved = true;
+        set->nodes_moved = true;
+        for (SdcSize i = 0; i < set->change_count; i++) {
+            SdcChange* change = &set->changes[i];
+            if (change->type == SDC_CHANGE_REMOVED || change->kind == SDC_ENTITY_CHAPTER) continue;
+            change->index = change->kind == SDC_ENTITY_NODE
+                ? id_index_find(data->node_index, data->node_count, change->id)
+                : id_index_find(data->group_index, data->group_count, change->id);
+        }
+    }
+    
+    if (set->change_count > 1) {
+        qsort(set->changes, set->change_count, sizeof(SdcChange), compare_changes);
+    }
+    sdc_free(fresh);
+    return set;
+}
+
+const SdcChange* sdc_find_change(const SdcChangeSet* changes, SdcEntityKind kind, int id) {
+    if (!changes) return NULL;
+    
+    SdcSize lo = 0;
+    SdcSize hi = changes->change_count;
+    while (lo < hi) {
+        SdcSize mid = lo + (hi - lo) / 2;
+        const SdcChange* change = &changes->changes[mid];
+        if (change->kind < kind || (change->kind == kind && change->id < id)) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    if (lo < changes->change_count && changes->changes[lo].kind == kind && changes->changes[lo].id == id) {
+        return &changes->changes[lo];
+    }
+    return NULL;
+}
+
+void sdc_free_change_set(SdcChangeSet* changes) {
+    if (!changes) return;
+    free(changes->changes);
+    free(changes);
+}
+
+// ============================================================================
+// PUBLIC API IMPLEMENTATION
+// ============================================================================
+
+// Parse a whole input. With source set, the spans of its top-level blocks
+// are added to it. at_end tells whether the input ran out before a failed
+// parse could finish (a block or string left open).
+static StoryData* parse_input(const Lexer* lexer, SdcSource* source, bool* at_end) {
+    Parser* parser = parser_create(lexer);
+    parser->source = source;
+    bool parsed = parse_story(parser) && !parser->error_message;
+    if (at_end) *at_end = is_at_end_parser(parser);
+    
+    if (parser->lexer.read_error) {
+        if (last_error) free(last_error);
+        last_error = strdup("Failed to read input");
+        last_error_line = 0;
+        parsed = false;
+    } else if (parser->lexer_error) {
+        if (last_error) free(last_error);
+        last_error = strdup("Lexer error: invalid token");
+        last_error_line = 0;
+        parsed = false;
+    }
+    
+    if (!parsed) {
+        StoryData* failed_story = parser->story;
+        sdc_free(failed_story);
+        parser->story = NULL;
+        parser_free(parser);
+        return NULL;
+    }
+    
+    StoryData* result = parser->story;
+    parser->story = NULL;
+    
+    parser_free(parser);
+    
+    return result;
+}
+
+StoryData* sdc_parse_string(const char* source) {
+    if (!source) return NULL;
+    
+    Lexer lexer;
+    lexer_init(&lexer, source, strlen(source));
+    return parse_input(&lexer, NULL, NULL);
+}
+
+StoryData* sdc_parse_editable(const char* source) {
+    if (!source) return NULL;
+    
+    // Lex the copy kept for sdc_reparse
+    size_t length = strlen(source);
+    SdcSource* retained = source_create(source, length);
+    
+    Lexer lexer;
+    lexer_init(&lexer, source_window(retained, 0, length), length);
+    StoryData* story = parse_input(&lexer, retained, NULL);
+    if (story) {
+        story->source = retained;
+    } else {
+        free_source(retained);
+    }
+    return story;
+}
+
+StoryData* sdc_parse_reader(SdcReadFn read, void* user) {
+    if (!read) return NULL;
+    
+    Lexer lexer;
+    lexer_init_reader(&lexer, read, user);
+    return parse_input(&lexer, NULL, NULL);
+}
+
+#ifndef SDC_NO_FILESYSTEM
+static long read_file(void* user, char* buffer, size_t size) {
+    FILE* file = (FILE*)user;
+    size_t count = fread(buffer, 1, size, file);
+    if (count == 0 && ferror(file)) return -1;
+    return (long)count;
+}
+
+StoryData* sdc_parse_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        if (last_error) free(last_error);
+        last_error = strdup("Failed to open file");
+        return NULL;
+    }
+    
+    StoryData* result = parse_cache.directory ? cache_parse_file(file)
+                                              : sdc_parse_reader(read_file, file);
+    fclose(file);
+    
+    return result;
+}
+#endif
+
+void sdc_free(StoryData* data) {
+    if (!data) return;
+    
+    // Free states
+    for (SdcSize i = 0; i < data->state_count; i++) {
+        free(data->states[i].name);
+    }
+    free(data->states);
+    
+    // Free global variables
+    for (SdcSize i = 0; i < data->global_var_count; i++) {
+        free(data->global_vars[i].name);
+        if (data->global_vars[i].type == SDC_VAR_TYPE_STRING) {
+            free(data->global_vars[i].default_value.string_value);
+        }
+    }
+    free(data->global_vars);
+    
+    // Free tags
+    for (SdcSize i = 0; i < data->tag_count; i++) {
+        free(data->tags[i].name);
+        free(data->tags[i].color);
+        for (SdcSize j = 0; j < data->tags[i].key_count; j++) {
+            free(data->tags[i].keys[j]);
+        }
+        free(data->tags[i].keys);
+    }
+    free(data->tags);
+    
+    // Free chapters
+    for (SdcSize i = 0; i < data->chapter_count; i++) {
+        free(data->chapters[i].name);
+    }
+    free(data->chapters);
+    
+    // Free groups (updated to include linked_lists)
+    for (SdcSize i = 0; i < data->group_count; i++) {
+        free_group(&data->groups[i]);
+    }
+    free(data->groups);
+    
+    // Free nodes
+    for (SdcSize i = 0; i < data->node_count; i++) {
+        free_node(data, &data->nodes[i]);
+    }
+    free(data->nodes);
+    
+    // Free timeline payloads
+    for (SdcSize i = 0; i < data->dialogue_count; i++) {
+        free_dialogue(&data->dialogues[i]);
+    }
+    free(data->dialogues);
+    free(data->dialogue_hashes);
+    
+    for (SdcSize i = 0; i < data->action_count; i++) {
+        free_action(&data->actions[i]);
+    }
+    free(data->actions);
+    free(data->action_hashes);
+    
+    free(data->timeline_pool);
+    free(data->node_index);
+    free(data->group_index);
+    
+    for (SdcSize i = 0; i < data->linked_list_count; i++) {
+        free(data->linked_lists[i].name);
+        free(data->linked_lists[i].scope);
+        for (SdcSize j = 0; j < data->linked_lists[i].field_count; j++) {
             free(data->linked_lists[i].field_names[j]);
             free(data->linked_lists[i].fields[j].type);
+            if (data->linked_lists[i].columns) {
+                free(data->linked_lists[i].columns[j].data.int_values);
+                free(data->linked_lists[i].columns[j].present);
+            }
         }
         free(data->linked_lists[i].field_names);
         free(data->linked_lists[i].fields);
+        free(data->linked_lists[i].columns);
+        
+        for (SdcSize j = 0; j < data->linked_lists[i].string_count; j++) {
+            free(data->linked_lists[i].strings[j]);
+        }
+        free(data->linked_lists[i].strings);
     }
     free(data->linked_lists);
     
     // Free characters
-    for (int i = 0; i < data->character_count; i++) {
+    for (SdcSize i = 0; i < data->character_count; i++) {
         free(data->characters[i].name);
         free(data->characters[i].biography);
         free(data->characters[i].description);
         
-        for (int j = 0; j < data->characters[i].linked_list_count; j++) {
+        for (SdcSize j = 0; j < data->characters[i].linked_list_count; j++) {
             free(data->characters[i].linked_list_names[j]);
-            
-            LinkedListData* ll_data = &data->characters[i].linked_list_data[j];
-            for (int k = 0; k < ll_data->count; k++) {
-                for (int m = 0; m < ll_data->instances[k].count; m++) {
-                    free(ll_data->instances[k].keys[m]);
-                    if (ll_data->instances[k].values[m].type == SDC_LL_VALUE_STRING) {
-                        free(ll_data->instances[k].values[m].data.string_value);
-                    }
-                }
-                free(ll_data->instances[k].keys);
-                free(ll_data->instances[k].values);
-            }
-            free(ll_data->instances);
         }
         free(data->characters[i].linked_list_names);
         free(data->characters[i].linked_list_data);
     }
     free(data->characters);
     
+    free_source(data->source);
     free(data);
 }
 
@@ -2438,7 +5111,7 @@ const char* sdc_get_error(void) {
 }
 
 LinkedListDefinition* sdc_get_linked_list(StoryData* data, const char* name) {
-    for (int i = 0; i < data->linked_list_count; i++) {
+    for (SdcSize i = 0; i < data->linked_list_count; i++) {
         if (strcmp(data->linked_lists[i].name, name) == 0) {
             return &data->linked_lists[i];
         }
@@ -2447,7 +5120,7 @@ LinkedListDefinition* sdc_get_linked_list(StoryData* data, const char* name) {
 }
 
 Character* sdc_get_character(StoryData* data, const char* name) {
-    for (int i = 0; i < data->character_count; i++) {
+    for (SdcSize i = 0; i < data->character_count; i++) {
         if (strcmp(data->characters[i].name, name) == 0) {
             return &data->characters[i];
         }
@@ -2455,18 +5128,80 @@ Character* sdc_get_character(StoryData* data, const char* name) {
     return NULL;
 }
 
-LinkedListDefinition* sdc_get_linked_lists(StoryData* data, int* count) {
+LinkedListDefinition* sdc_get_linked_lists(StoryData* data, SdcSize* count) {
     if (count) *count = data->linked_list_count;
     return data->linked_lists;
 }
 
-Character* sdc_get_characters(StoryData* data, int* count) {
+Character* sdc_get_characters(StoryData* data, SdcSize* count) {
     if (count) *count = data->character_count;
     return data->characters;
 }
 
+SdcSize sdc_linked_list_field_index(const LinkedListDefinition* list, const char* field_name) {
+    for (SdcSize i = 0; i < list->field_count; i++) {
+        if (strcmp(list->field_names[i], field_name) == 0) {
+            return i;
+        }
+    }
+    return SDC_NOT_FOUND;
+}
+
+bool sdc_linked_list_has_value(const LinkedListDefinition* list, SdcSize row, SdcSize field) {
+    // Unsigned comparison also rejects negative positions with SDC_INT_SIZES
+    if ((size_t)row >= (size_t)list->row_count || (size_t)field >= (size_t)list->field_count) {
+        return false;
+    }
+    return list->columns[field].present[row];
+}
+
+long sdc_linked_list_get_int(const LinkedListDefinition* list, SdcSize row, SdcSize field) {
+    if (!sdc_linked_list_has_value(list, row, field)) return 0;
+    const LinkedListColumn* column = &list->columns[field];
+    if (column->type == SDC_LL_VALUE_INT) return column->data.int_values[row];
+    if (column->type == SDC_LL_VALUE_FLOAT) return (long)column->data.float_values[row];
+    return 0;
+}
+
+double sdc_linked_list_get_float(const LinkedListDefinition* list, SdcSize row, SdcSize field) {
+    if (!sdc_linked_list_has_value(list, row, field)) return 0.0;
+    const LinkedListColumn* column = &list->columns[field];
+    if (column->type == SDC_LL_VALUE_FLOAT) return column->data.float_values[row];
+    if (column->type == SDC_LL_VALUE_INT) return (double)column->data.int_values[row];
+    return 0.0;
+}
+
+bool sdc_linked_list_get_bool(const LinkedListDefinition* list, SdcSize row, SdcSize field) {
+    if (!sdc_linked_list_has_value(list, row, field)) return false;
+    const LinkedListColumn* column = &list->columns[field];
+    if (column->type != SDC_LL_VALUE_BOOL) return false;
+    return column->data.bool_values[row];
+}
+
+const char* sdc_linked_list_get_string(const LinkedListDefinition* list, SdcSize row, SdcSize field) {
+    if (!sdc_linked_list_has_value(list, row, field)) return NULL;
+    const LinkedListColumn* column = &list->columns[field];
+    if (column->type != SDC_LL_VALUE_STRING) return NULL;
+    return list->strings[column->data.string_ids[row]];
+}
+
+Dialogue* sdc_get_dialogue(StoryData* data, const TimelineItem* item) {
+    if (item->type != SDC_TIMELINE_ITEM_DIALOGUE) return NULL;
+    return &data->dialogues[item->payload];
+}
+
+Action* sdc_get_action(StoryData* data, const TimelineItem* item) {
+    if (item->type != SDC_TIMELINE_ITEM_ACTION) return NULL;
+    return &data->actions[item->payload];
+}
+
+uint64_t sdc_get_item_hash(const StoryData* data, const TimelineItem* item) {
+    if (item->type == SDC_TIMELINE_ITEM_DIALOGUE) return data->dialogue_hashes[item->payload];
+    return data->action_hashes[item->payload];
+}
+
 Chapter* sdc_get_chapter(StoryData* data, int id) {
-    for (int i = 0; i < data->chapter_count; i++) {
+    for (SdcSize i = 0; i < data->chapter_count; i++) {
         if (data->chapters[i].id == id) {
             return &data->chapters[i];
         }
@@ -2475,7 +5210,11 @@ Chapter* sdc_get_chapter(StoryData* data, int id) {
 }
 
 Group* sdc_get_group(StoryData* data, int id) {
-    for (int i = 0; i < data->group_count; i++) {
+    if (data->group_index) {
+        SdcSize index = id_index_find(data->group_index, data->group_count, id);
+        return index != SDC_NOT_FOUND ? &data->groups[index] : NULL;
+    }
+    for (SdcSize i = 0; i < data->group_count; i++) {
         if (data->groups[i].id == id) {
             return &data->groups[i];
         }
@@ -2484,7 +5223,11 @@ Group* sdc_get_group(StoryData* data, int id) {
 }
 
 Node* sdc_get_node(StoryData* data, int id) {
-    for (int i = 0; i < data->node_count; i++) {
+    if (data->node_index) {
+        SdcSize index = id_index_find(data->node_index, data->node_count, id);
+        return index != SDC_NOT_FOUND ? &data->nodes[index] : NULL;
+    }
+    for (SdcSize i = 0; i < data->node_count; i++) {
         if (data->nodes[i].id == id) {
             return &data->nodes[i];
         }
@@ -2493,7 +5236,7 @@ Node* sdc_get_node(StoryData* data, int id) {
 }
 
 TagDefinition* sdc_get_tag_definition(StoryData* data, const char* name) {
-    for (int i = 0; i < data->tag_count; i++) {
+    for (SdcSize i = 0; i < data->tag_count; i++) {
         if (strcmp(data->tags[i].name, name) == 0) {
             return &data->tags[i];
         }
@@ -2502,7 +5245,7 @@ TagDefinition* sdc_get_tag_definition(StoryData* data, const char* name) {
 }
 
 GlobalVariable* sdc_get_global_variable(StoryData* data, const char* name) {
-    for (int i = 0; i < data->global_var_count; i++) {
+    for (SdcSize i = 0; i < data->global_var_count; i++) {
         if (strcmp(data->global_vars[i].name, name) == 0) {
             return &data->global_vars[i];
         }
@@ -2510,17 +5253,17 @@ GlobalVariable* sdc_get_global_variable(StoryData* data, const char* name) {
     return NULL;
 }
 
-TagDefinition* sdc_get_tag_definitions(StoryData* data, int* count) {
+TagDefinition* sdc_get_tag_definitions(StoryData* data, SdcSize* count) {
     if (count) *count = data->tag_count;
     return data->tags;
 }
 
-GlobalVariable* sdc_get_global_variables(StoryData* data, int* count) {
+GlobalVariable* sdc_get_global_variables(StoryData* data, SdcSize* count) {
     if (count) *count = data->global_var_count;
     return data->global_vars;
 }
 
-State* sdc_get_states(StoryData* data, int* count) {
+State* sdc_get_states(StoryData* data, SdcSize* count) {
     if (count) *count = data->state_count;
     return data->states;
 }
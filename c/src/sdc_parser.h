@@ -7,11 +7,26 @@
 #define SDC_PARSER_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // ============================================================================
 // PUBLIC DATA STRUCTURES
 // ============================================================================
 
+// Type of every count, capacity and array index in the API. Stories larger
+// than 2 GB need the full size_t range; define SDC_INT_SIZES before
+// including this header (and when building the parser) to keep the
+// original int fields for existing callers.
+#ifdef SDC_INT_SIZES
+typedef int SdcSize;
+#else
+typedef size_t SdcSize;
+#endif
+
+// Index returned by lookups that find nothing (-1 with SDC_INT_SIZES)
+#define SDC_NOT_FOUND ((SdcSize)-1)
+
 // State definition
 typedef struct {
     char* name;
@@ -37,20 +52,7 @@ typedef struct {
     } default_value;
 } GlobalVariable;
 
-// Linked list structures
-typedef struct {
-    char* type;  // "integer", "float", "string", "boolean"
-} LinkedListField;
-
-typedef struct {
-    char* name;
-    char* scope;  // "character", "group", "both"
-    char** field_names;
-    LinkedListField* fields;
-    int field_count;
-} LinkedListDefinition;
-
-// Linked list data value (can be int, float, string, or bool)
+// Linked list value types (also used as column types)
 typedef enum {
     SDC_LL_VALUE_INT,
     SDC_LL_VALUE_FLOAT,
@@ -58,25 +60,49 @@ typedef enum {
     SDC_LL_VALUE_BOOL
 } LinkedListValueType;
 
+// Linked list structures
+typedef struct {
+    char* type;  // "integer", "float", "string", "boolean"
+    LinkedListValueType value_type;  // Column type derived from 'type'
+} LinkedListField;
+
+// One typed column of linked-list data. Each row is one instance of the
+// list (a character's single instance, or one element of an array).
 typedef struct {
     LinkedListValueType type;
     union {
-        long int_value;
-        double float_value;
-        char* string_value;
-        bool bool_value;
+        long* int_values;
+        double* float_values;
+        bool* bool_values;
+        SdcSize* string_ids;  // Index into LinkedListDefinition.strings
     } data;
-} LinkedListValue;
+    bool* present;        // false if the row does not set this field
+} LinkedListColumn;
 
 typedef struct {
-    char** keys;
-    LinkedListValue* values;
-    int count;
-} LinkedListDataInstance;
+    char* name;
+    char* scope;  // "character", "group", "both"
+    char** field_names;
+    LinkedListField* fields;
+    SdcSize field_count;
+    
+    // Instance data stored by column, one column per field
+    LinkedListColumn* columns;
+    SdcSize row_count;
+    SdcSize row_capacity;
+    
+    // String pool for SDC_LL_VALUE_STRING columns
+    char** strings;
+    SdcSize string_count;
+    SdcSize string_capacity;
+} LinkedListDefinition;
 
+// A character's instances of one linked list: rows
+// [first_row, first_row + count) of linked_lists[list_index]
 typedef struct {
-    LinkedListDataInstance* instances;
-    int count;
+    SdcSize list_index;
+    SdcSize first_row;
+    SdcSize count;
     bool is_array;  // true if array, false if single instance
 } LinkedListData;
 
@@ -87,7 +113,7 @@ typedef struct {
     char* description;
     char** linked_list_names;
     LinkedListData* linked_list_data;
-    int linked_list_count;
+    SdcSize linked_list_count;
 } Character;
 
 // Tag system
@@ -101,19 +127,24 @@ typedef struct {
     TagType type;
     char* color;
     char** keys;      // NULL for single-type tags
-    int key_count;
+    SdcSize key_count;
 } TagDefinition;
 
-// Story entities
+// Story entities. content_hash identifies what an entity was parsed from:
+// a 64-bit hash of its tokens, from the keyword that opens it to its
+// closing brace. Whitespace and comments do not change it, and the
+// JavaScript parser reports the same value as 'content-hash'. Timeline
+// items keep theirs beside their payloads (see sdc_get_item_hash).
 typedef struct {
     int id;
     char* name;
+    uint64_t content_hash;
 } Chapter;
 
 typedef struct {
-    char** characters;  // Array of character names
-    char** texts;       // Array of dialogue texts
-    int line_count;     // Number of lines in this dialogue
+    char** characters;   // Array of character names
+    char** texts;        // Array of dialogue texts
+    SdcSize line_count;  // Number of lines in this dialogue
 } Dialogue;
 
 typedef struct {
@@ -187,7 +218,7 @@ typedef struct {
 typedef struct {
     char* reference;      // Linked list name
     LinkedListFieldModification* modifications;
-    int modification_count;
+    SdcSize modification_count;
 } LinkedListEventData;
 
 typedef enum {
@@ -231,7 +262,7 @@ typedef struct Action Action;
 
 typedef struct {
     ChoiceOption* options;
-    int option_count;
+    SdcSize option_count;
 } ChoiceAction;
 
 struct Action {
@@ -250,7 +281,7 @@ struct Action {
 struct ChoiceOption {
     char* text;
     Action* actions;      // Timeline of actions within this choice
-    int action_count;
+    SdcSize action_count;
 };
 
 typedef enum {
@@ -258,13 +289,12 @@ typedef enum {
     SDC_TIMELINE_ITEM_DIALOGUE
 } TimelineItemType;
 
+// Fixed-size timeline entry. The payload lives out of line in
+// StoryData.dialogues or StoryData.actions depending on the type.
 typedef struct {
     TimelineItemType type;
-    int number;  // The number (dialogue 1, action 2, etc.)
-    union {
-        Action action;
-        Dialogue dialogue;
-    } data;
+    int number;        // The number (dialogue 1, action 2, etc.)
+    uint32_t payload;  // Index into the payload array for this type
 } TimelineItem;
 
 typedef struct {
@@ -272,10 +302,10 @@ typedef struct {
     int end_node;
     
     // Points mapping: node_id -> array of connected node_ids
-    int* point_keys;           // Array of source node IDs
-    int** point_values;        // Array of arrays (connected node IDs)
-    int* point_value_counts;   // Count for each array in point_values
-    int point_count;           // Number of point mappings
+    int* point_keys;               // Array of source node IDs
+    int** point_values;            // Array of arrays (connected node IDs)
+    SdcSize* point_value_counts;   // Count for each array in point_values
+    SdcSize point_count;           // Number of point mappings
 } NodeGraph;
 
 typedef struct {
@@ -291,14 +321,16 @@ typedef struct {
     char* content;
     
     GroupTag* tags;
-    int tag_count;
+    SdcSize tag_count;
     
     NodeGraph nodes;
     
     char** linked_lists;  // Array of linked list names
-    int linked_list_count;
+    SdcSize linked_list_count;
     
     int parent_group;     // Parent group ID (-1 if none)
+    
+    uint64_t content_hash;
 } Group;
 
 typedef struct {
@@ -307,44 +339,82 @@ typedef struct {
     char* content;
     
     TimelineItem* timeline;
-    int timeline_count;
+    SdcSize timeline_count;
+    
+    uint64_t content_hash;
 } Node;
 
+// Id lookup entry: position of an entity in its StoryData array
+typedef struct {
+    int id;
+    SdcSize index;
+} IdIndexEntry;
+
+// Source text and block spans kept for sdc_reparse (opaque)
+typedef struct SdcSource SdcSource;
+
 typedef struct {
     State* states;
-    int state_count;
+    SdcSize state_count;
     
     GlobalVariable* global_vars;
-    int global_var_count;
+    SdcSize global_var_count;
     
     LinkedListDefinition* linked_lists;
-    int linked_list_count;
+    SdcSize linked_list_count;
     
     Character* characters;
-    int character_count;
+    SdcSize character_count;
     
     TagDefinition* tags;
-    int tag_count;
+    SdcSize tag_count;
     
     Chapter* chapters;
-    int chapter_count;
+    SdcSize chapter_count;
     
     Group* groups;
-    int group_count;
+    SdcSize group_count;
     
     Node* nodes;
-    int node_count;
+    SdcSize node_count;
+    
+    // Timeline payloads referenced by TimelineItem.payload, each with the
+    // content_hash of its item at the same index
+    Dialogue* dialogues;
+    uint64_t* dialogue_hashes;
+    SdcSize dialogue_count;
+    SdcSize dialogue_capacity;
+    
+    Action* actions;
+    uint64_t* action_hashes;
+    SdcSize action_count;
+    SdcSize action_capacity;
+    
+    // Single allocation backing every node's timeline after sdc_relayout
+    TimelineItem* timeline_pool;
+    SdcSize timeline_pool_count;
+    
+    // Id indexes sorted by id (built by sdc_relayout, NULL otherwise)
+    IdIndexEntry* node_index;
+    IdIndexEntry* group_index;
+    
+    // Retained by sdc_parse_editable for sdc_reparse, NULL otherwise
+    SdcSource* source;
 } StoryData;
 
 // ============================================================================
 // PUBLIC API
 // ============================================================================
 
+// File access is left out of builds with SDC_NO_FILESYSTEM defined, such
+// as the WebAssembly module
+#ifndef SDC_NO_FILESYSTEM
 /**
  * Parse a .sdc file from disk
  * Returns NULL on error
  */
 StoryData* sdc_parse_file(const char* filename);
+#endif
 
 /**
  * Parse a .sdc format string from memory
@@ -352,6 +422,102 @@ StoryData* sdc_parse_file(const char* filename);
  */
 StoryData* sdc_parse_string(const char* source);
 
+/**
+ * Parse a .sdc format string from memory for editing
+ * Unlike sdc_parse_string, the story keeps a copy of the source and the
+ * spans of its blocks, so it can be edited with sdc_reparse.
+ * Returns NULL on error
+ */
+StoryData* sdc_parse_editable(const char* source);
+
+/**
+ * Apply an edit to a story from sdc_parse_editable: old_length bytes of
+ * its source at edit_offset are replaced by new_text. Only the top-level
+ * blocks (chapters, groups, nodes) the edit touches are re-lexed and
+ * re-parsed, and the results are spliced into the story.
+ * Pointers to chapters, groups and nodes stay valid while the edit keeps
+ * the same blocks, as typing inside one does; the edited entries are
+ * updated in place, and their timelines and payloads are replaced. An
+ * edit that adds or removes blocks moves the entries of that kind, and
+ * one that touches states, variables, tags, linked lists or characters
+ * reparses the whole source (reapplying sdc_relayout if it was used).
+ * Returns false while the source has a parse error, here or left by an
+ * earlier edit, and sdc_get_error describes the first one. Blocks that
+ * do not parse keep their last valid contents until an edit fixes them.
+ */
+bool sdc_reparse(StoryData* data, size_t edit_offset, size_t old_length, const char* new_text);
+
+typedef enum {
+    SDC_ENTITY_CHAPTER,
+    SDC_ENTITY_GROUP,
+    SDC_ENTITY_NODE
+} SdcEntityKind;
+
+typedef enum {
+    SDC_CHANGE_ADDED,
+    SDC_CHANGE_REMOVED,
+    SDC_CHANGE_MODIFIED
+} SdcChangeType;
+
+typedef struct {
+    SdcEntityKind kind;
+    SdcChangeType type;
+    int id;
+    SdcSize index;        // Position after the reload, SDC_NOT_FOUND if removed
+} SdcChange;
+
+// Result of sdc_reload. Entities not listed kept their contents.
+typedef struct {
+    SdcChange* changes;   // Sorted by kind, then id
+    SdcSize change_count;
+    SdcSize unchanged_count;
+    bool sections_changed;  // States, variables, tags, linked lists or
+                            // characters were replaced
+    
+    // The array of that kind was rebuilt, moving every entry in it
+    bool chapters_moved;
+    bool groups_moved;
+    bool nodes_moved;
+} SdcChangeSet;
+
+/**
+ * Replace the contents of a story with a new version of its source, for
+ * servers that reload published files under live sessions. Chapters,
+ * groups and nodes are matched by id and compared by content_hash;
+ * unchanged ones are kept as they are, and changed ones are updated in
+ * place while no entity of their kind is added or removed, so pointers to
+ * them stay valid. Otherwise that kind's array is rebuilt in file order
+ * and its *_moved flag is set. Section tables are kept unless their text
+ * changed, which stories without a source always count as.
+ * A story from sdc_parse_editable keeps the new source for sdc_reparse
+ * and later reloads; other stories keep none.
+ * Returns NULL on error (the story is left unchanged); free the result
+ * with sdc_free_change_set
+ */
+SdcChangeSet* sdc_reload(StoryData* data, const char* new_source);
+
+/**
+ * Find the change to an entity, or NULL if it is unchanged
+ */
+const SdcChange* sdc_find_change(const SdcChangeSet* changes, SdcEntityKind kind, int id);
+
+void sdc_free_change_set(SdcChangeSet* changes);
+
+/**
+ * Input callback for sdc_parse_reader: copy up to size bytes into buffer
+ * Returns the number of bytes copied, 0 at end of input, or a negative
+ * value on error
+ */
+typedef long (*SdcReadFn)(void* user, char* buffer, size_t size);
+
+/**
+ * Parse a .sdc story pulled through a read callback (pipes, sockets,
+ * decompression streams). Input is read in fixed-size chunks and is never
+ * held in memory as a whole.
+ * Returns NULL on error
+ */
+StoryData* sdc_parse_reader(SdcReadFn read, void* user);
+
 /**
  * Free all memory associated with a StoryData structure
  */
@@ -374,40 +540,78 @@ GlobalVariable* sdc_get_global_variable(StoryData* data, const char* name);
 LinkedListDefinition* sdc_get_linked_list(StoryData* data, const char* name);
 Character* sdc_get_character(StoryData* data, const char* name);
 
+/**
+ * Timeline payload lookup
+ * Returns NULL if the item is not of the requested type
+ */
+Dialogue* sdc_get_dialogue(StoryData* data, const TimelineItem* item);
+Action* sdc_get_action(StoryData* data, const TimelineItem* item);
+
+/**
+ * Content hash of a timeline item
+ */
+uint64_t sdc_get_item_hash(const StoryData* data, const TimelineItem* item);
+
 /**
  * Get all tag definitions
  * Returns pointer to internal array (do not free)
  * Sets count to number of tags
  */
-TagDefinition* sdc_get_tag_definitions(StoryData* data, int* count);
+TagDefinition* sdc_get_tag_definitions(StoryData* data, SdcSize* count);
 
 /**
  * Get all global variables
  * Returns pointer to internal array (do not free)
  * Sets count to number of variables
  */
-GlobalVariable* sdc_get_global_variables(StoryData* data, int* count);
+GlobalVariable* sdc_get_global_variables(StoryData* data, SdcSize* count);
 
 /**
  * Get all states
  * Returns pointer to internal array (do not free)
  * Sets count to number of states
  */
-State* sdc_get_states(StoryData* data, int* count);
+State* sdc_get_states(StoryData* data, SdcSize* count);
 
 /**
  * Get all linked lists
  * Returns pointer to internal array (do not free)
  * Sets count to number of linked lists
  */
-LinkedListDefinition* sdc_get_linked_lists(StoryData* data, int* count);
+LinkedListDefinition* sdc_get_linked_lists(StoryData* data, SdcSize* count);
 
 /**
  * Get all characters
  * Returns pointer to internal array (do not free)
  * Sets count to number of characters
  */
-Character* sdc_get_characters(StoryData* data, int* count);
+Character* sdc_get_characters(StoryData* data, SdcSize* count);
+
+/**
+ * Linked list data accessors
+ * Rows are addressed by index into the definition's columns (see
+ * LinkedListData for the rows owned by a character). Numeric getters
+ * convert between int and float columns; other type mismatches and
+ * unset fields return 0, false or NULL. sdc_linked_list_field_index
+ * returns SDC_NOT_FOUND for unknown fields.
+ */
+SdcSize sdc_linked_list_field_index(const LinkedListDefinition* list, const char* field_name);
+bool sdc_linked_list_has_value(const LinkedListDefinition* list, SdcSize row, SdcSize field);
+long sdc_linked_list_get_int(const LinkedListDefinition* list, SdcSize row, SdcSize field);
+double sdc_linked_list_get_float(const LinkedListDefinition* list, SdcSize row, SdcSize field);
+bool sdc_linked_list_get_bool(const LinkedListDefinition* list, SdcSize row, SdcSize field);
+const char* sdc_linked_list_get_string(const LinkedListDefinition* list, SdcSize row, SdcSize field);
+
+/**
+ * Reorder the story for sequential playthrough access
+ * Groups are ordered by chapter. Nodes are ordered by group, then
+ * breadth-first along each group's node graph from its start node; nodes
+ * outside every graph keep their file order at the end. Timelines are
+ * packed into one allocation and dialogue/action payloads are rewritten in
+ * the same order. Id lookups use a sorted index afterwards.
+ * Invalidates pointers to groups, nodes, timeline items and payloads.
+ */
+void sdc_relayout(StoryData* data);
 
 /**
  * Validate that all references (@node, @group) resolve correctly
@@ -415,4 +619,39 @@ Character* sdc_get_characters(StoryData* data, int* count);
  */
 bool sdc_validate_references(StoryData* data);
 
+#ifndef SDC_NO_FILESYSTEM
+/**
+ * Parse cache for sdc_parse_file (disabled by default)
+ * While enabled, every file is read and hashed. If directory holds an
+ * image of the same contents written by this library version, the story
+ * is loaded from it instead of being parsed; otherwise the file is parsed
+ * and its image stored. Least recently used images are removed once the
+ * directory holds more than max_bytes of them.
+ * Returns false if the directory cannot be created or opened
+ */
+bool sdc_cache_enable(const char* directory, size_t max_bytes);
+void sdc_cache_disable(void);
+
+/**
+ * Remove every image from the cache directory
+ */
+void sdc_cache_clear(void);
+
+// Cache activity since it was enabled or the stats were reset.
+// The hit rate is hits / lookups.
+typedef struct {
+    uint64_t lookups;      // sdc_parse_file calls with the cache enabled
+    uint64_t hits;         // Stories loaded from an image
+    uint64_t misses;       // Stories parsed from source
+    uint64_t stores;       // Images written after a miss
+    uint64_t evictions;    // Images removed to stay within max_bytes
+    double hash_seconds;   // Reading and hashing files
+    double hit_seconds;    // Loading images
+    double miss_seconds;   // Parsing and storing images
+} SdcCacheStats;
+
+void sdc_cache_get_stats(SdcCacheStats* stats);
+void sdc_cache_reset_stats(void);
+#endif
+
 #endif // SDC_PARSER_H
\ No newline at end of file
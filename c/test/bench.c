@@ -0,0 +1,151 @@
+#include "../src/sdc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Growable text buffer for generated inputs
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+void buffer_append(Buffer* buffer, const char* text) {
+    size_t length = strlen(text);
+    if (buffer->length + length + 1 > buffer->capacity) {
+        buffer->capacity = (buffer->capacity + length + 1) * 2;
+        buffer->data = (char*)realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->length, text, length + 1);
+    buffer->length += length;
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Parse source repeatedly and report the best run
+void run_benchmark(const char* name, const char* source, size_t length, int iterations) {
+    double best = 0.0;
+    
+    for (int i = 0; i < iterations; i++) {
+        double start = now_seconds();
+        StoryData* data = sdc_parse_string(source);
+        double elapsed = now_seconds() - start;
+        
+        if (!data) {
+            printf("%s: parse failed: %s\n", name, sdc_get_error());
+            return;
+        }
+        sdc_free(data);
+        
+        if (i == 0 || elapsed < best) best = elapsed;
+    }
+    
+    printf("%-12s %8.2f MB  %8.2f ms  %8.1f MB/s\n", name,
+           length / 1e6, best * 1e3, length / 1e6 / best);
+}
+
+// Type text one character at a time into a node in the middle of source,
+// reparsing after every keystroke, and report the latency
+void run_reparse_benchmark(const char* name, const char* source, const char* text) {
+    StoryData* data = sdc_parse_editable(source);
+    if (!data) {
+        printf("%s: parse failed: %s\n", name, sdc_get_error());
+        return;
+    }
+    
+    // Just inside the first dialogue string past the middle
+    const char* quote = strstr(source + strlen(source) / 2, ": \"");
+    size_t offset = (size_t)(quote - source) + 3;
+    Node* node = &data->nodes[data->node_count / 2];
+    
+    double total = 0.0;
+    double worst = 0.0;
+    size_t length = strlen(text);
+    for (size_t i = 0; i < length; i++) {
+        char typed[2] = { text[i], '\0' };
+        double start = now_seconds();
+        bool parsed = sdc_reparse(data, offset + i, 0, typed);
+        double elapsed = now_seconds() - start;
+        
+        if (!parsed) {
+            printf("%s: reparse failed: %s\n", name, sdc_get_error());
+            break;
+        }
+        total += elapsed;
+        if (elapsed > worst) worst = elapsed;
+    }
+    
+    printf("%-12s %8zu keys  %8.3f ms avg  %8.3f ms max  %s\n", name, length,
+           total * 1e3 / length, worst * 1e3,
+           node == &data->nodes[data->node_count / 2] ? "stable" : "moved");
+    sdc_free(data);
+}
+
+// Keyword and identifier dense input: short fields, event actions and
+// dialogue lines keyed by character name
+void generate_identifiers(Buffer* buffer, int node_count) {
+    char line[256];
+    
+    for (int i = 1; i <= node_count; i++) {
+        snprintf(line, sizeof(line), "node %d {\n    title: \"N\"\n    content: \"\"\n    timeline: {\n", i);
+        buffer_append(buffer, line);
+        
+        for (int j = 1; j <= 4; j++) {
+            snprintf(line, sizeof(line),
+                     "        dialogue %d {\n            Saniyah : \"a\"\n            Caroline : \"b\"\n        }\n", j);
+            buffer_append(buffer, line);
+        }
+        
+        buffer_append(buffer,
+            "        action 1 {\n            type: \"event\"\n            event: \"next-node\"\n        }\n"
+            "        action 2 {\n            type: \"event\"\n            event: \"exit-current-node\"\n        }\n"
+            "        action 3 {\n            type: \"enter\"\n            group: 2\n        }\n"
+            "    }\n}\n");
+    }
+}
+
+// Number dense input: groups with large NodeGraph point maps
+void generate_numbers(Buffer* buffer, int point_count) {
+    char line[256];
+    int group_size = 500;
+    
+    for (int group = 1; group * group_size <= point_count; group++) {
+        snprintf(line, sizeof(line),
+                 "group %d {\n    chapter: 1\n    name: \"G\"\n    nodes: {\n"
+                 "        start: 1,\n        end: %d,\n        points: {\n", group, group_size);
+        buffer_append(buffer, line);
+        
+        for (int i = 1; i <= group_size; i++) {
+            int base = (group - 1) * group_size + i;
+            snprintf(line, sizeof(line), "            %d: [ %d, %d, %d, %d, %d ]\n",
+                     base, base + 1, base + 17, base + 256, base + 4099, base + 65537);
+            buffer_append(buffer, line);
+        }
+        
+        buffer_append(buffer, "        }\n    }\n}\n");
+    }
+}
+
+int main(int argc, char** argv) {
+    int scale = argc > 1 ? atoi(argv[1]) : 20000;
+    if (scale <= 0) scale = 20000;
+    
+    Buffer identifiers = { NULL, 0, 0 };
+    generate_identifiers(&identifiers, scale);
+    run_benchmark("identifiers", identifiers.data, identifiers.length, 5);
+    run_reparse_benchmark("reparse", identifiers.data,
+                          "The quick brown fox jumps over the lazy dog. 0123456789");
+    free(identifiers.data);
+    
+    Buffer numbers = { NULL, 0, 0 };
+    generate_numbers(&numbers, scale * 10);
+    run_benchmark("numbers", numbers.data, numbers.length, 5);
+    free(numbers.data);
+    
+    return 0;
+}
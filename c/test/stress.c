@@ -0,0 +1,159 @@
+#include "../src/sdc_parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Synthetic story streamed through sdc_parse_reader without ever existing
+// on disk or in memory: small nodes separated by runs of blank lines, so
+// byte offsets and line numbers both pass 2^31 within a few gigabytes.
+
+#define PADDING_BYTES (16 * 1024)
+
+typedef struct {
+    unsigned long long target;   // Stop starting new nodes past this many bytes
+    unsigned long long emitted;
+    unsigned long long lines;    // Newlines emitted so far
+    int node_count;
+    bool broken;                 // Finish with an invalid node
+    bool done;
+    
+    char node[512];              // Text being handed out
+    size_t node_length;
+    size_t node_position;
+    size_t padding_position;     // Padding left after the node
+    char padding[PADDING_BYTES];
+} Generator;
+
+double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static unsigned long long count_lines(const char* text, size_t length) {
+    unsigned long long lines = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\n') lines++;
+    }
+    return lines;
+}
+
+// Queue the next node, or the invalid tail once the target is reached
+void generator_next(Generator* gen) {
+    if (gen->emitted >= gen->target) {
+        if (gen->broken && !gen->done) {
+            gen->node_length = (size_t)snprintf(gen->node, sizeof(gen->node), "node 0 ]\n");
+        } else {
+            gen->node_length = 0;
+        }
+        gen->done = true;
+        gen->padding_position = PADDING_BYTES;
+    } else {
+        gen->node_count++;
+        gen->node_length = (size_t)snprintf(gen->node, sizeof(gen->node),
+            "node %d {\n    title: \"N\"\n    content: \"\"\n    timeline: {\n"
+            "        dialogue 1 {\n            Saniyah : \"a\"\n        }\n"
+            "        action 1 {\n            type: \"event\"\n            event: \"next-node\"\n        }\n"
+            "    }\n}\n", gen->node_count);
+        gen->padding_position = 0;
+    }
+    gen->node_position = 0;
+    gen->lines += count_lines(gen->node, gen->node_length);
+    if (!gen->done) gen->lines += PADDING_BYTES;
+}
+
+long generator_read(void* user, char* buffer, size_t size) {
+    Generator* gen = (Generator*)user;
+    size_t written = 0;
+    
+    while (written < size) {
+        if (gen->node_position < gen->node_length) {
+            size_t n = gen->node_length - gen->node_position;
+            if (n > size - written) n = size - written;
+            memcpy(buffer + written, gen->node + gen->node_position, n);
+            gen->node_position += n;
+            written += n;
+        } else if (gen->padding_position < PADDING_BYTES) {
+            size_t n = PADDING_BYTES - gen->padding_position;
+            if (n > size - written) n = size - written;
+            memcpy(buffer + written, gen->padding, n);
+            gen->padding_position += n;
+            written += n;
+        } else if (gen->done) {
+            break;
+        } else {
+            generator_next(gen);
+        }
+    }
+    
+    gen->emitted += written;
+    return (long)written;
+}
+
+Generator* generator_create(unsigned long long target, bool broken) {
+    Generator* gen = (Generator*)calloc(1, sizeof(Generator));
+    gen->target = target;
+    gen->broken = broken;
+    memset(gen->padding, '\n', PADDING_BYTES);
+    gen->padding_position = PADDING_BYTES;  // Nothing queued yet
+    return gen;
+}
+
+int main(int argc, char** argv) {
+    double gigabytes = argc > 1 ? atof(argv[1]) : 3.0;
+    double time_limit = argc > 2 ? atof(argv[2]) : 300.0;
+    if (gigabytes <= 0.0) gigabytes = 3.0;
+    unsigned long long target = (unsigned long long)(gigabytes * 1024 * 1024 * 1024);
+    int failures = 0;
+    
+    // A valid story: every node must arrive
+    Generator* gen = generator_create(target, false);
+    double start = now_seconds();
+    StoryData* data = sdc_parse_reader(generator_read, gen);
+    double elapsed = now_seconds() - start;
+    
+    if (!data) {
+        printf("Valid story failed: %s\n", sdc_get_error());
+        failures++;
+    } else {
+        printf("Parsed %.2f GB: %zu nodes, %zu dialogues, %zu actions in %.1f s (%.0f MB/s)\n",
+               gen->emitted / 1073741824.0, (size_t)data->node_count, (size_t)data->dialogue_count,
+               (size_t)data->action_count, elapsed, gen->emitted / 1e6 / elapsed);
+        if (data->node_count != (SdcSize)gen->node_count ||
+            data->nodes[data->node_count - 1].id != gen->node_count) {
+            printf("Expected %d nodes\n", gen->node_count);
+            failures++;
+        }
+        if (elapsed > time_limit) {
+            printf("Exceeded the %.0f s time limit\n", time_limit);
+            failures++;
+        }
+        sdc_free(data);
+    }
+    free(gen);
+    
+    // The same story ending in an error: the position must be exact
+    gen = generator_create(target, true);
+    data = sdc_parse_reader(generator_read, gen);
+    const char* error = sdc_get_error();
+    unsigned long long line = 0;
+    unsigned long long column = 0;
+    
+    if (data) {
+        printf("Broken story parsed\n");
+        sdc_free(data);
+        failures++;
+    } else if (!error || sscanf(error, "Error at line %llu, column %llu", &line, &column) != 2 ||
+               line != gen->lines || column != 8) {
+        printf("Expected an error at line %llu, column 8, got: %s\n",
+               gen->lines, error ? error : "(none)");
+        failures++;
+    } else {
+        printf("Error reported at line %llu, column %llu\n", line, column);
+    }
+    free(gen);
+    
+    printf(failures ? "FAILED\n" : "OK\n");
+    return failures ? 1 : 0;
+}
@@ -1,27 +1,36 @@
 #include "../src/sdc_parser.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#if defined(_WIN32)
+#include <direct.h>
+#define remove_directory _rmdir
+#else
+#include <unistd.h>
+#define remove_directory rmdir
+#endif
+
 void print_separator(const char* title) {
     printf("\n=== %s ===\n", title);
 }
 
 void print_states(StoryData* data) {
     print_separator("STATES");
-    int count;
+    SdcSize count;
     State* states = sdc_get_states(data, &count);
     
-    for (int i = 0; i < count; i++) {
+    for (SdcSize i = 0; i < count; i++) {
         printf("State: %s\n", states[i].name);
     }
 }
 
 void print_global_vars(StoryData* data) {
     print_separator("GLOBAL VARIABLES");
-    int count;
+    SdcSize count;
     GlobalVariable* vars = sdc_get_global_variables(data, &count);
     
-    for (int i = 0; i < count; i++) {
+    for (SdcSize i = 0; i < count; i++) {
         printf("Variable: %s\n", vars[i].name);
         printf("  Type: ");
         
@@ -49,60 +58,90 @@ void print_global_vars(StoryData* data) {
 
 void print_linked_lists(StoryData* data) {
     print_separator("LINKED LISTS");
-    int count;
+    SdcSize count;
     LinkedListDefinition* lists = sdc_get_linked_lists(data, &count);
     
-    for (int i = 0; i < count; i++) {
+    for (SdcSize i = 0; i < count; i++) {
         printf("Linked List: %s\n", lists[i].name);
         printf("  Scope: %s\n", lists[i].scope);
         printf("  Structure:\n");
         
-        for (int j = 0; j < lists[i].field_count; j++) {
+        for (SdcSize j = 0; j < lists[i].field_count; j++) {
             printf("    %s: %s\n", lists[i].field_names[j], lists[i].fields[j].type);
         }
         printf("\n");
     }
 }
 
+void print_linked_list_row(LinkedListDefinition* list, SdcSize row, const char* indent) {
+    for (SdcSize f = 0; f < list->field_count; f++) {
+        if (!sdc_linked_list_has_value(list, row, f)) continue;
+        
+        printf("%s%s: ", indent, list->field_names[f]);
+        switch (list->columns[f].type) {
+            case SDC_LL_VALUE_INT:
+                printf("%ld", sdc_linked_list_get_int(list, row, f));
+                break;
+            case SDC_LL_VALUE_FLOAT:
+                printf("%.2f", sdc_linked_list_get_float(list, row, f));
+                break;
+            case SDC_LL_VALUE_STRING:
+                printf("\"%s\"", sdc_linked_list_get_string(list, row, f));
+                break;
+            case SDC_LL_VALUE_BOOL:
+                printf("%s", sdc_linked_list_get_bool(list, row, f) ? "true" : "false");
+                break;
+        }
+        printf("\n");
+    }
+}
+
+// Whether two stories hold the same linked-list schemas and rows
+bool linked_lists_match(StoryData* a, StoryData* b) {
+    if (a->linked_list_count != b->linked_list_count) return false;
+    
+    for (SdcSize i = 0; i < a->linked_list_count; i++) {
+        LinkedListDefinition* x = &a->linked_lists[i];
+        LinkedListDefinition* y = sdc_get_linked_list(b, x->name);
+        if (!y || !x->scope || !y->scope || strcmp(x->scope, y->scope) != 0) return false;
+        if (x->field_count != y->field_count || x->row_count != y->row_count) return false;
+        
+        for (SdcSize f = 0; f < x->field_count; f++) {
+            if (strcmp(x->field_names[f], y->field_names[f]) != 0) return false;
+            if (x->columns[f].type != y->columns[f].type) return false;
+            
+            for (SdcSize row = 0; row < x->row_count; row++) {
+                bool present = sdc_linked_list_has_value(x, row, f);
+                if (present != sdc_linked_list_has_value(y, row, f)) return false;
+                if (present && sdc_linked_list_get_int(x, row, f) != sdc_linked_list_get_int(y, row, f)) return false;
+            }
+        }
+    }
+    return true;
+}
+
 void print_characters(StoryData* data) {
     print_separator("CHARACTERS");
-    int count;
+    SdcSize count;
     Character* characters = sdc_get_characters(data, &count);
     
-    for (int i = 0; i < count; i++) {
+    for (SdcSize i = 0; i < count; i++) {
         printf("Character: %s\n", characters[i].name);
         printf("  Biography: %s\n", characters[i].biography);
         printf("  Description: %s\n", characters[i].description);
         printf("  Linked List Data:\n");
         
-        for (int j = 0; j < characters[i].linked_list_count; j++) {
+        for (SdcSize j = 0; j < characters[i].linked_list_count; j++) {
             printf("    %s: ", characters[i].linked_list_names[j]);
             
             LinkedListData* ll_data = &characters[i].linked_list_data[j];
+            LinkedListDefinition* list = &data->linked_lists[ll_data->list_index];
             
             if (ll_data->is_array) {
                 printf("[\n");
-                for (int k = 0; k < ll_data->count; k++) {
+                for (SdcSize k = 0; k < ll_data->count; k++) {
                     printf("      {\n");
-                    LinkedListDataInstance* instance = &ll_data->instances[k];
-                    for (int m = 0; m < instance->count; m++) {
-                        printf("        %s: ", instance->keys[m]);
-                        switch (instance->values[m].type) {
-                            case SDC_LL_VALUE_INT:
-                                printf("%ld", instance->values[m].data.int_value);
-                                break;
-                            case SDC_LL_VALUE_FLOAT:
-                                printf("%.2f", instance->values[m].data.float_value);
-                                break;
-                            case SDC_LL_VALUE_STRING:
-                                printf("\"%s\"", instance->values[m].data.string_value);
-                                break;
-                            case SDC_LL_VALUE_BOOL:
-                                printf("%s", instance->values[m].data.bool_value ? "true" : "false");
-                                break;
-                        }
-                        printf("\n");
-                    }
+                    print_linked_list_row(list, ll_data->first_row + k, "        ");
                     printf("      }");
                     if (k < ll_data->count - 1) printf(",");
                     printf("\n");
@@ -110,25 +149,7 @@ void print_characters(StoryData* data) {
                 printf("    ]\n");
             } else {
                 printf("{\n");
-                LinkedListDataInstance* instance = &ll_data->instances[0];
-                for (int m = 0; m < instance->count; m++) {
-                    printf("      %s: ", instance->keys[m]);
-                    switch (instance->values[m].type) {
-                        case SDC_LL_VALUE_INT:
-                            printf("%ld", instance->values[m].data.int_value);
-                            break;
-                        case SDC_LL_VALUE_FLOAT:
-                            printf("%.2f", instance->values[m].data.float_value);
-                            break;
-                        case SDC_LL_VALUE_STRING:
-                            printf("\"%s\"", instance->values[m].data.string_value);
-                            break;
-                        case SDC_LL_VALUE_BOOL:
-                            printf("%s", instance->values[m].data.bool_value ? "true" : "false");
-                            break;
-                    }
-                    printf("\n");
-                }
+                print_linked_list_row(list, ll_data->first_row, "      ");
                 printf("    }\n");
             }
         }
@@ -138,17 +159,17 @@ void print_characters(StoryData* data) {
 
 void print_tag_definitions(StoryData* data) {
     print_separator("TAG DEFINITIONS");
-    int count;
+    SdcSize count;
     TagDefinition* tags = sdc_get_tag_definitions(data, &count);
     
-    for (int i = 0; i < count; i++) {
+    for (SdcSize i = 0; i < count; i++) {
         printf("Tag: %s\n", tags[i].name);
         printf("  Type: %s\n", tags[i].type == SDC_TAG_TYPE_SINGLE ? "single" : "key-value");
         printf("  Color: %s\n", tags[i].color ? tags[i].color : "none");
         
         if (tags[i].type == SDC_TAG_TYPE_KEYVALUE) {
             printf("  Keys: ");
-            for (int j = 0; j < tags[i].key_count; j++) {
+            for (SdcSize j = 0; j < tags[i].key_count; j++) {
                 printf("%s%s", tags[i].keys[j], j < tags[i].key_count - 1 ? ", " : "");
             }
             printf("\n");
@@ -159,21 +180,21 @@ void print_tag_definitions(StoryData* data) {
 
 void print_chapters(StoryData* data) {
     print_separator("CHAPTERS");
-    for (int i = 0; i < data->chapter_count; i++) {
+    for (SdcSize i = 0; i < data->chapter_count; i++) {
         printf("Chapter %d: %s\n", data->chapters[i].id, data->chapters[i].name);
     }
 }
 
 void print_groups(StoryData* data) {
     print_separator("GROUPS");
-    for (int i = 0; i < data->group_count; i++) {
+    for (SdcSize i = 0; i < data->group_count; i++) {
         Group* g = &data->groups[i];
         printf("Group %d: %s\n", g->id, g->name);
         printf("  Chapter: %d\n", g->chapter_id);
         printf("  Content: %s\n", g->content);
         printf("  Parent Group: %d\n", g->parent_group);
         printf("  Tags: ");
-        for (int j = 0; j < g->tag_count; j++) {
+        for (SdcSize j = 0; j < g->tag_count; j++) {
             printf("%s", g->tags[j].tag_name);
             if (g->tags[j].selected_key) {
                 printf("(%s: %s)", g->tags[j].selected_key, g->tags[j].value);
@@ -182,12 +203,12 @@ void print_groups(StoryData* data) {
         }
         printf("\n");
         printf("  Linked Lists: ");
-        for (int j = 0; j < g->linked_list_count; j++) {
+        for (SdcSize j = 0; j < g->linked_list_count; j++) {
             printf("%s%s", g->linked_lists[j], j < g->linked_list_count - 1 ? ", " : "");
         }
         printf("\n");
-        printf("  Nodes: start=%d, end=%d, points=%d\n", 
-               g->nodes.start_node, g->nodes.end_node, g->nodes.point_count);
+        printf("  Nodes: start=%d, end=%d, points=%zu\n", 
+               g->nodes.start_node, g->nodes.end_node, (size_t)g->nodes.point_count);
         printf("\n");
     }
 }
@@ -197,7 +218,7 @@ void print_linked_list_event(EventActionData* event) {
     printf("          Reference: %s\n", event->data.linked_list.reference);
     printf("          Modifications:\n");
     
-    for (int i = 0; i < event->data.linked_list.modification_count; i++) {
+    for (SdcSize i = 0; i < event->data.linked_list.modification_count; i++) {
         LinkedListFieldModification* mod = &event->data.linked_list.modifications[i];
         printf("            Field: %s\n", mod->field);
         
@@ -221,46 +242,48 @@ void print_linked_list_event(EventActionData* event) {
 
 void print_nodes(StoryData* data) {
     print_separator("NODES");
-    for (int i = 0; i < data->node_count; i++) {
+    for (SdcSize i = 0; i < data->node_count; i++) {
         Node* n = &data->nodes[i];
         printf("Node %d: %s\n", n->id, n->title);
         printf("  Content: %s\n", n->content);
-        printf("  Timeline items: %d\n", n->timeline_count);
+        printf("  Timeline items: %zu\n", (size_t)n->timeline_count);
         
-        for (int j = 0; j < n->timeline_count; j++) {
+        for (SdcSize j = 0; j < n->timeline_count; j++) {
             TimelineItem* item = &n->timeline[j];
             if (item->type == SDC_TIMELINE_ITEM_DIALOGUE) {
+                Dialogue* dialogue = sdc_get_dialogue(data, item);
                 printf("    Dialogue %d:\n", item->number);
-                for (int k = 0; k < item->data.dialogue.line_count; k++) {
+                for (SdcSize k = 0; k < dialogue->line_count; k++) {
                     printf("      %s: \"%s\"\n", 
-                           item->data.dialogue.characters[k],
-                           item->data.dialogue.texts[k]);
+                           dialogue->characters[k],
+                           dialogue->texts[k]);
                 }
             } else if (item->type == SDC_TIMELINE_ITEM_ACTION) {
+                Action* action = sdc_get_action(data, item);
                 printf("    Action %d: ", item->number);
-                switch (item->data.action.type) {
+                switch (action->type) {
                     case SDC_ACTION_TYPE_CODE:
                         printf("CODE (length=%zu)\n", 
-                               item->data.action.data.code.code ? 
-                               strlen(item->data.action.data.code.code) : 0);
+                               action->data.code.code ? 
+                               strlen(action->data.code.code) : 0);
                         break;
                     case SDC_ACTION_TYPE_GOTO:
                         printf("GOTO node %d\n", 
-                               item->data.action.data.goto_action.target_node);
+                               action->data.goto_action.target_node);
                         break;
                     case SDC_ACTION_TYPE_EXIT:
                         printf("EXIT %s\n", 
-                               item->data.action.data.exit_action.target);
+                               action->data.exit_action.target);
                         break;
                     case SDC_ACTION_TYPE_ENTER:
                         printf("ENTER group %d\n", 
-                               item->data.action.data.enter_action.target_group);
+                               action->data.enter_action.target_group);
                         break;
                     case SDC_ACTION_TYPE_CHOICE:
                         printf("CHOICE\n");
                         break;
                     case SDC_ACTION_TYPE_EVENT: {
-                        EventActionData* e = &item->data.action.data.event;
+                        EventActionData* e = &action->data.event;
                         printf("EVENT - ");
                         switch (e->event_type) {
                             case SDC_EVENT_TYPE_NEXT_NODE:
@@ -324,6 +347,97 @@ void print_nodes(StoryData* data) {
     }
 }
 
+// Reader callback that hands out a few bytes per call, like a pipe
+static long read_trickle(void* user, char* buffer, size_t size) {
+    return (long)fread(buffer, 1, size < 7 ? size : 7, (FILE*)user);
+}
+
+// Reader callback over a string in memory, filling each request
+typedef struct {
+    const char* text;
+    size_t length;
+    size_t at;
+} MemoryReader;
+
+static long read_memory(void* user, char* buffer, size_t size) {
+    MemoryReader* reader = (MemoryReader*)user;
+    size_t n = reader->length - reader->at;
+    if (n > size) n = size;
+    memcpy(buffer, reader->text + reader->at, n);
+    reader->at += n;
+    return (long)n;
+}
+
+// Whether two parses of the same source agree on every node and payload
+static bool stories_match(StoryData* a, StoryData* b) {
+    if (a->node_count != b->node_count || a->dialogue_count != b->dialogue_count ||
+        a->action_count != b->action_count) return false;
+    
+    for (SdcSize i = 0; i < a->node_count; i++) {
+        Node* x = &a->nodes[i];
+        Node* y = &b->nodes[i];
+        if (x->id != y->id || x->content_hash != y->content_hash ||
+            x->timeline_count != y->timeline_count || strcmp(x->title, y->title) != 0) return false;
+        for (SdcSize j = 0; j < x->timeline_count; j++) {
+            if (sdc_get_item_hash(a, &x->timeline[j]) != sdc_get_item_hash(b, &y->timeline[j])) return false;
+        }
+    }
+    for (SdcSize i = 0; i < a->dialogue_count; i++) {
+        if (strcmp(a->dialogues[i].texts[0], b->dialogues[i].texts[0]) != 0) return false;
+    }
+    for (SdcSize i = 0; i < a->action_count; i++) {
+        Action* x = &a->actions[i];
+        Action* y = &b->actions[i];
+        if (x->type != y->type) return false;
+        if (x->type == SDC_ACTION_TYPE_CODE && strcmp(x->data.code.code, y->data.code.code) != 0) return false;
+        if (x->type == SDC_ACTION_TYPE_EVENT && x->data.event.event_type == SDC_EVENT_TYPE_ADJUST_VARIABLE &&
+            x->data.event.data.adjust_variable.increment != y->data.event.data.adjust_variable.increment) return false;
+    }
+    return true;
+}
+
+// A story past one reader refill, behind a comment of padding bytes, so
+// each token of the repeated node lands on the refill boundary for one
+// padding length
+static char* generate_refill_story(size_t padding, size_t* unit_length) {
+    static const char* unit =
+        "node %d {\n"
+        "    title: \"Node '%d' # \xc3\xbc\"\n"
+        "    timeline: {\n"
+        "        dialogue 1 {\n"
+        "            Caroline : \"Line %d with { braces } and \xe2\x9c\x93\"\n"
+        "        }\n"
+        "        action 1 {\n"
+        "            type: \"code\"\n"
+        "            <! if (!done && a > 1) { total = 1.25; } !>\n"
+        "        }\n"
+        "        action 2 {\n"
+        "            type: \"event\"\n"
+        "            data: {\n"
+        "                type: \"adjust-variable\"\n"
+        "                name: \"Money\"\n"
+        "                increment: -12.375\n"
+        "            }\n"
+        "        }\n"
+        "    }\n"
+        "}\n";
+    
+    size_t capacity = padding + 80 * 1024;
+    char* text = (char*)malloc(capacity);
+    size_t length = 0;
+    text[length++] = '#';
+    while (length < padding + 1) text[length++] = '-';
+    text[length++] = '\n';
+    
+    // Ids of the same width keep every copy the same length
+    for (int id = 1000; length < padding + 68 * 1024; id++) {
+        int n = snprintf(text + length, capacity - length, unit, id, id, id);
+        *unit_length = (size_t)n;
+        length += (size_t)n;
+    }
+    return text;
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
         printf("Usage: %s <story_file.sdc>\n", argv[0]);
@@ -356,20 +470,238 @@ int main(int argc, char** argv) {
     LinkedListDefinition* prof = sdc_get_linked_list(data, "Profession");
     if (prof) {
         printf("Found Profession linked list with scope: %s\n", prof->scope);
+        
+        // Scan a whole column by field index
+        SdcSize value_field = sdc_linked_list_field_index(prof, "Value");
+        long total = 0;
+        for (SdcSize row = 0; row < prof->row_count; row++) {
+            total += sdc_linked_list_get_int(prof, row, value_field);
+        }
+        printf("Profession rows: %zu, Value total: %ld\n", (size_t)prof->row_count, total);
     }
     
     Character* saniyah = sdc_get_character(data, "Saniyah");
     if (saniyah) {
-        printf("Found character Saniyah with %d linked lists\n", saniyah->linked_list_count);
+        printf("Found character Saniyah with %zu linked lists\n", (size_t)saniyah->linked_list_count);
     }
     
     Group* group1 = sdc_get_group(data, 1);
     if (group1) {
-        printf("Found Group 1 with %d linked lists\n", group1->linked_list_count);
+        printf("Found Group 1 with %zu linked lists\n", (size_t)group1->linked_list_count);
         printf("Parent group: %d\n", group1->parent_group);
     }
     
+    // Lookups must survive the traversal-order relayout
+    sdc_relayout(data);
+    SdcSize relayout_items = 0;
+    for (SdcSize i = 0; i < data->node_count; i++) {
+        Node* node = sdc_get_node(data, data->nodes[i].id);
+        if (node != &data->nodes[i]) {
+            printf("Relayout lookup mismatch for node %d\n", data->nodes[i].id);
+        }
+        relayout_items += node->timeline_count;
+    }
+    printf("Relayout: %zu nodes, %zu timeline items\n", (size_t)data->node_count, (size_t)relayout_items);
+    
+    // Breadth-first order on a branching graph declared out of order,
+    // after a group without points
+    StoryData* branching = sdc_parse_string(
+        "chapter 1 { name: \"A\" }\n"
+        "group 0 { chapter: 1 name: \"E\" }\n"
+        "group 1 { chapter: 1 name: \"G\" nodes: { start: 1, end: 7, points: {\n"
+        "    4: [ 7 ]\n    1: [ 3, 2 ]\n    9: [ 8 ]\n    2: [ 4, 6 ]\n    3: [ 5 ]\n} } }\n"
+        "node 10 { title: \"j\" }\nnode 9 { title: \"i\" }\nnode 8 { title: \"h\" }\n"
+        "node 7 { title: \"g\" }\nnode 6 { title: \"f\" }\nnode 5 { title: \"e\" }\n"
+        "node 4 { title: \"d\" }\nnode 3 { title: \"c\" }\nnode 2 { title: \"b\" }\n"
+        "node 1 { title: \"a\" }\n");
+    if (branching) {
+        sdc_relayout(branching);
+        printf("Relayout order:");
+        for (SdcSize i = 0; i < branching->node_count; i++) {
+            printf(" %d", branching->nodes[i].id);
+        }
+        printf("\n");
+        sdc_free(branching);
+    } else {
+        printf("Relayout graph failed: %s\n", sdc_get_error());
+    }
+    
+    // The same story parsed incrementally through a reader
+    FILE* file = fopen(argv[1], "rb");
+    StoryData* streamed = file ? sdc_parse_reader(read_trickle, file) : NULL;
+    if (file) fclose(file);
+    if (streamed) {
+        printf("Reader: %zu nodes, %zu dialogues, %zu actions\n",
+               (size_t)streamed->node_count, (size_t)streamed->dialogue_count, (size_t)streamed->action_count);
+        sdc_free(streamed);
+    } else {
+        printf("Reader parse failed: %s\n", sdc_get_error());
+    }
+    
+    // Refill boundaries inside strings, numbers, keywords and code blocks
+    size_t unit_length = 0;
+    free(generate_refill_story(0, &unit_length));
+    size_t boundary_mismatches = 0;
+    for (size_t padding = 0; padding < unit_length; padding++) {
+        char* text = generate_refill_story(padding, &unit_length);
+        MemoryReader reader = { text, strlen(text), 0 };
+        StoryData* expected = sdc_parse_string(text);
+        StoryData* read = sdc_parse_reader(read_memory, &reader);
+        if (!expected || !read || !stories_match(expected, read)) boundary_mismatches++;
+        sdc_free(expected);
+        sdc_free(read);
+        free(text);
+    }
+    printf("Reader refills: %zu offsets, %zu mismatches\n", unit_length, boundary_mismatches);
+    
+    // A second parse of the unchanged file is served from the cache
+    if (sdc_cache_enable("sdc_test_cache", 1 << 20)) {
+        sdc_cache_clear();
+        StoryData* parsed = sdc_parse_file(argv[1]);
+        StoryData* cached = sdc_parse_file(argv[1]);
+        
+        SdcCacheStats stats;
+        sdc_cache_get_stats(&stats);
+        printf("Cache: %llu hits, %llu misses, %zu nodes, %zu actions\n",
+               (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+               cached ? (size_t)cached->node_count : 0, cached ? (size_t)cached->action_count : 0);
+        
+        sdc_free(parsed);
+        sdc_free(cached);
+        sdc_cache_clear();
+        sdc_cache_disable();
+        if (remove_directory("sdc_test_cache") != 0) {
+            printf("Cache directory left behind\n");
+        }
+    }
+    
     sdc_free(data);
     
+    // Edit one dialogue line of the source and reparse just its node
+    file = fopen(argv[1], "rb");
+    char* source = NULL;
+    if (file) {
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        source = (char*)calloc((size_t)length + 1, 1);
+        fread(source, 1, (size_t)length, file);
+        fclose(file);
+    }
+    
+    StoryData* edited = source ? sdc_parse_editable(source) : NULL;
+    const char* line = source ? strstr(source, "don't know") : NULL;
+    if (edited && line && edited->node_count > 0) {
+        Node* node = &edited->nodes[0];
+        if (sdc_reparse(edited, (size_t)(line - source), strlen("don't know"), "know")) {
+            Dialogue* dialogue = NULL;
+            for (SdcSize i = 0; i < node->timeline_count && !dialogue; i++) {
+                Dialogue* d = sdc_get_dialogue(edited, &node->timeline[i]);
+                if (d && d->line_count > 0 && strstr(d->texts[0], "know")) dialogue = d;
+            }
+            printf("Reparse: node %d %s, line now \"%s\"\n", node->id,
+                   node == &edited->nodes[0] ? "kept in place" : "moved",
+                   dialogue ? dialogue->texts[0] : "(missing)");
+        } else {
+            printf("Reparse failed: %s\n", sdc_get_error());
+        }
+    }
+    sdc_free(edited);
+    
+    // Commenting out an indented line reaches into the block after the edit
+    StoryData* joined = sdc_parse_editable("chapter 1 {\n}\n  chapter 2 { name: \"b\" }\n");
+    if (joined) {
+        bool reparsed = sdc_reparse(joined, 14, 0, "#");
+        StoryData* full = sdc_parse_string("chapter 1 {\n}\n#  chapter 2 { name: \"b\" }\n");
+        printf("Reparse into a comment: %s, %zu chapters, full parse has %zu\n",
+               reparsed ? "accepted" : "refused", (size_t)joined->chapter_count,
+               full ? (size_t)full->chapter_count : 0);
+        sdc_free(full);
+    }
+    sdc_free(joined);
+    
+    // Reload the story from a published copy with the same line changed
+    StoryData* live = source ? sdc_parse_editable(source) : NULL;
+    if (live && line && live->node_count > 0) {
+        size_t prefix = (size_t)(line - source);
+        char* published = (char*)malloc(strlen(source) + 1);
+        memcpy(published, source, prefix);
+        strcpy(published + prefix, "know");
+        strcat(published, line + strlen("don't know"));
+        
+        Node* node = &live->nodes[0];
+        SdcChangeSet* changes = sdc_reload(live, published);
+        if (changes) {
+            const SdcChange* change = sdc_find_change(changes, SDC_ENTITY_NODE, node->id);
+            printf("Reload: %zu changes, %zu unchanged, node %d %s, %s\n",
+                   (size_t)changes->change_count, (size_t)changes->unchanged_count, node->id,
+                   change && change->type == SDC_CHANGE_MODIFIED ? "modified" : "not modified",
+                   changes->nodes_moved ? "nodes moved" : "nodes kept in place");
+            sdc_free_change_set(changes);
+        } else {
+            printf("Reload failed: %s\n", sdc_get_error());
+        }
+        free(published);
+    }
+    sdc_free(live);
+    
+    // Comment the same line: the content hashes must not change
+    StoryData* plain = source ? sdc_parse_string(source) : NULL;
+    if (plain && line && plain->node_count > 0) {
+        size_t prefix = (size_t)(line - source);
+        while (prefix > 0 && source[prefix - 1] != '\n') prefix--;
+        char* commented = (char*)malloc(strlen(source) + 32);
+        memcpy(commented, source, prefix);
+        strcpy(commented + prefix, "    # reworded later\n");
+        strcat(commented, source + prefix);
+        
+        StoryData* reformatted = sdc_parse_string(commented);
+        if (reformatted && reformatted->node_count > 0) {
+            const Node* a = &plain->nodes[0];
+            const Node* b = &reformatted->nodes[0];
+            bool items_same = a->timeline_count == b->timeline_count;
+            for (SdcSize i = 0; items_same && i < a->timeline_count; i++) {
+                items_same = sdc_get_item_hash(plain, &a->timeline[i]) ==
+                             sdc_get_item_hash(reformatted, &b->timeline[i]);
+            }
+            printf("Hashes: node %d %016llx, %s after a comment\n", a->id,
+                   (unsigned long long)a->content_hash,
+                   a->content_hash == b->content_hash && items_same ? "unchanged" : "changed");
+        }
+        sdc_free(reformatted);
+        free(commented);
+    }
+    sdc_free(plain);
+    
+    // Character data before the linked-list schemas it uses
+    const char* lists = source ? strstr(source, "linked-lists [") : NULL;
+    const char* characters = source ? strstr(source, "characters [") : NULL;
+    const char* tags = source ? strstr(source, "tags [") : NULL;
+    if (lists && characters && tags && lists < characters && characters < tags) {
+        size_t length = strlen(source);
+        char* reordered = (char*)malloc(length + 1);
+        size_t at = (size_t)(lists - source);
+        memcpy(reordered, source, at);
+        memcpy(reordered + at, characters, (size_t)(tags - characters));
+        at += (size_t)(tags - characters);
+        memcpy(reordered + at, lists, (size_t)(characters - lists));
+        strcpy(reordered + at + (size_t)(characters - lists), tags);
+        
+        StoryData* in_order = sdc_parse_string(source);
+        StoryData* data_first = sdc_parse_string(reordered);
+        if (in_order && data_first) {
+            LinkedListDefinition* stats = sdc_get_linked_list(data_first, "Stats");
+            printf("Data before schemas: %zu lists, Stats scope %s, %s\n",
+                   (size_t)data_first->linked_list_count, stats && stats->scope ? stats->scope : "(none)",
+                   linked_lists_match(in_order, data_first) ? "matches" : "differs");
+        } else {
+            printf("Data before schemas failed: %s\n", sdc_get_error());
+        }
+        sdc_free(in_order);
+        sdc_free(data_first);
+        free(reordered);
+    }
+    free(source);
+    
     return 0;
 }
\ No newline at end of file
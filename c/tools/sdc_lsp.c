@@ -0,0 +1,1840 @@
+// Language server for .sdc stories, speaking LSP over stdin and stdout.
+//
+// Each open document keeps a StoryData that sdc_reparse updates on every
+// edit, which supplies the diagnostics, and an index of the names the
+// text defines and references, which answers go-to-definition and
+// find-all-references without touching the rest of the document.
+//
+//   sdc_lsp                serve on stdin and stdout
+//   sdc_lsp --bench [N]    time requests against a generated N-node story
+
+#include "../src/sdc_parser.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// ============================================================================
+// OUTPUT BUFFER
+// ============================================================================
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+static void buffer_reserve(Buffer* buffer, size_t extra) {
+    if (buffer->length + extra + 1 <= buffer->capacity) return;
+    buffer->capacity = (buffer->length + extra + 1) * 2;
+    buffer->data = (char*)realloc(buffer->data, buffer->capacity);
+}
+
+static void buffer_append_bytes(Buffer* buffer, const char* bytes, size_t length) {
+    buffer_reserve(buffer, length);
+    memcpy(buffer->data + buffer->length, bytes, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void buffer_append(Buffer* buffer, const char* text) {
+    buffer_append_bytes(buffer, text, strlen(text));
+}
+
+// Formatted output; callers only format numbers and short names
+static void buffer_printf(Buffer* buffer, const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    
+    if (length < 0) return;
+    if ((size_t)length >= sizeof(text)) length = (int)sizeof(text) - 1;
+    buffer_append_bytes(buffer, text, (size_t)length);
+}
+
+static void buffer_append_json_string(Buffer* buffer, const char* text, size_t length) {
+    buffer_reserve(buffer, length + 2);
+    buffer_append_bytes(buffer, "\"", 1);
+    
+    size_t run = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        
+        buffer_append_bytes(buffer, text + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  buffer_append(buffer, "\\\""); break;
+            case '\\': buffer_append(buffer, "\\\\"); break;
+            case '\n': buffer_append(buffer, "\\n"); break;
+            case '\r': buffer_append(buffer, "\\r"); break;
+            case '\t': buffer_append(buffer, "\\t"); break;
+            default:   buffer_printf(buffer, "\\u%04x", c); break;
+        }
+    }
+    
+    buffer_append_bytes(buffer, text + run, length - run);
+    buffer_append_bytes(buffer, "\"", 1);
+}
+
+// ============================================================================
+// JSON
+// ============================================================================
+
+typedef enum {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+typedef struct JsonValue {
+    JsonType type;
+    bool boolean;
+    double number;
+    char* string;              // JSON_STRING, '\0' terminated
+    size_t length;
+    struct JsonValue* items;   // JSON_ARRAY and JSON_OBJECT
+    char** keys;               // JSON_OBJECT
+    size_t count;
+} JsonValue;
+
+typedef struct {
+    const char* p;
+    const char* end;
+} JsonReader;
+
+// Nesting allowed in a message; LSP params stay far below it
+#define JSON_MAX_DEPTH 64
+
+static void json_free(JsonValue* value) {
+    free(value->string);
+    for (size_t i = 0; i < value->count; i++) {
+        json_free(&value->items[i]);
+        if (value->keys) free(value->keys[i]);
+    }
+    free(value->items);
+    free(value->keys);
+    memset(value, 0, sizeof(JsonValue));
+}
+
+static void json_skip(JsonReader* reader) {
+    while (reader->p < reader->end &&
+           (*reader->p == ' ' || *reader->p == '\t' || *reader->p == '\n' || *reader->p == '\r')) {
+        reader->p++;
+    }
+}
+
+static bool json_hex4(JsonReader* reader, unsigned* code) {
+    if (reader->end - reader->p < 4) return false;
+    
+    *code = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = *reader->p++;
+        unsigned digit;
+        if (c >= '0' && c <= '9') digit = (unsigned)(c - '0');
+        else if (c >= 'a' && c <= 'f') digit = (unsigned)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') digit = (unsigned)(c - 'A' + 10);
+        else return false;
+        *code = *code * 16 + digit;
+    }
+    return true;
+}
+
+static void json_append_utf8(Buffer* buffer, unsigned code) {
+    char bytes[4];
+    size_t length;
+    if (code < 0x80) {
+        bytes[0] = (char)code;
+        length = 1;
+    } else if (code < 0x800) {
+        bytes[0] = (char)(0xC0 | (code >> 6));
+        bytes[1] = (char)(0x80 | (code & 0x3F));
+        length = 2;
+    } else if (code < 0x10000) {
+        bytes[0] = (char)(0xE0 | (code >> 12));
+        bytes[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (code & 0x3F));
+        length = 3;
+    } else {
+        bytes[0] = (char)(0xF0 | (code >> 18));
+        bytes[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+        bytes[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+        bytes[3] = (char)(0x80 | (code & 0x3F));
+        length = 4;
+    }
+    buffer_append_bytes(buffer, bytes, length);
+}
+
+// String starting at the opening quote, unescaped to UTF-8
+static bool json_parse_string(JsonReader* reader, char** string, size_t* length) {
+    reader->p++;
+    Buffer buffer = { NULL, 0, 0 };
+    const char* run = reader->p;
+    
+    while (reader->p < reader->end && *reader->p != '"') {
+        if (*reader->p != '\\') {
+            reader->p++;
+            continue;
+        }
+        
+        buffer_append_bytes(&buffer, run, (size_t)(reader->p - run));
+        reader->p++;
+        if (reader->p >= reader->end) break;
+        
+        char escape = *reader->p++;
+        switch (escape) {
+            case 'n': buffer_append_bytes(&buffer, "\n", 1); break;
+            case 't': buffer_append_bytes(&buffer, "\t", 1); break;
+            case 'r': buffer_append_bytes(&buffer, "\r", 1); break;
+            case 'b': buffer_append_bytes(&buffer, "\b", 1); break;
+            case 'f': buffer_append_bytes(&buffer, "\f", 1); break;
+            case 'u': {
+                unsigned code;
+                if (!json_hex4(reader, &code)) {
+                    free(buffer.data);
+                    return false;
+                }
+                
+                // A surrogate pair encodes one code point
+                unsigned low;
+                if (code >= 0xD800 && code < 0xDC00 && reader->end - reader->p >= 6 &&
+                    reader->p[0] == '\\' && reader->p[1] == 'u') {
+                    reader->p += 2;
+                    if (!json_hex4(reader, &low)) {
+                        free(buffer.data);
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                json_append_utf8(&buffer, code);
+                break;
+            }
+            default:
+                buffer_append_bytes(&buffer, &escape, 1);
+                break;
+        }
+        run = reader->p;
+    }
+    
+    if (reader->p >= reader->end) {
+        free(buffer.data);
+        return false;
+    }
+    buffer_append_bytes(&buffer, run, (size_t)(reader->p - run));
+    reader->p++;
+    
+    *string = buffer.data;
+    *length = buffer.length;
+    return true;
+}
+
+static bool json_parse_value(JsonReader* reader, JsonValue* value, int depth);
+
+// Array or object starting at its opening bracket
+static bool json_parse_container(JsonReader* reader, JsonValue* value, int depth) {
+    bool object = *reader->p == '{';
+    char close = object ? '}' : ']';
+    value->type = object ? JSON_OBJECT : JSON_ARRAY;
+    reader->p++;
+    
+    size_t capacity = 0;
+    json_skip(reader);
+    if (reader->p < reader->end && *reader->p == close) {
+        reader->p++;
+        return true;
+    }
+    
+    while (true) {
+        if (value->count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            value->items = (JsonValue*)realloc(value->items, sizeof(JsonValue) * capacity);
+            if (object) value->keys = (char**)realloc(value->keys, sizeof(char*) * capacity);
+        }
+        JsonValue* item = &value->items[value->count];
+        memset(item, 0, sizeof(JsonValue));
+        
+        json_skip(reader);
+        if (object) {
+            size_t key_length;
+            if (reader->p >= reader->end || *reader->p != '"') return false;
+            if (!json_parse_string(reader, &value->keys[value->count], &key_length)) return false;
+            value->count++;
+            
+            json_skip(reader);
+            if (reader->p >= reader->end || *reader->p != ':') return false;
+            reader->p++;
+        } else {
+            value->count++;
+        }
+        if (!json_parse_value(reader, item, depth + 1)) return false;
+        
+        json_skip(reader);
+        if (reader->p >= reader->end) return false;
+        if (*reader->p == close) {
+            reader->p++;
+            return true;
+        }
+        if (*reader->p != ',') return false;
+        reader->p++;
+    }
+}
+
+static bool json_parse_value(JsonReader* reader, JsonValue* value, int depth) {
+    json_skip(reader);
+    if (reader->p >= reader->end || depth > JSON_MAX_DEPTH) return false;
+    
+    char c = *reader->p;
+    size_t remaining = (size_t)(reader->end - reader->p);
+    if (c == '{' || c == '[') {
+        return json_parse_container(reader, value, depth);
+    } else if (c == '"') {
+        value->type = JSON_STRING;
+        return json_parse_string(reader, &value->string, &value->length);
+    } else if (remaining >= 4 && memcmp(reader->p, "true", 4) == 0) {
+        value->type = JSON_BOOL;
+        value->boolean = true;
+        reader->p += 4;
+    } else if (remaining >= 5 && memcmp(reader->p, "false", 5) == 0) {
+        value->type = JSON_BOOL;
+        reader->p += 5;
+    } else if (remaining >= 4 && memcmp(reader->p, "null", 4) == 0) {
+        value->type = JSON_NULL;
+        reader->p += 4;
+    } else {
+        // Messages are read with a '\0' after them, so strtod stops in time
+        char* number_end;
+        value->type = JSON_NUMBER;
+        value->number = strtod(reader->p, &number_end);
+        if (number_end == reader->p) return false;
+        reader->p = number_end;
+    }
+    return true;
+}
+
+static bool json_parse(const char* text, size_t length, JsonValue* value) {
+    JsonReader reader = { text, text + length };
+    memset(value, 0, sizeof(JsonValue));
+    if (json_parse_value(&reader, value, 0)) return true;
+    
+    json_free(value);
+    return false;
+}
+
+// Member of an object, or NULL if value is not an object or lacks it
+static const JsonValue* json_get(const JsonValue* value, const char* key) {
+    if (!value || value->type != JSON_OBJECT) return NULL;
+    for (size_t i = 0; i < value->count; i++) {
+        if (strcmp(value->keys[i], key) == 0) return &value->items[i];
+    }
+    return NULL;
+}
+
+static const char* json_string(const JsonValue* value) {
+    return value && value->type == JSON_STRING ? value->string : NULL;
+}
+
+static size_t json_size(const JsonValue* value) {
+    return value && value->type == JSON_NUMBER && value->number > 0 ? (size_t)value->number : 0;
+}
+
+// ============================================================================
+// DOCUMENT INDEX
+// ============================================================================
+
+// Names the index tracks. Nodes, groups and chapters are defined by their
+// blocks and referenced as @node(N), @group(N) and @chapter(N); characters
+// and variables are defined in the characters and global-vars sections.
+typedef enum {
+    SYMBOL_NODE,
+    SYMBOL_GROUP,
+    SYMBOL_CHAPTER,
+    SYMBOL_CHARACTER,
+    SYMBOL_VARIABLE
+} SymbolKind;
+
+// Definition or reference of a symbol. Offsets and lines count from the
+// start of its chunk, so edits elsewhere leave it alone.
+typedef struct {
+    uint32_t symbol;
+    bool definition;
+    size_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t column;   // On the chunk's first line, from the chunk start
+    uint32_t width;    // Columns it spans
+} Occurrence;
+
+// A run of top-level blocks of a document, usually just one. Edits
+// rescan the chunks they touch and no others. Where a chunk starts is
+// kept by the document, so edits do not visit the chunks after them.
+typedef struct {
+    char* text;
+    size_t length;
+    size_t index;       // Position in the document
+    size_t lines;       // Newlines in the text
+    size_t tail;        // Columns after the last newline, or of the whole text
+    
+    Occurrence* occurrences;  // In text order
+    size_t occurrence_count;
+} Chunk;
+
+typedef struct {
+    SymbolKind kind;
+    char* name;
+    
+    Chunk** chunks;     // Chunks with occurrences of it, unordered
+    size_t chunk_count;
+    size_t chunk_capacity;
+    Chunk* last_chunk;  // Last chunk added, so each is added once
+} Symbol;
+
+typedef struct {
+    char* uri;
+    long version;
+    bool utf16;         // Columns count UTF-16 code units, else bytes
+    
+    Chunk** chunks;     // In file order
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t* length_tree;  // Fenwick trees of chunk lengths and newlines,
+    size_t* line_tree;    // summing to the offset and line of a chunk
+    size_t length;
+    
+    Symbol* symbols;
+    size_t symbol_count;
+    size_t symbol_capacity;
+    uint32_t* symbol_table;   // Open addressing, symbol index + 1
+    size_t symbol_table_size;
+    
+    StoryData* story;   // NULL until the text parses once
+    char* error;        // Diagnostic last published, NULL if none
+} Document;
+
+static size_t count_columns(const Document* doc, const char* text, size_t length) {
+    if (!doc->utf16) return length;
+    
+    size_t units = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+    }
+    return units;
+}
+
+static uint32_t symbol_hash(SymbolKind kind, const char* name, size_t length) {
+    uint32_t hash = 2166136261u ^ (uint32_t)kind;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void symbol_table_grow(Document* doc) {
+    free(doc->symbol_table);
+    doc->symbol_table_size = doc->symbol_table_size ? doc->symbol_table_size * 2 : 256;
+    doc->symbol_table = (uint32_t*)calloc(doc->symbol_table_size, sizeof(uint32_t));
+    
+    size_t mask = doc->symbol_table_size - 1;
+    for (size_t i = 0; i < doc->symbol_count; i++) {
+        const Symbol* symbol = &doc->symbols[i];
+        size_t slot = symbol_hash(symbol->kind, symbol->name, strlen(symbol->name)) & mask;
+        while (doc->symbol_table[slot]) slot = (slot + 1) & mask;
+        doc->symbol_table[slot] = (uint32_t)i + 1;
+    }
+}
+
+// Index of a symbol, added on first use
+static uint32_t document_symbol(Document* doc, SymbolKind kind, const char* name, size_t length) {
+    if ((doc->symbol_count + 1) * 2 > doc->symbol_table_size) symbol_table_grow(doc);
+    
+    size_t mask = doc->symbol_table_size - 1;
+    size_t slot = symbol_hash(kind, name, length) & mask;
+    while (doc->symbol_table[slot]) {
+        uint32_t index = doc->symbol_table[slot] - 1;
+        const Symbol* symbol = &doc->symbols[index];
+        if (symbol->kind == kind && strncmp(symbol->name, name, length) == 0 &&
+            symbol->name[length] == '\0') {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    if (doc->symbol_count == doc->symbol_capacity) {
+        doc->symbol_capacity = doc->symbol_capacity ? doc->symbol_capacity * 2 : 64;
+        doc->symbols = (Symbol*)realloc(doc->symbols, sizeof(Symbol) * doc->symbol_capacity);
+    }
+    Symbol* symbol = &doc->symbols[doc->symbol_count];
+    memset(symbol, 0, sizeof(Symbol));
+    symbol->kind = kind;
+    symbol->name = (char*)malloc(length + 1);
+    memcpy(symbol->name, name, length);
+    symbol->name[length] = '\0';
+    
+    doc->symbol_table[slot] = (uint32_t)doc->symbol_count + 1;
+    return (uint32_t)doc->symbol_count++;
+}
+
+// Add a chunk to the postings of the symbols it mentions
+static void post_chunk(Document* doc, Chunk* chunk) {
+    for (size_t i = 0; i < chunk->occurrence_count; i++) {
+        Symbol* symbol = &doc->symbols[chunk->occurrences[i].symbol];
+        if (symbol->last_chunk == chunk) continue;
+        
+        if (symbol->chunk_count == symbol->chunk_capacity) {
+            symbol->chunk_capacity = symbol->chunk_capacity ? symbol->chunk_capacity * 2 : 4;
+            symbol->chunks = (Chunk**)realloc(symbol->chunks, sizeof(Chunk*) * symbol->chunk_capacity);
+        }
+        symbol->chunks[symbol->chunk_count++] = chunk;
+        symbol->last_chunk = chunk;
+    }
+}
+
+static void clear_last_chunks(Document* doc, const Chunk* chunk) {
+    for (size_t i = 0; i < chunk->occurrence_count; i++) {
+        doc->symbols[chunk->occurrences[i].symbol].last_chunk = NULL;
+    }
+}
+
+// Remove a chunk from its postings, using last_chunk to mark the symbols
+// already done
+static void unpost_chunk(Document* doc, Chunk* chunk) {
+    clear_last_chunks(doc, chunk);
+    for (size_t i = 0; i < chunk->occurrence_count; i++) {
+        Symbol* symbol = &doc->symbols[chunk->occurrences[i].symbol];
+        if (symbol->last_chunk == chunk) continue;
+        symbol->last_chunk = chunk;
+        
+        // Chunks near an edit were usually posted last
+        for (size_t j = symbol->chunk_count; j-- > 0;) {
+            if (symbol->chunks[j] == chunk) {
+                symbol->chunks[j] = symbol->chunks[--symbol->chunk_count];
+                break;
+            }
+        }
+    }
+    clear_last_chunks(doc, chunk);
+}
+
+// ============================================================================
+// SCANNER
+// ============================================================================
+
+// Tokens as the parser's lexer splits them, with the context needed to
+// tell definitions and references apart. A chunk ends where its scan is
+// back at the top level, so each chunk scans the same on its own.
+
+typedef enum {
+    SCAN_IDENTIFIER,
+    SCAN_NUMBER,
+    SCAN_STRING,
+    SCAN_CODE,
+    SCAN_PUNCT
+} ScanKind;
+
+typedef struct {
+    ScanKind kind;
+    size_t offset;
+    size_t length;
+    size_t line;
+    size_t column;
+} ScanToken;
+
+// Start of a top-level block after the first in the scanned text
+typedef struct {
+    size_t offset;
+    size_t line;
+    size_t column;
+} ScanBlock;
+
+typedef struct {
+    Occurrence* occurrences;
+    size_t occurrence_count;
+    size_t occurrence_capacity;
+    
+    ScanBlock* blocks;
+    size_t block_count;
+    size_t block_capacity;
+    
+    size_t lines;
+    bool clean;         // Ended outside blocks, strings, code blocks and comments
+} Scan;
+
+typedef enum {
+    FRAME_OTHER,
+    FRAME_CHARACTERS,   // characters [ ... ]
+    FRAME_VARIABLES,    // global-vars [ ... ]
+    FRAME_DIALOGUE,     // dialogue N { ... }
+    FRAME_DATA          // data: { ... } of an event
+} FrameKind;
+
+typedef struct {
+    FrameKind kind;
+    bool adjusts_variable;  // FRAME_DATA: its type is "adjust-variable"
+    bool has_name;          // FRAME_DATA: name holds its name value
+    ScanToken name;
+} Frame;
+
+typedef struct {
+    Document* doc;
+    const char* text;
+    Scan* scan;
+    
+    ScanToken history[4];   // Latest token first
+    int history_count;
+    
+    Frame* frames;
+    size_t depth;
+    size_t frame_capacity;
+    bool between_blocks;    // At the top level with no block open
+} Scanner;
+
+static bool scan_is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool scan_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool scan_is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+static void free_scan(Scan* scan) {
+    free(scan->occurrences);
+    free(scan->blocks);
+}
+
+static const ScanToken* scanner_previous(const Scanner* scanner, int n) {
+    return n < scanner->history_count ? &scanner->history[n] : NULL;
+}
+
+static bool token_is(const Scanner* scanner, const ScanToken* token, const char* text) {
+    size_t length = strlen(text);
+    return token && token->kind == SCAN_IDENTIFIER && token->length == length &&
+           memcmp(scanner->text + token->offset, text, length) == 0;
+}
+
+static bool punct_is(const Scanner* scanner, const ScanToken* token, char c) {
+    return token && token->kind == SCAN_PUNCT && scanner->text[token->offset] == c;
+}
+
+// Kind of the symbol a block keyword defines or an @ reference names
+static bool block_symbol_kind(const Scanner* scanner, const ScanToken* token, SymbolKind* kind) {
+    if (token_is(scanner, token, "node")) *kind = SYMBOL_NODE;
+    else if (token_is(scanner, token, "group")) *kind = SYMBOL_GROUP;
+    else if (token_is(scanner, token, "chapter")) *kind = SYMBOL_CHAPTER;
+    else return false;
+    return true;
+}
+
+// Record text from start to end, which begins at column on a line,
+// as an occurrence of the symbol named by name
+static void scanner_add(Scanner* scanner, SymbolKind kind, bool definition,
+                        size_t start, size_t end, size_t line, size_t column,
+                        const char* name, size_t name_length) {
+    Scan* scan = scanner->scan;
+    if (scan->occurrence_count == scan->occurrence_capacity) {
+        scan->occurrence_capacity = scan->occurrence_capacity ? scan->occurrence_capacity * 2 : 64;
+        scan->occurrences = (Occurrence*)realloc(scan->occurrences,
+                                                 sizeof(Occurrence) * scan->occurrence_capacity);
+    }
+    
+    Occurrence* occurrence = &scan->occurrences[scan->occurrence_count++];
+    occurrence->symbol = document_symbol(scanner->doc, kind, name, name_length);
+    occurrence->definition = definition;
+    occurrence->offset = start;
+    occurrence->length = (uint32_t)(end - start);
+    occurrence->line = (uint32_t)line;
+    occurrence->column = (uint32_t)column;
+    occurrence->width = (uint32_t)count_columns(scanner->doc, scanner->text + start, end - start);
+}
+
+// A string token's contents, without the quotes
+static void scanner_add_string(Scanner* scanner, SymbolKind kind, bool definition, const ScanToken* token) {
+    size_t start = token->offset + 1;
+    size_t end = token->offset + token->length - 1;
+    scanner_add(scanner, kind, definition, start, end, token->line, token->column + 1,
+                scanner->text + start, end - start);
+}
+
+static void scanner_push(Scanner* scanner, FrameKind kind) {
+    if (scanner->depth == scanner->frame_capacity) {
+        scanner->frame_capacity = scanner->frame_capacity ? scanner->frame_capacity * 2 : 16;
+        scanner->frames = (Frame*)realloc(scanner->frames, sizeof(Frame) * scanner->frame_capacity);
+    }
+    Frame* frame = &scanner->frames[scanner->depth++];
+    memset(frame, 0, sizeof(Frame));
+    frame->kind = kind;
+}
+
+static void scanner_token(Scanner* scanner, const ScanToken* token) {
+    const ScanToken* p1 = scanner_previous(scanner, 0);
+    const ScanToken* p2 = scanner_previous(scanner, 1);
+    const ScanToken* p3 = scanner_previous(scanner, 2);
+    const ScanToken* p4 = scanner_previous(scanner, 3);
+    Frame* frame = scanner->depth > 0 ? &scanner->frames[scanner->depth - 1] : NULL;
+    char punct = token->kind == SCAN_PUNCT ? scanner->text[token->offset] : '\0';
+    SymbolKind kind;
+    
+    // A name at the top level after a closed block starts the next one
+    if (scanner->depth == 0) {
+        if (token->kind == SCAN_IDENTIFIER && scanner->between_blocks && p1) {
+            Scan* scan = scanner->scan;
+            if (scan->block_count == scan->block_capacity) {
+                scan->block_capacity = scan->block_capacity ? scan->block_capacity * 2 : 16;
+                scan->blocks = (ScanBlock*)realloc(scan->blocks, sizeof(ScanBlock) * scan->block_capacity);
+            }
+            ScanBlock* block = &scan->blocks[scan->block_count++];
+            block->offset = token->offset;
+            block->line = token->line;
+            block->column = token->column;
+        }
+        scanner->between_blocks = false;
+    }
+    
+    if (punct == '{' || punct == '[') {
+        FrameKind frame_kind = FRAME_OTHER;
+        if (punct == '[' && scanner->depth == 0 && token_is(scanner, p1, "characters")) {
+            frame_kind = FRAME_CHARACTERS;
+        } else if (punct == '[' && scanner->depth == 0 && token_is(scanner, p1, "global-vars")) {
+            frame_kind = FRAME_VARIABLES;
+        } else if (punct == '{' && p1 && p1->kind == SCAN_NUMBER && token_is(scanner, p2, "dialogue")) {
+            frame_kind = FRAME_DIALOGUE;
+        } else if (punct == '{' && punct_is(scanner, p1, ':') && token_is(scanner, p2, "data")) {
+            frame_kind = FRAME_DATA;
+        }
+        scanner_push(scanner, frame_kind);
+    } else if (punct == '}' || punct == ']') {
+        if (frame) {
+            // The type of an event's data may follow its name
+            if (frame->kind == FRAME_DATA && frame->adjusts_variable && frame->has_name) {
+                scanner_add_string(scanner, SYMBOL_VARIABLE, false, &frame->name);
+            }
+            scanner->depth--;
+            if (scanner->depth == 0) scanner->between_blocks = true;
+        }
+    } else if (token->kind == SCAN_NUMBER) {
+        // node N, group N or chapter N at the top level
+        if (scanner->depth == 0 && block_symbol_kind(scanner, p1, &kind)) {
+            scanner_add(scanner, kind, true, p1->offset, token->offset + token->length,
+                        p1->line, p1->column, scanner->text + token->offset, token->length);
+        }
+    } else if (punct == ')') {
+        // @node(N), @group(N) or @chapter(N)
+        if (p1 && p1->kind == SCAN_NUMBER && punct_is(scanner, p2, '(') &&
+            block_symbol_kind(scanner, p3, &kind) && punct_is(scanner, p4, '@')) {
+            scanner_add(scanner, kind, false, p4->offset, token->offset + token->length,
+                        p4->line, p4->column, scanner->text + p1->offset, p1->length);
+        }
+    } else if (punct == ':' && frame && p1) {
+        if (p1->kind == SCAN_STRING && frame->kind == FRAME_CHARACTERS) {
+            scanner_add_string(scanner, SYMBOL_CHARACTER, true, p1);
+        } else if (p1->kind == SCAN_STRING && frame->kind == FRAME_VARIABLES) {
+            scanner_add_string(scanner, SYMBOL_VARIABLE, true, p1);
+        } else if (p1->kind == SCAN_IDENTIFIER && frame->kind == FRAME_DIALOGUE) {
+            scanner_add(scanner, SYMBOL_CHARACTER, false, p1->offset, p1->offset + p1->length,
+                        p1->line, p1->column, scanner->text + p1->offset, p1->length);
+        }
+    } else if (token->kind == SCAN_STRING && frame && frame->kind == FRAME_DATA &&
+               punct_is(scanner, p1, ':')) {
+        if (token_is(scanner, p2, "character")) {
+            scanner_add_string(scanner, SYMBOL_CHARACTER, false, token);
+        } else if (token_is(scanner, p2, "name")) {
+            frame->name = *token;
+            frame->has_name = true;
+        } else if (token_is(scanner, p2, "type")) {
+            frame->adjusts_variable = token->length == 17 &&
+                memcmp(scanner->text + token->offset, "\"adjust-variable\"", 17) == 0;
+        }
+    }
+    
+    memmove(&scanner->history[1], &scanner->history[0], sizeof(ScanToken) * 3);
+    scanner->history[0] = *token;
+    if (scanner->history_count < 4) scanner->history_count++;
+}
+
+static int compare_occurrences(const void* a, const void* b) {
+    const Occurrence* x = (const Occurrence*)a;
+    const Occurrence* y = (const Occurrence*)b;
+    return x->offset < y->offset ? -1 : (x->offset > y->offset);
+}
+
+// Tokenize text, collecting its occurrences and the starts of its blocks
+static void scan_text(Document* doc, const char* text, size_t length, Scan* scan) {
+    Scanner scanner;
+    memset(&scanner, 0, sizeof(Scanner));
+    scanner.doc = doc;
+    scanner.text = text;
+    scanner.scan = scan;
+    scanner.between_blocks = true;
+    
+    scan->occurrence_count = 0;
+    scan->block_count = 0;
+    scan->clean = true;
+    
+    size_t line = 0;
+    size_t line_start = 0;
+    size_t i = 0;
+    while (i < length) {
+        char c = text[i];
+        if (c == '\n') {
+            line++;
+            line_start = ++i;
+            continue;
+        }
+        if (scan_is_space(c)) {
+            i++;
+            continue;
+        }
+        if (c == '#') {
+            const char* newline = (const char*)memchr(text + i, '\n', length - i);
+            if (!newline) {
+                scan->clean = false;
+                break;
+            }
+            i = (size_t)(newline - text);
+            continue;
+        }
+        
+        ScanToken token;
+        token.offset = i;
+        token.line = line;
+        token.column = count_columns(doc, text + line_start, i - line_start);
+        
+        if (c == '"' || (c == '<' && i + 1 < length && text[i + 1] == '!')) {
+            // Strings and code blocks run over lines until they close
+            bool string = c == '"';
+            bool closed = false;
+            token.kind = string ? SCAN_STRING : SCAN_CODE;
+            i += string ? 1 : 2;
+            
+            while (i < length) {
+                char d = text[i++];
+                if (d == '\n') {
+                    line++;
+                    line_start = i;
+                } else if (string ? d == '"' : (d == '!' && i < length && text[i] == '>')) {
+                    if (!string) i++;
+                    closed = true;
+                    break;
+                }
+            }
+            if (!closed) {
+                scan->clean = false;
+                break;
+            }
+        } else if (scan_is_digit(c) || (c == '-' && i + 1 < length && scan_is_digit(text[i + 1]))) {
+            token.kind = SCAN_NUMBER;
+            i++;
+            while (i < length && (scan_is_digit(text[i]) || text[i] == '.')) i++;
+        } else if (scan_is_alpha(c) || c == '-') {
+            token.kind = SCAN_IDENTIFIER;
+            i++;
+            while (i < length && (scan_is_alpha(text[i]) || scan_is_digit(text[i]) || text[i] == '-')) i++;
+        } else {
+            token.kind = SCAN_PUNCT;
+            i++;
+        }
+        
+        token.length = i - token.offset;
+        scanner_token(&scanner, &token);
+    }
+    
+    // Names of event data may come out after what follows them
+    if (scanner.depth > 0) scan->clean = false;
+    scan->lines = line;
+    if (scan->occurrence_count > 1) {
+        qsort(scan->occurrences, scan->occurrence_count, sizeof(Occurrence), compare_occurrences);
+    }
+    free(scanner.frames);
+}
+
+// ============================================================================
+// DOCUMENTS
+// ============================================================================
+
+static void free_chunk(Chunk* chunk) {
+    free(chunk->text);
+    free(chunk->occurrences);
+    free(chunk);
+}
+
+static void free_document(Document* doc) {
+    for (size_t i = 0; i < doc->chunk_count; i++) {
+        free_chunk(doc->chunks[i]);
+    }
+    for (size_t i = 0; i < doc->symbol_count; i++) {
+        free(doc->symbols[i].name);
+        free(doc->symbols[i].chunks);
+    }
+    free(doc->chunks);
+    free(doc->length_tree);
+    free(doc->line_tree);
+    free(doc->symbols);
+    free(doc->symbol_table);
+    sdc_free(doc->story);
+    free(doc->error);
+    free(doc->uri);
+    free(doc);
+}
+
+static size_t lowest_bit(size_t i) {
+    return i & (~i + 1);
+}
+
+static void tree_add(size_t* tree, size_t count, size_t index, size_t delta) {
+    for (size_t i = index + 1; i <= count; i += lowest_bit(i)) tree[i] += delta;
+}
+
+// Sum of the first count values
+static size_t tree_sum(const size_t* tree, size_t count) {
+    size_t sum = 0;
+    for (size_t i = count; i > 0; i -= lowest_bit(i)) sum += tree[i];
+    return sum;
+}
+
+// Most leading values whose sum is below limit, or at most limit
+static size_t tree_find(const size_t* tree, size_t count, size_t limit, bool inclusive) {
+    size_t step = 1;
+    while (step * 2 <= count) step *= 2;
+    
+    size_t position = 0;
+    for (; step > 0; step /= 2) {
+        size_t next = position + step;
+        if (next <= count && (inclusive ? tree[next] <= limit : tree[next] < limit)) {
+            position = next;
+            limit -= tree[next];
+        }
+    }
+    return position;
+}
+
+static size_t chunk_offset(const Document* doc, size_t index) {
+    return tree_sum(doc->length_tree, index);
+}
+
+static size_t chunk_line(const Document* doc, size_t index) {
+    return tree_sum(doc->line_tree, index);
+}
+
+// Column a chunk starts at: the columns back to the newline before it
+static size_t chunk_column(const Document* doc, size_t index) {
+    size_t column = 0;
+    while (index > 0) {
+        const Chunk* previous = doc->chunks[--index];
+        column += previous->tail;
+        if (previous->lines > 0) break;
+    }
+    return column;
+}
+
+// Last chunk starting at or before offset: the one to read it from
+static size_t chunk_containing(const Document* doc, size_t offset) {
+    size_t index = tree_find(doc->length_tree, doc->chunk_count, offset, true);
+    return index < doc->chunk_count ? index : doc->chunk_count - 1;
+}
+
+// Last chunk starting before offset: the one an edit there extends
+static size_t chunk_before(const Document* doc, size_t offset) {
+    size_t index = tree_find(doc->length_tree, doc->chunk_count, offset, false);
+    return index < doc->chunk_count ? index : doc->chunk_count - 1;
+}
+
+static char document_byte(const Document* doc, size_t offset) {
+    if (offset >= doc->length) return '\0';
+    size_t index = chunk_containing(doc, offset);
+    return doc->chunks[index]->text[offset - chunk_offset(doc, index)];
+}
+
+// Number the chunks from index from on and rebuild the trees, after an
+// edit changed how many chunks there are
+static void document_reindex(Document* doc, size_t from) {
+    size_t count = doc->chunk_count;
+    for (size_t i = from; i < count; i++) {
+        doc->chunks[i]->index = i;
+    }
+    
+    doc->length_tree = (size_t*)realloc(doc->length_tree, sizeof(size_t) * (count + 1));
+    doc->line_tree = (size_t*)realloc(doc->line_tree, sizeof(size_t) * (count + 1));
+    for (size_t i = 1; i <= count; i++) {
+        doc->length_tree[i] = doc->chunks[i - 1]->length;
+        doc->line_tree[i] = doc->chunks[i - 1]->lines;
+    }
+    for (size_t i = 1; i <= count; i++) {
+        size_t parent = i + lowest_bit(i);
+        if (parent <= count) {
+            doc->length_tree[parent] += doc->length_tree[i];
+            doc->line_tree[parent] += doc->line_tree[i];
+        }
+    }
+}
+
+// Cut scanned text into chunks at its block starts and insert them at
+// position at. Returns how many were inserted.
+static size_t document_insert_chunks(Document* doc, size_t at, const char* text, size_t length,
+                                     const Scan* scan) {
+    size_t count = length > 0 || doc->chunk_count == 0 ? scan->block_count + 1 : 0;
+    if (doc->chunk_count + count > doc->chunk_capacity) {
+        doc->chunk_capacity = (doc->chunk_count + count) * 2;
+        doc->chunks = (Chunk**)realloc(doc->chunks, sizeof(Chunk*) * doc->chunk_capacity);
+    }
+    memmove(&doc->chunks[at + count], &doc->chunks[at], sizeof(Chunk*) * (doc->chunk_count - at));
+    doc->chunk_count += count;
+    
+    size_t next_occurrence = 0;
+    for (size_t i = 0; i < count; i++) {
+        ScanBlock start = { 0, 0, 0 };
+        if (i > 0) start = scan->blocks[i - 1];
+        size_t end = i < scan->block_count ? scan->blocks[i].offset : length;
+        size_t end_line = i < scan->block_count ? scan->blocks[i].line : scan->lines;
+        
+        Chunk* chunk = (Chunk*)calloc(1, sizeof(Chunk));
+        chunk->length = end - start.offset;
+        chunk->text = (char*)malloc(chunk->length + 1);
+        memcpy(chunk->text, text + start.offset, chunk->length);
+        chunk->text[chunk->length] = '\0';
+        chunk->lines = end_line - start.line;
+        
+        size_t last_line = chunk->length;
+        while (last_line > 0 && chunk->text[last_line - 1] != '\n') last_line--;
+        chunk->tail = count_columns(doc, chunk->text + last_line, chunk->length - last_line);
+        
+        size_t first_occurrence = next_occurrence;
+        while (next_occurrence < scan->occurrence_count && scan->occurrences[next_occurrence].offset < end) {
+            next_occurrence++;
+        }
+        chunk->occurrence_count = next_occurrence - first_occurrence;
+        if (chunk->occurrence_count > 0) {
+            chunk->occurrences = (Occurrence*)malloc(sizeof(Occurrence) * chunk->occurrence_count);
+            memcpy(chunk->occurrences, &scan->occurrences[first_occurrence],
+                   sizeof(Occurrence) * chunk->occurrence_count);
+        }
+        
+        for (size_t j = 0; j < chunk->occurrence_count; j++) {
+            Occurrence* occurrence = &chunk->occurrences[j];
+            occurrence->offset -= start.offset;
+            occurrence->line -= (uint32_t)start.line;
+            if (occurrence->line == 0) occurrence->column -= (uint32_t)start.column;
+        }
+        
+        doc->chunks[at + i] = chunk;
+        post_chunk(doc, chunk);
+    }
+    return count;
+}
+
+static Document* document_open(const char* uri, const char* text, size_t length, bool utf16) {
+    Document* doc = (Document*)calloc(1, sizeof(Document));
+    doc->uri = strdup(uri);
+    doc->utf16 = utf16;
+    
+    Scan scan;
+    memset(&scan, 0, sizeof(Scan));
+    scan_text(doc, text, length, &scan);
+    document_insert_chunks(doc, 0, text, length, &scan);
+    document_reindex(doc, 0);
+    doc->length = length;
+    free_scan(&scan);
+    
+    doc->story = sdc_parse_editable(text);
+    return doc;
+}
+
+// The whole text, for parsing it from scratch
+static char* document_text(const Document* doc) {
+    char* text = (char*)malloc(doc->length + 1);
+    size_t offset = 0;
+    for (size_t i = 0; i < doc->chunk_count; i++) {
+        const Chunk* chunk = doc->chunks[i];
+        memcpy(text + offset, chunk->text, chunk->length);
+        offset += chunk->length;
+    }
+    text[doc->length] = '\0';
+    return text;
+}
+
+// Replace old_length bytes at offset with text and rescan the chunks the
+// edit touches
+static void document_edit(Document* doc, size_t offset, size_t old_length, const char* text, size_t length) {
+    size_t first = chunk_before(doc, offset);
+    size_t after = chunk_before(doc, offset + old_length) + 1;
+    const Chunk* head = doc->chunks[first];
+    const Chunk* last = doc->chunks[after - 1];
+    
+    Buffer merged = { NULL, 0, 0 };
+    buffer_append_bytes(&merged, head->text, offset - chunk_offset(doc, first));
+    buffer_append_bytes(&merged, text, length);
+    size_t rest = offset + old_length - chunk_offset(doc, after - 1);
+    buffer_append_bytes(&merged, last->text + rest, last->length - rest);
+    
+    // A block, string, code block or comment left open takes in the chunks
+    // after it, as does text that runs into the first token of the next
+    Scan scan;
+    memset(&scan, 0, sizeof(Scan));
+    while (true) {
+        scan_text(doc, merged.data, merged.length, &scan);
+        bool joins = merged.length > 0 && !scan_is_space(merged.data[merged.length - 1]);
+        if ((scan.clean && !joins) || after == doc->chunk_count) break;
+        
+        size_t end = after + (after - first);
+        if (end > doc->chunk_count) end = doc->chunk_count;
+        for (; after < end; after++) {
+            buffer_append_bytes(&merged, doc->chunks[after]->text, doc->chunks[after]->length);
+        }
+    }
+    
+    // Keep the sizes of the chunks replaced, to update the trees in place
+    // when the edit leaves as many chunks as before
+    size_t removed = after - first;
+    size_t* old_sizes = (size_t*)malloc(sizeof(size_t) * removed * 2);
+    for (size_t i = 0; i < removed; i++) {
+        Chunk* chunk = doc->chunks[first + i];
+        old_sizes[i * 2] = chunk->length;
+        old_sizes[i * 2 + 1] = chunk->lines;
+        unpost_chunk(doc, chunk);
+        free_chunk(chunk);
+    }
+    memmove(&doc->chunks[first], &doc->chunks[after], sizeof(Chunk*) * (doc->chunk_count - after));
+    doc->chunk_count -= removed;
+    
+    size_t added = document_insert_chunks(doc, first, merged.data, merged.length, &scan);
+    if (added == removed) {
+        for (size_t i = 0; i < added; i++) {
+            Chunk* chunk = doc->chunks[first + i];
+            chunk->index = first + i;
+            tree_add(doc->length_tree, doc->chunk_count, first + i, chunk->length - old_sizes[i * 2]);
+            tree_add(doc->line_tree, doc->chunk_count, first + i, chunk->lines - old_sizes[i * 2 + 1]);
+        }
+    } else {
+        document_reindex(doc, first);
+    }
+    doc->length = doc->length - old_length + length;
+    
+    free(old_sizes);
+    
+    free(merged.data);
+    free_scan(&scan);
+}
+
+// Offset of the start of a line, or the end of the document past its
+// last line
+static size_t document_line_offset(const Document* doc, size_t line) {
+    if (line == 0) return 0;
+    
+    // The last chunk starting above the line holds the newline before it
+    size_t index = tree_find(doc->line_tree, doc->chunk_count, line, false);
+    if (index == doc->chunk_count) return doc->length;
+    const Chunk* chunk = doc->chunks[index];
+    size_t remaining = line - chunk_line(doc, index);
+    if (remaining > chunk->lines) return doc->length;
+    
+    const char* p = chunk->text;
+    while (true) {
+        p = (const char*)memchr(p, '\n', chunk->length - (size_t)(p - chunk->text)) + 1;
+        if (--remaining == 0) return chunk_offset(doc, index) + (size_t)(p - chunk->text);
+    }
+}
+
+// Offset of an LSP position, clamped to the end of its line
+static size_t document_offset(const Document* doc, size_t line, size_t character) {
+    size_t offset = document_line_offset(doc, line);
+    size_t index = chunk_containing(doc, offset);
+    size_t start = chunk_offset(doc, index);
+    
+    for (; character > 0 && index < doc->chunk_count; index++) {
+        const Chunk* chunk = doc->chunks[index];
+        const char* text = chunk->text;
+        size_t rel = offset - start;
+        
+        while (character > 0 && rel < chunk->length) {
+            unsigned char c = (unsigned char)text[rel];
+            if (c == '\n') return start + rel;
+            
+            if (!doc->utf16) {
+                rel++;
+                character--;
+                continue;
+            }
+            size_t size = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            size_t units = size == 4 ? 2 : 1;
+            if (units > character) break;
+            rel += size;
+            character -= units;
+        }
+        
+        if (rel < chunk->length) return start + rel;
+        start += chunk->length;
+        offset = start;
+    }
+    return offset < doc->length ? offset : doc->length;
+}
+
+// Columns from start to end on one line
+static size_t document_columns(const Document* doc, size_t start, size_t end) {
+    size_t columns = 0;
+    while (start < end) {
+        size_t index = chunk_containing(doc, start);
+        const Chunk* chunk = doc->chunks[index];
+        size_t rel = start - chunk_offset(doc, index);
+        size_t length = chunk->length - rel;
+        if (length > end - start) length = end - start;
+        
+        columns += count_columns(doc, chunk->text + rel, length);
+        start += length;
+    }
+    return columns;
+}
+
+// Occurrence covering offset, or NULL
+static const Occurrence* document_occurrence_at(const Document* doc, size_t offset, const Chunk** found) {
+    size_t index = chunk_containing(doc, offset);
+    
+    // The cursor just past a token at the end of a chunk is on that token
+    for (size_t back = 0; back < 2 && back <= index; back++) {
+        const Chunk* chunk = doc->chunks[index - back];
+        size_t rel = offset - chunk_offset(doc, index - back);
+        
+        size_t lo = 0;
+        size_t hi = chunk->occurrence_count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (chunk->occurrences[mid].offset <= rel) lo = mid + 1;
+            else hi = mid;
+        }
+        
+        if (lo > 0) {
+            const Occurrence* occurrence = &chunk->occurrences[lo - 1];
+            if (rel <= occurrence->offset + occurrence->length) {
+                *found = chunk;
+                return occurrence;
+            }
+        }
+    }
+    return NULL;
+}
+
+// ============================================================================
+// SERVER
+// ============================================================================
+
+typedef struct {
+    FILE* output;        // NULL keeps the last message in captured instead
+    Buffer captured;
+    bool utf16;          // Negotiated position encoding
+    bool initialized;
+    bool shutdown;
+    bool exit;
+    
+    Document** documents;
+    size_t document_count;
+    size_t document_capacity;
+} Server;
+
+// JSON-RPC error codes
+#define RPC_PARSE_ERROR -32700
+#define RPC_INVALID_REQUEST -32600
+#define RPC_METHOD_NOT_FOUND -32601
+#define RPC_SERVER_NOT_INITIALIZED -32002
+
+static void send_message(Server* server, const Buffer* body) {
+    if (!server->output) {
+        server->captured.length = 0;
+        buffer_append_bytes(&server->captured, body->data, body->length);
+        return;
+    }
+    
+    fprintf(server->output, "Content-Length: %zu\r\n\r\n", body->length);
+    fwrite(body->data, 1, body->length, server->output);
+    fflush(server->output);
+}
+
+static void append_id(Buffer* body, const JsonValue* id) {
+    if (id && id->type == JSON_STRING) buffer_append_json_string(body, id->string, id->length);
+    else if (id && id->type == JSON_NUMBER) buffer_printf(body, "%.17g", id->number);
+    else buffer_append(body, "null");
+}
+
+// Start of a response; the caller appends the result and a closing brace
+static void begin_response(Buffer* body, const JsonValue* id) {
+    buffer_append(body, "{\"jsonrpc\":\"2.0\",\"id\":");
+    append_id(body, id);
+    buffer_append(body, ",\"result\":");
+}
+
+static void send_error(Server* server, const JsonValue* id, int code, const char* message) {
+    Buffer body = { NULL, 0, 0 };
+    buffer_append(&body, "{\"jsonrpc\":\"2.0\",\"id\":");
+    append_id(&body, id);
+    buffer_printf(&body, ",\"error\":{\"code\":%d,\"message\":", code);
+    buffer_append_json_string(&body, message, strlen(message));
+    buffer_append(&body, "}}");
+    send_message(server, &body);
+    free(body.data);
+}
+
+static Document** find_document(Server* server, const JsonValue* params) {
+    const char* uri = json_string(json_get(json_get(params, "textDocument"), "uri"));
+    if (!uri) return NULL;
+    
+    for (size_t i = 0; i < server->document_count; i++) {
+        if (strcmp(server->documents[i]->uri, uri) == 0) return &server->documents[i];
+    }
+    return NULL;
+}
+
+static void append_position(Buffer* body, size_t line, size_t character) {
+    buffer_printf(body, "{\"line\":%zu,\"character\":%zu}", line, character);
+}
+
+static void append_location(Buffer* body, const Document* doc, const Chunk* chunk, const Occurrence* occurrence) {
+    size_t line = chunk_line(doc, chunk->index) + occurrence->line;
+    size_t character = occurrence->column;
+    if (occurrence->line == 0) character += chunk_column(doc, chunk->index);
+    
+    buffer_append(body, "{\"uri\":");
+    buffer_append_json_string(body, doc->uri, strlen(doc->uri));
+    buffer_append(body, ",\"range\":{\"start\":");
+    append_position(body, line, character);
+    buffer_append(body, ",\"end\":");
+    append_position(body, line, character + occurrence->width);
+    buffer_append(body, "}}");
+}
+
+// Publish the document's error, whose position comes from its message
+static void publish_diagnostics(Server* server, const Document* doc) {
+    Buffer body = { NULL, 0, 0 };
+    buffer_append(&body, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+    buffer_append_json_string(&body, doc->uri, strlen(doc->uri));
+    buffer_printf(&body, ",\"version\":%ld,\"diagnostics\":[", doc->version);
+    
+    if (doc->error) {
+        size_t line = 0;
+        size_t column = 0;
+        int consumed = 0;
+        const char* message = doc->error;
+        if (sscanf(message, "Error at line %zu, column %zu: %n", &line, &column, &consumed) == 2 &&
+            consumed > 0 && line > 0 && column > 0) {
+            message += consumed;
+        } else {
+            line = 1;
+            column = 1;
+        }
+        
+        // Underline the token the parser stopped at
+        size_t line_start = document_line_offset(doc, line - 1);
+        size_t start = line_start;
+        while (start - line_start < column - 1 && document_byte(doc, start) != '\n' && start < doc->length) {
+            start++;
+        }
+        size_t end = start;
+        while (end < doc->length && !scan_is_space(document_byte(doc, end))) end++;
+        if (end == start && end < doc->length) end++;
+        
+        size_t character = document_columns(doc, line_start, start);
+        buffer_append(&body, "{\"range\":{\"start\":");
+        append_position(&body, line - 1, character);
+        buffer_append(&body, ",\"end\":");
+        append_position(&body, line - 1, character + document_columns(doc, start, end));
+        buffer_append(&body, "},\"severity\":1,\"source\":\"sdc\",\"message\":");
+        buffer_append_json_string(&body, message, strlen(message));
+        buffer_append(&body, "}");
+    }
+    
+    buffer_append(&body, "]}}");
+    send_message(server, &body);
+    free(body.data);
+}
+
+// Take the model's state after an edit and publish it if it changed
+static void update_diagnostics(Server* server, Document* doc, bool parsed, bool force) {
+    const char* error = parsed ? NULL : sdc_get_error();
+    bool same = error && doc->error ? strcmp(error, doc->error) == 0 : error == doc->error;
+    if (same && !force) return;
+    
+    free(doc->error);
+    doc->error = error ? strdup(error) : NULL;
+    publish_diagnostics(server, doc);
+}
+
+static void handle_initialize(Server* server, const JsonValue* id, const JsonValue* params) {
+    // Byte columns save converting every position; clients may offer them
+    const JsonValue* encodings = json_get(json_get(json_get(params, "capabilities"), "general"),
+                                          "positionEncodings");
+    server->utf16 = true;
+    for (size_t i = 0; encodings && encodings->type == JSON_ARRAY && i < encodings->count; i++) {
+        const char* encoding = json_string(&encodings->items[i]);
+        if (encoding && strcmp(encoding, "utf-8") == 0) server->utf16 = false;
+    }
+    server->initialized = true;
+    
+    Buffer body = { NULL, 0, 0 };
+    begin_response(&body, id);
+    buffer_append(&body, "{\"capabilities\":{\"positionEncoding\":");
+    buffer_append(&body, server->utf16 ? "\"utf-16\"" : "\"utf-8\"");
+    buffer_append(&body, ",\"textDocumentSync\":{\"openClose\":true,\"change\":2},"
+                         "\"definitionProvider\":true,\"referencesProvider\":true},"
+                         "\"serverInfo\":{\"name\":\"sdc_lsp\"}}}");
+    send_message(server, &body);
+    free(body.data);
+}
+
+static void handle_did_open(Server* server, const JsonValue* params) {
+    const JsonValue* item = json_get(params, "textDocument");
+    const char* uri = json_string(json_get(item, "uri"));
+    const JsonValue* text = json_get(item, "text");
+    if (!uri || !text || text->type != JSON_STRING) return;
+    
+    Document** existing = find_document(server, params);
+    if (existing) {
+        free_document(*existing);
+        *existing = server->documents[--server->document_count];
+    }
+    
+    if (server->document_count == server->document_capacity) {
+        server->document_capacity = server->document_capacity ? server->document_capacity * 2 : 4;
+        server->documents = (Document**)realloc(server->documents, sizeof(Document*) * server->document_capacity);
+    }
+    Document* doc = document_open(uri, text->string, text->length, server->utf16);
+    doc->version = (long)json_size(json_get(item, "version"));
+    server->documents[server->document_count++] = doc;
+    update_diagnostics(server, doc, doc->story != NULL, true);
+}
+
+static void handle_did_change(Server* server, const JsonValue* params) {
+    Document** found = find_document(server, params);
+    const JsonValue* changes = json_get(params, "contentChanges");
+    if (!found || !changes || changes->type != JSON_ARRAY) return;
+    
+    Document* doc = *found;
+    doc->version = (long)json_size(json_get(json_get(params, "textDocument"), "version"));
+    
+    bool parsed = true;
+    for (size_t i = 0; i < changes->count; i++) {
+        const JsonValue* change = &changes->items[i];
+        const JsonValue* range = json_get(change, "range");
+        const JsonValue* text = json_get(change, "text");
+        if (!text || text->type != JSON_STRING) continue;
+        
+        if (!range) {
+            // The whole text replaced
+            Document* fresh = document_open(doc->uri, text->string, text->length, doc->utf16);
+            fresh->version = doc->version;
+            fresh->error = doc->error;
+            doc->error = NULL;
+            free_document(doc);
+            *found = doc = fresh;
+            parsed = doc->story != NULL;
+            continue;
+        }
+        
+        const JsonValue* start = json_get(range, "start");
+        const JsonValue* end = json_get(range, "end");
+        size_t start_offset = document_offset(doc, json_size(json_get(start, "line")),
+                                              json_size(json_get(start, "character")));
+        size_t end_offset = document_offset(doc, json_size(json_get(end, "line")),
+                                            json_size(json_get(end, "character")));
+        if (end_offset < start_offset) end_offset = start_offset;
+        
+        document_edit(doc, start_offset, end_offset - start_offset, text->string, text->length);
+        if (doc->story) parsed = sdc_reparse(doc->story, start_offset, end_offset - start_offset, text->string);
+    }
+    
+    // Text that never parsed has no model to update yet
+    if (!doc->story) {
+        char* text = document_text(doc);
+        doc->story = sdc_parse_editable(text);
+        parsed = doc->story != NULL;
+        free(text);
+    }
+    update_diagnostics(server, doc, parsed, false);
+}
+
+static void handle_did_close(Server* server, const JsonValue* params) {
+    Document** found = find_document(server, params);
+    if (!found) return;
+    
+    Document* doc = *found;
+    *found = server->documents[--server->document_count];
+    
+    // Clear its diagnostics
+    free(doc->error);
+    doc->error = NULL;
+    publish_diagnostics(server, doc);
+    free_document(doc);
+}
+
+static int compare_chunks(const void* a, const void* b) {
+    const Chunk* x = *(const Chunk* const*)a;
+    const Chunk* y = *(const Chunk* const*)b;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+// Locations of a symbol's occurrences in file order: definitions only,
+// or all of them with or without the definitions
+static void append_locations(Buffer* body, const Document* doc, uint32_t index,
+                             bool references, bool definitions) {
+    const Symbol* symbol = &doc->symbols[index];
+    Chunk** chunks = (Chunk**)malloc(sizeof(Chunk*) * (symbol->chunk_count + 1));
+    if (symbol->chunk_count > 0) memcpy(chunks, symbol->chunks, sizeof(Chunk*) * symbol->chunk_count);
+    qsort(chunks, symbol->chunk_count, sizeof(Chunk*), compare_chunks);
+    
+    bool first = true;
+    buffer_append(body, "[");
+    for (size_t i = 0; i < symbol->chunk_count; i++) {
+        const Chunk* chunk = chunks[i];
+        for (size_t j = 0; j < chunk->occurrence_count; j++) {
+            const Occurrence* occurrence = &chunk->occurrences[j];
+            if (occurrence->symbol != index) continue;
+            if (occurrence->definition ? !definitions : !references) continue;
+            
+            if (!first) buffer_append(body, ",");
+            append_location(body, doc, chunk, occurrence);
+            first = false;
+        }
+    }
+    buffer_append(body, "]");
+    free(chunks);
+}
+
+// Symbol under the cursor of a position request
+static bool find_symbol(Server* server, const JsonValue* params, Document** doc, uint32_t* symbol) {
+    Document** found = find_document(server, params);
+    if (!found) return false;
+    
+    const JsonValue* position = json_get(params, "position");
+    size_t offset = document_offset(*found, json_size(json_get(position, "line")),
+                                    json_size(json_get(position, "character")));
+    
+    const Chunk* chunk;
+    const Occurrence* occurrence = document_occurrence_at(*found, offset, &chunk);
+    if (!occurrence) return false;
+    
+    *doc = *found;
+    *symbol = occurrence->symbol;
+    return true;
+}
+
+static void handle_definition(Server* server, const JsonValue* id, const JsonValue* params) {
+    Buffer body = { NULL, 0, 0 };
+    begin_response(&body, id);
+    
+    Document* doc;
+    uint32_t symbol;
+    if (find_symbol(server, params, &doc, &symbol)) {
+        append_locations(&body, doc, symbol, false, true);
+    } else {
+        buffer_append(&body, "null");
+    }
+    
+    buffer_append(&body, "}");
+    send_message(server, &body);
+    free(body.data);
+}
+
+static void handle_references(Server* server, const JsonValue* id, const JsonValue* params) {
+    Buffer body = { NULL, 0, 0 };
+    begin_response(&body, id);
+    
+    Document* doc;
+    uint32_t symbol;
+    const JsonValue* declaration = json_get(json_get(params, "context"), "includeDeclaration");
+    if (find_symbol(server, params, &doc, &symbol)) {
+        append_locations(&body, doc, symbol, true, declaration && declaration->boolean);
+    } else {
+        buffer_append(&body, "null");
+    }
+    
+    buffer_append(&body, "}");
+    send_message(server, &body);
+    free(body.data);
+}
+
+static void handle_message(Server* server, const char* text, size_t length) {
+    JsonValue message;
+    if (!json_parse(text, length, &message)) {
+        send_error(server, NULL, RPC_PARSE_ERROR, "Parse error");
+        return;
+    }
+    
+    const JsonValue* id = json_get(&message, "id");
+    const char* method = json_string(json_get(&message, "method"));
+    const JsonValue* params = json_get(&message, "params");
+    
+    if (!method) {
+        // Replies to requests the server never makes
+        if (!id) send_error(server, NULL, RPC_INVALID_REQUEST, "Invalid request");
+    } else if (strcmp(method, "initialize") == 0) {
+        handle_initialize(server, id, params);
+    } else if (strcmp(method, "shutdown") == 0) {
+        Buffer body = { NULL, 0, 0 };
+        begin_response(&body, id);
+        buffer_append(&body, "null}");
+        send_message(server, &body);
+        free(body.data);
+        server->shutdown = true;
+    } else if (strcmp(method, "exit") == 0) {
+        server->exit = true;
+    } else if (!server->initialized) {
+        if (id) send_error(server, id, RPC_SERVER_NOT_INITIALIZED, "Server not initialized");
+    } else if (strcmp(method, "textDocument/didOpen") == 0) {
+        handle_did_open(server, params);
+    } else if (strcmp(method, "textDocument/didChange") == 0) {
+        handle_did_change(server, params);
+    } else if (strcmp(method, "textDocument/didClose") == 0) {
+        handle_did_close(server, params);
+    } else if (strcmp(method, "textDocument/definition") == 0) {
+        handle_definition(server, id, params);
+    } else if (strcmp(method, "textDocument/references") == 0) {
+        handle_references(server, id, params);
+    } else if (id) {
+        send_error(server, id, RPC_METHOD_NOT_FOUND, "Method not found");
+    }
+    
+    json_free(&message);
+}
+
+static void free_server(Server* server) {
+    for (size_t i = 0; i < server->document_count; i++) {
+        free_document(server->documents[i]);
+    }
+    free(server->documents);
+    free(server->captured.data);
+}
+
+// ============================================================================
+// TRANSPORT
+// ============================================================================
+
+static bool header_is(const char* line, const char* name) {
+    for (; *name; line++, name++) {
+        if (tolower((unsigned char)*line) != tolower((unsigned char)*name)) return false;
+    }
+    return true;
+}
+
+// Body of the next message followed by a '\0', or NULL at end of input
+static char* read_message(FILE* input, size_t* length) {
+    char line[256];
+    size_t content_length = 0;
+    bool has_length = false;
+    
+    while (fgets(line, sizeof(line), input)) {
+        if (header_is(line, "Content-Length:")) {
+            content_length = (size_t)strtoull(line + 15, NULL, 10);
+            has_length = true;
+        } else if ((line[0] == '\r' || line[0] == '\n') && has_length) {
+            char* body = (char*)malloc(content_length + 1);
+            if (fread(body, 1, content_length, input) != content_length) {
+                free(body);
+                return NULL;
+            }
+            body[content_length] = '\0';
+            *length = content_length;
+            return body;
+        }
+    }
+    return NULL;
+}
+
+static int serve(void) {
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    Server server;
+    memset(&server, 0, sizeof(Server));
+    server.output = stdout;
+    server.utf16 = true;
+    
+    size_t length;
+    char* body;
+    while (!server.exit && (body = read_message(stdin, &length)) != NULL) {
+        handle_message(&server, body, length);
+        free(body);
+    }
+    
+    // Exit status 0 only after an orderly shutdown
+    int status = server.exit && server.shutdown ? 0 : 1;
+    free_server(&server);
+    return status;
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Story whose nodes each speak, adjust a variable and go to the next node
+static void generate_story(Buffer* buffer, int node_count) {
+    char text[512];
+    buffer_append(buffer,
+        "characters [\n    \"Saniyah\": {\n        biography: \"\"\n        description: \"\"\n    }\n"
+        "    \"Caroline\": {\n        biography: \"\"\n        description: \"\"\n    }\n]\n\n"
+        "global-vars [\n    \"Money\": {\n        type: \"float\"\n        default: 30.0\n    }\n]\n\n"
+        "chapter 1 {\n    name: \"Chapter\"\n}\n\n");
+    
+    for (int i = 1; i <= node_count; i++) {
+        snprintf(text, sizeof(text),
+                 "node %d {\n    title: \"N\"\n    content: \"\"\n    timeline: {\n"
+                 "        dialogue 1 {\n            Saniyah : \"a\"\n            Caroline : \"b\"\n        }\n"
+                 "        action 1 {\n            type: \"event\"\n            data: {\n"
+                 "                type: \"adjust-variable\"\n                name: \"Money\"\n"
+                 "                increment: 1\n            }\n        }\n"
+                 "        action 2 {\n            type: \"event\"\n            goto: @node(%d)\n        }\n"
+                 "    }\n}\n\n", i, i % node_count + 1);
+        buffer_append(buffer, text);
+    }
+}
+
+// LSP position of offset in text (ASCII, so bytes and UTF-16 agree)
+static void text_position(const char* text, size_t offset, size_t* line, size_t* character) {
+    *line = 0;
+    size_t line_start = 0;
+    for (size_t i = 0; i < offset; i++) {
+        if (text[i] == '\n') {
+            (*line)++;
+            line_start = i + 1;
+        }
+    }
+    *character = offset - line_start;
+}
+
+static size_t count_results(const Buffer* output) {
+    size_t count = 0;
+    for (const char* p = output->data; (p = strstr(p, "\"uri\"")) != NULL; p++) count++;
+    return count;
+}
+
+// Time a position request repeatedly and report it
+static void time_query(Server* server, const char* name, const char* method,
+                       size_t line, size_t character, int iterations) {
+    char request[512];
+    snprintf(request, sizeof(request),
+             "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"%s\",\"params\":{"
+             "\"textDocument\":{\"uri\":\"file:///bench.sdc\"},"
+             "\"position\":{\"line\":%zu,\"character\":%zu},"
+             "\"context\":{\"includeDeclaration\":true}}}", method, line, character);
+    
+    double total = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = now_seconds();
+        handle_message(server, request, strlen(request));
+        total += now_seconds() - start;
+    }
+    
+    printf("%-12s %8.3f ms avg  %8zu results\n", name, total * 1e3 / iterations,
+           count_results(&server->captured));
+}
+
+static int run_benchmark(int node_count) {
+    Server server;
+    memset(&server, 0, sizeof(Server));
+    server.utf16 = true;
+    
+    Buffer story = { NULL, 0, 0 };
+    generate_story(&story, node_count);
+    
+    const char* initialize = "{\"jsonrpc\":\"2.0\",\"id\":0,\"method\":\"initialize\",\"params\":{}}";
+    handle_message(&server, initialize, strlen(initialize));
+    
+    Buffer open = { NULL, 0, 0 };
+    buffer_append(&open, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didOpen\",\"params\":{"
+                         "\"textDocument\":{\"uri\":\"file:///bench.sdc\",\"languageId\":\"sdc\","
+                         "\"version\":1,\"text\":");
+    buffer_append_json_string(&open, story.data, story.length);
+    buffer_append(&open, "}}}");
+    
+    double start = now_seconds();
+    handle_message(&server, open.data, open.length);
+    printf("%-12s %8.2f MB  %8.2f ms  %zu nodes\n", "open", story.length / 1e6,
+           (now_seconds() - start) * 1e3, server.documents[0]->story ? (size_t)server.documents[0]->story->node_count : 0);
+    free(open.data);
+    
+    // Type into the first line of dialogue of the middle node
+    char marker[64];
+    snprintf(marker, sizeof(marker), "node %d {", node_count / 2 + 1);
+    const char* middle = strstr(story.data, marker);
+    size_t line, character;
+    text_position(story.data, (size_t)(strstr(middle, ": \"a") - story.data) + 3, &line, &character);
+    
+    const char* typed = "The quick brown fox jumps over the lazy dog. 0123456789";
+    size_t typed_length = strlen(typed);
+    double total = 0.0;
+    double worst = 0.0;
+    for (size_t i = 0; i < typed_length; i++) {
+        char change[512];
+        snprintf(change, sizeof(change),
+                 "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didChange\",\"params\":{"
+                 "\"textDocument\":{\"uri\":\"file:///bench.sdc\",\"version\":%zu},"
+                 "\"contentChanges\":[{\"range\":{\"start\":{\"line\":%zu,\"character\":%zu},"
+                 "\"end\":{\"line\":%zu,\"character\":%zu}},\"text\":\"%c\"}]}}",
+                 i + 2, line, character + i, line, character + i, typed[i]);
+        
+        start = now_seconds();
+        handle_message(&server, change, strlen(change));
+        double elapsed = now_seconds() - start;
+        total += elapsed;
+        if (elapsed > worst) worst = elapsed;
+    }
+    printf("%-12s %8zu keys  %8.3f ms avg  %8.3f ms max  %s\n", "keystroke", typed_length,
+           total * 1e3 / typed_length, worst * 1e3, server.documents[0]->error ? "error" : "clean");
+    
+    // Then break the node and mend it again
+    const char* breaks[] = { "}", "" };
+    for (int i = 0; i < 2; i++) {
+        char change[512];
+        snprintf(change, sizeof(change),
+                 "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/didChange\",\"params\":{"
+                 "\"textDocument\":{\"uri\":\"file:///bench.sdc\",\"version\":%d},"
+                 "\"contentChanges\":[{\"range\":{\"start\":{\"line\":%zu,\"character\":0},"
+                 "\"end\":{\"line\":%zu,\"character\":%d}},\"text\":\"%s\"}]}}",
+                 100 + i, line, line, i, breaks[i]);
+        
+        start = now_seconds();
+        handle_message(&server, change, strlen(change));
+        printf("%-12s %8.3f ms  %s\n", i == 0 ? "break" : "mend",
+               (now_seconds() - start) * 1e3, server.documents[0]->error ? "error" : "clean");
+    }
+    
+    // Queries at the middle node: its goto, a speaker, and a variable
+    text_position(story.data, (size_t)(strstr(middle, "@node(") - story.data) + 1, &line, &character);
+    time_query(&server, "definition", "textDocument/definition", line, character, 1000);
+    time_query(&server, "node refs", "textDocument/references", line, character, 1000);
+    
+    text_position(story.data, (size_t)(strstr(middle, "Caroline") - story.data), &line, &character);
+    time_query(&server, "character", "textDocument/references", line, character, 10);
+    
+    text_position(story.data, (size_t)(strstr(middle, "\"Money\"") - story.data) + 1, &line, &character);
+    time_query(&server, "variable", "textDocument/references", line, character, 10);
+    
+    free(story.data);
+    free_server(&server);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        int node_count = argc > 2 ? atoi(argv[2]) : 100000;
+        return run_benchmark(node_count > 0 ? node_count : 100000);
+    }
+    return serve();
+}
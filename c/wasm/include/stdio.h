@@ -0,0 +1,13 @@
+// Minimal stdio.h for the WebAssembly build (see wasm/sdc_libc.c).
+// Only formatting into buffers is available.
+
+#ifndef SDC_WASM_STDIO_H
+#define SDC_WASM_STDIO_H
+
+#include <stdarg.h>
+#include <stddef.h>
+
+int snprintf(char* buffer, size_t size, const char* format, ...);
+int vsnprintf(char* buffer, size_t size, const char* format, va_list args);
+
+#endif // SDC_WASM_STDIO_H
@@ -0,0 +1,17 @@
+// Minimal stdlib.h for the WebAssembly build (see wasm/sdc_libc.c)
+
+#ifndef SDC_WASM_STDLIB_H
+#define SDC_WASM_STDLIB_H
+
+#include <stddef.h>
+
+void* malloc(size_t size);
+void* calloc(size_t count, size_t size);
+void* realloc(void* pointer, size_t size);
+void free(void* pointer);
+
+void qsort(void* base, size_t count, size_t size, int (*compare)(const void*, const void*));
+
+double strtod(const char* text, char** end);
+
+#endif // SDC_WASM_STDLIB_H
@@ -0,0 +1,19 @@
+// Minimal string.h for the WebAssembly build (see wasm/sdc_libc.c)
+
+#ifndef SDC_WASM_STRING_H
+#define SDC_WASM_STRING_H
+
+#include <stddef.h>
+
+void* memcpy(void* destination, const void* source, size_t size);
+void* memmove(void* destination, const void* source, size_t size);
+void* memset(void* destination, int value, size_t size);
+int memcmp(const void* a, const void* b, size_t size);
+
+size_t strlen(const char* s);
+int strcmp(const char* a, const char* b);
+int strncmp(const char* a, const char* b, size_t size);
+char* strstr(const char* haystack, const char* needle);
+char* strdup(const char* s);
+
+#endif // SDC_WASM_STRING_H
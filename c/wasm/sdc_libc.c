@@ -0,0 +1,361 @@
+/**
+ * Freestanding C library for the WebAssembly build of the parser
+ * Provides just what sdc_parser.c calls, so the module needs no
+ * Emscripten or WASI runtime; the only imports are parse_float and
+ * format_float.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "include/stdio.h"
+#include "include/stdlib.h"
+#include "include/string.h"
+
+// memcpy, memmove and memset below rely on the builtins lowering to the
+// memory.copy and memory.fill instructions rather than to calls to
+// themselves
+#if defined(__wasm__) && !defined(__wasm_bulk_memory__)
+#error "Build with -mbulk-memory"
+#endif
+
+// ============================================================================
+// MEMORY
+// ============================================================================
+
+#define SDC_WASM_PAGE 65536
+
+// Blocks are powers of two from 16 bytes up, each starting with an 8-byte
+// header that holds its class, so payloads keep the 8-byte alignment of
+// doubles and uint64_t. Freed blocks go on a list per class and are reused
+// by the next allocation of that class; memory is never given back to the
+// host. Stories are built from many small allocations that are freed
+// together, which this serves in constant time.
+#define SDC_MIN_CLASS 4
+#define SDC_CLASS_COUNT (sizeof(size_t) * 8)
+#define SDC_BLOCK_HEADER 8
+
+typedef struct FreeBlock {
+    struct FreeBlock* next;
+} FreeBlock;
+
+extern unsigned char __heap_base;  // Defined by the linker
+
+static FreeBlock* free_lists[SDC_CLASS_COUNT];
+static uintptr_t heap_top;  // 0 until the first allocation
+
+// Class of a block holding size bytes, header included
+static unsigned block_class(size_t size) {
+    if (size <= ((size_t)1 << SDC_MIN_CLASS)) return SDC_MIN_CLASS;
+    return (unsigned)(sizeof(unsigned long) * 8) - (unsigned)__builtin_clzl((unsigned long)(size - 1));
+}
+
+// Fresh memory from the end of the heap, growing linear memory if needed
+static void* heap_take(size_t size) {
+    if (!heap_top) {
+        heap_top = ((uintptr_t)&__heap_base + 7) & ~(uintptr_t)7;
+    }
+    
+    uintptr_t heap_end = (uintptr_t)__builtin_wasm_memory_size(0) * SDC_WASM_PAGE;
+    if (size > heap_end - heap_top) {
+        size_t missing = size - (size_t)(heap_end - heap_top);
+        size_t pages = (missing + SDC_WASM_PAGE - 1) / SDC_WASM_PAGE;
+        if (__builtin_wasm_memory_grow(0, pages) == (size_t)-1) return NULL;
+    }
+    
+    void* block = (void*)heap_top;
+    heap_top += size;
+    return block;
+}
+
+void* malloc(size_t size) {
+    if (size > ((size_t)-1 >> 2)) return NULL;
+    
+    unsigned index = block_class(size + SDC_BLOCK_HEADER);
+    unsigned char* block = (unsigned char*)free_lists[index];
+    if (block) {
+        free_lists[index] = ((FreeBlock*)block)->next;
+    } else {
+        block = (unsigned char*)heap_take((size_t)1 << index);
+        if (!block) return NULL;
+    }
+    
+    *(uint32_t*)block = index;
+    return block + SDC_BLOCK_HEADER;
+}
+
+void free(void* pointer) {
+    if (!pointer) return;
+    
+    unsigned char* block = (unsigned char*)pointer - SDC_BLOCK_HEADER;
+    unsigned index = *(uint32_t*)block;
+    ((FreeBlock*)block)->next = free_lists[index];
+    free_lists[index] = (FreeBlock*)block;
+}
+
+void* calloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size) return NULL;
+    
+    void* pointer = malloc(count * size);
+    if (pointer) memset(pointer, 0, count * size);
+    return pointer;
+}
+
+void* realloc(void* pointer, size_t size) {
+    if (!pointer) return malloc(size);
+    
+    unsigned index = *(uint32_t*)((unsigned char*)pointer - SDC_BLOCK_HEADER);
+    size_t capacity = ((size_t)1 << index) - SDC_BLOCK_HEADER;
+    if (size <= capacity) return pointer;
+    
+    void* moved = malloc(size);
+    if (!moved) return NULL;
+    memcpy(moved, pointer, capacity);
+    free(pointer);
+    return moved;
+}
+
+// ============================================================================
+// STRINGS
+// ============================================================================
+
+void* memcpy(void* destination, const void* source, size_t size) {
+    return __builtin_memcpy(destination, source, size);
+}
+
+void* memmove(void* destination, const void* source, size_t size) {
+    return __builtin_memmove(destination, source, size);
+}
+
+void* memset(void* destination, int value, size_t size) {
+    return __builtin_memset(destination, value, size);
+}
+
+int memcmp(const void* a, const void* b, size_t size) {
+    const unsigned char* x = (const unsigned char*)a;
+    const unsigned char* y = (const unsigned char*)b;
+    for (size_t i = 0; i < size; i++) {
+        if (x[i] != y[i]) return x[i] < y[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+size_t strlen(const char* s) {
+    const char* end = s;
+    while (*end) end++;
+    return (size_t)(end - s);
+}
+
+int strcmp(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (int)(unsigned char)*a - (int)(unsigned char)*b;
+}
+
+int strncmp(const char* a, const char* b, size_t size) {
+    for (; size > 0; size--, a++, b++) {
+        if (*a != *b || !*a) return (int)(unsigned char)*a - (int)(unsigned char)*b;
+    }
+    return 0;
+}
+
+char* strstr(const char* haystack, const char* needle) {
+    size_t length = strlen(needle);
+    for (; *haystack; haystack++) {
+        if (strncmp(haystack, needle, length) == 0) return (char*)haystack;
+    }
+    return length == 0 ? (char*)haystack : NULL;
+}
+
+char* strdup(const char* s) {
+    size_t size = strlen(s) + 1;
+    char* copy = (char*)malloc(size);
+    if (copy) memcpy(copy, s, size);
+    return copy;
+}
+
+// ============================================================================
+// CONVERSIONS
+// ============================================================================
+
+// Float literals too long for the parser's exact fast path are converted
+// by the host; sdc_wasm.js supplies this with parseFloat
+__attribute__((import_module("env"), import_name("parse_float")))
+double sdc_host_parse_float(const char* text, size_t length);
+
+// The parser only passes whole literals, so *end is the end of text
+double strtod(const char* text, char** end) {
+    size_t length = strlen(text);
+    if (end) *end = (char*)text + length;
+    return sdc_host_parse_float(text, length);
+}
+
+// Heapsort: no recursion and no scratch memory. The parser's comparisons
+// are total orders, so the result does not depend on stability.
+static void swap_bytes(unsigned char* a, unsigned char* b, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        unsigned char t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+static void sift_down(unsigned char* base, size_t root, size_t count, size_t size,
+                      int (*compare)(const void*, const void*)) {
+    while (true) {
+        size_t child = 2 * root + 1;
+        if (child >= count) return;
+        if (child + 1 < count && compare(base + child * size, base + (child + 1) * size) < 0) child++;
+        if (compare(base + root * size, base + child * size) >= 0) return;
+        swap_bytes(base + root * size, base + child * size, size);
+        root = child;
+    }
+}
+
+void qsort(void* base, size_t count, size_t size, int (*compare)(const void*, const void*)) {
+    unsigned char* bytes = (unsigned char*)base;
+    if (count < 2) return;
+    
+    for (size_t i = count / 2; i-- > 0;) {
+        sift_down(bytes, i, count, size, compare);
+    }
+    for (size_t end = count - 1; end > 0; end--) {
+        swap_bytes(bytes, bytes + end * size, size);
+        sift_down(bytes, 0, end, size, compare);
+    }
+}
+
+// ============================================================================
+// FORMATTING
+// ============================================================================
+
+// Output that counts every character but stores only what fits
+typedef struct {
+    char* buffer;
+    size_t size;
+    size_t length;
+} FormatOutput;
+
+static void put_char(FormatOutput* out, char c) {
+    if (out->length + 1 < out->size) out->buffer[out->length] = c;
+    out->length++;
+}
+
+static void put_unsigned(FormatOutput* out, unsigned long long value, unsigned base) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while (value);
+    while (count > 0) put_char(out, digits[--count]);
+}
+
+// Floats are formatted by the host as %.<precision>g would; sdc_wasm.js
+// supplies this. Returns the length written, at most size - 1.
+__attribute__((import_module("env"), import_name("format_float")))
+size_t sdc_host_format_float(double value, int precision, char* buffer, size_t size);
+
+// The conversions sdc_parser.c uses: %s (with an optional .* precision),
+// %g (with an optional .N precision), %c, %d, %i, %u and %x with the l,
+// ll and z modifiers, and %%
+int vsnprintf(char* buffer, size_t size, const char* format, va_list args) {
+    FormatOutput out = { buffer, size, 0 };
+    
+    for (const char* p = format; *p; p++) {
+        if (*p != '%') {
+            put_char(&out, *p);
+            continue;
+        }
+        p++;
+        
+        int precision = -1;
+        if (p[0] == '.' && p[1] == '*') {
+            precision = va_arg(args, int);
+            p += 2;
+        } else if (p[0] == '.') {
+            precision = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++) precision = precision * 10 + (*p - '0');
+        }
+        
+        int longs = 0;
+        bool is_size = false;
+        while (*p == 'l') {
+            longs++;
+            p++;
+        }
+        if (*p == 'z') {
+            is_size = true;
+            p++;
+        }
+        
+        switch (*p) {
+            case 's': {
+                const char* s = va_arg(args, const char*);
+                if (!s) s = "(null)";
+                for (int i = 0; s[i] && (precision < 0 || i < precision); i++) put_char(&out, s[i]);
+                break;
+            }
+            
+            case 'c':
+                put_char(&out, (char)va_arg(args, int));
+                break;
+            
+            case 'g': {
+                char digits[40];
+                size_t length = sdc_host_format_float(va_arg(args, double), precision < 0 ? 6 : precision,
+                                                      digits, sizeof(digits));
+                for (size_t i = 0; i < length; i++) put_char(&out, digits[i]);
+                break;
+            }
+            
+            case 'd':
+            case 'i': {
+                long long value = is_size ? (long long)va_arg(args, size_t)
+                                : longs >= 2 ? va_arg(args, long long)
+                                : longs == 1 ? va_arg(args, long)
+                                : va_arg(args, int);
+                if (value < 0) {
+                    put_char(&out, '-');
+                    put_unsigned(&out, 0ull - (unsigned long long)value, 10);
+                } else {
+                    put_unsigned(&out, (unsigned long long)value, 10);
+                }
+                break;
+            }
+            
+            case 'u':
+            case 'x': {
+                unsigned long long value = is_size ? va_arg(args, size_t)
+                                         : longs >= 2 ? va_arg(args, unsigned long long)
+                                         : longs == 1 ? va_arg(args, unsigned long)
+                                         : va_arg(args, unsigned);
+                put_unsigned(&out, value, *p == 'x' ? 16 : 10);
+                break;
+            }
+            
+            case '%':
+                put_char(&out, '%');
+                break;
+            
+            default:
+                if (!*p) p--;
+                break;
+        }
+    }
+    
+    if (size > 0) buffer[out.length < size ? out.length : size - 1] = '\0';
+    return (int)out.length;
+}
+
+int snprintf(char* buffer, size_t size, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, size, format, args);
+    va_end(args);
+    return length;
+}
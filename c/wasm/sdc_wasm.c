@@ -0,0 +1,225 @@
+/**
+ * WebAssembly exports for js/sdc_wasm.js
+ * The parser API itself (sdc_parse_string, sdc_free, sdc_get_error, ...)
+ * is exported by name from build_wasm.sh and build_wasm.bat. This file
+ * adds the memory calls the binding needs to pass source text in, and a
+ * table of struct sizes and field offsets so its views over StoryData
+ * never hard-code a layout.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "../src/sdc_parser.h"
+
+#define SDC_WASM_EXPORT(name) __attribute__((export_name(#name)))
+
+SDC_WASM_EXPORT(sdc_wasm_alloc)
+void* sdc_wasm_alloc(size_t size) {
+    return malloc(size);
+}
+
+SDC_WASM_EXPORT(sdc_wasm_release)
+void sdc_wasm_release(void* pointer) {
+    free(pointer);
+}
+
+// ============================================================================
+// LAYOUT
+// ============================================================================
+
+typedef struct {
+    const char* name;
+    uint32_t value;
+} LayoutEntry;
+
+#define LAYOUT_SIZE(type) { "sizeof." #type, (uint32_t)sizeof(type) }
+#define LAYOUT_FIELD(type, field) { #type "." #field, (uint32_t)offsetof(type, field) }
+
+static const LayoutEntry layout[] = {
+    LAYOUT_SIZE(void*),
+    LAYOUT_SIZE(SdcSize),
+    LAYOUT_SIZE(long),
+    
+    LAYOUT_FIELD(StoryData, states),
+    LAYOUT_FIELD(StoryData, state_count),
+    LAYOUT_FIELD(StoryData, global_vars),
+    LAYOUT_FIELD(StoryData, global_var_count),
+    LAYOUT_FIELD(StoryData, linked_lists),
+    LAYOUT_FIELD(StoryData, linked_list_count),
+    LAYOUT_FIELD(StoryData, characters),
+    LAYOUT_FIELD(StoryData, character_count),
+    LAYOUT_FIELD(StoryData, tags),
+    LAYOUT_FIELD(StoryData, tag_count),
+    LAYOUT_FIELD(StoryData, chapters),
+    LAYOUT_FIELD(StoryData, chapter_count),
+    LAYOUT_FIELD(StoryData, groups),
+    LAYOUT_FIELD(StoryData, group_count),
+    LAYOUT_FIELD(StoryData, nodes),
+    LAYOUT_FIELD(StoryData, node_count),
+    LAYOUT_FIELD(StoryData, dialogues),
+    LAYOUT_FIELD(StoryData, dialogue_hashes),
+    LAYOUT_FIELD(StoryData, actions),
+    LAYOUT_FIELD(StoryData, action_hashes),
+    
+    LAYOUT_SIZE(State),
+    LAYOUT_FIELD(State, name),
+    
+    LAYOUT_SIZE(GlobalVariable),
+    LAYOUT_FIELD(GlobalVariable, name),
+    LAYOUT_FIELD(GlobalVariable, type),
+    LAYOUT_FIELD(GlobalVariable, default_value),
+    
+    LAYOUT_SIZE(LinkedListField),
+    LAYOUT_FIELD(LinkedListField, type),
+    
+    LAYOUT_SIZE(LinkedListColumn),
+    LAYOUT_FIELD(LinkedListColumn, type),
+    LAYOUT_FIELD(LinkedListColumn, data),
+    LAYOUT_FIELD(LinkedListColumn, present),
+    
+    LAYOUT_SIZE(LinkedListDefinition),
+    LAYOUT_FIELD(LinkedListDefinition, name),
+    LAYOUT_FIELD(LinkedListDefinition, scope),
+    LAYOUT_FIELD(LinkedListDefinition, field_names),
+    LAYOUT_FIELD(LinkedListDefinition, fields),
+    LAYOUT_FIELD(LinkedListDefinition, field_count),
+    LAYOUT_FIELD(LinkedListDefinition, columns),
+    LAYOUT_FIELD(LinkedListDefinition, strings),
+    
+    LAYOUT_SIZE(LinkedListData),
+    LAYOUT_FIELD(LinkedListData, list_index),
+    LAYOUT_FIELD(LinkedListData, first_row),
+    LAYOUT_FIELD(LinkedListData, count),
+    LAYOUT_FIELD(LinkedListData, is_array),
+    
+    LAYOUT_SIZE(Character),
+    LAYOUT_FIELD(Character, name),
+    LAYOUT_FIELD(Character, biography),
+    LAYOUT_FIELD(Character, description),
+    LAYOUT_FIELD(Character, linked_list_names),
+    LAYOUT_FIELD(Character, linked_list_data),
+    LAYOUT_FIELD(Character, linked_list_count),
+    
+    LAYOUT_SIZE(TagDefinition),
+    LAYOUT_FIELD(TagDefinition, name),
+    LAYOUT_FIELD(TagDefinition, type),
+    LAYOUT_FIELD(TagDefinition, color),
+    LAYOUT_FIELD(TagDefinition, keys),
+    LAYOUT_FIELD(TagDefinition, key_count),
+    
+    LAYOUT_SIZE(Chapter),
+    LAYOUT_FIELD(Chapter, id),
+    LAYOUT_FIELD(Chapter, name),
+    LAYOUT_FIELD(Chapter, content_hash),
+    
+    LAYOUT_SIZE(GroupTag),
+    LAYOUT_FIELD(GroupTag, tag_name),
+    LAYOUT_FIELD(GroupTag, selected_key),
+    LAYOUT_FIELD(GroupTag, value),
+    
+    LAYOUT_FIELD(NodeGraph, start_node),
+    LAYOUT_FIELD(NodeGraph, end_node),
+    LAYOUT_FIELD(NodeGraph, point_keys),
+    LAYOUT_FIELD(NodeGraph, point_values),
+    LAYOUT_FIELD(NodeGraph, point_value_counts),
+    LAYOUT_FIELD(NodeGraph, point_count),
+    
+    LAYOUT_SIZE(Group),
+    LAYOUT_FIELD(Group, id),
+    LAYOUT_FIELD(Group, chapter_id),
+    LAYOUT_FIELD(Group, name),
+    LAYOUT_FIELD(Group, content),
+    LAYOUT_FIELD(Group, tags),
+    LAYOUT_FIELD(Group, tag_count),
+    LAYOUT_FIELD(Group, nodes),
+    LAYOUT_FIELD(Group, linked_lists),
+    LAYOUT_FIELD(Group, linked_list_count),
+    LAYOUT_FIELD(Group, parent_group),
+    LAYOUT_FIELD(Group, content_hash),
+    
+    LAYOUT_SIZE(TimelineItem),
+    LAYOUT_FIELD(TimelineItem, type),
+    LAYOUT_FIELD(TimelineItem, number),
+    LAYOUT_FIELD(TimelineItem, payload),
+    
+    LAYOUT_SIZE(Node),
+    LAYOUT_FIELD(Node, id),
+    LAYOUT_FIELD(Node, title),
+    LAYOUT_FIELD(Node, content),
+    LAYOUT_FIELD(Node, timeline),
+    LAYOUT_FIELD(Node, timeline_count),
+    LAYOUT_FIELD(Node, content_hash),
+    
+    LAYOUT_SIZE(Dialogue),
+    LAYOUT_FIELD(Dialogue, characters),
+    LAYOUT_FIELD(Dialogue, texts),
+    LAYOUT_FIELD(Dialogue, line_count),
+    
+    LAYOUT_SIZE(Action),
+    LAYOUT_FIELD(Action, number),
+    LAYOUT_FIELD(Action, type),
+    LAYOUT_FIELD(Action, data.code.code),
+    LAYOUT_FIELD(Action, data.goto_action.target_node),
+    LAYOUT_FIELD(Action, data.exit_action.target),
+    LAYOUT_FIELD(Action, data.enter_action.target_group),
+    LAYOUT_FIELD(Action, data.choice.options),
+    LAYOUT_FIELD(Action, data.choice.option_count),
+    LAYOUT_FIELD(Action, data.event.event_type),
+    LAYOUT_FIELD(Action, data.event.data),
+    
+    LAYOUT_SIZE(ChoiceOption),
+    LAYOUT_FIELD(ChoiceOption, text),
+    LAYOUT_FIELD(ChoiceOption, actions),
+    LAYOUT_FIELD(ChoiceOption, action_count),
+    
+    LAYOUT_FIELD(AdjustVariableEventData, name),
+    LAYOUT_FIELD(AdjustVariableEventData, increment),
+    LAYOUT_FIELD(AdjustVariableEventData, value),
+    LAYOUT_FIELD(AdjustVariableEventData, is_toggle),
+    LAYOUT_FIELD(AdjustVariableEventData, has_increment),
+    LAYOUT_FIELD(AdjustVariableEventData, has_value),
+    
+    LAYOUT_FIELD(AddStateEventData, name),
+    LAYOUT_FIELD(AddStateEventData, character),
+    LAYOUT_FIELD(RemoveStateEventData, name),
+    LAYOUT_FIELD(RemoveStateEventData, character),
+    
+    LAYOUT_FIELD(ProgressStoryEventData, chapter_id),
+    LAYOUT_FIELD(ProgressStoryEventData, group_id),
+    LAYOUT_FIELD(ProgressStoryEventData, node_id),
+    
+    LAYOUT_FIELD(LinkedListEventData, reference),
+    LAYOUT_FIELD(LinkedListEventData, modifications),
+    LAYOUT_FIELD(LinkedListEventData, modification_count),
+    
+    LAYOUT_SIZE(LinkedListFieldModification),
+    LAYOUT_FIELD(LinkedListFieldModification, field),
+    LAYOUT_FIELD(LinkedListFieldModification, amount),
+    LAYOUT_FIELD(LinkedListFieldModification, set_value),
+    LAYOUT_FIELD(LinkedListFieldModification, append_value),
+    LAYOUT_FIELD(LinkedListFieldModification, replace_value),
+    LAYOUT_FIELD(LinkedListFieldModification, is_toggle),
+    LAYOUT_FIELD(LinkedListFieldModification, has_amount),
+    LAYOUT_FIELD(LinkedListFieldModification, has_set),
+    LAYOUT_FIELD(LinkedListFieldModification, has_append),
+    LAYOUT_FIELD(LinkedListFieldModification, has_replace)
+};
+
+// The table is read one entry at a time, so the binding does not need to
+// know the pointer size before it has read it
+SDC_WASM_EXPORT(sdc_wasm_layout_count)
+uint32_t sdc_wasm_layout_count(void) {
+    return (uint32_t)(sizeof(layout) / sizeof(layout[0]));
+}
+
+SDC_WASM_EXPORT(sdc_wasm_layout_name)
+const char* sdc_wasm_layout_name(uint32_t index) {
+    return layout[index].name;
+}
+
+SDC_WASM_EXPORT(sdc_wasm_layout_value)
+uint32_t sdc_wasm_layout_value(uint32_t index) {
+    return layout[index].value;
+}
@@ -65,10 +65,36 @@ class EndResult extends ExecutionResult {
   }
 }
 
+// Kinds of the steps StoryEngine.executeUntil runs, one bit each so they
+// combine into a stop mask. They match the result types of execute().
+const StepKind = Object.freeze({
+  DIALOGUE: 1,
+  ACTION: 2,
+  EVENT: 4,
+  CHOICE: 8,
+  TRANSITION: 16,
+  END: 32
+});
+
 // ============================================================================
 // STORY ENGINE
 // ============================================================================
 
+const NO_CHARACTERS = Object.freeze([]);
+
+/**
+ * Map from each entry's key to the first entry with it
+ */
+function buildIndex(entries, key) {
+  const index = new Map();
+  if (!entries) return index;
+  
+  for (const entry of entries) {
+    if (!index.has(entry[key])) index.set(entry[key], entry);
+  }
+  return index;
+}
+
 class StoryEngine {
   constructor(storyData) {
     this.story = storyData;
@@ -87,8 +113,64 @@ class StoryEngine {
     this.currentChoiceAction = null;
     this.selectedChoiceIndex = null;
     
+    // Why the last executeUntil call ended, when it returned StepKind.END
+    this.stopReason = null;
+    
     // Parser reference
     this.parser = new SDCParser();
+    
+    // Id and name indexes, and the objects the current ids resolved to
+    this.chapterIndex = null;
+    this.groupIndex = null;
+    this.nodeIndex = null;
+    this.globalVarIndex = null;
+    this.linkedListIndex = null;
+    this.listCharacters = null;
+    this.groupLists = null;
+    this.cachedChapterId = null;
+    this.cachedChapter = null;
+    this.cachedGroupId = null;
+    this.cachedGroup = null;
+    this.cachedNodeId = null;
+    this.cachedNode = null;
+    this.indexStory();
+  }
+  
+  /**
+   * Build the lookup indexes. Call again after adding or removing entries
+   * of the story; the first entry of an id or name wins, as in SDCParser.
+   */
+  indexStory() {
+    this.chapterIndex = buildIndex(this.story.chapters, 'id');
+    this.groupIndex = buildIndex(this.story.groups, 'id');
+    this.nodeIndex = buildIndex(this.story.nodes, 'id');
+    this.globalVarIndex = buildIndex(this.story['global-vars'], 'name');
+    this.linkedListIndex = buildIndex(this.story['linked-lists'], 'name');
+    
+    // Names of the characters carrying each linked list, in story order
+    const listCharacters = new Map();
+    for (const character of this.story.characters || []) {
+      if (!character['linked-list-data']) continue;
+      for (const listName in character['linked-list-data']) {
+        if (!listCharacters.has(listName)) listCharacters.set(listName, []);
+        listCharacters.get(listName).push(character.name);
+      }
+    }
+    for (const names of listCharacters.values()) Object.freeze(names);
+    this.listCharacters = listCharacters;
+    
+    // Linked lists enabled in each group
+    this.groupLists = new Map();
+    for (const group of this.story.groups || []) {
+      this.groupLists.set(group, new Set(group['linked-lists'] || []));
+    }
+    
+    this.cachedChapterId = null;
+    this.cachedChapter = null;
+    this.cachedGroupId = null;
+    this.cachedGroup = null;
+    this.cachedNodeId = null;
+    this.cachedNode = null;
   }
 
   // ========================================================================
@@ -113,7 +195,11 @@ class StoryEngine {
    */
   getCurrentNode() {
     if (!this.currentNodeId) return null;
-    return this.parser.getNode(this.story, this.currentNodeId);
+    if (this.cachedNodeId !== this.currentNodeId) {
+      this.cachedNode = this.nodeIndex.get(this.currentNodeId) || null;
+      this.cachedNodeId = this.currentNodeId;
+    }
+    return this.cachedNode;
   }
 
   /**
@@ -121,7 +207,11 @@ class StoryEngine {
    */
   getCurrentGroup() {
     if (!this.currentGroupId) return null;
-    return this.parser.getGroup(this.story, this.currentGroupId);
+    if (this.cachedGroupId !== this.currentGroupId) {
+      this.cachedGroup = this.groupIndex.get(this.currentGroupId) || null;
+      this.cachedGroupId = this.currentGroupId;
+    }
+    return this.cachedGroup;
   }
 
   /**
@@ -129,7 +219,11 @@ class StoryEngine {
    */
   getCurrentChapter() {
     if (!this.currentChapterId) return null;
-    return this.parser.getChapter(this.story, this.currentChapterId);
+    if (this.cachedChapterId !== this.currentChapterId) {
+      this.cachedChapter = this.chapterIndex.get(this.currentChapterId) || null;
+      this.cachedChapterId = this.currentChapterId;
+    }
+    return this.cachedChapter;
   }
 
   /**
@@ -174,7 +268,7 @@ class StoryEngine {
    * Navigate to a specific group
    */
   enterGroup(groupId) {
-    const group = this.parser.getGroup(this.story, groupId);
+    const group = this.groupIndex.get(groupId);
     if (!group) return false;
     
     this.currentGroupId = groupId;
@@ -236,7 +330,11 @@ class StoryEngine {
    * Clear parameter stack
    */
   clearParameters() {
-    this.parameterStack = {};
+    // Keep the empty stack rather than allocate one on every step
+    for (const context in this.parameterStack) {
+      this.parameterStack = {};
+      return;
+    }
   }
 
   /**
@@ -540,27 +638,31 @@ class StoryEngine {
    * Execute next-node event
    */
   executeNextNodeEvent(actionNumber) {
-    // Get current group's node graph
-    const group = this.getCurrentGroup();
-    if (!group || !group.nodes || !group.nodes.points) {
-      return new EndResult('no-next-node');
-    }
-    
-    // Find next node from current node
-    const currentNodeId = this.currentNodeId;
-    const nextNodes = group.nodes.points[currentNodeId];
-    
-    if (!nextNodes || nextNodes.length === 0) {
+    // Find next node from current node in the group's node graph
+    const nextNodeId = this.nextNodeId();
+    if (nextNodeId === null) {
       return new EndResult('no-next-node');
     }
     
     // Navigate to first next node
-    const nextNodeId = nextNodes[0];
     this.gotoNode(nextNodeId);
     
     return new TransitionResult('node', { nodeId: nextNodeId });
   }
 
+  /**
+   * First node after the current one in the current group's node graph,
+   * or null
+   */
+  nextNodeId() {
+    const group = this.getCurrentGroup();
+    if (!group || !group.nodes || !group.nodes.points) return null;
+    
+    const nextNodes = group.nodes.points[this.currentNodeId];
+    if (!nextNodes || nextNodes.length === 0) return null;
+    return nextNodes[0];
+  }
+  
   /**
    * Execute exit-current-node event
    */
@@ -587,7 +689,7 @@ class StoryEngine {
     const isToggle = event['is-toggle'];
     
     // Get variable definition to determine type
-    const varDef = this.parser.getGlobalVariable(this.story, variableName);
+    const varDef = this.globalVarIndex.get(variableName);
     
     const eventData = {
       variableName,
@@ -637,7 +739,23 @@ class StoryEngine {
     const groupId = event['group-id'];
     const nodeId = event['node-id'];
     
-    // Update current position
+    this.applyProgressStory(event);
+    
+    return new EventResult(actionNumber, 'progress-story', {
+      chapterId: chapterId !== -1 ? chapterId : null,
+      groupId: groupId !== -1 ? groupId : null,
+      nodeId: nodeId !== -1 ? nodeId : null
+    });
+  }
+  
+  /**
+   * Move to the position a progress-story event names
+   */
+  applyProgressStory(event) {
+    const chapterId = event['chapter-id'];
+    const groupId = event['group-id'];
+    const nodeId = event['node-id'];
+    
     if (chapterId !== null && chapterId !== -1) {
       this.currentChapterId = chapterId;
     }
@@ -647,12 +765,6 @@ class StoryEngine {
     if (nodeId !== null && nodeId !== -1) {
       this.gotoNode(nodeId);
     }
-    
-    return new EventResult(actionNumber, 'progress-story', {
-      chapterId: chapterId !== -1 ? chapterId : null,
-      groupId: groupId !== -1 ? groupId : null,
-      nodeId: nodeId !== -1 ? nodeId : null
-    });
   }
 
   /**
@@ -663,7 +775,7 @@ class StoryEngine {
     const modifications = event.values || [];
     
     // Get linked list definition
-    const listDef = this.parser.getLinkedList(this.story, linkedListName);
+    const listDef = this.linkedListIndex.get(linkedListName);
     
     // Process modifications with parameters
     const processedMods = modifications.map(mod => {
@@ -705,34 +817,185 @@ class StoryEngine {
 
   /**
    * Get characters affected by linked list modification
-   * (characters in current group that have this linked list)
+   * (characters in current group that have this linked list).
+   * The array is shared and frozen.
    */
   getAffectedCharacters(linkedListName) {
     const group = this.getCurrentGroup();
-    if (!group || !group['linked-lists']) {
-      return [];
-    }
+    if (!group) return NO_CHARACTERS;
     
     // Check if this linked list is in the current group
-    if (!group['linked-lists'].includes(linkedListName)) {
-      return [];
-    }
-    
-    // Get all characters that have this linked list
-    const affectedChars = [];
-    for (const character of this.story.characters) {
-      // Check if character has linked-list-data object with this list
-      if (character['linked-list-data']) {
-        const hasLinkedList = linkedListName in character['linked-list-data'];
-        if (hasLinkedList) {
-          affectedChars.push(character.name);
+    const lists = this.groupLists.get(group);
+    if (!lists || !lists.has(linkedListName)) return NO_CHARACTERS;
+    
+    return this.listCharacters.get(linkedListName) || NO_CHARACTERS;
+  }
+
+  // ========================================================================
+  // BATCH EXECUTION
+  // ========================================================================
+  
+  /**
+   * Execute timeline items until one of a kind in stopMask, without
+   * allocating result objects. Choices and ends always stop, since nothing
+   * can follow them without the caller. Steps have the same effects as
+   * repeated execute() calls.
+   * @param {number} stopMask - StepKind bits to stop at
+   * @param {function} [sink] - Called as sink(kind, item) for every step,
+   *   with the story's own timeline item or choice sub-action; copy what
+   *   is needed into your own buffers, as the item is not a result object
+   * @returns {number} StepKind of the last step. For StepKind.END,
+   *   stopReason holds the EndResult reason
+   */
+  executeUntil(stopMask, sink) {
+    const mask = stopMask | StepKind.CHOICE | StepKind.END;
+    
+    while (true) {
+      let kind;
+      
+      if (this.selectedChoiceIndex !== null) {
+        kind = this.stepChoiceActions(sink);
+        this.selectedChoiceIndex = null;
+      } else {
+        const item = this.getCurrentTimelineItem();
+        if (!item) {
+          this.stopReason = 'timeline-complete';
+          return StepKind.END;
+        }
+        
+        if (!item.type) {
+          console.error('Timeline item missing type:', item);
+          this.stopReason = 'invalid-item';
+          return StepKind.END;
         }
+        
+        kind = this.stepItem(item);
+        if (sink) sink(kind, item);
+        
+        if (!this.awaitingChoice) {
+          this.clearParameters();
+          this.advance();
+        }
+      }
+      
+      if (kind & mask) return kind;
+    }
+  }
+  
+  /**
+   * Apply one timeline item as execute() would, returning its StepKind
+   */
+  stepItem(item) {
+    if (item.type === TimelineItemType.DIALOGUE) return StepKind.DIALOGUE;
+    
+    if (item.type !== TimelineItemType.ACTION) {
+      console.error('Unknown timeline item type:', item.type);
+      this.stopReason = 'no-content';
+      return StepKind.END;
+    }
+    
+    const actionType = item['action-type'];
+    if (actionType === ActionType.CHOICE) {
+      if (item.data && item.data.choice && item.data.choice.options) {
+        this.currentChoiceAction = item;
+        this.awaitingChoice = true;
       }
+      return StepKind.CHOICE;
     }
     
-    return affectedChars;
+    return this.stepAction(actionType, item);
   }
-
+  
+  /**
+   * Apply a goto, exit, enter or event action; other actions have no
+   * effect on the engine
+   */
+  stepAction(actionType, action) {
+    switch (actionType) {
+      case ActionType.GOTO:
+        this.gotoNode(action.data['target-node']);
+        return StepKind.TRANSITION;
+      
+      case ActionType.EXIT:
+        if (action.data.target === 'node') {
+          this.exitNode();
+          this.stopReason = 'exit-node';
+          return StepKind.END;
+        } else if (action.data.target === 'group') {
+          this.exitGroup();
+          this.stopReason = 'exit-group';
+          return StepKind.END;
+        }
+        return StepKind.ACTION;
+      
+      case ActionType.ENTER:
+        this.enterGroup(action.data['target-group']);
+        return StepKind.TRANSITION;
+      
+      case ActionType.EVENT:
+        return this.stepEvent(action.data);
+      
+      default:
+        return StepKind.ACTION;
+    }
+  }
+  
+  /**
+   * Apply an event as executeEventAction would
+   */
+  stepEvent(event) {
+    switch (event['event-type']) {
+      case EventType.NEXT_NODE: {
+        const nextNodeId = this.nextNodeId();
+        if (nextNodeId === null) {
+          this.stopReason = 'no-next-node';
+          return StepKind.END;
+        }
+        this.gotoNode(nextNodeId);
+        return StepKind.TRANSITION;
+      }
+      
+      case EventType.EXIT_CURRENT_NODE:
+        this.exitNode();
+        this.stopReason = 'exit-node';
+        return StepKind.END;
+      
+      case EventType.EXIT_CURRENT_GROUP:
+        this.exitGroup();
+        this.stopReason = 'exit-group';
+        return StepKind.END;
+      
+      case EventType.PROGRESS_STORY:
+        this.applyProgressStory(event);
+        return StepKind.EVENT;
+      
+      default:
+        return StepKind.EVENT;
+    }
+  }
+  
+  /**
+   * Run the actions of the selected choice as executeChoiceActions would,
+   * returning the StepKind of the last one
+   */
+  stepChoiceActions(sink) {
+    const action = this.currentChoiceAction;
+    if (!action || !action.data || !action.data.choice || !action.data.choice.options) {
+      return StepKind.ACTION;
+    }
+    
+    const actions = action.data.choice.options[this.selectedChoiceIndex].actions;
+    let kind = StepKind.ACTION;
+    if (!actions) return kind;
+    
+    for (let i = 0; i < actions.length; i++) {
+      kind = this.stepAction(actions[i].type, actions[i]);
+      if (sink) sink(kind, actions[i]);
+      if (kind === StepKind.TRANSITION || kind === StepKind.END) break;
+    }
+    return kind;
+  }
+  
   // ========================================================================
   // UTILITY
   // ========================================================================
@@ -762,6 +1025,7 @@ class StoryEngine {
     this.awaitingChoice = false;
     this.currentChoiceAction = null;
     this.selectedChoiceIndex = null;
+    this.stopReason = null;
     this.clearParameters();
   }
 }
@@ -772,6 +1036,7 @@ class StoryEngine {
 
 export {
   StoryEngine,
+  StepKind,
   ExecutionResult,
   DialogueResult,
   ActionResult,
@@ -9,78 +9,79 @@
 // TOKEN TYPES
 // ============================================================================
 
+// Small integers, so the lexer can keep token types in a Uint8Array
 const TokenType = {
   // Literals
-  IDENTIFIER: 'IDENTIFIER',
-  STRING: 'STRING',
-  NUMBER: 'NUMBER',
-  FLOAT: 'FLOAT',
-  CODE_BLOCK: 'CODE_BLOCK',
-  TRUE: 'TRUE',
-  FALSE: 'FALSE',
+  IDENTIFIER: 0,
+  STRING: 1,
+  NUMBER: 2,
+  FLOAT: 3,
+  CODE_BLOCK: 4,
+  TRUE: 5,
+  FALSE: 6,
   
   // Keywords
-  STATES: 'STATES',
-  GLOBAL_VARS: 'GLOBAL_VARS',
-  LINKED_LISTS: 'LINKED_LISTS',
-  CHARACTERS: 'CHARACTERS',
-  DEFAULT: 'DEFAULT',
-  TITLE: 'TITLE',
-  TAGS: 'TAGS',
-  CHAPTER: 'CHAPTER',
-  GROUP: 'GROUP',
-  NODE: 'NODE',
-  NAME: 'NAME',
-  CONTENT: 'CONTENT',
-  TYPE: 'TYPE',
-  COLOR: 'COLOR',
-  KEYS: 'KEYS',
-  SCOPE: 'SCOPE',
-  STRUCTURE: 'STRUCTURE',
-  BIOGRAPHY: 'BIOGRAPHY',
-  DESCRIPTION: 'DESCRIPTION',
-  LINKED_LIST_DATA: 'LINKED_LIST_DATA',
-  TIMELINE: 'TIMELINE',
-  ACTION: 'ACTION',
-  DIALOGUE: 'DIALOGUE',
-  CHOICE: 'CHOICE',
-  CHOICES: 'CHOICES',
-  TEXT: 'TEXT',
-  GOTO: 'GOTO',
-  EXIT: 'EXIT',
-  ENTER: 'ENTER',
-  NODES: 'NODES',
-  START: 'START',
-  END: 'END',
-  POINTS: 'POINTS',
-  DATA: 'DATA',
-  INCREMENT: 'INCREMENT',
-  VALUE: 'VALUE',
-  TOGGLE: 'TOGGLE',
-  CHARACTER: 'CHARACTER',
-  EVENT: 'EVENT',
-  REFERENCE: 'REFERENCE',
-  VALUES: 'VALUES',
-  AMOUNT: 'AMOUNT',
-  SET: 'SET',
-  APPEND: 'APPEND',
-  REPLACE: 'REPLACE',
-  PARENT_GROUP: 'PARENT_GROUP',
+  STATES: 7,
+  GLOBAL_VARS: 8,
+  LINKED_LISTS: 9,
+  CHARACTERS: 10,
+  DEFAULT: 11,
+  TITLE: 12,
+  TAGS: 13,
+  CHAPTER: 14,
+  GROUP: 15,
+  NODE: 16,
+  NAME: 17,
+  CONTENT: 18,
+  TYPE: 19,
+  COLOR: 20,
+  KEYS: 21,
+  SCOPE: 22,
+  STRUCTURE: 23,
+  BIOGRAPHY: 24,
+  DESCRIPTION: 25,
+  LINKED_LIST_DATA: 26,
+  TIMELINE: 27,
+  ACTION: 28,
+  DIALOGUE: 29,
+  CHOICE: 30,
+  CHOICES: 31,
+  TEXT: 32,
+  GOTO: 33,
+  EXIT: 34,
+  ENTER: 35,
+  NODES: 36,
+  START: 37,
+  END: 38,
+  POINTS: 39,
+  DATA: 40,
+  INCREMENT: 41,
+  VALUE: 42,
+  TOGGLE: 43,
+  CHARACTER: 44,
+  EVENT: 45,
+  REFERENCE: 46,
+  VALUES: 47,
+  AMOUNT: 48,
+  SET: 49,
+  APPEND: 50,
+  REPLACE: 51,
+  PARENT_GROUP: 52,
   
   // Symbols
-  LBRACE: 'LBRACE',
-  RBRACE: 'RBRACE',
-  LBRACKET: 'LBRACKET',
-  RBRACKET: 'RBRACKET',
-  COLON: 'COLON',
-  COMMA: 'COMMA',
-  AT: 'AT',
-  LPAREN: 'LPAREN',
-  RPAREN: 'RPAREN',
+  LBRACE: 53,
+  RBRACE: 54,
+  LBRACKET: 55,
+  RBRACKET: 56,
+  COLON: 57,
+  COMMA: 58,
+  AT: 59,
+  LPAREN: 60,
+  RPAREN: 61,
   
   // Special
-  EOF: 'EOF',
-  ERROR: 'ERROR'
+  EOF: 62,
+  ERROR: 63
 };
 
 // ============================================================================
@@ -129,122 +130,319 @@ const TimelineItemType = {
 // LEXER
 // ============================================================================
 
-class Token {
-  constructor(type, lexeme, line, column, value = null) {
-    this.type = type;
-    this.lexeme = lexeme;
-    this.line = line;
-    this.column = column;
-    this.value = value;
+// BEGIN GENERATED KEYWORDS
+// Generated by tools/gen_keywords.js from tools/keywords.txt; do not edit.
+
+const KEYWORD_COUNT = 48;
+const KEYWORD_BUCKETS = 24;
+
+const KEYWORD_DISPLACEMENTS = new Uint16Array([
+  0, 6, 14, 16, 0, 10, 11, 9, 8, 15, 17, 0, 3, 1, 7, 0,
+  0, 0, 5, 1, 5, 48, 0, 44
+]);
+
+const KEYWORD_TEXTS = [
+  'enter',
+  'points',
+  'end',
+  'nodes',
+  'values',
+  'content',
+  'character',
+  'biography',
+  'set',
+  'start',
+  'name',
+  'dialogue',
+  'choice',
+  'tags',
+  'reference',
+  'true',
+  'keys',
+  'replace',
+  'group',
+  'states',
+  'false',
+  'structure',
+  'linked-lists',
+  'text',
+  'exit',
+  'default',
+  'type',
+  'amount',
+  'description',
+  'choices',
+  'chapter',
+  'global-vars',
+  'characters',
+  'data',
+  'node',
+  'value',
+  'title',
+  'parent-group',
+  'increment',
+  'linked-list-data',
+  'timeline',
+  'action',
+  'color',
+  'toggle',
+  'goto',
+  'append',
+  'event',
+  'scope'
+];
+
+const KEYWORD_TYPES = [
+  TokenType.ENTER,
+  TokenType.POINTS,
+  TokenType.END,
+  TokenType.NODES,
+  TokenType.VALUES,
+  TokenType.CONTENT,
+  TokenType.CHARACTER,
+  TokenType.BIOGRAPHY,
+  TokenType.SET,
+  TokenType.START,
+  TokenType.NAME,
+  TokenType.DIALOGUE,
+  TokenType.CHOICE,
+  TokenType.TAGS,
+  TokenType.REFERENCE,
+  TokenType.TRUE,
+  TokenType.KEYS,
+  TokenType.REPLACE,
+  TokenType.GROUP,
+  TokenType.STATES,
+  TokenType.FALSE,
+  TokenType.STRUCTURE,
+  TokenType.LINKED_LISTS,
+  TokenType.TEXT,
+  TokenType.EXIT,
+  TokenType.DEFAULT,
+  TokenType.TYPE,
+  TokenType.AMOUNT,
+  TokenType.DESCRIPTION,
+  TokenType.CHOICES,
+  TokenType.CHAPTER,
+  TokenType.GLOBAL_VARS,
+  TokenType.CHARACTERS,
+  TokenType.DATA,
+  TokenType.NODE,
+  TokenType.VALUE,
+  TokenType.TITLE,
+  TokenType.PARENT_GROUP,
+  TokenType.INCREMENT,
+  TokenType.LINKED_LIST_DATA,
+  TokenType.TIMELINE,
+  TokenType.ACTION,
+  TokenType.COLOR,
+  TokenType.TOGGLE,
+  TokenType.GOTO,
+  TokenType.APPEND,
+  TokenType.EVENT,
+  TokenType.SCOPE
+];
+
+/**
+ * Classify source.substring(start, end), which must not be empty
+ * @returns {number} Keyword token type or TokenType.IDENTIFIER
+ */
+function keywordLookup(source, start, end) {
+  const length = end - start;
+  const key = (source.charCodeAt(start) |
+               (length > 1 ? source.charCodeAt(start + 1) : 0) << 8 |
+               source.charCodeAt(end - 1) << 16 |
+               (length & 0xFF) << 24) >>> 0;
+  const spread = Math.imul((key ^ KEYWORD_DISPLACEMENTS[key % KEYWORD_BUCKETS]) >>> 0, 0x9e3779b1) >>> 0;
+  const slot = Math.floor(spread * KEYWORD_COUNT / 4294967296);
+  const text = KEYWORD_TEXTS[slot];
+  if (text.length === length && source.startsWith(text, start)) {
+    return KEYWORD_TYPES[slot];
   }
+  return TokenType.IDENTIFIER;
 }
+// END GENERATED KEYWORDS
 
-class Lexer {
+// Character codes the lexer tests for
+const CHAR_TAB = 0x09;
+const CHAR_LF = 0x0a;
+const CHAR_CR = 0x0d;
+const CHAR_SPACE = 0x20;
+const CHAR_BANG = 0x21;
+const CHAR_QUOTE = 0x22;
+const CHAR_HASH = 0x23;
+const CHAR_LPAREN = 0x28;
+const CHAR_RPAREN = 0x29;
+const CHAR_COMMA = 0x2c;
+const CHAR_MINUS = 0x2d;
+const CHAR_DOT = 0x2e;
+const CHAR_0 = 0x30;
+const CHAR_9 = 0x39;
+const CHAR_COLON = 0x3a;
+const CHAR_LT = 0x3c;
+const CHAR_GT = 0x3e;
+const CHAR_AT = 0x40;
+const CHAR_LBRACKET = 0x5b;
+const CHAR_RBRACKET = 0x5d;
+const CHAR_UNDERSCORE = 0x5f;
+const CHAR_LBRACE = 0x7b;
+const CHAR_RBRACE = 0x7d;
+
+/**
+ * Tokens as parallel typed arrays: token i has type types[i], covers
+ * source.substring(starts[i], ends[i]) and ends on line lines[i]. Nothing
+ * is sliced from the source until the parser asks for a value or text.
+ */
+class TokenList {
   constructor(source) {
+    const capacity = (source.length >> 2) + 16;
+    this.source = source;
+    this.count = 0;
+    this.types = new Uint8Array(capacity);
+    this.starts = new Int32Array(capacity);
+    this.ends = new Int32Array(capacity);
+    this.lines = new Int32Array(capacity);
+  }
+  
+  push(type, start, end, line) {
+    if (this.count === this.types.length) this.grow();
+    
+    const i = this.count++;
+    this.types[i] = type;
+    this.starts[i] = start;
+    this.ends[i] = end;
+    this.lines[i] = line;
+  }
+  
+  grow() {
+    const capacity = this.types.length * 2;
+    const types = new Uint8Array(capacity);
+    const starts = new Int32Array(capacity);
+    const ends = new Int32Array(capacity);
+    const lines = new Int32Array(capacity);
+    types.set(this.types);
+    starts.set(this.starts);
+    ends.set(this.ends);
+    lines.set(this.lines);
+    this.types = types;
+    this.starts = starts;
+    this.ends = ends;
+    this.lines = lines;
+  }
+  
+  /**
+   * Value of token i: the contents of a string or code block, a number,
+   * a boolean, or null for any other token
+   */
+  value(i) {
+    const start = this.starts[i];
+    const end = this.ends[i];
+    
+    switch (this.types[i]) {
+      case TokenType.STRING:
+        return this.source.substring(start + 1, end - 1);
+      
+      case TokenType.CODE_BLOCK:
+        return this.source.substring(start + 2, end - 2);
+      
+      case TokenType.NUMBER: {
+        const source = this.source;
+        const negative = source.charCodeAt(start) === CHAR_MINUS;
+        let number = 0;
+        for (let j = negative ? start + 1 : start; j < end; j++) {
+          number = number * 10 + (source.charCodeAt(j) - CHAR_0);
+        }
+        return negative ? -number : number;
+      }
+      
+      case TokenType.FLOAT:
+        return parseFloat(this.source.substring(start, end));
+      
+      case TokenType.TRUE:
+        return true;
+      
+      case TokenType.FALSE:
+        return false;
+      
+      default:
+        return null;
+    }
+  }
+  
+  // Source text of token i
+  text(i) {
+    return this.source.substring(this.starts[i], this.ends[i]);
+  }
+  
+  // Column of the start of token i, counted from 1. Only error messages
+  // need it, so it is found from the source rather than stored.
+  column(i) {
+    const start = this.starts[i];
+    return start - this.source.lastIndexOf('\n', start - 1);
+  }
+}
+
+// The lexer reports progress every PROGRESS_CHARACTERS characters and the
+// parser every PROGRESS_TOKENS tokens, about the same stretch of source.
+// Without a callback the next report is at Infinity, so the check in their
+// loops is one comparison that never passes.
+const PROGRESS_CHARACTERS = 1 << 18;
+const PROGRESS_TOKENS = 1 << 15;
+
+class Lexer {
+  constructor(source, onProgress = null, line = 1) {
     this.source = source;
     this.current = 0;
     this.start = 0;
-    this.line = 1;
-    this.column = 1;
-    this.tokens = [];
-    
-    this.keywords = {
-      'states': TokenType.STATES,
-      'global-vars': TokenType.GLOBAL_VARS,
-      'linked-lists': TokenType.LINKED_LISTS,
-      'characters': TokenType.CHARACTERS,
-      'default': TokenType.DEFAULT,
-      'title': TokenType.TITLE,
-      'tags': TokenType.TAGS,
-      'chapter': TokenType.CHAPTER,
-      'group': TokenType.GROUP,
-      'node': TokenType.NODE,
-      'name': TokenType.NAME,
-      'content': TokenType.CONTENT,
-      'type': TokenType.TYPE,
-      'color': TokenType.COLOR,
-      'keys': TokenType.KEYS,
-      'scope': TokenType.SCOPE,
-      'structure': TokenType.STRUCTURE,
-      'biography': TokenType.BIOGRAPHY,
-      'description': TokenType.DESCRIPTION,
-      'linked-list-data': TokenType.LINKED_LIST_DATA,
-      'timeline': TokenType.TIMELINE,
-      'action': TokenType.ACTION,
-      'dialogue': TokenType.DIALOGUE,
-      'choice': TokenType.CHOICE,
-      'choices': TokenType.CHOICES,
-      'text': TokenType.TEXT,
-      'goto': TokenType.GOTO,
-      'exit': TokenType.EXIT,
-      'enter': TokenType.ENTER,
-      'nodes': TokenType.NODES,
-      'start': TokenType.START,
-      'end': TokenType.END,
-      'points': TokenType.POINTS,
-      'data': TokenType.DATA,
-      'increment': TokenType.INCREMENT,
-      'value': TokenType.VALUE,
-      'toggle': TokenType.TOGGLE,
-      'character': TokenType.CHARACTER,
-      'event': TokenType.EVENT,
-      'reference': TokenType.REFERENCE,
-      'values': TokenType.VALUES,
-      'amount': TokenType.AMOUNT,
-      'set': TokenType.SET,
-      'append': TokenType.APPEND,
-      'replace': TokenType.REPLACE,
-      'parent-group': TokenType.PARENT_GROUP,
-      'true': TokenType.TRUE,
-      'false': TokenType.FALSE
-    };
+    this.line = line;
+    this.tokens = new TokenList(source);
+    this.onProgress = onProgress;
+    this.nextProgress = onProgress ? PROGRESS_CHARACTERS : Infinity;
   }
   
   isAtEnd() {
     return this.current >= this.source.length;
   }
   
+  // Characters are handled as char codes; 0 stands for the end of input
   advance() {
-    const c = this.source[this.current++];
-    this.column++;
-    return c;
+    return this.source.charCodeAt(this.current++);
   }
   
   peek() {
-    if (this.isAtEnd()) return '\0';
-    return this.source[this.current];
+    if (this.isAtEnd()) return 0;
+    return this.source.charCodeAt(this.current);
   }
   
   peekNext() {
-    if (this.current + 1 >= this.source.length) return '\0';
-    return this.source[this.current + 1];
+    if (this.current + 1 >= this.source.length) return 0;
+    return this.source.charCodeAt(this.current + 1);
   }
   
   isDigit(c) {
-    return c >= '0' && c <= '9';
+    return c >= CHAR_0 && c <= CHAR_9;
   }
   
   isAlpha(c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c === '_';
+    return (c >= 0x61 && c <= 0x7a) || (c >= 0x41 && c <= 0x5a) || c === CHAR_UNDERSCORE;
   }
   
   skipWhitespace() {
     while (true) {
       const c = this.peek();
       switch (c) {
-        case ' ':
-        case '\r':
-        case '\t':
-          this.advance();
+        case CHAR_SPACE:
+        case CHAR_CR:
+        case CHAR_TAB:
+          this.current++;
           break;
-        case '\n':
+        case CHAR_LF:
           this.line++;
-          this.column = 0;
-          this.advance();
+          this.current++;
           break;
-        case '#':
-          while (this.peek() !== '\n' && !this.isAtEnd()) {
-            this.advance();
+        case CHAR_HASH:
+          while (this.peek() !== CHAR_LF && !this.isAtEnd()) {
+            this.current++;
           }
           break;
         default:
@@ -253,35 +451,28 @@ class Lexer {
     }
   }
   
-  addToken(type, value = null) {
-    const lexeme = this.source.substring(this.start, this.current);
-    const token = new Token(type, lexeme, this.line, 
-                           this.column - (this.current - this.start), value);
-    this.tokens.push(token);
+  addToken(type) {
+    this.tokens.push(type, this.start, this.current, this.line);
   }
   
   scanString() {
-    this.advance(); // Opening quote
-    const stringStart = this.current;
+    this.current++; // Opening quote
     
-    while (this.peek() !== '"' && !this.isAtEnd()) {
+    while (this.peek() !== CHAR_QUOTE && !this.isAtEnd()) {
       const currentChar = this.peek();
       
       // Handle all line ending types
-      if (currentChar === '\r' && this.peekNext() === '\n') {
+      if (currentChar === CHAR_CR && this.peekNext() === CHAR_LF) {
         this.line++;
-        this.column = 0;
-        this.advance(); // \r
-        this.advance(); // \n
+        this.current += 2;
         continue;
       }
       
-      if (currentChar === '\r' || currentChar === '\n') {
+      if (currentChar === CHAR_CR || currentChar === CHAR_LF) {
         this.line++;
-        this.column = 0;
       }
       
-      this.advance();
+      this.current++;
     }
     
     if (this.isAtEnd()) {
@@ -289,95 +480,68 @@ class Lexer {
       return;
     }
     
-    const value = this.source.substring(stringStart, this.current);
-    this.advance(); // Closing quote
-    this.addToken(TokenType.STRING, value);
+    this.current++; // Closing quote
+    this.addToken(TokenType.STRING);
   }
   
   scanNumber() {
     let isFloat = false;
     
     // Handle negative sign
-    if (this.peek() === '-') {
-      this.advance();
+    if (this.peek() === CHAR_MINUS) {
+      this.current++;
     }
     
     while (this.isDigit(this.peek())) {
-      this.advance();
+      this.current++;
     }
     
     // Check for decimal point
-    if (this.peek() === '.' && this.isDigit(this.peekNext())) {
+    if (this.peek() === CHAR_DOT && this.isDigit(this.peekNext())) {
       isFloat = true;
-      this.advance(); // Consume '.'
+      this.current++; // Consume '.'
       
       while (this.isDigit(this.peek())) {
-        this.advance();
+        this.current++;
       }
     }
     
-    const lexeme = this.source.substring(this.start, this.current);
-    const value = isFloat ? parseFloat(lexeme) : parseInt(lexeme, 10);
-    this.addToken(isFloat ? TokenType.FLOAT : TokenType.NUMBER, value);
+    this.addToken(isFloat ? TokenType.FLOAT : TokenType.NUMBER);
   }
   
   scanIdentifier() {
-    while (this.isAlpha(this.peek()) || this.isDigit(this.peek()) || this.peek() === '-') {
-      this.advance();
+    let c = this.peek();
+    while (this.isAlpha(c) || this.isDigit(c) || c === CHAR_MINUS) {
+      this.current++;
+      c = this.peek();
     }
     
-    const text = this.source.substring(this.start, this.current);
-    const type = this.keywords[text] || TokenType.IDENTIFIER;
-    
-    if (type === TokenType.TRUE || type === TokenType.FALSE) {
-      this.addToken(type, type === TokenType.TRUE);
-    } else {
-      this.addToken(type);
-    }
+    this.addToken(keywordLookup(this.source, this.start, this.current));
   }
   
   scanCodeBlock() {
-    this.advance(); // <
-    this.advance(); // !
-    
-    const codeStart = this.current;
+    this.current += 2; // <!
     
     while (!this.isAtEnd()) {
-      // Check for closing !>
-      if (this.peek() === '!' && this.peekNext() === '>') {
-        break;
-      }
-      
-      // Handle line endings properly for all platforms
       const currentChar = this.peek();
       
-      // Windows: \r\n (check for \r followed by \n)
-      if (currentChar === '\r' && this.peekNext() === '\n') {
-        this.line++;
-        this.column = 0;
-        this.advance(); // Skip \r
-        this.advance(); // Skip \n
-        continue;
+      // Check for closing !>
+      if (currentChar === CHAR_BANG && this.peekNext() === CHAR_GT) {
+        break;
       }
       
-      // Old Mac: \r alone
-      if (currentChar === '\r') {
+      // Windows \r\n counts once, old Mac \r and Unix \n alone each count
+      if (currentChar === CHAR_CR && this.peekNext() === CHAR_LF) {
         this.line++;
-        this.column = 0;
-        this.advance();
+        this.current += 2;
         continue;
       }
       
-      // Unix: \n alone
-      if (currentChar === '\n') {
+      if (currentChar === CHAR_CR || currentChar === CHAR_LF) {
         this.line++;
-        this.column = 0;
-        this.advance();
-        continue;
       }
       
-      // Regular character
-      this.advance();
+      this.current++;
     }
     
     if (this.isAtEnd()) {
@@ -386,71 +550,62 @@ class Lexer {
       return;
     }
     
-    const code = this.source.substring(codeStart, this.current);
-    
-    this.advance(); // !
-    this.advance(); // >
-    
-    this.addToken(TokenType.CODE_BLOCK, code);
+    this.current += 2; // !>
+    this.addToken(TokenType.CODE_BLOCK);
   }
   
   scanTokens() {
     while (!this.isAtEnd()) {
-      this.start = this.current;
+      if (this.current >= this.nextProgress) {
+        this.nextProgress = this.current + PROGRESS_CHARACTERS;
+        this.onProgress('lex', this.current, this.source.length);
+      }
       this.skipWhitespace();
       
       if (this.isAtEnd()) break;
       
       this.start = this.current;
-      const c = this.advance();
+      const c = this.peek();
       
       switch (c) {
-        case '{': this.addToken(TokenType.LBRACE); break;
-        case '}': this.addToken(TokenType.RBRACE); break;
-        case '[': this.addToken(TokenType.LBRACKET); break;
-        case ']': this.addToken(TokenType.RBRACKET); break;
-        case ':': this.addToken(TokenType.COLON); break;
-        case ',': this.addToken(TokenType.COMMA); break;
-        case '@': this.addToken(TokenType.AT); break;
-        case '(': this.addToken(TokenType.LPAREN); break;
-        case ')': this.addToken(TokenType.RPAREN); break;
+        case CHAR_LBRACE: this.current++; this.addToken(TokenType.LBRACE); break;
+        case CHAR_RBRACE: this.current++; this.addToken(TokenType.RBRACE); break;
+        case CHAR_LBRACKET: this.current++; this.addToken(TokenType.LBRACKET); break;
+        case CHAR_RBRACKET: this.current++; this.addToken(TokenType.RBRACKET); break;
+        case CHAR_COLON: this.current++; this.addToken(TokenType.COLON); break;
+        case CHAR_COMMA: this.current++; this.addToken(TokenType.COMMA); break;
+        case CHAR_AT: this.current++; this.addToken(TokenType.AT); break;
+        case CHAR_LPAREN: this.current++; this.addToken(TokenType.LPAREN); break;
+        case CHAR_RPAREN: this.current++; this.addToken(TokenType.RPAREN); break;
         
-        case '<':
-          if (this.peek() === '!') {
+        case CHAR_LT:
+          if (this.peekNext() === CHAR_BANG) {
             this.scanCodeBlock();
           } else {
+            this.current++;
             this.addToken(TokenType.ERROR);
           }
           break;
         
-        case '"':
-          this.current--;
-          this.column--;
+        case CHAR_QUOTE:
           this.scanString();
           break;
         
-        case '-':
-          if (this.isDigit(this.peek())) {
-            this.current--;
-            this.column--;
+        case CHAR_MINUS:
+          if (this.isDigit(this.peekNext())) {
             this.scanNumber();
           } else {
-            this.current--;
-            this.column--;
             this.scanIdentifier();
           }
           break;
         
         default:
           if (this.isDigit(c)) {
-            this.current--;
-            this.column--;
             this.scanNumber();
           } else if (this.isAlpha(c)) {
-            this.current--;
-            this.column--;
             this.scanIdentifier();
           } else {
+            this.current++;
             this.addToken(TokenType.ERROR);
           }
           break;
@@ -464,37 +619,390 @@ class Lexer {
   }
 }
 
+// ============================================================================
+// STORY MODEL
+// ============================================================================
+
+// Chapters, groups, nodes and their timelines. Every field is set in the
+// constructor, always in the same order, so all objects of a class share
+// one hidden class and the engine's reads of them stay monomorphic. The
+// fields keep the keys the parser has always produced.
+
+class SdcChapter {
+  constructor(id) {
+    this.id = id;
+    this.name = null;
+    this['content-hash'] = null;
+  }
+}
+
+class SdcGroupTag {
+  constructor(tagName) {
+    this['tag-name'] = tagName;
+    this['selected-key'] = null;
+    this.value = null;
+  }
+}
+
+class SdcNodeGraph {
+  constructor() {
+    this['start-node'] = 0;
+    this['end-node'] = 0;
+    this.points = {};
+  }
+}
+
+class SdcGroup {
+  constructor(id) {
+    this.id = id;
+    this['chapter-id'] = 0;
+    this.name = null;
+    this.content = null;
+    this.tags = [];
+    this.nodes = null;
+    this['linked-lists'] = [];
+    this['parent-group'] = null;
+    this['content-hash'] = null;
+  }
+}
+
+class SdcNode {
+  constructor(id) {
+    this.id = id;
+    this.title = null;
+    this.content = null;
+    this.timeline = [];
+    this['content-hash'] = null;
+  }
+}
+
+class SdcDialogueLine {
+  constructor(character, text) {
+    this.character = character;
+    this.text = text;
+  }
+}
+
+class SdcDialogue {
+  constructor(number) {
+    this.type = TimelineItemType.DIALOGUE;
+    this.number = number;
+    this.lines = [];
+    this['content-hash'] = null;
+  }
+}
+
+// Data of an action, one class per action type and, for events, per
+// event type. Each carries only its own fields, so action.data stays
+// small while all data of one kind shares a shape.
+
+class SdcCodeData {
+  constructor(code = null) {
+    this.code = code;
+  }
+}
+
+class SdcGotoData {
+  constructor(targetNode = null) {
+    this['target-node'] = targetNode;
+  }
+}
+
+class SdcExitData {
+  constructor(target = null) {
+    this.target = target;
+  }
+}
+
+class SdcEnterData {
+  constructor(targetGroup = null) {
+    this['target-group'] = targetGroup;
+  }
+}
+
+class SdcChoiceData {
+  constructor() {
+    this.choice = null;
+  }
+}
+
+// Events without fields of their own: next-node, exit-current-node,
+// exit-current-group and unknown types
+class SdcEvent {
+  constructor(eventType = EventType.UNKNOWN) {
+    this['event-type'] = eventType;
+  }
+}
+
+class SdcAdjustVariableEvent extends SdcEvent {
+  constructor(name = null, value = null, increment = null, isToggle = false) {
+    super(EventType.ADJUST_VARIABLE);
+    this.name = name;
+    this.value = value;
+    this.increment = increment;
+    this['is-toggle'] = isToggle;
+  }
+}
+
+// add-state and remove-state
+class SdcStateEvent extends SdcEvent {
+  constructor(eventType, name = null, character = null) {
+    super(eventType);
+    this.name = name;
+    this.character = character;
+  }
+}
+
+class SdcProgressStoryEvent extends SdcEvent {
+  constructor(chapterId = null, groupId = null, nodeId = null) {
+    super(EventType.PROGRESS_STORY);
+    this['chapter-id'] = chapterId;
+    this['group-id'] = groupId;
+    this['node-id'] = nodeId;
+  }
+}
+
+class SdcLinkedListEvent extends SdcEvent {
+  constructor(reference = null, values = []) {
+    super(EventType.LINKED_LIST);
+    this.reference = reference;
+    this.values = values;
+  }
+}
+
+/**
+ * Empty data for an action of the given type
+ * @param {string} actionType - ActionType value
+ * @param {string} [eventType] - EventType value, for events
+ * @returns {object}
+ */
+function createActionData(actionType, eventType = EventType.UNKNOWN) {
+  switch (actionType) {
+    case ActionType.CODE: return new SdcCodeData();
+    case ActionType.GOTO: return new SdcGotoData();
+    case ActionType.EXIT: return new SdcExitData();
+    case ActionType.ENTER: return new SdcEnterData();
+    case ActionType.CHOICE: return new SdcChoiceData();
+  }
+  
+  switch (eventType) {
+    case EventType.ADJUST_VARIABLE: return new SdcAdjustVariableEvent();
+    case EventType.ADD_STATE:
+    case EventType.REMOVE_STATE: return new SdcStateEvent(eventType);
+    case EventType.PROGRESS_STORY: return new SdcProgressStoryEvent();
+    case EventType.LINKED_LIST: return new SdcLinkedListEvent();
+    default: return new SdcEvent(eventType);
+  }
+}
+
+class SdcAction {
+  constructor(number) {
+    this.type = TimelineItemType.ACTION;
+    this.number = number;
+    this['action-type'] = ActionType.CODE;
+    this.data = new SdcCodeData();
+    this['content-hash'] = null;
+  }
+}
+
+// One field change of a linked-list event
+class SdcListModification {
+  constructor(field) {
+    this.field = field;
+    this.amount = null;
+    this.set = null;
+    this.append = null;
+    this.replace = null;
+    this.toggle = null;
+  }
+}
+
 // ============================================================================
 // PARSER
 // ============================================================================
 
+// FNV-1a, 64-bit, kept as [high, low] in a Uint32Array. It takes the UTF-8
+// text of each token as 64-bit little-endian words. The last word holds
+// the 0 to 7 bytes left over and the low byte of the token's length in its
+// top byte. Whitespace and comments are not tokens, so they never change a
+// hash. The C parser computes the same values.
+const HASH_BASIS_HIGH = 0xcbf29ce4;
+const HASH_BASIS_LOW = 0x84222325;
+
+let hashBytes = new Uint8Array(256);
+
+// hash = (hash ^ word) * 0x100000001b3
+function hashWord(hash, high, low) {
+  const mixed = (hash[1] ^ low) >>> 0;
+  const product = mixed * 0x1b3;
+  hash[0] = (Math.imul(hash[0] ^ high, 0x1b3) + (mixed << 8) + Math.floor(product / 4294967296)) >>> 0;
+  hash[1] = product >>> 0;
+}
+
+// UTF-8 encodes source.substring(start, end) into hashBytes and returns
+// its length in bytes
+function encodeHashBytes(source, start, end) {
+  if (hashBytes.length < (end - start) * 3) hashBytes = new Uint8Array((end - start) * 3);
+  
+  const bytes = hashBytes;
+  let length = 0;
+  for (let i = start; i < end; i++) {
+    let c = source.charCodeAt(i);
+    if (c < 0x80) {
+      bytes[length++] = c;
+    } else if (c < 0x800) {
+      bytes[length++] = 0xc0 | (c >> 6);
+      bytes[length++] = 0x80 | (c & 0x3f);
+    } else if (c >= 0xd800 && c < 0xdc00 && i + 1 < end &&
+               (source.charCodeAt(i + 1) & 0xfc00) === 0xdc00) {
+      c = 0x10000 + ((c - 0xd800) << 10) + (source.charCodeAt(++i) - 0xdc00);
+      bytes[length++] = 0xf0 | (c >> 18);
+      bytes[length++] = 0x80 | ((c >> 12) & 0x3f);
+      bytes[length++] = 0x80 | ((c >> 6) & 0x3f);
+      bytes[length++] = 0x80 | (c & 0x3f);
+    } else {
+      bytes[length++] = 0xe0 | (c >> 12);
+      bytes[length++] = 0x80 | ((c >> 6) & 0x3f);
+      bytes[length++] = 0x80 | (c & 0x3f);
+    }
+  }
+  return length;
+}
+
+// Mixes the token at source.substring(start, end) into block, and into
+// item unless it is null
+function hashToken(source, start, end, block, item) {
+  const length = end - start;
+  let i = start;
+  while (i < end && source.charCodeAt(i) < 0x80) i++;
+  if (i < end) {
+    hashEncoded(encodeHashBytes(source, start, end), block, item);
+    return;
+  }
+  
+  // ASCII text is its own UTF-8
+  for (i = start; i + 8 <= end; i += 8) {
+    const low = source.charCodeAt(i) | source.charCodeAt(i + 1) << 8 |
+                source.charCodeAt(i + 2) << 16 | source.charCodeAt(i + 3) << 24;
+    const high = source.charCodeAt(i + 4) | source.charCodeAt(i + 5) << 8 |
+                 source.charCodeAt(i + 6) << 16 | source.charCodeAt(i + 7) << 24;
+    hashWord(block, high, low);
+    if (item) hashWord(item, high, low);
+  }
+  
+  let low = 0;
+  let high = (length & 0xff) << 24;
+  for (let shift = 0; i < end; i++, shift += 8) {
+    if (shift < 32) low |= source.charCodeAt(i) << shift;
+    else high |= source.charCodeAt(i) << (shift - 32);
+  }
+  hashWord(block, high, low);
+  if (item) hashWord(item, high, low);
+}
+
+// hashToken for text that encodeHashBytes put into hashBytes
+function hashEncoded(length, block, item) {
+  const bytes = hashBytes;
+  let i = 0;
+  for (; i + 8 <= length; i += 8) {
+    const low = bytes[i] | bytes[i + 1] << 8 | bytes[i + 2] << 16 | bytes[i + 3] << 24;
+    const high = bytes[i + 4] | bytes[i + 5] << 8 | bytes[i + 6] << 16 | bytes[i + 7] << 24;
+    hashWord(block, high, low);
+    if (item) hashWord(item, high, low);
+  }
+  
+  let low = 0;
+  let high = (length & 0xff) << 24;
+  for (let shift = 0; i < length; i++, shift += 8) {
+    if (shift < 32) low |= bytes[i] << shift;
+    else high |= bytes[i] << (shift - 32);
+  }
+  hashWord(block, high, low);
+  if (item) hashWord(item, high, low);
+}
+
+const HEX_DIGITS = [];
+for (let i = 0; i < 16; i++) HEX_DIGITS.push(i.toString(16).charCodeAt(0));
+
+// 16 hex digits. Built in one fromCharCode call, as toString and padStart
+// make several strings for every entity.
+function hashHex(hash) {
+  const d = HEX_DIGITS;
+  const high = hash[0];
+  const low = hash[1];
+  return String.fromCharCode(
+    d[high >>> 28], d[(high >>> 24) & 15], d[(high >>> 20) & 15], d[(high >>> 16) & 15],
+    d[(high >>> 12) & 15], d[(high >>> 8) & 15], d[(high >>> 4) & 15], d[high & 15],
+    d[low >>> 28], d[(low >>> 24) & 15], d[(low >>> 20) & 15], d[(low >>> 16) & 15],
+    d[(low >>> 12) & 15], d[(low >>> 8) & 15], d[(low >>> 4) & 15], d[low & 15]);
+}
+
+// An empty story, with its sections in output order
+function createStoryData() {
+  return {
+    states: [],
+    'global-vars': [],
+    'linked-lists': [],
+    characters: [],
+    tags: [],
+    chapters: [],
+    groups: [],
+    nodes: []
+  };
+}
+
 class Parser {
-  constructor(tokens) {
+  constructor(tokens, onProgress = null) {
     this.tokens = tokens;
     this.current = 0;
     this.errorMessage = null;
+    this.onProgress = onProgress;
+    this.nextProgress = onProgress ? PROGRESS_TOKENS : Infinity;
+    
+    // Content hashes of the block and timeline item being parsed. Consumed
+    // tokens go into the first `hashing` of them.
+    this.blockHash = new Uint32Array(2);
+    this.itemHash = new Uint32Array(2);
+    this.hashing = 0;
   }
   
+  // Tokens are indices into this.tokens; read them through its types
+  // array and its value() and text() methods
   peek() {
-    return this.tokens[this.current];
+    return this.current;
   }
   
   previous() {
-    return this.tokens[this.current - 1];
+    return this.current - 1;
   }
   
   isAtEnd() {
-    return this.peek().type === TokenType.EOF;
+    return this.tokens.types[this.current] === TokenType.EOF;
   }
   
   advance() {
-    if (!this.isAtEnd()) this.current++;
+    if (!this.isAtEnd()) {
+      if (this.hashing) {
+        const tokens = this.tokens;
+        hashToken(tokens.source, tokens.starts[this.current], tokens.ends[this.current],
+                  this.blockHash, this.hashing === 2 ? this.itemHash : null);
+      }
+      this.current++;
+    }
     return this.previous();
   }
   
+  // Start hashing the tokens of a block (level 0) or timeline item (level 1)
+  hashBegin(level) {
+    const hash = level === 0 ? this.blockHash : this.itemHash;
+    hash[0] = HASH_BASIS_HIGH;
+    hash[1] = HASH_BASIS_LOW;
+    this.hashing = level + 1;
+  }
+  
   check(type) {
     if (this.isAtEnd()) return false;
-    return this.peek().type === type;
+    return this.tokens.types[this.current] === type;
   }
   
   match(type) {
@@ -509,7 +1017,8 @@ class Parser {
     if (this.errorMessage) return; // Keep first error
     
     const token = this.peek();
-    this.errorMessage = `Error at line ${token.line}, column ${token.column}: ${message} (got '${token.lexeme}')`;
+    this.errorMessage = `Error at line ${this.tokens.lines[token]}, column ${this.tokens.column(token)}: ` +
+                        `${message} (got '${this.tokens.text(token)}')`;
   }
   
   expect(type, message) {
@@ -530,7 +1039,7 @@ class Parser {
     while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
       if (this.check(TokenType.STRING)) {
         const token = this.advance();
-        states.push({ name: token.value });
+        states.push({ name: this.tokens.value(token) });
       } else {
         this.advance();
       }
@@ -551,7 +1060,7 @@ class Parser {
       if (this.check(TokenType.STRING)) {
         const nameToken = this.advance();
         const variable = {
-          name: nameToken.value,
+          name: this.tokens.value(nameToken),
           type: GlobalVarType.STRING,
           default: null
         };
@@ -564,7 +1073,7 @@ class Parser {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'type'")) return null;
             const typeToken = this.advance();
             
-            switch (typeToken.value) {
+            switch (this.tokens.value(typeToken)) {
               case 'string': variable.type = GlobalVarType.STRING; break;
               case 'int': variable.type = GlobalVarType.INT; break;
               case 'bool': variable.type = GlobalVarType.BOOL; break;
@@ -574,13 +1083,13 @@ class Parser {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'default'")) return null;
             const defaultToken = this.peek();
             
-            if (defaultToken.type === TokenType.STRING || 
-                defaultToken.type === TokenType.NUMBER ||
-                defaultToken.type === TokenType.FLOAT ||
-                defaultToken.type === TokenType.TRUE ||
-                defaultToken.type === TokenType.FALSE) {
+            if (this.tokens.types[defaultToken] === TokenType.STRING || 
+                this.tokens.types[defaultToken] === TokenType.NUMBER ||
+                this.tokens.types[defaultToken] === TokenType.FLOAT ||
+                this.tokens.types[defaultToken] === TokenType.TRUE ||
+                this.tokens.types[defaultToken] === TokenType.FALSE) {
               this.advance();
-              variable.default = defaultToken.value;
+              variable.default = this.tokens.value(defaultToken);
             } else {
               this.setError("Expected default value");
               return null;
@@ -615,7 +1124,7 @@ class Parser {
       if (this.check(TokenType.STRING)) {
         const nameToken = this.advance();
         const linkedList = {
-          name: nameToken.value,
+          name: this.tokens.value(nameToken),
           scope: null,
           structure: {}
         };
@@ -627,14 +1136,14 @@ class Parser {
           if (this.match(TokenType.SCOPE)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'scope'")) return null;
             const scopeToken = this.advance();
-            linkedList.scope = scopeToken.value;
+            linkedList.scope = this.tokens.value(scopeToken);
           } else if (this.match(TokenType.STRUCTURE)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'structure'")) return null;
             if (!this.expect(TokenType.LBRACE, "Expected '{' after 'structure:'")) return null;
             
             while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
               if (this.check(TokenType.IDENTIFIER)) {
-                const fieldName = this.advance().lexeme;
+                const fieldName = this.tokens.text(this.advance());
                 if (!this.expect(TokenType.COLON, "Expected ':' after field name")) return null;
                 if (!this.expect(TokenType.LBRACE, "Expected '{' after field name")) return null;
                 
@@ -644,7 +1153,7 @@ class Parser {
                   if (this.match(TokenType.TYPE)) {
                     if (!this.expect(TokenType.COLON, "Expected ':' after 'type'")) return null;
                     const typeToken = this.advance();
-                    field.type = typeToken.value;
+                    field.type = this.tokens.value(typeToken);
                   } else {
                     this.advance();
                   }
@@ -688,7 +1197,7 @@ class Parser {
       if (this.check(TokenType.STRING)) {
         const nameToken = this.advance();
         const character = {
-          name: nameToken.value,
+          name: this.tokens.value(nameToken),
           biography: '',
           description: '',
           'linked-list-data': {}
@@ -701,18 +1210,18 @@ class Parser {
           if (this.match(TokenType.BIOGRAPHY)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'biography'")) return null;
             const bioToken = this.advance();
-            character.biography = bioToken.value;
+            character.biography = this.tokens.value(bioToken);
           } else if (this.match(TokenType.DESCRIPTION)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'description'")) return null;
             const descToken = this.advance();
-            character.description = descToken.value;
+            character.description = this.tokens.value(descToken);
           } else if (this.match(TokenType.LINKED_LIST_DATA)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'linked-list-data'")) return null;
             if (!this.expect(TokenType.LBRACE, "Expected '{' after 'linked-list-data:'")) return null;
             
             while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
               if (this.check(TokenType.IDENTIFIER)) {
-                const listName = this.advance().lexeme;
+                const listName = this.tokens.text(this.advance());
                 if (!this.expect(TokenType.COLON, "Expected ':' after list name")) return null;
                 
                 if (this.check(TokenType.LBRACE)) {
@@ -772,14 +1281,14 @@ class Parser {
     
     while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
       if (this.check(TokenType.IDENTIFIER)) {
-        const key = this.advance().lexeme;
+        const key = this.tokens.text(this.advance());
         if (this.expect(TokenType.COLON, "Expected ':'")) {
           if (this.check(TokenType.NUMBER) || this.check(TokenType.FLOAT)) {
-            data[key] = this.advance().value;
+            data[key] = this.tokens.value(this.advance());
           } else if (this.check(TokenType.STRING)) {
-            data[key] = this.advance().value;
+            data[key] = this.tokens.value(this.advance());
           } else if (this.check(TokenType.TRUE) || this.check(TokenType.FALSE)) {
-            data[key] = this.advance().value;
+            data[key] = this.tokens.value(this.advance());
           }
         }
       } else {
@@ -794,7 +1303,7 @@ class Parser {
   parseTagDefinition() {
     const nameToken = this.advance();
     const tag = {
-      name: nameToken.value,
+      name: this.tokens.value(nameToken),
       type: TagType.SINGLE,
       color: null,
       keys: []
@@ -807,11 +1316,11 @@ class Parser {
       if (this.match(TokenType.TYPE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'type'")) return null;
         const typeToken = this.advance();
-        tag.type = typeToken.value === 'key-value' ? TagType.KEYVALUE : TagType.SINGLE;
+        tag.type = this.tokens.value(typeToken) === 'key-value' ? TagType.KEYVALUE : TagType.SINGLE;
       } else if (this.match(TokenType.COLOR)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'color'")) return null;
         const colorToken = this.advance();
-        tag.color = colorToken.value;
+        tag.color = this.tokens.value(colorToken);
       } else if (this.match(TokenType.KEYS)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'keys'")) return null;
         if (!this.expect(TokenType.LBRACKET, "Expected '[' after 'keys:'")) return null;
@@ -819,7 +1328,7 @@ class Parser {
         while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
           if (this.check(TokenType.STRING)) {
             const keyToken = this.advance();
-            tag.keys.push(keyToken.value);
+            tag.keys.push(this.tokens.value(keyToken));
           }
           if (this.check(TokenType.COMMA)) this.advance();
         }
@@ -858,18 +1367,16 @@ class Parser {
   }
   
   parseChapter() {
+    this.hashBegin(0);
     if (!this.expect(TokenType.CHAPTER, "Expected 'chapter'")) return null;
     
     const idToken = this.advance();
-    if (idToken.type !== TokenType.NUMBER) {
+    if (this.tokens.types[idToken] !== TokenType.NUMBER) {
       this.setError("Expected chapter number");
       return null;
     }
     
-    const chapter = {
-      id: idToken.value,
-      name: null
-    };
+    const chapter = new SdcChapter(this.tokens.value(idToken));
     
     if (!this.expect(TokenType.LBRACE, "Expected '{' after chapter number")) return null;
     
@@ -877,13 +1384,15 @@ class Parser {
       if (this.match(TokenType.NAME)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'name'")) return null;
         const nameToken = this.advance();
-        chapter.name = nameToken.value;
+        chapter.name = this.tokens.value(nameToken);
       } else {
         this.advance();
       }
     }
     
     if (!this.expect(TokenType.RBRACE, "Expected '}' after chapter")) return null;
+    chapter['content-hash'] = hashHex(this.blockHash);
+    this.hashing = 0;
     return chapter;
   }
   
@@ -895,11 +1404,7 @@ class Parser {
     while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
       if (this.check(TokenType.STRING)) {
         const tagName = this.advance();
-        const tag = {
-          'tag-name': tagName.value,
-          'selected-key': null,
-          value: null
-        };
+        const tag = new SdcGroupTag(this.tokens.value(tagName));
         
         if (this.match(TokenType.COLON)) {
           if (this.check(TokenType.LBRACE)) {
@@ -908,11 +1413,11 @@ class Parser {
             while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
               if (this.check(TokenType.STRING)) {
                 const key = this.advance();
-                tag['selected-key'] = key.value;
+                tag['selected-key'] = this.tokens.value(key);
                 
                 if (this.match(TokenType.COLON)) {
                   const value = this.advance();
-                  tag.value = value.value;
+                  tag.value = this.tokens.value(value);
                 }
               } else {
                 this.advance();
@@ -938,21 +1443,17 @@ class Parser {
   parseNodeGraph() {
     if (!this.expect(TokenType.LBRACE, "Expected '{' for nodes")) return null;
     
-    const graph = {
-      'start-node': 0,
-      'end-node': 0,
-      points: {}
-    };
+    const graph = new SdcNodeGraph();
     
     while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
       if (this.match(TokenType.START)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'start'")) return null;
         const num = this.advance();
-        graph['start-node'] = num.value;
+        graph['start-node'] = this.tokens.value(num);
       } else if (this.match(TokenType.END)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'end'")) return null;
         const num = this.advance();
-        graph['end-node'] = num.value;
+        graph['end-node'] = this.tokens.value(num);
       } else if (this.match(TokenType.POINTS)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'points'")) return null;
         if (!this.expect(TokenType.LBRACE, "Expected '{' after 'points:'")) return null;
@@ -968,12 +1469,12 @@ class Parser {
                 while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
                   if (this.check(TokenType.NUMBER)) {
                     const val = this.advance();
-                    values.push(val.value);
+                    values.push(this.tokens.value(val));
                   }
                   if (this.check(TokenType.COMMA)) this.advance();
                 }
                 
-                graph.points[key.value] = values;
+                graph.points[this.tokens.value(key)] = values;
                 this.expect(TokenType.RBRACKET, "Expected ']' after point values");
               }
             }
@@ -996,19 +1497,11 @@ class Parser {
   }
   
   parseGroup() {
+    this.hashBegin(0);
     if (!this.expect(TokenType.GROUP, "Expected 'group'")) return null;
     
     const idToken = this.advance();
-    const group = {
-      id: idToken.value,
-      'chapter-id': 0,
-      name: null,
-      content: null,
-      tags: [],
-      nodes: null,
-      'linked-lists': [],
-      'parent-group': null
-    };
+    const group = new SdcGroup(this.tokens.value(idToken));
     
     if (!this.expect(TokenType.LBRACE, "Expected '{' after group number")) return null;
     
@@ -1016,19 +1509,19 @@ class Parser {
       if (this.match(TokenType.CHAPTER)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'chapter'")) return null;
         const chapterToken = this.advance();
-        group['chapter-id'] = chapterToken.value;
+        group['chapter-id'] = this.tokens.value(chapterToken);
       } else if (this.match(TokenType.NAME)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'name'")) return null;
         const nameToken = this.advance();
-        group.name = nameToken.value;
+        group.name = this.tokens.value(nameToken);
       } else if (this.match(TokenType.CONTENT)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'content'")) return null;
         const contentToken = this.advance();
-        group.content = contentToken.value;
+        group.content = this.tokens.value(contentToken);
       } else if (this.match(TokenType.PARENT_GROUP)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'parentGroup'")) return null;
         const parentToken = this.advance();
-        group['parent-group'] = parentToken.value;
+        group['parent-group'] = this.tokens.value(parentToken);
       } else if (this.match(TokenType.TAGS)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'tags'")) return null;
         const tags = this.parseGroupTags();
@@ -1046,7 +1539,7 @@ class Parser {
         while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
           if (this.check(TokenType.STRING)) {
             const listName = this.advance();
-            group['linked-lists'].push(listName.value);
+            group['linked-lists'].push(this.tokens.value(listName));
           }
           if (this.check(TokenType.COMMA)) this.advance();
         }
@@ -1060,6 +1553,8 @@ class Parser {
     }
     
     if (!this.expect(TokenType.RBRACE, "Expected '}' after group")) return null;
+    group['content-hash'] = hashHex(this.blockHash);
+    this.hashing = 0;
     return group;
   }
   
@@ -1069,29 +1564,24 @@ class Parser {
     const timeline = [];
     
     while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
+      this.hashBegin(1);
+      
       if (this.match(TokenType.DIALOGUE)) {
         const num = this.advance();
         if (!this.expect(TokenType.LBRACE, "Expected '{' after dialogue")) return null;
         
-        const dialogue = {
-          type: TimelineItemType.DIALOGUE,
-          number: num.value,
-          lines: []
-        };
+        const dialogue = new SdcDialogue(this.tokens.value(num));
         
         while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
           const character = this.peek();
-          if (character.type === TokenType.IDENTIFIER) {
+          if (this.tokens.types[character] === TokenType.IDENTIFIER) {
             this.advance();
             if (!this.expect(TokenType.COLON, "Expected ':' after character")) return null;
             
             const text = this.peek();
-            if (text.type === TokenType.STRING) {
+            if (this.tokens.types[text] === TokenType.STRING) {
               this.advance();
-              dialogue.lines.push({
-                character: character.lexeme,
-                text: text.value
-              });
+              dialogue.lines.push(new SdcDialogueLine(this.tokens.text(character), this.tokens.value(text)));
             } else {
               this.setError("Expected dialogue text");
               return null;
@@ -1102,18 +1592,14 @@ class Parser {
         }
         
         if (!this.expect(TokenType.RBRACE, "Expected '}' after dialogue")) return null;
+        dialogue['content-hash'] = hashHex(this.itemHash);
         timeline.push(dialogue);
         
       } else if (this.match(TokenType.ACTION)) {
         const num = this.advance();
         if (!this.expect(TokenType.LBRACE, "Expected '{' after action")) return null;
         
-        const action = {
-          type: TimelineItemType.ACTION,
-          number: num.value,
-          'action-type': ActionType.CODE,
-          data: {}
-        };
+        const action = new SdcAction(this.tokens.value(num));
         
         let braceDepth = 1;
         while (braceDepth > 0 && !this.isAtEnd()) {
@@ -1121,11 +1607,12 @@ class Parser {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'type'")) return null;
             const typeToken = this.peek();
             
-            if (typeToken.type === TokenType.STRING) {
+            if (this.tokens.types[typeToken] === TokenType.STRING) {
               const next = this.advance();
 
-              if (typeToken.value === 'code') {
+              if (this.tokens.value(typeToken) === 'code') {
                 action['action-type'] = ActionType.CODE;
+                action.data = new SdcCodeData();
                 
                 while (braceDepth > 0 && !this.isAtEnd()) {
                   let tokenConsumed = false;
@@ -1134,7 +1621,7 @@ class Parser {
                   
                   if (this.check(TokenType.CODE_BLOCK)) {
                     const codeToken = this.advance();
-                    action.data.code = codeToken.value;
+                    action.data.code = this.tokens.value(codeToken);
                     tokenConsumed = true;
                   }
                   
@@ -1162,11 +1649,12 @@ class Parser {
                 }
                 
                 break;
-              } else if (typeToken.value === 'event') {
+              } else if (this.tokens.value(typeToken) === 'event') {
                 action['action-type'] = ActionType.EVENT;
-                action.data['event-type'] = EventType.UNKNOWN;
-              } else if (typeToken.value === 'choice') {
+                action.data = new SdcEvent(EventType.UNKNOWN);
+              } else if (this.tokens.value(typeToken) === 'choice') {
                 action['action-type'] = ActionType.CHOICE;
+                action.data = new SdcChoiceData();
               }
             } else {
               this.advance();
@@ -1190,12 +1678,12 @@ class Parser {
             if (!this.expect(TokenType.RPAREN, "Expected ')' after reference id")) return null;
             
             action['action-type'] = ActionType.GOTO;
-            action.data['target-node'] = refId.value;
+            action.data = new SdcGotoData(this.tokens.value(refId));
           } else if (this.match(TokenType.EXIT)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'exit'")) return null;
             const target = this.advance();
             action['action-type'] = ActionType.EXIT;
-            action.data.target = target.value;
+            action.data = new SdcExitData(this.tokens.value(target));
           } else if (this.match(TokenType.ENTER)) {
             if (!this.expect(TokenType.COLON, "Expected ':' after 'enter'")) return null;
             if (!this.expect(TokenType.AT, "Expected '@' for reference")) return null;
@@ -1206,7 +1694,7 @@ class Parser {
             if (!this.expect(TokenType.RPAREN, "Expected ')' after reference id")) return null;
             
             action['action-type'] = ActionType.ENTER;
-            action.data['target-group'] = refId.value;
+            action.data = new SdcEnterData(this.tokens.value(refId));
           } else {
             if (this.check(TokenType.LBRACE)) braceDepth++;
             if (this.check(TokenType.RBRACE)) {
@@ -1218,94 +1706,95 @@ class Parser {
         }
         
         if (!this.expect(TokenType.RBRACE, "Expected '}' after action")) return null;
+        action['content-hash'] = hashHex(this.itemHash);
         timeline.push(action);
       } else {
         this.advance();
       }
+      this.hashing = 1;
     }
     
     if (!this.expect(TokenType.RBRACE, "Expected '}' after timeline")) return null;
     return timeline;
   }
   
+  // The fields are collected first and the data built at the end, as
+  // the class depends on the type, which may come after them
   parseEventData() {
-    const data = { 'event-type': EventType.UNKNOWN };
+    let eventType = EventType.UNKNOWN;
+    let name = null;
+    let value = null;
+    let increment = null;
+    let isToggle = false;
+    let character = null;
+    let reference = null;
+    let values = [];
+    let chapterId = null;
+    let groupId = null;
+    let nodeId = null;
     
     while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
       if (this.match(TokenType.TYPE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'type'")) return null;
-        const eventType = this.advance();
+        const typeToken = this.advance();
         
-        if (eventType.type === TokenType.STRING) {
-          switch (eventType.value) {
+        if (this.tokens.types[typeToken] === TokenType.STRING) {
+          switch (this.tokens.value(typeToken)) {
             case 'next-node':
-              data['event-type'] = EventType.NEXT_NODE;
+              eventType = EventType.NEXT_NODE;
               break;
             case 'exit-current-node':
-              data['event-type'] = EventType.EXIT_CURRENT_NODE;
+              eventType = EventType.EXIT_CURRENT_NODE;
               break;
             case 'exit-current-group':
-              data['event-type'] = EventType.EXIT_CURRENT_GROUP;
+              eventType = EventType.EXIT_CURRENT_GROUP;
               break;
             case 'adjust-variable':
-              data['event-type'] = EventType.ADJUST_VARIABLE;
-              data.name = null;
-              data.value = null;
-              data.increment = null;
-              data['is-toggle'] = false;
+              eventType = EventType.ADJUST_VARIABLE;
               break;
             case 'add-state':
-              data['event-type'] = EventType.ADD_STATE;
-              data.name = null;
-              data.character = null;
+              eventType = EventType.ADD_STATE;
               break;
             case 'remove-state':
-              data['event-type'] = EventType.REMOVE_STATE;
-              data.name = null;
-              data.character = null;
+              eventType = EventType.REMOVE_STATE;
               break;
             case 'progress-story':
-              data['event-type'] = EventType.PROGRESS_STORY;
-              data['chapter-id'] = null;
-              data['group-id'] = null;
-              data['node-id'] = null;
+              eventType = EventType.PROGRESS_STORY;
               break;
             case 'linked-list':
-              data['event-type'] = EventType.LINKED_LIST;
-              data.reference = null;
-              data.values = [];
+              eventType = EventType.LINKED_LIST;
               break;
           }
         }
       } else if (this.match(TokenType.NAME)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'name'")) return null;
-        const name = this.advance();
-        data.name = name.value;
+        const nameToken = this.advance();
+        name = this.tokens.value(nameToken);
       } else if (this.match(TokenType.INCREMENT)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'increment'")) return null;
         const inc = this.advance();
-        data.increment = inc.value;
+        increment = this.tokens.value(inc);
       } else if (this.match(TokenType.VALUE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'value'")) return null;
         const val = this.advance();
-        data.value = val.value;
+        value = this.tokens.value(val);
       } else if (this.match(TokenType.TOGGLE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'toggle'")) return null;
         const tog = this.advance();
-        data['is-toggle'] = (tog.value === 'toggle');
+        isToggle = (this.tokens.value(tog) === 'toggle');
       } else if (this.match(TokenType.CHARACTER)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'character'")) return null;
         const chr = this.advance();
-        data.character = chr.value;
+        character = this.tokens.value(chr);
       } else if (this.match(TokenType.REFERENCE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'reference'")) return null;
         const ref = this.advance();
-        data.reference = ref.value;
+        reference = this.tokens.value(ref);
       } else if (this.match(TokenType.VALUES)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'values'")) return null;
         if (!this.expect(TokenType.LBRACKET, "Expected '['")) return null;
         
-        data.values = [];
+        values = [];
         
         while (!this.check(TokenType.RBRACKET) && !this.isAtEnd()) {
           if (this.check(TokenType.STRING)) {
@@ -1313,24 +1802,24 @@ class Parser {
             if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
             if (!this.expect(TokenType.LBRACE, "Expected '{'")) return null;
             
-            const modification = { field: fieldName.value };
+            const modification = new SdcListModification(this.tokens.value(fieldName));
             
             while (!this.check(TokenType.RBRACE) && !this.isAtEnd()) {
               if (this.match(TokenType.AMOUNT)) {
                 if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
-                modification.amount = this.advance().value;
+                modification.amount = this.tokens.value(this.advance());
               } else if (this.match(TokenType.SET)) {
                 if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
-                modification.set = this.advance().value;
+                modification.set = this.tokens.value(this.advance());
               } else if (this.match(TokenType.APPEND)) {
                 if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
-                modification.append = this.advance().value;
+                modification.append = this.tokens.value(this.advance());
               } else if (this.match(TokenType.REPLACE)) {
                 if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
-                modification.replace = this.advance().value;
+                modification.replace = this.tokens.value(this.advance());
               } else if (this.match(TokenType.TOGGLE)) {
                 if (!this.expect(TokenType.COLON, "Expected ':'")) return null;
-                modification.toggle = this.advance().value;
+                modification.toggle = this.tokens.value(this.advance());
               } else {
                 this.advance();
               }
@@ -1338,7 +1827,7 @@ class Parser {
             }
             
             if (!this.expect(TokenType.RBRACE, "Expected '}'")) return null;
-            data.values.push(modification);
+            values.push(modification);
           } else {
             this.advance();
           }
@@ -1353,7 +1842,7 @@ class Parser {
         if (!this.expect(TokenType.LPAREN, "Expected '(' after reference type")) return null;
         const refId = this.advance();
         if (!this.expect(TokenType.RPAREN, "Expected ')' after reference id")) return null;
-        data['chapter-id'] = refId.value;
+        chapterId = this.tokens.value(refId);
       } else if (this.match(TokenType.GROUP)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'group'")) return null;
         if (!this.expect(TokenType.AT, "Expected '@' for group reference")) return null;
@@ -1361,7 +1850,7 @@ class Parser {
         if (!this.expect(TokenType.LPAREN, "Expected '(' after reference type")) return null;
         const refId = this.advance();
         if (!this.expect(TokenType.RPAREN, "Expected ')' after reference id")) return null;
-        data['group-id'] = refId.value;
+        groupId = this.tokens.value(refId);
       } else if (this.match(TokenType.NODE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'node'")) return null;
         if (!this.expect(TokenType.AT, "Expected '@' for node reference")) return null;
@@ -1369,7 +1858,7 @@ class Parser {
         if (!this.expect(TokenType.LPAREN, "Expected '(' after reference type")) return null;
         const refId = this.advance();
         if (!this.expect(TokenType.RPAREN, "Expected ')' after reference id")) return null;
-        data['node-id'] = refId.value;
+        nodeId = this.tokens.value(refId);
       } else {
         this.advance();
       }
@@ -1377,19 +1866,27 @@ class Parser {
       if (this.check(TokenType.COMMA)) this.advance();
     }
     
-    return data;
+    switch (eventType) {
+      case EventType.ADJUST_VARIABLE:
+        return new SdcAdjustVariableEvent(name, value, increment, isToggle);
+      case EventType.ADD_STATE:
+      case EventType.REMOVE_STATE:
+        return new SdcStateEvent(eventType, name, character);
+      case EventType.PROGRESS_STORY:
+        return new SdcProgressStoryEvent(chapterId, groupId, nodeId);
+      case EventType.LINKED_LIST:
+        return new SdcLinkedListEvent(reference, values);
+      default:
+        return new SdcEvent(eventType);
+    }
   }
   
   parseNode() {
+    this.hashBegin(0);
     if (!this.expect(TokenType.NODE, "Expected 'node'")) return null;
     
     const idToken = this.advance();
-    const node = {
-      id: idToken.value,
-      title: null,
-      content: null,
-      timeline: []
-    };
+    const node = new SdcNode(this.tokens.value(idToken));
     
     if (!this.expect(TokenType.LBRACE, "Expected '{' after node number")) return null;
     
@@ -1397,11 +1894,11 @@ class Parser {
       if (this.match(TokenType.TITLE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'title'")) return null;
         const titleToken = this.advance();
-        node.title = titleToken.value;
+        node.title = this.tokens.value(titleToken);
       } else if (this.match(TokenType.CONTENT)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'content'")) return null;
         const contentToken = this.advance();
-        node.content = contentToken.value;
+        node.content = this.tokens.value(contentToken);
       } else if (this.match(TokenType.TIMELINE)) {
         if (!this.expect(TokenType.COLON, "Expected ':' after 'timeline'")) return null;
         const timeline = this.parseTimeline();
@@ -1413,22 +1910,20 @@ class Parser {
     }
     
     if (!this.expect(TokenType.RBRACE, "Expected '}' after node")) return null;
+    node['content-hash'] = hashHex(this.blockHash);
+    this.hashing = 0;
     return node;
   }
   
-  parse() {
-    const storyData = {
-      states: [],
-      'global-vars': [],
-      'linked-lists': [],
-      characters: [],
-      tags: [],
-      chapters: [],
-      groups: [],
-      nodes: []
-    };
-    
+  // Adds the declarations of the tokens to storyData, which may already
+  // hold those of an earlier part of the source
+  parse(storyData = createStoryData()) {
     while (!this.isAtEnd()) {
+      if (this.current >= this.nextProgress) {
+        this.nextProgress = this.current + PROGRESS_TOKENS;
+        this.onProgress('parse', this.current, this.tokens.count);
+      }
+      
       if (this.check(TokenType.STATES)) {
         const states = this.parseStates();
         if (!states) return null;
@@ -1470,6 +1965,766 @@ class Parser {
   }
 }
 
+// ============================================================================
+// BINARY STORY
+// ============================================================================
+
+// A parsed story in one buffer, the image that toBinary() writes and
+// loadBinary() opens. parseAsync also returns large stories in this form,
+// as the buffer is transferred out of the worker rather than copied.
+// BinaryStory decodes fields only as they are read. All values are
+// little-endian, and tables and records are fixed in size, so any field
+// can be found without reading the ones before it:
+//
+//   header    'SDCB', version, then [offset, count] of each table below
+//   doubles   numbers that are not int32
+//   hashes    content hashes as [high, low]
+//   sections  one slot each for states, global-vars, linked-lists,
+//             characters and tags
+//   chapters, groups, nodes, items, lines   records of slots
+//   strings   count + 1 byte offsets, then the UTF-8 text they point into
+//
+// A slot is [kind, payload]: null, false, true, an int32, or the index of
+// a string, double or hash. Values without a fixed shape (the sections,
+// group tags, graphs and linked lists, and action data) are JSON strings.
+const BINARY_MAGIC = 0x42434453;  // "SDCB"
+const BINARY_VERSION = 1;
+
+const SlotKind = { NULL: 0, FALSE: 1, TRUE: 2, INT: 3, DOUBLE: 4, STRING: 5, HASH: 6, JSON: 7 };
+
+// Tables in header order
+const BinaryTable = {
+  DOUBLES: 0, HASHES: 1, SECTIONS: 2, CHAPTERS: 3, GROUPS: 4, NODES: 5, ITEMS: 6, LINES: 7, STRINGS: 8
+};
+const BINARY_TABLE_COUNT = 9;
+const BINARY_HEADER_SIZE = 8 + BINARY_TABLE_COUNT * 8;
+
+// Record sizes in slots. Groups and chapters hold their fields in model
+// order. Nodes end with [first item, item count]. Items start with
+// [type, 0], number and content-hash; dialogues then have [first line,
+// line count], actions action-type and data. Lines are character, text.
+const SECTION_KEYS = ['states', 'global-vars', 'linked-lists', 'characters', 'tags'];
+const CHAPTER_SLOTS = 3;
+const GROUP_SLOTS = 9;
+const NODE_SLOTS = 5;
+const ITEM_SLOTS = 5;
+const LINE_SLOTS = 2;
+
+const ITEM_DIALOGUE = 0;
+const ITEM_ACTION = 1;
+
+class BinaryStoryWriter {
+  constructor(shared = false) {
+    this.shared = shared;
+    this.strings = new Map();
+    this.stringLength = 0;
+    this.doubles = [];
+    this.hashes = [];
+    
+    // Records as u32 words, two per slot, indexed by BinaryTable
+    this.tables = [null, null, [], [], [], [], [], []];
+  }
+  
+  string(text) {
+    let index = this.strings.get(text);
+    if (index === undefined) {
+      index = this.strings.size;
+      this.strings.set(text, index);
+      this.stringLength += text.length;
+    }
+    return index;
+  }
+  
+  slot(words, value) {
+    if (value === null || value === undefined) {
+      words.push(SlotKind.NULL, 0);
+    } else if (value === false) {
+      words.push(SlotKind.FALSE, 0);
+    } else if (value === true) {
+      words.push(SlotKind.TRUE, 0);
+    } else if (typeof value === 'number') {
+      if ((value | 0) === value && !Object.is(value, -0)) {
+        words.push(SlotKind.INT, value >>> 0);
+      } else {
+        words.push(SlotKind.DOUBLE, this.doubles.length);
+        this.doubles.push(value);
+      }
+    } else if (typeof value === 'string') {
+      words.push(SlotKind.STRING, this.string(value));
+    } else {
+      words.push(SlotKind.JSON, this.string(JSON.stringify(value)));
+    }
+  }
+  
+  hashSlot(words, hash) {
+    if (hash === null) {
+      words.push(SlotKind.NULL, 0);
+      return;
+    }
+    words.push(SlotKind.HASH, this.hashes.length >> 1);
+    this.hashes.push(parseInt(hash.substring(0, 8), 16), parseInt(hash.substring(8), 16));
+  }
+  
+  write(storyData) {
+    const [, , sections, chapters, groups, nodes, items, lines] = this.tables;
+    
+    for (const key of SECTION_KEYS) this.slot(sections, storyData[key]);
+    
+    for (const chapter of storyData.chapters) {
+      this.slot(chapters, chapter.id);
+      this.slot(chapters, chapter.name);
+      this.hashSlot(chapters, chapter['content-hash']);
+    }
+    
+    for (const group of storyData.groups) {
+      this.slot(groups, group.id);
+      this.slot(groups, group['chapter-id']);
+      this.slot(groups, group.name);
+      this.slot(groups, group.content);
+      this.slot(groups, group.tags);
+      this.slot(groups, group.nodes);
+      this.slot(groups, group['linked-lists']);
+      this.slot(groups, group['parent-group']);
+      this.hashSlot(groups, group['content-hash']);
+    }
+    
+    for (const node of storyData.nodes) {
+      this.slot(nodes, node.id);
+      this.slot(nodes, node.title);
+      this.slot(nodes, node.content);
+      this.hashSlot(nodes, node['content-hash']);
+      nodes.push(items.length / (ITEM_SLOTS * 2), node.timeline.length);
+      
+      for (const item of node.timeline) {
+        const isAction = item.type === TimelineItemType.ACTION;
+        items.push(isAction ? ITEM_ACTION : ITEM_DIALOGUE, 0);
+        this.slot(items, item.number);
+        this.hashSlot(items, item['content-hash']);
+        
+        if (isAction) {
+          this.slot(items, item['action-type']);
+          this.slot(items, item.data);
+        } else {
+          items.push(lines.length / (LINE_SLOTS * 2), item.lines.length, SlotKind.NULL, 0);
+          for (const line of item.lines) {
+            this.slot(lines, line.character);
+            this.slot(lines, line.text);
+          }
+        }
+      }
+    }
+    
+    return this.finish();
+  }
+  
+  // Lays the tables out in one buffer, each 8-byte aligned
+  finish() {
+    const sizes = this.tables.map(words => words ? words.length * 4 : 0);
+    sizes[BinaryTable.DOUBLES] = this.doubles.length * 8;
+    sizes[BinaryTable.HASHES] = this.hashes.length * 4;
+    sizes[BinaryTable.STRINGS] = (this.strings.size + 1) * 4;
+    
+    // Strings are encoded first, as their length in bytes is not known
+    const text = new Uint8Array(this.stringLength * 3);
+    const stringOffsets = new Uint32Array(this.strings.size + 1);
+    const encoder = new TextEncoder();
+    let textLength = 0;
+    let index = 0;
+    for (const string of this.strings.keys()) {
+      stringOffsets[index++] = textLength;
+      textLength += encoder.encodeInto(string, text.subarray(textLength)).written;
+    }
+    stringOffsets[index] = textLength;
+    
+    const offsets = [];
+    let size = BINARY_HEADER_SIZE;
+    for (const tableSize of sizes) {
+      offsets.push(size);
+      size += (tableSize + 7) & ~7;
+    }
+    
+    const buffer = this.shared ? new SharedArrayBuffer(size + textLength) : new ArrayBuffer(size + textLength);
+    const view = new DataView(buffer);
+    view.setUint32(0, BINARY_MAGIC, true);
+    view.setUint32(4, BINARY_VERSION, true);
+    
+    const counts = [
+      this.doubles.length, this.hashes.length >> 1, SECTION_KEYS.length,
+      this.tables[BinaryTable.CHAPTERS].length / (CHAPTER_SLOTS * 2),
+      this.tables[BinaryTable.GROUPS].length / (GROUP_SLOTS * 2),
+      this.tables[BinaryTable.NODES].length / (NODE_SLOTS * 2),
+      this.tables[BinaryTable.ITEMS].length / (ITEM_SLOTS * 2),
+      this.tables[BinaryTable.LINES].length / (LINE_SLOTS * 2),
+      this.strings.size
+    ];
+    for (let table = 0; table < BINARY_TABLE_COUNT; table++) {
+      view.setUint32(8 + table * 8, offsets[table], true);
+      view.setUint32(12 + table * 8, counts[table], true);
+    }
+    
+    this.doubles.forEach((value, i) => view.setFloat64(offsets[BinaryTable.DOUBLES] + i * 8, value, true));
+    const writeWords = (words, offset) => {
+      for (let i = 0; i < words.length; i++) view.setUint32(offset + i * 4, words[i], true);
+    };
+    writeWords(this.hashes, offsets[BinaryTable.HASHES]);
+    for (let table = BinaryTable.SECTIONS; table <= BinaryTable.LINES; table++) {
+      writeWords(this.tables[table], offsets[table]);
+    }
+    writeWords(stringOffsets, offsets[BinaryTable.STRINGS]);
+    new Uint8Array(buffer, size).set(text.subarray(0, textLength));
+    
+    return buffer;
+  }
+}
+
+/**
+ * Encode a parsed story into a binary story buffer
+ * @param {object} storyData
+ * @param {boolean} [shared] - Build it in a SharedArrayBuffer
+ * @returns {ArrayBuffer|SharedArrayBuffer}
+ */
+function encodeBinaryStory(storyData, shared = false) {
+  return new BinaryStoryWriter(shared).write(storyData);
+}
+
+// Bytes per record of each table, in header order; strings have count + 1
+// offsets
+const BINARY_RECORD_SIZES = [8, 8, 8, CHAPTER_SLOTS * 8, GROUP_SLOTS * 8, NODE_SLOTS * 8, ITEM_SLOTS * 8, LINE_SLOTS * 8, 4];
+
+// Reads slots out of a binary story. Each string is decoded the first
+// time it is read and kept.
+class BinaryStoryReader {
+  constructor(data) {
+    const buffer = ArrayBuffer.isView(data) ? data.buffer : data;
+    const byteOffset = ArrayBuffer.isView(data) ? data.byteOffset : 0;
+    this.view = new DataView(buffer, byteOffset, data.byteLength);
+    this.bytes = new Uint8Array(buffer, byteOffset, data.byteLength);
+    if (data.byteLength < BINARY_HEADER_SIZE || this.u32(0) !== BINARY_MAGIC) {
+      throw new Error('Not a binary SDC story');
+    }
+    if (this.u32(4) !== BINARY_VERSION) {
+      throw new Error(`Unsupported binary SDC story version ${this.u32(4)}`);
+    }
+    
+    this.offsets = [];
+    this.counts = [];
+    for (let table = 0; table < BINARY_TABLE_COUNT; table++) {
+      this.offsets.push(this.u32(8 + table * 8));
+      this.counts.push(this.u32(12 + table * 8));
+    }
+    
+    const stringCount = this.counts[BinaryTable.STRINGS];
+    this.textStart = this.offsets[BinaryTable.STRINGS] + (((stringCount + 1) * 4 + 7) & ~7);
+    this.stringCache = new Array(stringCount);
+    this.decoder = new TextDecoder();
+    
+    // TextDecoder does not take views of shared memory, so strings in a
+    // SharedArrayBuffer are copied out before decoding
+    this.shared = typeof SharedArrayBuffer !== 'undefined' && buffer instanceof SharedArrayBuffer;
+    
+    // Slots are not checked as they are read, but every table has to lie
+    // within the buffer
+    const length = data.byteLength;
+    const fits = (offset, size) => offset <= length && size <= length - offset;
+    let valid = this.counts[BinaryTable.SECTIONS] === SECTION_KEYS.length &&
+                this.textStart <= length;
+    for (let table = 0; valid && table < BINARY_TABLE_COUNT; table++) {
+      const count = this.counts[table] + (table === BinaryTable.STRINGS ? 1 : 0);
+      valid = fits(this.offsets[table], count * BINARY_RECORD_SIZES[table]);
+    }
+    if (!valid || !fits(this.textStart, this.u32(this.offsets[BinaryTable.STRINGS] + stringCount * 4))) {
+      throw new Error('Damaged binary SDC story');
+    }
+  }
+  
+  u32(offset) {
+    return this.view.getUint32(offset, true);
+  }
+  
+  // Byte offset of record index of a table whose records are slots long
+  record(table, index, slots) {
+    return this.offsets[table] + index * slots * 8;
+  }
+  
+  string(index) {
+    let string = this.stringCache[index];
+    if (string === undefined) {
+      const offsets = this.offsets[BinaryTable.STRINGS] + index * 4;
+      const bytes = this.bytes.subarray(this.textStart + this.u32(offsets), this.textStart + this.u32(offsets + 4));
+      string = this.decoder.decode(this.shared ? bytes.slice() : bytes);
+      this.stringCache[index] = string;
+    }
+    return string;
+  }
+  
+  // Value of the slot at offset. JSON values are parsed anew on each read.
+  value(offset) {
+    const payload = this.u32(offset + 4);
+    switch (this.u32(offset)) {
+      case SlotKind.FALSE: return false;
+      case SlotKind.TRUE: return true;
+      case SlotKind.INT: return payload | 0;
+      case SlotKind.DOUBLE: return this.view.getFloat64(this.offsets[BinaryTable.DOUBLES] + payload * 8, true);
+      case SlotKind.STRING: return this.string(payload);
+      case SlotKind.JSON: return JSON.parse(this.string(payload));
+      case SlotKind.HASH: {
+        const hash = this.offsets[BinaryTable.HASHES] + payload * 8;
+        return hashHex([this.u32(hash), this.u32(hash + 4)]);
+      }
+      default: return null;
+    }
+  }
+}
+
+const BINARY_READER = Symbol('reader');
+const BINARY_OFFSET = Symbol('offset');
+const BINARY_CACHE = Symbol('cache');
+
+const inspectSymbol = Symbol.for('nodejs.util.inspect.custom');
+
+// Records of a binary story. Fields are getters, so a record holds only
+// its reader and offset; toJSON() copies them into a plain object, and
+// Node prints a record as the model object it stands for.
+class BinaryRecord {
+  constructor(reader, offset) {
+    this[BINARY_READER] = reader;
+    this[BINARY_OFFSET] = offset;
+    this[BINARY_CACHE] = null;
+  }
+  
+  slot(index) {
+    return this[BINARY_READER].value(this[BINARY_OFFSET] + index * 8);
+  }
+  
+  // [first, count] stored in place of a slot
+  range(index) {
+    const reader = this[BINARY_READER];
+    const offset = this[BINARY_OFFSET] + index * 8;
+    return [reader.u32(offset), reader.u32(offset + 4)];
+  }
+  
+  // Arrays and objects decoded from the buffer are kept for later reads
+  cached(key, build) {
+    if (!this[BINARY_CACHE]) this[BINARY_CACHE] = {};
+    if (!(key in this[BINARY_CACHE])) this[BINARY_CACHE][key] = build();
+    return this[BINARY_CACHE][key];
+  }
+  
+  toJSON() {
+    const result = {};
+    for (const key of this.constructor.keys) result[key] = this[key];
+    return result;
+  }
+  
+  [inspectSymbol]() {
+    return Object.assign(Object.create(this.constructor.model.prototype), this.toJSON());
+  }
+}
+
+// Records first to first + count - 1 of a table
+function binaryRecords(reader, RecordClass, table, slots, first, count) {
+  const records = new Array(count);
+  for (let i = 0; i < count; i++) {
+    records[i] = new RecordClass(reader, reader.record(table, first + i, slots));
+  }
+  return records;
+}
+
+class BinaryChapter extends BinaryRecord {
+  static keys = Object.keys(new SdcChapter(0));
+  static model = SdcChapter;
+  
+  get id() { return this.slot(0); }
+  get name() { return this.slot(1); }
+  get ['content-hash']() { return this.slot(2); }
+}
+
+class BinaryGroup extends BinaryRecord {
+  static keys = Object.keys(new SdcGroup(0));
+  static model = SdcGroup;
+  
+  get id() { return this.slot(0); }
+  get ['chapter-id']() { return this.slot(1); }
+  get name() { return this.slot(2); }
+  get content() { return this.slot(3); }
+  
+  get tags() {
+    return this.cached('tags', () => this.slot(4).map(tag => Object.assign(new SdcGroupTag(null), tag)));
+  }
+  
+  get nodes() {
+    return this.cached('nodes', () => {
+      const graph = this.slot(5);
+      return graph && Object.assign(new SdcNodeGraph(), graph);
+    });
+  }
+  
+  get ['linked-lists']() {
+    return this.cached('linked-lists', () => this.slot(6));
+  }
+  
+  get ['parent-group']() { return this.slot(7); }
+  get ['content-hash']() { return this.slot(8); }
+}
+
+class BinaryNode extends BinaryRecord {
+  static keys = Object.keys(new SdcNode(0));
+  static model = SdcNode;
+  
+  get id() { return this.slot(0); }
+  get title() { return this.slot(1); }
+  get content() { return this.slot(2); }
+  
+  get timeline() {
+    return this.cached('timeline', () => {
+      const reader = this[BINARY_READER];
+      const [first, count] = this.range(4);
+      const timeline = new Array(count);
+      for (let i = 0; i < count; i++) {
+        const offset = reader.record(BinaryTable.ITEMS, first + i, ITEM_SLOTS);
+        timeline[i] = reader.u32(offset) === ITEM_ACTION
+          ? new BinaryAction(reader, offset)
+          : new BinaryDialogue(reader, offset);
+      }
+      return timeline;
+    });
+  }
+  
+  get ['content-hash']() { return this.slot(3); }
+}
+
+class BinaryDialogue extends BinaryRecord {
+  static keys = Object.keys(new SdcDialogue(0));
+  static model = SdcDialogue;
+  
+  get type() { return TimelineItemType.DIALOGUE; }
+  get number() { return this.slot(1); }
+  
+  get lines() {
+    return this.cached('lines', () => {
+      const reader = this[BINARY_READER];
+      const [first, count] = this.range(3);
+      const lines = new Array(count);
+      for (let i = 0; i < count; i++) {
+        const offset = reader.record(BinaryTable.LINES, first + i, LINE_SLOTS);
+        lines[i] = new SdcDialogueLine(reader.value(offset), reader.value(offset + 8));
+      }
+      return lines;
+    });
+  }
+  
+  get ['content-hash']() { return this.slot(2); }
+}
+
+class BinaryAction extends BinaryRecord {
+  static keys = Object.keys(new SdcAction(0));
+  static model = SdcAction;
+  
+  get type() { return TimelineItemType.ACTION; }
+  get number() { return this.slot(1); }
+  get ['action-type']() { return this.slot(3); }
+  
+  // Rebuilt as the data class of its action and event type, with its
+  // list modifications
+  get data() {
+    return this.cached('data', () => {
+      const fields = this.slot(4);
+      const data = Object.assign(createActionData(this['action-type'], fields['event-type']), fields);
+      if (data.values) {
+        data.values = data.values.map(change => Object.assign(new SdcListModification(change.field), change));
+      }
+      return data;
+    });
+  }
+  
+  get ['content-hash']() { return this.slot(2); }
+}
+
+/**
+ * A story read from a binary story buffer, with the keys and values of
+ * the StoryData that SDCParser.parse returns. The section tables are
+ * decoded the first time they are read; chapters, groups and nodes are
+ * records whose fields are decoded on access.
+ * @param {ArrayBuffer|SharedArrayBuffer|ArrayBufferView} buffer - The
+ *   image, or a view of it such as a Node Buffer
+ */
+class BinaryStory {
+  constructor(buffer) {
+    this[BINARY_READER] = new BinaryStoryReader(buffer);
+    this[BINARY_CACHE] = {};
+  }
+  
+  // The bytes of the image, to save or to post to another worker
+  get buffer() {
+    return this[BINARY_READER].bytes;
+  }
+  
+  cached(key, build) {
+    if (!(key in this[BINARY_CACHE])) this[BINARY_CACHE][key] = build();
+    return this[BINARY_CACHE][key];
+  }
+  
+  section(index) {
+    return this.cached(SECTION_KEYS[index], () => {
+      const reader = this[BINARY_READER];
+      return reader.value(reader.record(BinaryTable.SECTIONS, index, 1));
+    });
+  }
+  
+  records(RecordClass, table, slots) {
+    return this.cached(table, () => {
+      const reader = this[BINARY_READER];
+      return binaryRecords(reader, RecordClass, table, slots, 0, reader.counts[table]);
+    });
+  }
+  
+  get states() { return this.section(0); }
+  get ['global-vars']() { return this.section(1); }
+  get ['linked-lists']() { return this.section(2); }
+  get characters() { return this.section(3); }
+  get tags() { return this.section(4); }
+  get chapters() { return this.records(BinaryChapter, BinaryTable.CHAPTERS, CHAPTER_SLOTS); }
+  get groups() { return this.records(BinaryGroup, BinaryTable.GROUPS, GROUP_SLOTS); }
+  get nodes() { return this.records(BinaryNode, BinaryTable.NODES, NODE_SLOTS); }
+  
+  toJSON() {
+    return {
+      states: this.states,
+      'global-vars': this['global-vars'],
+      'linked-lists': this['linked-lists'],
+      characters: this.characters,
+      tags: this.tags,
+      chapters: this.chapters,
+      groups: this.groups,
+      nodes: this.nodes
+    };
+  }
+  
+  [inspectSymbol]() {
+    return this.toJSON();
+  }
+}
+
+// ============================================================================
+// WORKERS
+// ============================================================================
+
+// parseAsync runs this same file as its worker. A browser worker is
+// started from the script's own URL with WORKER_HASH appended, so a page
+// that loads the parser into a worker of its own is not taken over.
+const WORKER_HASH = '#sdc-parse-worker';
+const SCRIPT_URL = typeof document !== 'undefined' && document.currentScript ? document.currentScript.src : null;
+const IS_NODE = typeof process !== 'undefined' && !!(process.versions && process.versions.node);
+
+// Sources at least this long come back from parseAsync as a binary story.
+// A structured clone is rebuilt object by object on the calling thread
+// when it is received, which for a large story is the pause parseAsync
+// is meant to avoid; a transferred buffer costs nothing to receive.
+const BINARY_TRANSFER_THRESHOLD = 1 << 20;
+
+// A worker running this file, on Node through worker_threads
+function startParseWorker(workerUrl, onMessage, onError) {
+  if (IS_NODE) {
+    const { Worker } = require('worker_threads');
+    const worker = new Worker(__filename, { workerData: { sdcParseWorker: true } });
+    worker.on('message', onMessage);
+    worker.on('error', onError);
+    return worker;
+  }
+  
+  const url = workerUrl || SCRIPT_URL;
+  if (!url) throw new Error('parseAsync needs options.workerUrl: the URL of sdc_parser.js');
+  const worker = new Worker(String(url).split('#')[0] + WORKER_HASH);
+  worker.onmessage = event => onMessage(event.data);
+  worker.onerror = onError;
+  return worker;
+}
+
+// Handles one request from parseAsync inside the worker
+function serveParseRequest(request, post) {
+  const parser = new SDCParser();
+  const onProgress = request.progress
+    ? (phase, loaded, total) => post({ type: 'progress', phase, loaded, total })
+    : null;
+  const storyData = parser.parse(request.source, onProgress);
+  
+  if (!storyData) {
+    post({ type: 'error', message: parser.getError() });
+  } else if (request.binary) {
+    const buffer = encodeBinaryStory(storyData);
+    post({ type: 'result', buffer }, [buffer]);
+  } else {
+    post({ type: 'result', storyData });
+  }
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+
+// parseStream parses once at least this much text can be cut off, so a
+// stream of small chunks is not parsed a few declarations at a time
+const STREAM_SEGMENT = 1 << 16;
+
+// Where the scanner of DeclarationSplitter is. SPLIT_LT follows a '<'
+// that may open a code block, SPLIT_BANG a '!' in one that may close it.
+const SPLIT_OUTSIDE = 0;
+const SPLIT_STRING = 1;
+const SPLIT_CODE = 2;
+const SPLIT_COMMENT = 3;
+const SPLIT_LT = 4;
+const SPLIT_BANG = 5;
+
+/**
+ * Collects source text as it arrives and finds where it can be cut
+ * between top-level declarations: after a line feed that is outside
+ * strings, code blocks and comments, with every brace and bracket closed
+ * and nothing after the last declaration. Text up to such a cut parses
+ * on its own as it would within the whole source, and, cut at a line
+ * start, keeps the lexer's line and column counting. Each chunk is
+ * scanned once, and the scanner keeps its state between chunks, so
+ * tokens may span them.
+ */
+class DeclarationSplitter {
+  constructor() {
+    this.chunks = [];   // Text not taken yet
+    this.length = 0;
+    this.cut = 0;       // End of the text that can be taken
+    this.state = SPLIT_OUTSIDE;
+    this.depth = 0;
+    this.open = false;  // Tokens at depth 0 since the last block closed
+  }
+  
+  push(chunk) {
+    const base = this.length;
+    this.chunks.push(chunk);
+    this.length += chunk.length;
+    
+    // The state is kept in locals for the loop and stored back after it
+    let state = this.state;
+    let depth = this.depth;
+    let open = this.open;
+    let cut = this.cut;
+    
+    for (let i = 0; i < chunk.length; i++) {
+      // Strings, code and comments are skipped to their end with indexOf
+      if (state === SPLIT_STRING) {
+        i = chunk.indexOf('"', i);
+        if (i < 0) break;
+        state = SPLIT_OUTSIDE;
+        continue;
+      }
+      if (state === SPLIT_CODE) {
+        i = chunk.indexOf('!', i);
+        if (i < 0) break;
+        state = SPLIT_BANG;
+        continue;
+      }
+      if (state === SPLIT_COMMENT) {
+        i = chunk.indexOf('\n', i);
+        if (i < 0) break;
+        state = SPLIT_OUTSIDE;
+      }
+      
+      const c = chunk.charCodeAt(i);
+      if (state === SPLIT_BANG) {
+        state = c === CHAR_BANG ? SPLIT_BANG : c === CHAR_GT ? SPLIT_OUTSIDE : SPLIT_CODE;
+        continue;
+      }
+      if (state === SPLIT_LT) {
+        state = SPLIT_OUTSIDE;
+        if (c === CHAR_BANG) {
+          state = SPLIT_CODE;
+          continue;
+        }
+      }
+      
+      switch (c) {
+        case CHAR_LF:
+          if (depth === 0 && !open) cut = base + i + 1;
+          break;
+        case CHAR_SPACE:
+        case CHAR_CR:
+        case CHAR_TAB:
+          break;
+        case CHAR_HASH:
+          state = SPLIT_COMMENT;
+          break;
+        case CHAR_LBRACE:
+        case CHAR_LBRACKET:
+          open = true;
+          depth++;
+          break;
+        case CHAR_RBRACE:
+        case CHAR_RBRACKET:
+          if (depth > 0) depth--;
+          if (depth === 0) open = false;
+          break;
+        case CHAR_QUOTE:
+          state = SPLIT_STRING;
+          if (depth === 0) open = true;
+          break;
+        case CHAR_LT:
+          state = SPLIT_LT;
+          if (depth === 0) open = true;
+          break;
+        default:
+          if (depth === 0) open = true;
+          break;
+      }
+    }
+    
+    this.state = state;
+    this.depth = depth;
+    this.open = open;
+    this.cut = cut;
+  }
+  
+  // The text up to the cut, which is then dropped
+  take() {
+    const text = this.chunks.join('');
+    const rest = text.substring(this.cut);
+    this.chunks = [rest];
+    this.length = rest.length;
+    this.cut = 0;
+    return text.substring(0, text.length - rest.length);
+  }
+  
+  // All the text left, at the end of the stream
+  rest() {
+    const text = this.chunks.join('');
+    this.chunks = [];
+    this.length = 0;
+    this.cut = 0;
+    return text;
+  }
+}
+
+// Chunks of a ReadableStream, or of any async iterable such as a Node
+// stream. Stopping early cancels the stream.
+async function* streamChunks(readable) {
+  if (typeof readable.getReader !== 'function') {
+    yield* readable;
+    return;
+  }
+  
+  const reader = readable.getReader();
+  let done = false;
+  try {
+    while (true) {
+      const result = await reader.read();
+      if (result.done) {
+        done = true;
+        return;
+      }
+      yield result.value;
+    }
+  } finally {
+    if (!done) await reader.cancel();
+    reader.releaseLock();
+  }
+}
+
 // ============================================================================
 // PUBLIC API
 // ============================================================================
@@ -1482,38 +2737,179 @@ class SDCParser {
   /**
    * Parse a .sdc format string
    * @param {string} source - The source code to parse
+   * @param {function} [onProgress] - Called as onProgress(phase, loaded, total)
+   *   during long parses; phase is 'lex' (characters) or 'parse' (tokens)
    * @returns {object|null} StoryData object or null on error
    */
-  parse(source) {
+  parse(source, onProgress = null) {
     this.lastError = null;
     
+    const storyData = createStoryData();
+    return this.parseInto(source, storyData, 1, onProgress) ? storyData : null;
+  }
+  
+  // Lexes and parses source, which starts on line firstLine, into
+  // storyData. Returns the line the source ends on, or 0 on error.
+  parseInto(source, storyData, firstLine, onProgress = null) {
     try {
-      const lexer = new Lexer(source);
+      const lexer = new Lexer(source, onProgress, firstLine);
       const tokens = lexer.scanTokens();
       
       // Check for lexer errors
-      for (const token of tokens) {
-        if (token.type === TokenType.ERROR) {
-          const errorMsg = `Tokenization error at line ${token.line}, column ${token.column}`;
+      for (let i = 0; i < tokens.count; i++) {
+        if (tokens.types[i] === TokenType.ERROR) {
+          const errorMsg = `Tokenization error at line ${tokens.lines[i]}, column ${tokens.column(i)}`;
           console.error(errorMsg);
           this.lastError = errorMsg;
-          return null;  // Return null on lexer error
+          return 0;  // Fail on lexer error
         }
       }
       
-      const parser = new Parser(tokens);
-      const storyData = parser.parse();
+      const parser = new Parser(tokens, onProgress);
+      const parsed = parser.parse(storyData);
       
       if (parser.errorMessage) {
         console.error('Parse error:', parser.errorMessage);
         this.lastError = parser.errorMessage;
-        return null;  // Return null on parser error
+        return 0;  // Fail on parser error
       }
       
-      return storyData;
+      return parsed ? lexer.line : 0;
     } catch (error) {
       console.error('Unexpected error during parsing:', error);
       this.lastError = error.message;
+      return 0;
+    }
+  }
+  
+  /**
+   * Parse a .sdc format string in a worker, leaving the calling thread free.
+   * Stories from sources of a million characters or more come back as a
+   * BinaryStory over one transferred buffer, decoded as it is read;
+   * smaller ones are structured clones, made of plain objects with the
+   * same keys as parse() returns.
+   * @param {string} source - The source code to parse
+   * @param {object} [options]
+   * @param {function} [options.onProgress] - As for parse()
+   * @param {string} [options.transfer] - 'binary' or 'clone', instead of choosing by size
+   * @param {string|URL} [options.workerUrl] - URL of this script, needed in the browser
+   *   when it is not loaded from a script tag
+   * @param {AbortSignal} [options.signal] - Stops the worker and rejects with the reason
+   * @returns {Promise<object|null>} StoryData object or null on error
+   */
+  parseAsync(source, options = {}) {
+    this.lastError = null;
+    const binary = options.transfer ? options.transfer === 'binary' : source.length >= BINARY_TRANSFER_THRESHOLD;
+    const signal = options.signal;
+    
+    return new Promise((resolve, reject) => {
+      if (signal && signal.aborted) {
+        reject(signal.reason);
+        return;
+      }
+      
+      let worker = null;
+      const finish = () => {
+        worker.terminate();
+        if (signal) signal.removeEventListener('abort', abort);
+      };
+      const abort = () => {
+        finish();
+        reject(signal.reason);
+      };
+      
+      worker = startParseWorker(options.workerUrl, message => {
+        if (message.type === 'progress') {
+          if (options.onProgress) options.onProgress(message.phase, message.loaded, message.total);
+          return;
+        }
+        
+        finish();
+        if (message.type === 'result') {
+          resolve(message.buffer ? new BinaryStory(message.buffer) : message.storyData);
+        } else {
+          this.lastError = message.message;
+          resolve(null);
+        }
+      }, error => {
+        finish();
+        this.lastError = error.message;
+        reject(error);
+      });
+      
+      if (signal) signal.addEventListener('abort', abort);
+      worker.postMessage({ source, binary, progress: !!options.onProgress });
+    });
+  }
+  
+  /**
+   * Parse a .sdc source while it is read from a stream. Each run of
+   * complete top-level declarations is parsed as soon as it has arrived,
+   * so parsing overlaps the download, and with onUpdate the chapters,
+   * groups and nodes read so far can be used before it ends. The story
+   * is the one parse() gives for the whole source. The error is the
+   * first in the source, and the stream is cancelled there; parse()
+   * tokenizes the whole source before parsing it, so it gives the same
+   * error unless a tokenization error follows a parse error, which it
+   * reports instead.
+   * @param {ReadableStream|AsyncIterable} readable - A fetch() body or
+   *   other ReadableStream, or a Node stream, of UTF-8 bytes or strings
+   * @param {object} [options]
+   * @param {function} [options.onUpdate] - Called as onUpdate(storyData)
+   *   after declarations are added; it is the object finally returned
+   * @returns {Promise<object|null>} StoryData object or null on error
+   */
+  async parseStream(readable, options = {}) {
+    this.lastError = null;
+    
+    const storyData = createStoryData();
+    const splitter = new DeclarationSplitter();
+    const decoder = new TextDecoder();
+    let line = 1;
+    
+    for await (const chunk of streamChunks(readable)) {
+      splitter.push(typeof chunk === 'string' ? chunk : decoder.decode(chunk, { stream: true }));
+      if (splitter.cut < STREAM_SEGMENT) continue;
+      
+      line = this.parseInto(splitter.take(), storyData, line);
+      if (!line) return null;
+      if (options.onUpdate) options.onUpdate(storyData);
+    }
+    
+    splitter.push(decoder.decode());
+    if (!this.parseInto(splitter.rest(), storyData, line)) return null;
+    if (options.onUpdate) options.onUpdate(storyData);
+    return storyData;
+  }
+  
+  /**
+   * Encode a story as a binary story image, which loadBinary() opens
+   * without parsing. Ship it in place of the .sdc text to skip
+   * tokenizing at startup.
+   * @param {object} storyData - A story from parse(), parseAsync() or loadBinary()
+   * @param {object} [options]
+   * @param {boolean} [options.shared] - Build it in a SharedArrayBuffer,
+   *   which other workers can open without a copy
+   * @returns {ArrayBuffer|SharedArrayBuffer}
+   */
+  toBinary(storyData, options = {}) {
+    return encodeBinaryStory(storyData, !!options.shared);
+  }
+  
+  /**
+   * Open a binary story image. Only the header is read here; fields are
+   * decoded from the buffer when they are accessed.
+   * @param {ArrayBuffer|SharedArrayBuffer|ArrayBufferView} buffer
+   * @returns {BinaryStory|null} Story, or null if the buffer is not a valid image
+   */
+  loadBinary(buffer) {
+    this.lastError = null;
+    
+    try {
+      return new BinaryStory(buffer);
+    } catch (error) {
+      console.error('Binary story error:', error.message);
+      this.lastError = error.message;
       return null;
     }
   }
@@ -1603,8 +2999,33 @@ class SDCParser {
 
 // Export for use as module or global
 if (typeof module !== 'undefined' && module.exports) {
-  module.exports = { SDCParser, GlobalVarType, TagType, ActionType, EventType, TimelineItemType };
-} else {
+  module.exports = {
+    SDCParser, GlobalVarType, TagType, ActionType, EventType, TimelineItemType,
+    SdcChapter, SdcGroup, SdcGroupTag, SdcNodeGraph, SdcNode, SdcDialogue, SdcDialogueLine,
+    SdcAction, SdcCodeData, SdcGotoData, SdcExitData, SdcEnterData, SdcChoiceData,
+    SdcEvent, SdcAdjustVariableEvent, SdcStateEvent, SdcProgressStoryEvent, SdcLinkedListEvent,
+    SdcListModification, createActionData, BinaryStory
+  };
+  
+  if (IS_NODE) {
+    const { isMainThread, workerData, parentPort } = require('worker_threads');
+    if (!isMainThread && workerData && workerData.sdcParseWorker) {
+      parentPort.on('message', request => {
+        serveParseRequest(request, (message, transfer) => parentPort.postMessage(message, transfer));
+      });
+    }
+  }
+} else if (typeof window !== 'undefined') {
   window.SDCParser = SDCParser;
   window.SDCParserEnums = { GlobalVarType, TagType, ActionType, EventType, TimelineItemType };
+  window.SDCParserModel = {
+    SdcChapter, SdcGroup, SdcGroupTag, SdcNodeGraph, SdcNode, SdcDialogue, SdcDialogueLine,
+    SdcAction, SdcCodeData, SdcGotoData, SdcExitData, SdcEnterData, SdcChoiceData,
+    SdcEvent, SdcAdjustVariableEvent, SdcStateEvent, SdcProgressStoryEvent, SdcLinkedListEvent,
+    SdcListModification, createActionData, BinaryStory
+  };
+} else if (typeof self !== 'undefined' && self.location && self.location.hash === WORKER_HASH) {
+  self.onmessage = event => {
+    serveParseRequest(event.data, (message, transfer) => self.postMessage(message, transfer));
+  };
 }
\ No newline at end of file
@@ -0,0 +1,1046 @@
+/**
+ * SDC Parser - WebAssembly binding
+ * Runs the C parser compiled to WebAssembly (c/build_wasm.sh) and reads
+ * the StoryData it builds where it lies in the module's memory. Chapters,
+ * groups, nodes, timeline items and action data are views whose fields
+ * are read from memory when accessed; the keys match the SDCParser model.
+ */
+
+import {
+  GlobalVarType, TagType, ActionType, EventType, TimelineItemType,
+  SdcChapter, SdcGroup, SdcGroupTag, SdcNodeGraph, SdcNode, SdcDialogue, SdcDialogueLine,
+  SdcAction, SdcListModification, createActionData
+} from './sdc_parser.js';
+
+// C enum values, in declaration order
+const GLOBAL_VAR_TYPES = [GlobalVarType.STRING, GlobalVarType.INT, GlobalVarType.BOOL, GlobalVarType.FLOAT];
+const TAG_TYPES = [TagType.SINGLE, TagType.KEYVALUE];
+const ACTION_TYPES = [
+  ActionType.CODE, ActionType.GOTO, ActionType.EXIT, ActionType.ENTER, ActionType.CHOICE, ActionType.EVENT
+];
+const EVENT_TYPES = [
+  EventType.NEXT_NODE, EventType.EXIT_CURRENT_NODE, EventType.EXIT_CURRENT_GROUP, EventType.ADJUST_VARIABLE,
+  EventType.ADD_STATE, EventType.REMOVE_STATE, EventType.PROGRESS_STORY, EventType.LINKED_LIST, EventType.UNKNOWN
+];
+
+const VAR_STRING = 0;
+const VAR_INT = 1;
+const VAR_BOOL = 2;
+
+const LL_INT = 0;
+const LL_FLOAT = 1;
+const LL_STRING = 2;
+
+const TIMELINE_ACTION = 0;
+
+const ACTION_CODE = 0;
+const ACTION_GOTO = 1;
+const ACTION_EXIT = 2;
+const ACTION_ENTER = 3;
+const ACTION_CHOICE = 4;
+const ACTION_EVENT = 5;
+
+const EVENT_ADJUST_VARIABLE = 3;
+const EVENT_ADD_STATE = 4;
+const EVENT_REMOVE_STATE = 5;
+const EVENT_PROGRESS_STORY = 6;
+const EVENT_LINKED_LIST = 7;
+
+const textDecoder = new TextDecoder();
+const textEncoder = new TextEncoder();
+
+// value as C's %.<precision>g formats it (see vsnprintf in sdc_libc.c)
+function formatFloat(value, precision) {
+  if (!Number.isFinite(value)) return Number.isNaN(value) ? 'nan' : value < 0 ? '-inf' : 'inf';
+  if (Object.is(value, -0)) return '-0';
+  
+  const digits = Math.max(precision, 1);
+  const exponent = Number(value.toExponential(digits - 1).split('e')[1]);
+  const trim = text => text.includes('.') ? text.replace(/\.?0+$/, '') : text;
+  if (exponent < -4 || exponent >= digits) {
+    const mantissa = trim(value.toExponential(digits - 1).split('e')[0]);
+    return `${mantissa}e${exponent < 0 ? '-' : '+'}${String(Math.abs(exponent)).padStart(2, '0')}`;
+  }
+  return trim(value.toFixed(digits - 1 - exponent));
+}
+
+// ============================================================================
+// MEMORY
+// ============================================================================
+
+// Typed reads from the module's memory. Growing the memory replaces its
+// buffer, so the views over it are refreshed whenever it has changed.
+class WasmHeap {
+  constructor(memory, layout) {
+    this.memory = memory;
+    this.buffer = null;
+    this.view = null;
+    this.bytes = null;
+    this.pointerSize = layout.sizeof_void_p;
+    this.sizeSize = layout.sizeof_SdcSize;
+    this.longSize = layout.sizeof_long;
+  }
+  
+  refresh() {
+    if (this.memory.buffer !== this.buffer) {
+      this.buffer = this.memory.buffer;
+      this.view = new DataView(this.buffer);
+      this.bytes = new Uint8Array(this.buffer);
+    }
+    return this.view;
+  }
+  
+  u8(address) {
+    return this.refresh().getUint8(address);
+  }
+  
+  i32(address) {
+    return this.refresh().getInt32(address, true);
+  }
+  
+  u32(address) {
+    return this.refresh().getUint32(address, true);
+  }
+  
+  f64(address) {
+    return this.refresh().getFloat64(address, true);
+  }
+  
+  // Pointers and sizes are 4 bytes in wasm32; wider values are read as
+  // two halves and must fit in a double
+  pointer(address) {
+    const view = this.refresh();
+    if (this.pointerSize === 4) return view.getUint32(address, true);
+    return view.getUint32(address, true) + view.getUint32(address + 4, true) * 4294967296;
+  }
+  
+  size(address) {
+    const view = this.refresh();
+    if (this.sizeSize === 4) return view.getUint32(address, true);
+    return view.getUint32(address, true) + view.getUint32(address + 4, true) * 4294967296;
+  }
+  
+  long(address) {
+    const view = this.refresh();
+    if (this.longSize === 4) return view.getInt32(address, true);
+    return view.getUint32(address, true) + view.getInt32(address + 4, true) * 4294967296;
+  }
+  
+  // NUL-terminated UTF-8, or null for a NULL pointer
+  string(address) {
+    if (address === 0) return null;
+    this.refresh();
+    const end = this.bytes.indexOf(0, address);
+    return textDecoder.decode(this.bytes.subarray(address, end));
+  }
+  
+  // A uint64_t content hash as the 16 hex digits SDCParser reports
+  hash(address) {
+    const view = this.refresh();
+    return view.getUint32(address + 4, true).toString(16).padStart(8, '0') +
+           view.getUint32(address, true).toString(16).padStart(8, '0');
+  }
+  
+  // Array of char*, as strings
+  strings(array, count) {
+    const result = [];
+    for (let i = 0; i < count; i++) {
+      result.push(this.string(this.pointer(array + i * this.pointerSize)));
+    }
+    return result;
+  }
+}
+
+// Struct sizes and field offsets exported by c/wasm/sdc_wasm.c, keyed
+// with '.' replaced by '_' (sizeof.Node -> sizeof_Node, Node.id -> Node_id)
+function readLayout(exports, memory) {
+  const bytes = () => new Uint8Array(memory.buffer);
+  const layout = {};
+  const count = exports.sdc_wasm_layout_count();
+  
+  for (let i = 0; i < count; i++) {
+    const name = exports.sdc_wasm_layout_name(i);
+    const end = bytes().indexOf(0, name);
+    const key = textDecoder.decode(bytes().subarray(name, end)).replace(/\*/g, '_p').replace(/\./g, '_');
+    layout[key] = exports.sdc_wasm_layout_value(i);
+  }
+  
+  return layout;
+}
+
+// ============================================================================
+// STORY VIEWS
+// ============================================================================
+
+const STORY = Symbol('story');
+const ADDRESS = Symbol('address');
+const ITEM = Symbol('item');
+const HASH = Symbol('hash');
+const CACHE = Symbol('cache');
+
+const inspectSymbol = Symbol.for('nodejs.util.inspect.custom');
+
+// Fields are getters on the prototype, so views hold only their story and
+// address. toJSON() copies them into a plain object, and Node prints a
+// view as the SDCParser object it stands for.
+class StructView {
+  constructor(story, address) {
+    this[STORY] = story;
+    this[ADDRESS] = address;
+    this[CACHE] = null;
+  }
+  
+  // Arrays and objects built from memory are kept for later reads
+  cached(key, build) {
+    if (!this[CACHE]) this[CACHE] = {};
+    if (!(key in this[CACHE])) this[CACHE][key] = build();
+    return this[CACHE][key];
+  }
+  
+  toJSON() {
+    const result = {};
+    for (const key of this.constructor.keys) result[key] = this[key];
+    return result;
+  }
+  
+  [inspectSymbol]() {
+    return Object.assign(Object.create(this.constructor.model.prototype), this.toJSON());
+  }
+}
+
+// Views over an array of structs, created when the array is first read
+function viewArray(story, ViewClass, array, count, stride) {
+  const views = new Array(count);
+  for (let i = 0; i < count; i++) views[i] = new ViewClass(story, array + i * stride);
+  return views;
+}
+
+class ChapterView extends StructView {
+  static keys = ['id', 'name', 'content-hash'];
+  static model = SdcChapter;
+  
+  get id() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Chapter_id);
+  }
+  
+  get name() {
+    const story = this[STORY];
+    return story.heap.string(story.heap.pointer(this[ADDRESS] + story.layout.Chapter_name));
+  }
+  
+  get ['content-hash']() {
+    const story = this[STORY];
+    return story.heap.hash(this[ADDRESS] + story.layout.Chapter_content_hash);
+  }
+}
+
+class GroupView extends StructView {
+  static keys = [
+    'id', 'chapter-id', 'name', 'content', 'tags', 'nodes', 'linked-lists', 'parent-group', 'content-hash'
+  ];
+  static model = SdcGroup;
+  
+  get id() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Group_id);
+  }
+  
+  get ['chapter-id']() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Group_chapter_id);
+  }
+  
+  get name() {
+    const story = this[STORY];
+    return story.heap.string(story.heap.pointer(this[ADDRESS] + story.layout.Group_name));
+  }
+  
+  get content() {
+    const story = this[STORY];
+    return story.heap.string(story.heap.pointer(this[ADDRESS] + story.layout.Group_content));
+  }
+  
+  get tags() {
+    return this.cached('tags', () => {
+      const { heap, layout: L } = this[STORY];
+      const array = heap.pointer(this[ADDRESS] + L.Group_tags);
+      const count = heap.size(this[ADDRESS] + L.Group_tag_count);
+      const tags = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_GroupTag;
+        const tag = new SdcGroupTag(heap.string(heap.pointer(entry + L.GroupTag_tag_name)));
+        tag['selected-key'] = heap.string(heap.pointer(entry + L.GroupTag_selected_key));
+        tag.value = heap.string(heap.pointer(entry + L.GroupTag_value));
+        tags.push(tag);
+      }
+      
+      return tags;
+    });
+  }
+  
+  get nodes() {
+    return this.cached('nodes', () => {
+      const { heap, layout: L } = this[STORY];
+      const graph = this[ADDRESS] + L.Group_nodes;
+      const result = new SdcNodeGraph();
+      result['start-node'] = heap.i32(graph + L.NodeGraph_start_node);
+      result['end-node'] = heap.i32(graph + L.NodeGraph_end_node);
+      
+      const keys = heap.pointer(graph + L.NodeGraph_point_keys);
+      const values = heap.pointer(graph + L.NodeGraph_point_values);
+      const counts = heap.pointer(graph + L.NodeGraph_point_value_counts);
+      const count = heap.size(graph + L.NodeGraph_point_count);
+      
+      for (let i = 0; i < count; i++) {
+        const targets = heap.pointer(values + i * heap.pointerSize);
+        const targetCount = heap.size(counts + i * heap.sizeSize);
+        const list = [];
+        for (let j = 0; j < targetCount; j++) list.push(heap.i32(targets + j * 4));
+        result.points[heap.i32(keys + i * 4)] = list;
+      }
+      
+      return result;
+    });
+  }
+  
+  get ['linked-lists']() {
+    return this.cached('linked-lists', () => {
+      const { heap, layout: L } = this[STORY];
+      return heap.strings(heap.pointer(this[ADDRESS] + L.Group_linked_lists),
+                          heap.size(this[ADDRESS] + L.Group_linked_list_count));
+    });
+  }
+  
+  get ['parent-group']() {
+    const story = this[STORY];
+    const parent = story.heap.i32(this[ADDRESS] + story.layout.Group_parent_group);
+    return parent === -1 ? null : parent;
+  }
+  
+  get ['content-hash']() {
+    const story = this[STORY];
+    return story.heap.hash(this[ADDRESS] + story.layout.Group_content_hash);
+  }
+}
+
+class NodeView extends StructView {
+  static keys = ['id', 'title', 'content', 'timeline', 'content-hash'];
+  static model = SdcNode;
+  
+  get id() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Node_id);
+  }
+  
+  get title() {
+    const story = this[STORY];
+    return story.heap.string(story.heap.pointer(this[ADDRESS] + story.layout.Node_title));
+  }
+  
+  get content() {
+    const story = this[STORY];
+    return story.heap.string(story.heap.pointer(this[ADDRESS] + story.layout.Node_content));
+  }
+  
+  // Dialogue and action views for the node's timeline items, which refer
+  // to their payloads, and the hashes kept beside them, by index
+  get timeline() {
+    return this.cached('timeline', () => {
+      const story = this[STORY];
+      const { heap, layout: L } = story;
+      const items = heap.pointer(this[ADDRESS] + L.Node_timeline);
+      const count = heap.size(this[ADDRESS] + L.Node_timeline_count);
+      const dialogues = heap.pointer(story[ADDRESS] + L.StoryData_dialogues);
+      const actions = heap.pointer(story[ADDRESS] + L.StoryData_actions);
+      const dialogueHashes = heap.pointer(story[ADDRESS] + L.StoryData_dialogue_hashes);
+      const actionHashes = heap.pointer(story[ADDRESS] + L.StoryData_action_hashes);
+      const timeline = new Array(count);
+      
+      for (let i = 0; i < count; i++) {
+        const item = items + i * L.sizeof_TimelineItem;
+        const payload = heap.u32(item + L.TimelineItem_payload);
+        timeline[i] = heap.i32(item + L.TimelineItem_type) === TIMELINE_ACTION
+          ? new ActionView(story, actions + payload * L.sizeof_Action, item, actionHashes + payload * 8)
+          : new DialogueView(story, dialogues + payload * L.sizeof_Dialogue, item,
+                             dialogueHashes + payload * 8);
+      }
+      
+      return timeline;
+    });
+  }
+  
+  get ['content-hash']() {
+    const story = this[STORY];
+    return story.heap.hash(this[ADDRESS] + story.layout.Node_content_hash);
+  }
+}
+
+// Timeline entries view their payload, read their number from the
+// timeline item and their hash from the story's hash array (item and
+// hash are 0 for actions inside choices)
+class DialogueView extends StructView {
+  static keys = ['type', 'number', 'lines', 'content-hash'];
+  static model = SdcDialogue;
+  
+  constructor(story, address, item = 0, hash = 0) {
+    super(story, address);
+    this[ITEM] = item;
+    this[HASH] = hash;
+  }
+  
+  get type() {
+    return TimelineItemType.DIALOGUE;
+  }
+  
+  get number() {
+    const story = this[STORY];
+    return story.heap.i32(this[ITEM] + story.layout.TimelineItem_number);
+  }
+  
+  get lines() {
+    return this.cached('lines', () => {
+      const { heap, layout: L } = this[STORY];
+      const count = heap.size(this[ADDRESS] + L.Dialogue_line_count);
+      const characters = heap.strings(heap.pointer(this[ADDRESS] + L.Dialogue_characters), count);
+      const texts = heap.strings(heap.pointer(this[ADDRESS] + L.Dialogue_texts), count);
+      return characters.map((character, i) => new SdcDialogueLine(character, texts[i]));
+    });
+  }
+  
+  get ['content-hash']() {
+    return this[STORY].heap.hash(this[HASH]);
+  }
+}
+
+class ActionView extends StructView {
+  static keys = ['type', 'number', 'action-type', 'data', 'content-hash'];
+  static model = SdcAction;
+  
+  constructor(story, address, item = 0, hash = 0) {
+    super(story, address);
+    this[ITEM] = item;
+    this[HASH] = hash;
+  }
+  
+  get type() {
+    return TimelineItemType.ACTION;
+  }
+  
+  get number() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Action_number);
+  }
+  
+  get ['action-type']() {
+    const story = this[STORY];
+    return ACTION_TYPES[story.heap.i32(this[ADDRESS] + story.layout.Action_type)];
+  }
+  
+  get data() {
+    return this.cached('data', () => new ActionDataView(this[STORY], this[ADDRESS]));
+  }
+  
+  get ['content-hash']() {
+    if (this[HASH] === 0) return null;
+    return this[STORY].heap.hash(this[HASH]);
+  }
+}
+
+// The data of an action, at the Action's own address. Its keys are those
+// of the model data class for its action and event type; other fields
+// read as null.
+class ActionDataView extends StructView {
+  model() {
+    return createActionData(ACTION_TYPES[this.actionType()], this['event-type']);
+  }
+  
+  toJSON() {
+    const result = {};
+    for (const key of Object.keys(this.model())) result[key] = this[key];
+    return result;
+  }
+  
+  [inspectSymbol]() {
+    return Object.assign(this.model(), this.toJSON());
+  }
+  
+  actionType() {
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Action_type);
+  }
+  
+  eventType() {
+    if (this.actionType() !== ACTION_EVENT) return -1;
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Action_data_event_event_type);
+  }
+  
+  // Address of the event's data union
+  event() {
+    const story = this[STORY];
+    return this[ADDRESS] + story.layout.Action_data_event_data;
+  }
+  
+  stringAt(address) {
+    const heap = this[STORY].heap;
+    return heap.string(heap.pointer(address));
+  }
+  
+  get ['event-type']() {
+    const type = this.eventType();
+    return type === -1 ? null : EVENT_TYPES[type];
+  }
+  
+  get code() {
+    if (this.actionType() !== ACTION_CODE) return null;
+    return this.stringAt(this[ADDRESS] + this[STORY].layout.Action_data_code_code);
+  }
+  
+  get ['target-node']() {
+    if (this.actionType() !== ACTION_GOTO) return null;
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Action_data_goto_action_target_node);
+  }
+  
+  get target() {
+    if (this.actionType() !== ACTION_EXIT) return null;
+    return this.stringAt(this[ADDRESS] + this[STORY].layout.Action_data_exit_action_target);
+  }
+  
+  get ['target-group']() {
+    if (this.actionType() !== ACTION_ENTER) return null;
+    const story = this[STORY];
+    return story.heap.i32(this[ADDRESS] + story.layout.Action_data_enter_action_target_group);
+  }
+  
+  // Options as { text, actions }, with the actions as views
+  get choice() {
+    if (this.actionType() !== ACTION_CHOICE) return null;
+    return this.cached('choice', () => {
+      const story = this[STORY];
+      const { heap, layout: L } = story;
+      const options = heap.pointer(this[ADDRESS] + L.Action_data_choice_options);
+      const count = heap.size(this[ADDRESS] + L.Action_data_choice_option_count);
+      const result = [];
+      
+      for (let i = 0; i < count; i++) {
+        const option = options + i * L.sizeof_ChoiceOption;
+        result.push({
+          text: heap.string(heap.pointer(option + L.ChoiceOption_text)),
+          actions: viewArray(story, ActionView, heap.pointer(option + L.ChoiceOption_actions),
+                             heap.size(option + L.ChoiceOption_action_count), L.sizeof_Action)
+        });
+      }
+      
+      return result;
+    });
+  }
+  
+  get name() {
+    const L = this[STORY].layout;
+    switch (this.eventType()) {
+      case EVENT_ADJUST_VARIABLE: return this.stringAt(this.event() + L.AdjustVariableEventData_name);
+      case EVENT_ADD_STATE: return this.stringAt(this.event() + L.AddStateEventData_name);
+      case EVENT_REMOVE_STATE: return this.stringAt(this.event() + L.RemoveStateEventData_name);
+      default: return null;
+    }
+  }
+  
+  get value() {
+    if (this.eventType() !== EVENT_ADJUST_VARIABLE) return null;
+    const { heap, layout: L } = this[STORY];
+    if (!heap.u8(this.event() + L.AdjustVariableEventData_has_value)) return null;
+    return this.stringAt(this.event() + L.AdjustVariableEventData_value);
+  }
+  
+  get increment() {
+    if (this.eventType() !== EVENT_ADJUST_VARIABLE) return null;
+    const { heap, layout: L } = this[STORY];
+    if (!heap.u8(this.event() + L.AdjustVariableEventData_has_increment)) return null;
+    return heap.f64(this.event() + L.AdjustVariableEventData_increment);
+  }
+  
+  get ['is-toggle']() {
+    if (this.eventType() !== EVENT_ADJUST_VARIABLE) return false;
+    const { heap, layout: L } = this[STORY];
+    return heap.u8(this.event() + L.AdjustVariableEventData_is_toggle) !== 0;
+  }
+  
+  get character() {
+    const L = this[STORY].layout;
+    switch (this.eventType()) {
+      case EVENT_ADD_STATE: return this.stringAt(this.event() + L.AddStateEventData_character);
+      case EVENT_REMOVE_STATE: return this.stringAt(this.event() + L.RemoveStateEventData_character);
+      default: return null;
+    }
+  }
+  
+  get reference() {
+    if (this.eventType() !== EVENT_LINKED_LIST) return null;
+    return this.stringAt(this.event() + this[STORY].layout.LinkedListEventData_reference);
+  }
+  
+  // Field changes as SdcListModification objects. The C parser keeps set,
+  // append and replace values as text.
+  get values() {
+    if (this.eventType() !== EVENT_LINKED_LIST) return null;
+    return this.cached('values', () => {
+      const { heap, layout: L } = this[STORY];
+      const array = heap.pointer(this.event() + L.LinkedListEventData_modifications);
+      const count = heap.size(this.event() + L.LinkedListEventData_modification_count);
+      const result = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_LinkedListFieldModification;
+        const modification = new SdcListModification(this.stringAt(entry + L.LinkedListFieldModification_field));
+        if (heap.u8(entry + L.LinkedListFieldModification_has_amount)) {
+          modification.amount = heap.f64(entry + L.LinkedListFieldModification_amount);
+        }
+        if (heap.u8(entry + L.LinkedListFieldModification_has_set)) {
+          modification.set = this.stringAt(entry + L.LinkedListFieldModification_set_value);
+        }
+        if (heap.u8(entry + L.LinkedListFieldModification_has_append)) {
+          modification.append = this.stringAt(entry + L.LinkedListFieldModification_append_value);
+        }
+        if (heap.u8(entry + L.LinkedListFieldModification_has_replace)) {
+          modification.replace = this.stringAt(entry + L.LinkedListFieldModification_replace_value);
+        }
+        if (heap.u8(entry + L.LinkedListFieldModification_is_toggle)) {
+          modification.toggle = 'toggle';
+        }
+        result.push(modification);
+      }
+      
+      return result;
+    });
+  }
+  
+  progressId(field) {
+    if (this.eventType() !== EVENT_PROGRESS_STORY) return null;
+    const id = this[STORY].heap.i32(this.event() + field);
+    return id === -1 ? null : id;
+  }
+  
+  get ['chapter-id']() {
+    return this.progressId(this[STORY].layout.ProgressStoryEventData_chapter_id);
+  }
+  
+  get ['group-id']() {
+    return this.progressId(this[STORY].layout.ProgressStoryEventData_group_id);
+  }
+  
+  get ['node-id']() {
+    return this.progressId(this[STORY].layout.ProgressStoryEventData_node_id);
+  }
+}
+
+// Root of a parsed story. The section tables (states, variables, linked
+// lists, characters and tags) are small and are copied into plain objects
+// the first time they are read; chapters, groups and nodes are views.
+class StoryView {
+  constructor(parser, address) {
+    this[STORY] = this;
+    this[ADDRESS] = address;
+    this[CACHE] = {};
+    this.parser = parser;
+    this.heap = parser.heap;
+    this.layout = parser.layout;
+  }
+  
+  cached(key, build) {
+    if (!(key in this[CACHE])) this[CACHE][key] = build();
+    return this[CACHE][key];
+  }
+  
+  // Pointer and count of one of StoryData's arrays
+  table(array, count) {
+    return [this.heap.pointer(this[ADDRESS] + array), this.heap.size(this[ADDRESS] + count)];
+  }
+  
+  get states() {
+    return this.cached('states', () => {
+      const L = this.layout;
+      const [array, count] = this.table(L.StoryData_states, L.StoryData_state_count);
+      const states = [];
+      for (let i = 0; i < count; i++) {
+        states.push({ name: this.heap.string(this.heap.pointer(array + i * L.sizeof_State + L.State_name)) });
+      }
+      return states;
+    });
+  }
+  
+  get ['global-vars']() {
+    return this.cached('global-vars', () => {
+      const { heap, layout: L } = this;
+      const [array, count] = this.table(L.StoryData_global_vars, L.StoryData_global_var_count);
+      const variables = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_GlobalVariable;
+        const type = heap.i32(entry + L.GlobalVariable_type);
+        const value = entry + L.GlobalVariable_default_value;
+        variables.push({
+          name: heap.string(heap.pointer(entry + L.GlobalVariable_name)),
+          type: GLOBAL_VAR_TYPES[type],
+          default: type === VAR_STRING ? heap.string(heap.pointer(value))
+                 : type === VAR_INT ? heap.long(value)
+                 : type === VAR_BOOL ? heap.u8(value) !== 0
+                 : heap.f64(value)
+        });
+      }
+      
+      return variables;
+    });
+  }
+  
+  get ['linked-lists']() {
+    return this.cached('linked-lists', () => {
+      const { heap, layout: L } = this;
+      const [array, count] = this.table(L.StoryData_linked_lists, L.StoryData_linked_list_count);
+      const lists = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_LinkedListDefinition;
+        const names = heap.strings(heap.pointer(entry + L.LinkedListDefinition_field_names),
+                                   heap.size(entry + L.LinkedListDefinition_field_count));
+        const fields = heap.pointer(entry + L.LinkedListDefinition_fields);
+        const structure = {};
+        names.forEach((name, field) => {
+          structure[name] = { type: heap.string(heap.pointer(fields + field * L.sizeof_LinkedListField +
+                                                             L.LinkedListField_type)) };
+        });
+        
+        lists.push({
+          name: heap.string(heap.pointer(entry + L.LinkedListDefinition_name)),
+          scope: heap.string(heap.pointer(entry + L.LinkedListDefinition_scope)),
+          structure
+        });
+      }
+      
+      return lists;
+    });
+  }
+  
+  // One row of a linked list's columns as { field: value }, for the fields
+  // the row sets
+  listRow(list, row) {
+    const { heap, layout: L } = this;
+    const names = heap.strings(heap.pointer(list + L.LinkedListDefinition_field_names),
+                               heap.size(list + L.LinkedListDefinition_field_count));
+    const columns = heap.pointer(list + L.LinkedListDefinition_columns);
+    const strings = heap.pointer(list + L.LinkedListDefinition_strings);
+    const result = {};
+    
+    names.forEach((name, field) => {
+      const column = columns + field * L.sizeof_LinkedListColumn;
+      if (!heap.u8(heap.pointer(column + L.LinkedListColumn_present) + row)) return;
+      
+      const data = heap.pointer(column + L.LinkedListColumn_data);
+      switch (heap.i32(column + L.LinkedListColumn_type)) {
+        case LL_INT: result[name] = heap.long(data + row * heap.longSize); break;
+        case LL_FLOAT: result[name] = heap.f64(data + row * 8); break;
+        case LL_STRING:
+          result[name] = heap.string(heap.pointer(strings + heap.size(data + row * heap.sizeSize) * heap.pointerSize));
+          break;
+        default: result[name] = heap.u8(data + row) !== 0; break;
+      }
+    });
+    
+    return result;
+  }
+  
+  get characters() {
+    return this.cached('characters', () => {
+      const { heap, layout: L } = this;
+      const [array, count] = this.table(L.StoryData_characters, L.StoryData_character_count);
+      const lists = heap.pointer(this[ADDRESS] + L.StoryData_linked_lists);
+      const characters = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_Character;
+        const listCount = heap.size(entry + L.Character_linked_list_count);
+        const names = heap.strings(heap.pointer(entry + L.Character_linked_list_names), listCount);
+        const data = heap.pointer(entry + L.Character_linked_list_data);
+        const listData = {};
+        
+        names.forEach((name, j) => {
+          const rows = data + j * L.sizeof_LinkedListData;
+          const list = lists + heap.size(rows + L.LinkedListData_list_index) * L.sizeof_LinkedListDefinition;
+          const first = heap.size(rows + L.LinkedListData_first_row);
+          const instances = [];
+          for (let r = 0; r < heap.size(rows + L.LinkedListData_count); r++) {
+            instances.push(this.listRow(list, first + r));
+          }
+          listData[name] = heap.u8(rows + L.LinkedListData_is_array) ? instances : instances[0] || {};
+        });
+        
+        characters.push({
+          name: heap.string(heap.pointer(entry + L.Character_name)),
+          biography: heap.string(heap.pointer(entry + L.Character_biography)) || '',
+          description: heap.string(heap.pointer(entry + L.Character_description)) || '',
+          'linked-list-data': listData
+        });
+      }
+      
+      return characters;
+    });
+  }
+  
+  get tags() {
+    return this.cached('tags', () => {
+      const { heap, layout: L } = this;
+      const [array, count] = this.table(L.StoryData_tags, L.StoryData_tag_count);
+      const tags = [];
+      
+      for (let i = 0; i < count; i++) {
+        const entry = array + i * L.sizeof_TagDefinition;
+        tags.push({
+          name: heap.string(heap.pointer(entry + L.TagDefinition_name)),
+          type: TAG_TYPES[heap.i32(entry + L.TagDefinition_type)],
+          color: heap.string(heap.pointer(entry + L.TagDefinition_color)),
+          keys: heap.strings(heap.pointer(entry + L.TagDefinition_keys), heap.size(entry + L.TagDefinition_key_count))
+        });
+      }
+      
+      return tags;
+    });
+  }
+  
+  get chapters() {
+    return this.cached('chapters', () => {
+      const L = this.layout;
+      const [array, count] = this.table(L.StoryData_chapters, L.StoryData_chapter_count);
+      return viewArray(this, ChapterView, array, count, L.sizeof_Chapter);
+    });
+  }
+  
+  get groups() {
+    return this.cached('groups', () => {
+      const L = this.layout;
+      const [array, count] = this.table(L.StoryData_groups, L.StoryData_group_count);
+      return viewArray(this, GroupView, array, count, L.sizeof_Group);
+    });
+  }
+  
+  get nodes() {
+    return this.cached('nodes', () => {
+      const L = this.layout;
+      const [array, count] = this.table(L.StoryData_nodes, L.StoryData_node_count);
+      return viewArray(this, NodeView, array, count, L.sizeof_Node);
+    });
+  }
+  
+  // The view of the entry at address in one of the story's arrays, or null
+  viewAt(views, array, stride, address) {
+    if (address === 0) return null;
+    return views[(address - this.heap.pointer(this[ADDRESS] + array)) / stride];
+  }
+  
+  /**
+   * Release the story's memory. The story and every view taken from it
+   * must not be used afterwards.
+   */
+  free() {
+    if (this[ADDRESS] === 0) return;
+    this.parser.exports.sdc_free(this[ADDRESS]);
+    this[ADDRESS] = 0;
+  }
+  
+  toJSON() {
+    return {
+      states: this.states,
+      'global-vars': this['global-vars'],
+      'linked-lists': this['linked-lists'],
+      characters: this.characters,
+      tags: this.tags,
+      chapters: this.chapters,
+      groups: this.groups,
+      nodes: this.nodes
+    };
+  }
+  
+  [inspectSymbol]() {
+    return this.toJSON();
+  }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+/**
+ * SDCParser backed by the WebAssembly build of the C parser. Create one
+ * with WasmSDCParser.load(); parse() and the lookups then work like
+ * SDCParser's. Stories live in the module's memory until free() is
+ * called on them.
+ */
+class WasmSDCParser {
+  constructor(instance) {
+    this.exports = instance.exports;
+    this.layout = readLayout(this.exports, this.exports.memory);
+    this.heap = new WasmHeap(this.exports.memory, this.layout);
+    this.lastError = null;
+  }
+  
+  /**
+   * Instantiate the module
+   * @param {string|URL|ArrayBuffer|Uint8Array|WebAssembly.Module} [wasm] -
+   *   Module or its bytes, path or URL; defaults to sdc_parser.wasm next
+   *   to this file
+   * @returns {Promise<WasmSDCParser>}
+   */
+  static async load(wasm = new URL('./sdc_parser.wasm', import.meta.url)) {
+    let source = wasm;
+    if (typeof wasm === 'string' || wasm instanceof URL) {
+      const url = new URL(wasm, import.meta.url);
+      if (url.protocol === 'file:') {
+        const { readFile } = await import('node:fs/promises');
+        source = await readFile(url);
+      } else {
+        source = await (await fetch(url)).arrayBuffer();
+      }
+    }
+    
+    // Long float literals are converted and floats formatted here (see
+    // strtod and vsnprintf in sdc_libc.c)
+    let parser = null;
+    const imports = {
+      env: {
+        parse_float: (text, length) => {
+          parser.heap.refresh();
+          return parseFloat(textDecoder.decode(parser.heap.bytes.subarray(text, text + length)));
+        },
+        format_float: (value, precision, buffer, size) => {
+          parser.heap.refresh();
+          return textEncoder.encodeInto(formatFloat(value, precision), parser.heap.bytes.subarray(buffer, buffer + size - 1)).written;
+        }
+      }
+    };
+    
+    const result = await WebAssembly.instantiate(source, imports);
+    parser = new WasmSDCParser(result.instance || result);
+    return parser;
+  }
+  
+  /**
+   * Parse a .sdc format string
+   * @param {string} source - The source code to parse
+   * @returns {object|null} Story view or null on error
+   */
+  parse(source) {
+    this.lastError = null;
+    
+    const bytes = textEncoder.encode(source);
+    const input = this.exports.sdc_wasm_alloc(bytes.length + 1);
+    if (input === 0) {
+      this.lastError = 'Out of memory';
+      return null;
+    }
+    
+    this.heap.refresh();
+    this.heap.bytes.set(bytes, input);
+    this.heap.bytes[input + bytes.length] = 0;
+    
+    const story = this.exports.sdc_parse_string(input);
+    this.exports.sdc_wasm_release(input);
+    
+    if (story === 0) {
+      this.lastError = this.heap.string(this.exports.sdc_get_error()) || 'Parse failed';
+      return null;
+    }
+    
+    return new StoryView(this, story);
+  }
+  
+  getLastError() {
+    return this.lastError;
+  }
+  
+  /**
+   * Get the last error message
+   * @returns {string|null}
+   */
+  getError() {
+    return this.lastError;
+  }
+  
+  /**
+   * Get a chapter by ID, using the C parser's lookup
+   * @param {object} storyData
+   * @param {number} id
+   * @returns {object|null}
+   */
+  getChapter(storyData, id) {
+    const L = this.layout;
+    return storyData.viewAt(storyData.chapters, L.StoryData_chapters, L.sizeof_Chapter,
+                            this.exports.sdc_get_chapter(storyData[ADDRESS], id));
+  }
+  
+  /**
+   * Get a group by ID, using the C parser's lookup
+   * @param {object} storyData
+   * @param {number} id
+   * @returns {object|null}
+   */
+  getGroup(storyData, id) {
+    const L = this.layout;
+    return storyData.viewAt(storyData.groups, L.StoryData_groups, L.sizeof_Group,
+                            this.exports.sdc_get_group(storyData[ADDRESS], id));
+  }
+  
+  /**
+   * Get a node by ID, using the C parser's lookup
+   * @param {object} storyData
+   * @param {number} id
+   * @returns {object|null}
+   */
+  getNode(storyData, id) {
+    const L = this.layout;
+    return storyData.viewAt(storyData.nodes, L.StoryData_nodes, L.sizeof_Node,
+                            this.exports.sdc_get_node(storyData[ADDRESS], id));
+  }
+  
+  /**
+   * Get a tag definition by name
+   * @param {object} storyData
+   * @param {string} name
+   * @returns {object|null}
+   */
+  getTagDefinition(storyData, name) {
+    return storyData.tags.find(t => t.name === name) || null;
+  }
+  
+  /**
+   * Get a global variable by name
+   * @param {object} storyData
+   * @param {string} name
+   * @returns {object|null}
+   */
+  getGlobalVariable(storyData, name) {
+    return storyData['global-vars'].find(v => v.name === name) || null;
+  }
+  
+  /**
+   * Get a linked list definition by name
+   * @param {object} storyData
+   * @param {string} name
+   * @returns {object|null}
+   */
+  getLinkedList(storyData, name) {
+    return storyData['linked-lists'].find(l => l.name === name) || null;
+  }
+  
+  /**
+   * Get a character by name
+   * @param {object} storyData
+   * @param {string} name
+   * @returns {object|null}
+   */
+  getCharacter(storyData, name) {
+    return storyData.characters.find(c => c.name === name) || null;
+  }
+}
+
+export { WasmSDCParser };
@@ -0,0 +1,52 @@
+/**
+ * Parser benchmarks
+ * Run from the js directory: node test/bench.js [scale]
+ */
+
+import { SDCParser } from "../sdc_parser.js";
+
+function runBenchmark(name, source, iterations) {
+  const parser = new SDCParser();
+  let best = Infinity;
+  
+  // Warm up the JIT before timing
+  parser.parse(source);
+  
+  for (let i = 0; i < iterations; i++) {
+    const start = performance.now();
+    parser.parse(source);
+    const elapsed = performance.now() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  
+  const megabytes = source.length / 1e6;
+  console.log(`${name.padEnd(12)} ${megabytes.toFixed(2).padStart(8)} MB  ` +
+              `${best.toFixed(2).padStart(8)} ms  ` +
+              `${(megabytes / (best / 1000)).toFixed(1).padStart(8)} MB/s`);
+}
+
+// Keyword and identifier dense input: short fields, event actions and
+// dialogue lines keyed by character name
+function generateIdentifiers(nodeCount) {
+  const parts = [];
+  
+  for (let i = 1; i <= nodeCount; i++) {
+    parts.push(`node ${i} {\n    title: "N"\n    content: ""\n    timeline: {\n`);
+    
+    for (let j = 1; j <= 4; j++) {
+      parts.push(`        dialogue ${j} {\n            Saniyah : "a"\n            Caroline : "b"\n        }\n`);
+    }
+    
+    parts.push(
+      '        action 1 {\n            type: "event"\n            event: "next-node"\n        }\n' +
+      '        action 2 {\n            type: "event"\n            event: "exit-current-node"\n        }\n' +
+      '        action 3 {\n            type: "enter"\n            group: 2\n        }\n' +
+      '    }\n}\n');
+  }
+  
+  return parts.join('');
+}
+
+const scale = parseInt(process.argv[2], 10) || 20000;
+
+runBenchmark('identifiers', generateIdentifiers(scale), 5);
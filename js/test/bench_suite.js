@@ -0,0 +1,397 @@
+/**
+ * Parser and engine benchmark suite
+ * Run from the js directory:
+ *   node --expose-gc test/bench_suite.js [options]
+ *
+ *   --scale N[,N...]   generate stories of N nodes (default 1000,10000,
+ *                      unless --story is given)
+ *   --story FILE       benchmark a .sdc file; may be repeated
+ *   --runs N           timed runs per measurement (default 10)
+ *   --warmup N         untimed runs before them (default 3)
+ *   --out FILE         write the results as JSON
+ *   --compare FILE     print the change from an earlier --out file
+ *
+ * For each story it measures parse throughput and peak heap, engine
+ * steps per second through execute() and executeUntil(), and the latency
+ * of resolving a choice. Times are reported as median, mean, standard
+ * deviation, 95% confidence interval of the mean, p95, min and max.
+ * Without --expose-gc collections are not forced between runs, so the
+ * numbers are noisier.
+ */
+
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import v8 from 'v8';
+import { SDCParser, ActionType, EventType, createActionData } from '../sdc_parser.js';
+import { StoryEngine, StepKind } from '../sdc_engine.js';
+
+// Results files carry this, so --compare can refuse files it cannot read
+const RESULTS_VERSION = 1;
+
+// Engine walks over loaded stories stop here if the story never ends
+const MAX_STEPS = 1000000;
+
+const CHOICE_OPTIONS = 3;
+
+// ============================================================================
+// OPTIONS
+// ============================================================================
+
+function parseOptions(argv) {
+  const options = { scales: null, stories: [], runs: 10, warmup: 3, out: null, compare: null };
+  
+  for (let i = 0; i < argv.length; i++) {
+    const value = argv[i + 1];
+    switch (argv[i]) {
+      case '--scale': options.scales = value.split(',').map(n => parseInt(n, 10)); i++; break;
+      case '--story': options.stories.push(value); i++; break;
+      case '--runs': options.runs = parseInt(value, 10); i++; break;
+      case '--warmup': options.warmup = parseInt(value, 10); i++; break;
+      case '--out': options.out = value; i++; break;
+      case '--compare': options.compare = value; i++; break;
+      default:
+        console.error(`Unknown option ${argv[i]}`);
+        process.exit(2);
+    }
+  }
+  
+  // Generated stories only by default when no file is given
+  if (!options.scales) options.scales = options.stories.length > 0 ? [] : [1000, 10000];
+  return options;
+}
+
+// ============================================================================
+// STORIES
+// ============================================================================
+
+// Event bodies cycled through the timelines
+const EVENTS = [
+  'type: "adjust-variable"\n                name: "Money"\n                increment: 1',
+  'type: "add-state"\n                name: "Poisoned"\n                character: "Saniyah"',
+  'type: "linked-list"\n                reference: "Stats"\n' +
+    '                values: [ "Health": { amount: -1 } ]',
+  'type: "remove-state"\n                name: "Poisoned"\n                character: "Saniyah"'
+];
+
+// A chapter and group whose nodes chain through next-node, each with
+// dialogue, events, code and, last, a choice
+function generateStory(nodeCount) {
+  const parts = [
+    'states [\n    "Poisoned"\n]\n\n',
+    'global-vars [\n    "Money": {\n        type: "float"\n        default: 30.0\n    }\n]\n\n',
+    'chapter 1 {\n    name: "C"\n}\n'
+  ];
+  
+  parts.push('group 1 {\n    chapter: 1\n    name: "G"\n    nodes: {\n' +
+             `        start: 1,\n        end: ${nodeCount},\n        points: {\n`);
+  for (let i = 1; i < nodeCount; i++) {
+    parts.push(`            ${i}: [ ${i + 1} ]\n`);
+  }
+  parts.push('        }\n    }\n}\n');
+  
+  for (let i = 1; i <= nodeCount; i++) {
+    parts.push(`node ${i} {\n    title: "Node ${i}"\n    content: "Generated"\n    timeline: {\n`);
+    for (let j = 1; j <= 4; j++) {
+      parts.push(`        dialogue ${j} {\n            Saniyah : "Line ${j} of node ${i}"\n` +
+                 '            Caroline : "And the answer, with ünïcödé"\n        }\n');
+      parts.push(`        action ${j} {\n            type: "event"\n            data: {\n` +
+                 `                ${EVENTS[(i + j) % EVENTS.length]}\n            }\n        }\n`);
+    }
+    parts.push('        action 5 {\n            type: "code"\n            <! tick(); !>\n        }\n' +
+               '        action 6 {\n            type: "choice"\n        }\n' +
+               '    }\n}\n');
+  }
+  
+  return parts.join('');
+}
+
+function eventAction(number, eventType) {
+  const data = createActionData(ActionType.EVENT, eventType);
+  if (eventType === EventType.ADJUST_VARIABLE) {
+    data.name = 'Money';
+    data.increment = number;
+  }
+  return { type: ActionType.EVENT, number, 'action-type': ActionType.EVENT, data };
+}
+
+// The JavaScript parser does not read the options of a choice, so every
+// choice without them gets CHOICE_OPTIONS, each adjusting a variable and
+// moving to the next node
+function fillChoices(storyData) {
+  let count = 0;
+  
+  for (const node of storyData.nodes) {
+    for (const item of node.timeline) {
+      if (item['action-type'] !== ActionType.CHOICE || (item.data.choice && item.data.choice.options)) continue;
+      
+      const options = [];
+      for (let k = 0; k < CHOICE_OPTIONS; k++) {
+        options.push({
+          text: `Option ${k + 1}`,
+          actions: [eventAction(k + 1, EventType.ADJUST_VARIABLE), eventAction(k + 2, EventType.NEXT_NODE)]
+        });
+      }
+      item.data.choice = { options };
+      count++;
+    }
+  }
+  
+  return count;
+}
+
+// Chapter, group and node the engine starts at: the first group and its
+// start node, or the first node
+function startPoint(storyData) {
+  const group = storyData.groups[0];
+  if (group && group.nodes) return [group['chapter-id'], group.id, group.nodes['start-node']];
+  const chapter = storyData.chapters[0];
+  return [chapter ? chapter.id : null, group ? group.id : null, storyData.nodes[0].id];
+}
+
+// ============================================================================
+// MEASUREMENT
+// ============================================================================
+
+function forceGc() {
+  if (global.gc) global.gc();
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.ceil(p * sorted.length) - 1)];
+}
+
+function summarize(samples) {
+  const sorted = [...samples].sort((a, b) => a - b);
+  const n = sorted.length;
+  const mean = sorted.reduce((sum, x) => sum + x, 0) / n;
+  const variance = n > 1 ? sorted.reduce((sum, x) => sum + (x - mean) ** 2, 0) / (n - 1) : 0;
+  const stddev = Math.sqrt(variance);
+  
+  return {
+    runs: n,
+    median: n % 2 ? sorted[(n - 1) / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2,
+    mean,
+    stddev,
+    ci95: 1.96 * stddev / Math.sqrt(n),
+    p95: percentile(sorted, 0.95),
+    min: sorted[0],
+    max: sorted[n - 1]
+  };
+}
+
+// Milliseconds of each timed run of fn, after the warmup runs
+function time(fn, options) {
+  for (let i = 0; i < options.warmup; i++) fn();
+  
+  const samples = [];
+  for (let i = 0; i < options.runs; i++) {
+    forceGc();
+    const start = performance.now();
+    fn();
+    samples.push(performance.now() - start);
+  }
+  return summarize(samples);
+}
+
+// Heap used while parsing, sampled at every progress report, above the
+// heap in use before; and the heap still held by the parsed story
+function measureHeap(source) {
+  const parser = new SDCParser();
+  forceGc();
+  const baseline = v8.getHeapStatistics().used_heap_size;
+  let peak = baseline;
+  
+  const sample = () => {
+    const used = v8.getHeapStatistics().used_heap_size;
+    if (used > peak) peak = used;
+  };
+  const storyData = parser.parse(source, sample);
+  sample();
+  
+  forceGc();
+  const retained = v8.getHeapStatistics().used_heap_size - baseline;
+  return { peakMB: (peak - baseline) / 1e6, retainedMB: retained / 1e6, nodes: storyData.nodes.length };
+}
+
+// Steps from the start to the end of the story with execute(), taking
+// choices in turn
+function walkExecute(engine, start) {
+  let steps = 0;
+  let choices = 0;
+  engine.start(...start);
+  
+  while (steps < MAX_STEPS) {
+    const result = engine.execute();
+    steps++;
+    if (result.type === 'end') break;
+    if (engine.isAwaitingChoice()) engine.selectChoice(choices++ % CHOICE_OPTIONS);
+  }
+  return steps;
+}
+
+let sinkSteps = 0;
+function countStep(kind, item) {
+  sinkSteps++;
+}
+
+function walkExecuteUntil(engine, start) {
+  let choices = 0;
+  sinkSteps = 0;
+  engine.start(...start);
+  
+  while (sinkSteps < MAX_STEPS) {
+    const kind = engine.executeUntil(0, countStep);
+    if (kind === StepKind.END) break;
+    if (engine.isAwaitingChoice()) engine.selectChoice(choices++ % CHOICE_OPTIONS);
+  }
+  return sinkSteps;
+}
+
+// Microseconds from selectChoice() to the result of the option's actions,
+// for every choice of a walk through the story
+function choiceLatencies(engine, start, samples) {
+  let steps = 0;
+  let choices = 0;
+  engine.start(...start);
+  
+  while (steps < MAX_STEPS) {
+    const result = engine.execute();
+    steps++;
+    if (result.type === 'end') break;
+    if (!engine.isAwaitingChoice()) continue;
+    
+    const begin = performance.now();
+    engine.selectChoice(choices++ % CHOICE_OPTIONS);
+    const resolved = engine.execute();
+    samples.push((performance.now() - begin) * 1000);
+    steps++;
+    if (resolved.type === 'end') break;
+  }
+}
+
+function benchmarkStory(name, source, options) {
+  const parser = new SDCParser();
+  const megabytes = Buffer.byteLength(source, 'utf8') / 1e6;
+  
+  const parse = time(() => parser.parse(source), options);
+  const heap = measureHeap(source);
+  
+  const storyData = parser.parse(source);
+  const choiceCount = fillChoices(storyData);
+  const engine = new StoryEngine(storyData);
+  const start = startPoint(storyData);
+  
+  const steps = walkExecute(engine, start);
+  const execute = time(() => walkExecute(engine, start), options);
+  const executeUntil = time(() => walkExecuteUntil(engine, start), options);
+  
+  const latencies = [];
+  for (let i = 0; i < options.warmup; i++) choiceLatencies(engine, start, []);
+  for (let i = 0; i < options.runs; i++) choiceLatencies(engine, start, latencies);
+  
+  return {
+    story: { name, megabytes, nodes: heap.nodes, choices: choiceCount },
+    parse: { ms: parse, mbPerSecond: megabytes / (parse.median / 1000), peakHeapMB: heap.peakMB,
+             retainedHeapMB: heap.retainedMB },
+    execute: { steps, ms: execute, stepsPerSecond: steps / (execute.median / 1000) },
+    executeUntil: { steps, ms: executeUntil, stepsPerSecond: steps / (executeUntil.median / 1000) },
+    choice: { us: latencies.length > 0 ? summarize(latencies) : null }
+  };
+}
+
+// ============================================================================
+// REPORTING
+// ============================================================================
+
+function formatStats(stats, unit) {
+  return `${stats.median.toFixed(2)} ${unit} median  ±${stats.ci95.toFixed(2)}  ` +
+         `(sd ${stats.stddev.toFixed(2)}, p95 ${stats.p95.toFixed(2)}, ` +
+         `${stats.min.toFixed(2)}-${stats.max.toFixed(2)}, n=${stats.runs})`;
+}
+
+function printResult(result) {
+  const { story, parse, execute, executeUntil, choice } = result;
+  console.log(`\n${story.name}: ${story.megabytes.toFixed(2)} MB, ${story.nodes} nodes, ${story.choices} choices`);
+  console.log(`  parse         ${parse.mbPerSecond.toFixed(1).padStart(8)} MB/s       ${formatStats(parse.ms, 'ms')}`);
+  console.log(`                peak heap ${parse.peakHeapMB.toFixed(1)} MB, retained ${parse.retainedHeapMB.toFixed(1)} MB`);
+  console.log(`  execute       ${(execute.stepsPerSecond / 1e6).toFixed(2).padStart(8)} M steps/s  ` +
+              formatStats(execute.ms, 'ms'));
+  console.log(`  executeUntil  ${(executeUntil.stepsPerSecond / 1e6).toFixed(2).padStart(8)} M steps/s  ` +
+              formatStats(executeUntil.ms, 'ms'));
+  if (choice.us) console.log(`  choice        ${formatStats(choice.us, 'us')}`);
+}
+
+// Headline figures, higher is better unless lowerIsBetter
+const HEADLINES = [
+  { label: 'parse MB/s', read: r => r.parse.mbPerSecond },
+  { label: 'parse peak heap MB', read: r => r.parse.peakHeapMB, lowerIsBetter: true },
+  { label: 'execute steps/s', read: r => r.execute.stepsPerSecond },
+  { label: 'executeUntil steps/s', read: r => r.executeUntil.stepsPerSecond },
+  { label: 'choice median us', read: r => r.choice.us && r.choice.us.median, lowerIsBetter: true }
+];
+
+function printComparison(results, file) {
+  const previous = JSON.parse(fs.readFileSync(file, 'utf8'));
+  if (previous.version !== RESULTS_VERSION) {
+    console.error(`${file}: results version ${previous.version}, expected ${RESULTS_VERSION}`);
+    return;
+  }
+  
+  console.log(`\nChange from ${file} (${previous.date}, Node ${previous.environment.node}):`);
+  for (const result of results) {
+    const before = previous.results.find(r => r.story.name === result.story.name);
+    if (!before) continue;
+    
+    console.log(`  ${result.story.name}`);
+    for (const { label, read, lowerIsBetter } of HEADLINES) {
+      const a = read(before);
+      const b = read(result);
+      if (!a || !b) continue;
+      const change = (b / a - 1) * 100;
+      const better = lowerIsBetter ? change < 0 : change > 0;
+      console.log(`    ${label.padEnd(22)} ${a.toPrecision(4).padStart(10)} -> ${b.toPrecision(4).padStart(10)}  ` +
+                  `${change >= 0 ? '+' : ''}${change.toFixed(1)}%${Math.abs(change) >= 1 ? (better ? ' better' : ' worse') : ''}`);
+    }
+  }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+const options = parseOptions(process.argv.slice(2));
+if (!global.gc) console.warn('Run with node --expose-gc to collect garbage between runs');
+
+const results = [];
+for (const scale of options.scales) {
+  results.push(benchmarkStory(`generated-${scale}`, generateStory(scale), options));
+  printResult(results[results.length - 1]);
+}
+for (const file of options.stories) {
+  results.push(benchmarkStory(path.basename(file), fs.readFileSync(file, 'utf8'), options));
+  printResult(results[results.length - 1]);
+}
+
+if (options.compare) printComparison(results, options.compare);
+
+if (options.out) {
+  const report = {
+    version: RESULTS_VERSION,
+    date: new Date().toISOString(),
+    environment: {
+      node: process.versions.node,
+      v8: process.versions.v8,
+      platform: `${os.platform()} ${os.release()}`,
+      arch: os.arch(),
+      cpu: os.cpus()[0] ? os.cpus()[0].model : null,
+      cpus: os.cpus().length,
+      exposeGc: !!global.gc
+    },
+    options: { runs: options.runs, warmup: options.warmup },
+    maxRssMB: process.resourceUsage().maxRSS / 1024,
+    results
+  };
+  fs.writeFileSync(options.out, JSON.stringify(report, null, 2) + '\n');
+  console.log(`\nWrote ${options.out}`);
+}
@@ -0,0 +1,64 @@
+/**
+ * Binary story image checks
+ * Run from the js directory: node test/binary_test.js
+ * Encodes __StoryStructure.sdc with toBinary, opens it again with
+ * loadBinary from an ArrayBuffer, a file and a SharedArrayBuffer read by
+ * a second thread, and compares each with SDCParser.parse.
+ */
+
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { Worker } from 'worker_threads';
+import { SDCParser, BinaryStory } from '../sdc_parser.js';
+
+const source = fs.readFileSync(new URL('./__StoryStructure.sdc', import.meta.url), 'utf8');
+const parser = new SDCParser();
+const storyData = parser.parse(source);
+const expected = JSON.stringify(storyData);
+let failures = 0;
+
+function check(name, passed) {
+  console.log(`${passed ? 'PASS' : 'FAIL'}  ${name}`);
+  if (!passed) failures++;
+}
+
+// ArrayBuffer
+const image = parser.toBinary(storyData);
+const story = parser.loadBinary(image);
+check('image is a BinaryStory', story instanceof BinaryStory);
+check('image matches parse()', JSON.stringify(story) === expected);
+check('lookups work on records', parser.getGroup(story, story.groups[0].id) === story.groups[0]);
+check('re-encoding gives the same image',
+      Buffer.compare(Buffer.from(parser.toBinary(story)), Buffer.from(image)) === 0);
+
+// A file read back as a Node Buffer, a view into a larger buffer
+const file = path.join(os.tmpdir(), `sdc_binary_test_${process.pid}.sdcb`);
+fs.writeFileSync(file, new Uint8Array(image));
+const padded = Buffer.concat([Buffer.alloc(3), fs.readFileSync(file)]);
+fs.unlinkSync(file);
+check('file matches parse()', JSON.stringify(parser.loadBinary(padded.subarray(3))) === expected);
+
+// SharedArrayBuffer, opened by another thread without copying
+const shared = parser.toBinary(storyData, { shared: true });
+check('shared image matches parse()', JSON.stringify(parser.loadBinary(shared)) === expected);
+
+const worker = new Worker(`
+  const { parentPort, workerData } = require('worker_threads');
+  const { SDCParser } = require(workerData.parser);
+  const story = new SDCParser().loadBinary(workerData.image);
+  parentPort.postMessage(JSON.stringify(story));
+`, { eval: true, workerData: { parser: new URL('../sdc_parser.js', import.meta.url).pathname, image: shared } });
+const fromWorker = await new Promise((resolve, reject) => {
+  worker.once('message', resolve);
+  worker.once('error', reject);
+});
+check('worker reads the shared image', fromWorker === expected);
+
+// Damaged images are refused
+const truncated = parser.loadBinary(image.slice(0, image.byteLength - 16));
+check('truncated image is refused', truncated === null && parser.getError() !== null);
+check('text is refused', parser.loadBinary(new TextEncoder().encode(source)) === null);
+
+console.log(failures === 0 ? '\nAll binary story checks passed' : `\n${failures} binary story check(s) failed`);
+process.exitCode = failures === 0 ? 0 : 1;
@@ -0,0 +1,119 @@
+/**
+ * Story engine benchmarks: execute() against executeUntil()
+ * Run from the js directory: node test/engine_bench.js [scale]
+ */
+
+import { PerformanceObserver } from "node:perf_hooks";
+import { SDCParser } from "../sdc_parser.js";
+import { StoryEngine, StepKind } from "../sdc_engine.js";
+
+// Collections seen since the last takeGcStats call
+let gcCount = 0;
+let gcTime = 0;
+const gcObserver = new PerformanceObserver(list => {
+  for (const entry of list.getEntries()) {
+    gcCount++;
+    gcTime += entry.duration;
+  }
+});
+gcObserver.observe({ entryTypes: ['gc'] });
+
+// GC entries are delivered asynchronously, so let them arrive first
+async function takeGcStats() {
+  await new Promise(resolve => setTimeout(resolve, 0));
+  const stats = { count: gcCount, time: gcTime };
+  gcCount = 0;
+  gcTime = 0;
+  return stats;
+}
+
+// Event bodies cycled through the timelines
+const EVENTS = [
+  'type: "adjust-variable"\n                name: "Money"\n                increment: 1',
+  'type: "add-state"\n                name: "Poisoned"\n                character: "Saniyah"',
+  'type: "linked-list"\n                reference: "Stats"\n' +
+    '                values: [ "Health": { amount: -1 } ]',
+  'type: "remove-state"\n                name: "Poisoned"\n                character: "Saniyah"'
+];
+
+// One group whose nodes chain through next-node events, each with
+// dialogue, several kinds of events and code
+function generateStory(nodeCount) {
+  const parts = ['chapter 1 {\n    name: "C"\n}\n'];
+  
+  parts.push('group 1 {\n    chapter: 1\n    name: "G"\n    nodes: {\n' +
+             `        start: 1,\n        end: ${nodeCount},\n        points: {\n`);
+  for (let i = 1; i < nodeCount; i++) {
+    parts.push(`            ${i}: [ ${i + 1} ]\n`);
+  }
+  parts.push('        }\n    }\n}\n');
+  
+  for (let i = 1; i <= nodeCount; i++) {
+    parts.push(`node ${i} {\n    title: "N"\n    timeline: {\n`);
+    for (let j = 1; j <= 4; j++) {
+      parts.push(`        dialogue ${j} {\n            Saniyah : "a"\n            Caroline : "b"\n        }\n`);
+      parts.push(`        action ${j} {\n            type: "event"\n            data: {\n` +
+                 `                ${EVENTS[(i + j) % EVENTS.length]}\n            }\n        }\n`);
+    }
+    parts.push('        action 5 {\n            type: "code"\n            <! tick(); !>\n        }\n' +
+               '        action 6 {\n            type: "event"\n            data: {\n' +
+               '                type: "next-node"\n            }\n        }\n' +
+               '    }\n}\n');
+  }
+  
+  return parts.join('');
+}
+
+// Steps from the start of the story to its end, one execute() at a time
+function runExecute(engine) {
+  let steps = 0;
+  let result;
+  engine.start(1, 1, 1);
+  do {
+    result = engine.execute();
+    steps++;
+  } while (result.type !== 'end');
+  return steps;
+}
+
+// The same walk in executeUntil batches, counting steps in the sink
+let sinkSteps = 0;
+function countStep(kind, item) {
+  sinkSteps++;
+}
+
+function runExecuteUntil(engine) {
+  sinkSteps = 0;
+  engine.start(1, 1, 1);
+  while (engine.executeUntil(0, countStep) !== StepKind.END) {}
+  return sinkSteps;
+}
+
+async function runBenchmark(name, engine, run, iterations) {
+  let best = Infinity;
+  let steps = 0;
+  
+  // Warm up the JIT before timing
+  run(engine);
+  await takeGcStats();
+  
+  for (let i = 0; i < iterations; i++) {
+    const start = performance.now();
+    steps = run(engine);
+    const elapsed = performance.now() - start;
+    if (elapsed < best) best = elapsed;
+  }
+  
+  const gc = await takeGcStats();
+  console.log(`${name.padEnd(14)} ${steps.toString().padStart(9)} steps  ` +
+              `${best.toFixed(2).padStart(8)} ms  ` +
+              `${(steps / (best / 1000) / 1e6).toFixed(2).padStart(7)} M steps/s  ` +
+              `${(gc.count / iterations).toFixed(1).padStart(6)} GCs  ` +
+              `${(gc.time / iterations).toFixed(2).padStart(7)} ms GC per run`);
+}
+
+const scale = parseInt(process.argv[2], 10) || 20000;
+const engine = new StoryEngine(new SDCParser().parse(generateStory(scale)));
+
+await runBenchmark('execute', engine, runExecute, 10);
+await runBenchmark('executeUntil', engine, runExecuteUntil, 10);
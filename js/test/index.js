@@ -1,6 +1,9 @@
 import { SDCParser } from "../sdc_parser.js";
+import { WasmSDCParser } from "../sdc_wasm.js";
 
-const parser = new SDCParser();
+// With --wasm the same checks run on the WebAssembly build of the C parser
+// (c/build_wasm.sh or c/build_wasm.bat), whose output should match
+const parser = process.argv.includes("--wasm") ? await WasmSDCParser.load() : new SDCParser();
 
 // Parse the full __StoryStructure.sdc content
 const data = parser.parse(`
@@ -0,0 +1,118 @@
+/**
+ * parseStream checks
+ * Run from the js directory: node test/stream_test.js
+ * Streams stories in chunks of several sizes, as bytes and as text,
+ * through Node streams and ReadableStream, and compares the result and
+ * errors with SDCParser.parse.
+ */
+
+import fs from 'fs';
+import { Readable } from 'stream';
+import { SDCParser } from '../sdc_parser.js';
+
+const source = fs.readFileSync(new URL('./__StoryStructure.sdc', import.meta.url), 'utf8');
+const parser = new SDCParser();
+let failures = 0;
+
+function check(name, passed) {
+  console.log(`${passed ? 'PASS' : 'FAIL'}  ${name}`);
+  if (!passed) failures++;
+}
+
+// The UTF-8 bytes of text in chunks of size bytes, so multi-byte
+// characters are split between chunks
+function byteChunks(text, size) {
+  const bytes = new TextEncoder().encode(text);
+  const chunks = [];
+  for (let i = 0; i < bytes.length; i += size) chunks.push(bytes.subarray(i, i + size));
+  return chunks;
+}
+
+function textChunks(text, size) {
+  const chunks = [];
+  for (let i = 0; i < text.length; i += size) chunks.push(text.substring(i, i + size));
+  return chunks;
+}
+
+function webStream(chunks) {
+  return new ReadableStream({
+    start(controller) {
+      for (const chunk of chunks) controller.enqueue(chunk);
+      controller.close();
+    }
+  });
+}
+
+// Whether streaming text in every chunking gives what parse() gives
+// for reference, by default the text itself
+async function matchesParse(text, reference = text) {
+  const expected = JSON.stringify(parser.parse(reference));
+  const expectedError = parser.getError();
+  
+  for (const size of [3, 61, 4096]) {
+    // Tiny chunks only through a Node stream, as ReadableStream takes
+    // tens of microseconds a chunk
+    const streams = [Readable.from(byteChunks(text, size))];
+    if (size > 3) streams.push(webStream(textChunks(text, size)));
+    
+    for (const stream of streams) {
+      const result = await parser.parseStream(stream);
+      if (JSON.stringify(result) !== expected || parser.getError() !== expectedError) return false;
+    }
+  }
+  return true;
+}
+
+const quiet = console.error;
+console.error = () => {};
+
+// Stories long enough to be parsed in several pieces
+const body = source.repeat(Math.ceil(200000 / source.length));
+const tricky = '# comment { [ "\n' + source.replace(/Saniyah/g, 'Sañiyah ✓ 🙂') +
+               '\nnode 99 { title: "x" # } ]\n content: "<! { !>" timeline: { action 1 {\n' +
+               'type: "code"\n <! if (a) { "b" } !>\n } } }\n';
+check('story matches parse()', await matchesParse(body));
+check('unicode, comments and code blocks', await matchesParse(tricky.repeat(20)));
+check('declarations sharing lines',
+      await matchesParse('chapter 1 { name: "A" } chapter 2\n{\nname: "B"\n}\nstray chapter 3 { name: "C" }\n'.repeat(3000)));
+
+// Errors keep the line and column of the whole source
+const broken = body + '\nnode 2 {\n    title: "x"\n    timeline: {\n        dialogue 1 {\n            A : \n';
+check('parse error matches parse()', await matchesParse(broken));
+check('tokenization error matches parse()', await matchesParse(body + '\nchapter 5 { name: "A" ; }\n'));
+check('unterminated string matches parse()', await matchesParse(body + '\nchapter 5 { name: "A }\n'));
+
+// parse() tokenizes everything first, so it reports the '$' far after
+// the parse error on line 2; the stream stops at the parse error
+const early = 'node 1 {\n    timeline: { dialogue 1 { A : 5 } }\n}\n' + body;
+parser.parse(early + '\nchapter 5 { name: "A" $ }\n');
+check('parse() reports the later tokenization error', parser.getError().startsWith('Tokenization error'));
+check('first error in the source', await matchesParse(early + '\nchapter 5 { name: "A" $ }\n', early));
+
+console.error = quiet;
+
+// A large story is usable before the stream ends
+const large = source.repeat(200);
+const total = parser.parse(large).nodes.length;
+const seen = [];
+const story = await parser.parseStream(Readable.from(byteChunks(large, 16384)), {
+  onUpdate: storyData => seen.push(storyData.nodes.length)
+});
+check('large story matches parse()', JSON.stringify(story) === JSON.stringify(parser.parse(large)));
+check('nodes available before the end', seen.length > 1 && seen[0] > 0 && seen[0] < total);
+
+// Failing stops reading the stream
+let pulled = 0;
+const failing = new ReadableStream({
+  pull(controller) {
+    pulled++;
+    controller.enqueue(pulled === 1 ? 'chapter 1 { name: }\n' + ' '.repeat(1 << 17) + '\n' : source);
+  }
+});
+console.error = () => {};
+check('error resolves to null', await parser.parseStream(failing) === null && parser.getError() !== null);
+console.error = quiet;
+check('stream is cancelled after an error', pulled < 5);
+
+console.log(failures === 0 ? '\nAll parseStream checks passed' : `\n${failures} parseStream check(s) failed`);
+process.exitCode = failures === 0 ? 0 : 1;
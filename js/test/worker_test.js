@@ -0,0 +1,51 @@
+/**
+ * parseAsync checks
+ * Run from the js directory: node test/worker_test.js
+ * Parses in a worker, with structured clone and with binary transfer, and
+ * compares each result with SDCParser.parse.
+ */
+
+import fs from 'fs';
+import { SDCParser, BinaryStory } from '../sdc_parser.js';
+
+const source = fs.readFileSync(new URL('./__StoryStructure.sdc', import.meta.url), 'utf8');
+const parser = new SDCParser();
+const expected = JSON.stringify(parser.parse(source));
+let failures = 0;
+
+function check(name, passed) {
+  console.log(`${passed ? 'PASS' : 'FAIL'}  ${name}`);
+  if (!passed) failures++;
+}
+
+// Structured clone
+const cloned = await parser.parseAsync(source, { transfer: 'clone' });
+check('clone matches parse()', JSON.stringify(cloned) === expected);
+
+// Binary transfer, read through BinaryStory
+const story = await parser.parseAsync(source, { transfer: 'binary' });
+check('binary result is a BinaryStory', story instanceof BinaryStory);
+check('binary matches parse()', JSON.stringify(story) === expected);
+check('records are read once', story.nodes[0].timeline === story.nodes[0].timeline);
+check('lookups work on records', parser.getNode(story, story.nodes[0].id) === story.nodes[0]);
+
+// Large sources are transferred as binary by default, and report progress
+const large = source.repeat(Math.ceil((1 << 21) / source.length));
+const phases = new Set();
+const largeStory = await parser.parseAsync(large, { onProgress: phase => phases.add(phase) });
+check('large source comes back binary', largeStory instanceof BinaryStory);
+check('large source matches parse()', JSON.stringify(largeStory) === JSON.stringify(parser.parse(large)));
+check('progress reported for lex and parse', phases.has('lex') && phases.has('parse'));
+
+// Errors resolve to null and set the error, as parse() does
+const failed = await parser.parseAsync('node 1 { title: }');
+check('error resolves to null', failed === null && parser.getError() !== null);
+
+// Aborting stops the worker
+const controller = new AbortController();
+const aborted = parser.parseAsync(large, { signal: controller.signal });
+controller.abort(new Error('stopped'));
+check('abort rejects', await aborted.then(() => false, error => error.message === 'stopped'));
+
+console.log(failures === 0 ? '\nAll parseAsync checks passed' : `\n${failures} parseAsync check(s) failed`);
+process.exitCode = failures === 0 ? 0 : 1;
@@ -0,0 +1,275 @@
+/**
+ * Keyword table generator
+ * Reads tools/keywords.txt and writes a minimal perfect hash for keyword
+ * classification into the C and JS lexers, between the
+ * BEGIN/END GENERATED KEYWORDS markers.
+ *
+ * Usage: node tools/gen_keywords.js [--check]
+ *   --check  exit with status 1 if either file is out of date
+ *
+ * Lookup: the key packs the first, second and last characters with the
+ * length (unique across the keyword set, checked here), then
+ * slot = scale(spread(key ^ displacement[key % buckets]), count), where
+ * spread is one multiply and scale maps 32 bits onto [0, count) with a
+ * multiply-high instead of a division.
+ * Constant-time hash, one table probe, one string compare.
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+const ROOT = path.join(__dirname, '..');
+const KEYWORD_FILE = path.join(__dirname, 'keywords.txt');
+const C_FILE = path.join(ROOT, 'c', 'src', 'sdc_parser.c');
+const JS_FILE = path.join(ROOT, 'js', 'sdc_parser.js');
+
+const BEGIN_MARKER = '// BEGIN GENERATED KEYWORDS';
+const END_MARKER = '// END GENERATED KEYWORDS';
+
+// ============================================================================
+// HASHING (must match the emitted C and JS)
+// ============================================================================
+
+function keywordKey(text) {
+  const length = text.length;
+  return (text.charCodeAt(0) |
+          (length > 1 ? text.charCodeAt(1) : 0) << 8 |
+          text.charCodeAt(length - 1) << 16 |
+          (length & 0xFF) << 24) >>> 0;
+}
+
+function slotOf(key, displacement, count) {
+  const spread = Math.imul((key ^ displacement) >>> 0, 0x9e3779b1) >>> 0;
+  return Math.floor(spread * count / 4294967296);
+}
+
+// ============================================================================
+// TABLE CONSTRUCTION
+// ============================================================================
+
+function readKeywords() {
+  const keywords = [];
+  const lines = fs.readFileSync(KEYWORD_FILE, 'utf8').split(/\r?\n/);
+  
+  for (const raw of lines) {
+    const line = raw.trim();
+    if (line === '' || line.startsWith('#')) continue;
+    
+    const [text, token] = line.split(/\s+/);
+    if (!/^[a-z][a-z0-9_-]*$/.test(text) || !/^[A-Z_]+$/.test(token || '')) {
+      throw new Error(`Invalid keyword line: ${raw}`);
+    }
+    if (keywords.some(k => k.text === text)) {
+      throw new Error(`Duplicate keyword: ${text}`);
+    }
+    
+    const key = keywordKey(text);
+    const clash = keywords.find(k => k.key === key);
+    if (clash) {
+      throw new Error(`Keywords '${clash.text}' and '${text}' share a hash key`);
+    }
+    keywords.push({ text, token, key });
+  }
+  
+  return keywords;
+}
+
+// Hash and displace: place the largest buckets first, searching for a
+// displacement that sends every member of the bucket to a free slot
+function buildTable(keywords) {
+  const count = keywords.length;
+  const bucketCount = Math.max(1, Math.ceil(count / 2));
+  
+  const buckets = Array.from({ length: bucketCount }, (_, index) => ({ index, members: [] }));
+  for (const keyword of keywords) {
+    buckets[keyword.key % bucketCount].members.push(keyword);
+  }
+  buckets.sort((a, b) => b.members.length - a.members.length || a.index - b.index);
+  
+  const slots = new Array(count).fill(null);
+  const displacements = new Array(bucketCount).fill(0);
+  
+  for (const bucket of buckets) {
+    if (bucket.members.length === 0) continue;
+    
+    let found = false;
+    for (let d = 0; d < 0x10000 && !found; d++) {
+      const chosen = bucket.members.map(k => slotOf(k.key, d, count));
+      const distinct = new Set(chosen).size === chosen.length;
+      if (distinct && chosen.every(slot => slots[slot] === null)) {
+        chosen.forEach((slot, i) => { slots[slot] = bucket.members[i]; });
+        displacements[bucket.index] = d;
+        found = true;
+      }
+    }
+    
+    if (!found) throw new Error('No displacement found; adjust the bucket count');
+  }
+  
+  return { count, bucketCount, slots, displacements };
+}
+
+// ============================================================================
+// EMITTERS
+// ============================================================================
+
+function wrap(values, indent, width) {
+  const lines = [];
+  for (let i = 0; i < values.length; i += width) {
+    lines.push(indent + values.slice(i, i + width).join(', ') + ',');
+  }
+  lines[lines.length - 1] = lines[lines.length - 1].slice(0, -1);
+  return lines.join('\n');
+}
+
+function emitC(table) {
+  const displacementType = Math.max(...table.displacements) > 0xFF ? 'uint16_t' : 'uint8_t';
+  const entries = table.slots.map(k =>
+    `    { ${JSON.stringify(k.text)}, ${k.text.length}, TOKEN_${k.token} }`);
+  
+  return `${BEGIN_MARKER}
+// Generated by tools/gen_keywords.js from tools/keywords.txt; do not edit.
+
+#define KEYWORD_COUNT ${table.count}
+#define KEYWORD_BUCKETS ${table.bucketCount}
+
+
+static const ${displacementType} keyword_displacements[KEYWORD_BUCKETS] = {
+${wrap(table.displacements.map(String), '    ', 16)}
+};
+
+static const struct {
+    const char* text;
+    int length;
+    TokenType type;
+} keyword_table[KEYWORD_COUNT] = {
+${entries.join(',\n')}
+};
+
+static inline uint64_t keyword_load64(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t keyword_load32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Compare with overlapping head/tail loads that stay inside both strings
+static inline bool keyword_equal(const char* a, const char* b, int length) {
+    if (length >= 8) {
+        for (int i = 0; i + 8 < length; i += 8) {
+            if (keyword_load64(a + i) != keyword_load64(b + i)) return false;
+        }
+        return keyword_load64(a + length - 8) == keyword_load64(b + length - 8);
+    }
+    if (length >= 4) {
+        return keyword_load32(a) == keyword_load32(b) &&
+               keyword_load32(a + length - 4) == keyword_load32(b + length - 4);
+    }
+    for (int i = 0; i < length; i++) {
+        if (a[i] != b[i]) return false;
+    }
+    return true;
+}
+
+// Classify an identifier of length >= 1
+static TokenType keyword_lookup(const char* start, int length) {
+    uint32_t key = (uint32_t)(unsigned char)start[0] |
+                   (uint32_t)(length > 1 ? (unsigned char)start[1] : 0) << 8 |
+                   (uint32_t)(unsigned char)start[length - 1] << 16 |
+                   (uint32_t)(length & 0xFF) << 24;
+    uint32_t spread = (key ^ keyword_displacements[key % KEYWORD_BUCKETS]) * 0x9e3779b1u;
+    uint32_t slot = (uint32_t)(((uint64_t)spread * KEYWORD_COUNT) >> 32);
+    
+    if (keyword_table[slot].length == length &&
+        keyword_equal(keyword_table[slot].text, start, length)) {
+        return keyword_table[slot].type;
+    }
+    return TOKEN_IDENTIFIER;
+}
+${END_MARKER}`;
+}
+
+function emitJS(table) {
+  const texts = table.slots.map(k => `  '${k.text}'`);
+  const types = table.slots.map(k => `  TokenType.${k.token}`);
+  
+  return `${BEGIN_MARKER}
+// Generated by tools/gen_keywords.js from tools/keywords.txt; do not edit.
+
+const KEYWORD_COUNT = ${table.count};
+const KEYWORD_BUCKETS = ${table.bucketCount};
+
+const KEYWORD_DISPLACEMENTS = new Uint16Array([
+${wrap(table.displacements.map(String), '  ', 16)}
+]);
+
+const KEYWORD_TEXTS = [
+${texts.join(',\n')}
+];
+
+const KEYWORD_TYPES = [
+${types.join(',\n')}
+];
+
+/**
+ * Classify source.substring(start, end), which must not be empty
+ * @returns {number} Keyword token type or TokenType.IDENTIFIER
+ */
+function keywordLookup(source, start, end) {
+  const length = end - start;
+  const key = (source.charCodeAt(start) |
+               (length > 1 ? source.charCodeAt(start + 1) : 0) << 8 |
+               source.charCodeAt(end - 1) << 16 |
+               (length & 0xFF) << 24) >>> 0;
+  const spread = Math.imul((key ^ KEYWORD_DISPLACEMENTS[key % KEYWORD_BUCKETS]) >>> 0, 0x9e3779b1) >>> 0;
+  const slot = Math.floor(spread * KEYWORD_COUNT / 4294967296);
+  const text = KEYWORD_TEXTS[slot];
+  if (text.length === length && source.startsWith(text, start)) {
+    return KEYWORD_TYPES[slot];
+  }
+  return TokenType.IDENTIFIER;
+}
+${END_MARKER}`;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+function replaceRegion(file, generated, check) {
+  const source = fs.readFileSync(file, 'utf8');
+  const begin = source.indexOf(BEGIN_MARKER);
+  const end = source.indexOf(END_MARKER);
+  if (begin < 0 || end < begin) {
+    throw new Error(`${file}: missing generated keyword markers`);
+  }
+  
+  const updated = source.slice(0, begin) + generated + source.slice(end + END_MARKER.length);
+  if (updated === source) return true;
+  if (check) return false;
+  
+  fs.writeFileSync(file, updated);
+  console.log(`Updated ${path.relative(ROOT, file)}`);
+  return true;
+}
+
+function main() {
+  const check = process.argv.includes('--check');
+  const keywords = readKeywords();
+  const table = buildTable(keywords);
+  
+  const cCurrent = replaceRegion(C_FILE, emitC(table), check);
+  const jsCurrent = replaceRegion(JS_FILE, emitJS(table), check);
+  
+  if (check && !(cCurrent && jsCurrent)) {
+    console.error('Generated keyword tables are out of date; run node tools/gen_keywords.js');
+    process.exit(1);
+  }
+}
+
+main();
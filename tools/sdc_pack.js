@@ -0,0 +1,35 @@
+/**
+ * Binary story packer
+ * Parses a .sdc file and writes it as a binary story image, which
+ * SDCParser.loadBinary() opens without tokenizing.
+ *
+ * Usage: node tools/sdc_pack.js <story.sdc> [story.sdcb]
+ *   The output defaults to the input path with the extension .sdcb.
+ */
+
+const fs = require('fs');
+const path = require('path');
+
+const { SDCParser } = require(path.join(__dirname, '..', 'js', 'sdc_parser.js'));
+
+function main() {
+  const input = process.argv[2];
+  if (!input) {
+    console.error('Usage: node tools/sdc_pack.js <story.sdc> [story.sdcb]');
+    process.exit(2);
+  }
+  const output = process.argv[3] || path.join(path.dirname(input), path.basename(input, path.extname(input)) + '.sdcb');
+  
+  const parser = new SDCParser();
+  const storyData = parser.parse(fs.readFileSync(input, 'utf8'));
+  if (!storyData) {
+    console.error(`${input}: ${parser.getError()}`);
+    process.exit(1);
+  }
+  
+  const image = parser.toBinary(storyData);
+  fs.writeFileSync(output, new Uint8Array(image));
+  console.log(`${output}: ${image.byteLength} bytes`);
+}
+
+main();